@@ -90,6 +90,18 @@
 /* Define to 1 if you have the 'flock' function. */
 #cmakedefine HAVE_FLOCK 1
 
+/* Define to 1 if you have the 'mmap' function. */
+#cmakedefine HAVE_MMAP 1
+
+/* Define to 1 if you have the 'fsync' function. */
+#cmakedefine HAVE_FSYNC 1
+
+/* Define to 1 if you have the 'ftruncate' function. */
+#cmakedefine HAVE_FTRUNCATE 1
+
+/* Define to 1 if you have the 'realpath' function. */
+#cmakedefine HAVE_REALPATH 1
+
 /* Define to 1 if you have the 'strlcpy' function. */
 #cmakedefine HAVE_LIBC_STRLCPY 1
 
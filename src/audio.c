@@ -27,21 +27,88 @@ bool bSoundWorking = false;			/* Is sound OK */
 static volatile bool bPlayingBuffer = false;	/* Is playing buffer? */
 int SoundBufferSize = 1024 / 4;			/* Size of sound buffer (in samples) */
 int SdlAudioBufferSize = 0;			/* in ms (0 = use default) */
+bool bAudioOffline = false;			/* Render sound only for recording, without audio device */
 int pulse_swallowing_count = 0;			/* Sound disciplined emulation rate controlled by  */
 						/*  window comparator and pulse swallowing counter */
 
+/* Without sound sync, the audio callback reads the samples a little bit
+ * faster or slower than at their nominal rate (at most 10 cents, see the
+ * comment in Audio_CallBack()), to keep the amount of buffered samples
+ * around the target latency when host and emulation clocks drift apart.
+ */
+#define AUDIO_RATE_ONE		0x10000		/* Read step for unaltered rate, 16.16 fixed point */
+#define AUDIO_RATE_MAX_DEV	380		/* (2^(10cents/1200cents) - 1) * AUDIO_RATE_ONE */
+
+static Uint32 nAudioPhase;			/* Fractional part of the read position */
+static int nAudioFillAvg;			/* Smoothed amount of buffered samples, 28.4 fixed point */
+static int nAudioFillErrSum;			/* Accumulated difference from target latency */
+static bool bAudioRefill = true;		/* Wait for target latency before playing */
+
+/* Only updated by the audio callback, see Audio_GetStats() */
+static AUDIO_STATS AudioStats;
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Return the read step for the next audio callback, based on how much
+ * the buffered samples average differs from the target latency.
+ *
+ * Proportional part reacts within a few seconds, and the slowly
+ * accumulating part takes over a constant clock drift, so that the
+ * buffered amount settles at the target instead of somewhere off it.
+ */
+static int Audio_AdaptRate(int nAvailable, int nTarget)
+{
+	const int nSumMax = nTarget * 256;
+	int nErr, nDev;
+
+	/* Samples are produced in bursts (per VBL or register write),
+	 * so don't react to single callbacks */
+	nAudioFillAvg += ((nAvailable << 4) - nAudioFillAvg) >> 3;
+	nErr = (nAudioFillAvg >> 4) - nTarget;
+
+	nAudioFillErrSum += nErr;
+	if (nAudioFillErrSum > nSumMax)
+		nAudioFillErrSum = nSumMax;
+	else if (nAudioFillErrSum < -nSumMax)
+		nAudioFillErrSum = -nSumMax;
+
+	/* full deviation at quarter target error, or when the sum is at its limit */
+	nDev = 4 * nErr * AUDIO_RATE_MAX_DEV / nTarget
+	       + (Sint64)nAudioFillErrSum * AUDIO_RATE_MAX_DEV / nSumMax;
+	if (nDev > AUDIO_RATE_MAX_DEV)
+		nDev = AUDIO_RATE_MAX_DEV;
+	else if (nDev < -AUDIO_RATE_MAX_DEV)
+		nDev = -AUDIO_RATE_MAX_DEV;
+	return AUDIO_RATE_ONE + nDev;
+}
+
 /*-----------------------------------------------------------------------*/
 /**
  * SDL audio callback function - copy emulation sound to audio system.
+ *
+ * AudioMixBuffer[] is a single producer / single consumer ring: only
+ * Sound_Update() advances AudioMixBuffer_nWritten and only this function
+ * advances AudioMixBuffer_nRead, so no lock is needed between them.
  */
 static void Audio_CallBack(void *userdata, Uint8 *stream, int len)
 {
 	Sint16 *pBuffer;
-	int i, window, nSamplesPerFrame;
+	Sint16 *s0, *s1;
+	Uint32 nRead, nFirst, nPhase;
+	int i, idx, window, nSamplesPerFrame, nTarget, nMaxFill;
+	int nAvailable, nNeeded, nStep;
 
 	pBuffer = (Sint16 *)stream;
 	len = len / 4;  // Use length in samples (16 bit stereo), not in bytes
 
+	/* Atomic read of the write counter guarantees that the samples
+	 * before it have been completely written by the emulation thread */
+	nRead = SDL_AtomicGet(&AudioMixBuffer_nRead);
+	nAvailable = (Uint32)SDL_AtomicGet(&AudioMixBuffer_nWritten) - nRead;
+
+	nSamplesPerFrame = nAudioFrequency/nScreenRefreshRate;
+	nTarget = SoundBufferSize + nSamplesPerFrame;
+
 	/* Adjust emulation rate within +/- 0.58% (10 cents) occasionally,
 	 * to synchronize sound. Note that an octave (frequency doubling)
 	 * has 12 semitones (12th root of two for a semitone), and that
@@ -53,58 +120,109 @@ static void Audio_CallBack(void *userdata, Uint8 *stream, int len)
 	 * See: main.c - Main_WaitOnVbl()
 	 */
 
-//fprintf ( stderr , "audio cb in len=%d gensmpl=%d idx=%d\n" , len , nGeneratedSamples , AudioMixBuffer_pos_read );
+//fprintf ( stderr , "audio cb in len=%d avail=%d read=%u\n" , len , nAvailable , nRead );
+	AudioStats.nCallbacks++;
+	i = nAvailable * 4 / nTarget;
+	AudioStats.FillHisto[i < AUDIO_FILL_HISTO_SIZE ? i : AUDIO_FILL_HISTO_SIZE - 1]++;
+
 	pulse_swallowing_count = 0;	/* 0 = Unaltered emulation rate */
+	nStep = AUDIO_RATE_ONE;		/* Unaltered sound rate */
 
 	if (ConfigureParams.Sound.bEnableSoundSync)
 	{
 		/* Sound synchronized emulation */
-		nSamplesPerFrame = nAudioFrequency/nScreenRefreshRate;
 		window = (nSamplesPerFrame > SoundBufferSize) ? nSamplesPerFrame : SoundBufferSize;
 
 		/* Window Comparator for SoundBufferSize */
-		if (nGeneratedSamples < window + (window >> 1))
+		if (nAvailable < window + (window >> 1))
 		/* Increase emulation rate to maintain sound synchronization */
 			pulse_swallowing_count = -5793 / nScreenRefreshRate;
 		else
-		if (nGeneratedSamples > (window << 1) + (window >> 2))
+		if (nAvailable > (window << 1) + (window >> 2))
 		/* Decrease emulation rate to maintain sound synchronization */
 			pulse_swallowing_count = 5793 / nScreenRefreshRate;
 
 		/* Otherwise emulation rate is unaltered. */
 	}
 
-	if (nGeneratedSamples >= len)
+	/* Far too many samples (fast forward, or audio device stalled):
+	 * they can't be caught up with the small rate changes, so skip
+	 * to the most recent ones */
+	nMaxFill = 3 * nTarget;
+	if (nMaxFill > AUDIOMIXBUFFER_SIZE - nSamplesPerFrame)
+		nMaxFill = AUDIOMIXBUFFER_SIZE - nSamplesPerFrame;
+	if (nAvailable > nMaxFill)
 	{
-		/* Enough samples available: Pass completed buffer to audio system
-		 * by write samples into sound buffer and by converting them from
-		 * 'signed' to 'unsigned' */
+		AudioStats.nSkips++;
+		AudioStats.nSkipped += nAvailable - nTarget;
+		nRead += nAvailable - nTarget;
+		nAvailable = nTarget;
+		nAudioFillAvg = nTarget << 4;
+		nAudioFillErrSum = 0;
+		nAudioPhase = 0;
+	}
+	nFirst = nRead;
+
+	/* After running out of samples (pause, turbo mode, slow system),
+	 * wait until there are enough of them again for the target latency */
+	if (bAudioRefill && nAvailable >= nTarget)
+	{
+		bAudioRefill = false;
+		nAudioFillAvg = nAvailable << 4;
+	}
+
+	/* Without sound sync, sound rate follows the emulation one */
+	if (!ConfigureParams.Sound.bEnableSoundSync && !bAudioRefill)
+		nStep = Audio_AdaptRate(nAvailable, nTarget);
+
+	/* Last output sample is interpolated from the sample at this offset and the next one */
+	nNeeded = ((nAudioPhase + (Uint32)(len - 1) * nStep) >> 16) + 2;
+
+	if (bAudioRefill)
+	{
+		AudioStats.nRefills++;
+		memset(pBuffer, 0, len * 4);
+	}
+	else if (nAvailable >= nNeeded)
+	{
+		/* Enough samples available: Pass completed buffer to audio system,
+		 * interpolating them linearly for the adjusted rate */
+		idx = nRead & AUDIOMIXBUFFER_SIZE_MASK;
+		nPhase = nAudioPhase;
 		for (i = 0; i < len; i++)
 		{
-			*pBuffer++ = AudioMixBuffer[(AudioMixBuffer_pos_read + i) & AUDIOMIXBUFFER_SIZE_MASK][0];
-			*pBuffer++ = AudioMixBuffer[(AudioMixBuffer_pos_read + i) & AUDIOMIXBUFFER_SIZE_MASK][1];
+			s0 = AudioMixBuffer[idx];
+			s1 = AudioMixBuffer[(idx + 1) & AUDIOMIXBUFFER_SIZE_MASK];
+			*pBuffer++ = s0[0] + (((s1[0] - s0[0]) * (int)(nPhase >> 4)) >> 12);
+			*pBuffer++ = s0[1] + (((s1[1] - s0[1]) * (int)(nPhase >> 4)) >> 12);
+			nPhase += nStep;
+			idx = (idx + (nPhase >> 16)) & AUDIOMIXBUFFER_SIZE_MASK;
+			nRead += nPhase >> 16;
+			nPhase &= 0xffff;
 		}
-		AudioMixBuffer_pos_read += len;
-		nGeneratedSamples -= len;
+		nAudioPhase = nPhase;
 	}
 	else  /* Not enough samples available: */
 	{
-		for (i = 0; i < nGeneratedSamples; i++)
+		for (i = 0; i < nAvailable; i++)
 		{
-			*pBuffer++ = AudioMixBuffer[(AudioMixBuffer_pos_read + i) & AUDIOMIXBUFFER_SIZE_MASK][0];
-			*pBuffer++ = AudioMixBuffer[(AudioMixBuffer_pos_read + i) & AUDIOMIXBUFFER_SIZE_MASK][1];
+			*pBuffer++ = AudioMixBuffer[(nRead + i) & AUDIOMIXBUFFER_SIZE_MASK][0];
+			*pBuffer++ = AudioMixBuffer[(nRead + i) & AUDIOMIXBUFFER_SIZE_MASK][1];
 		}
 		/* Clear rest of the buffer to ensure we don't play random bytes instead */
 		/* of missing samples */
-		memset(pBuffer, 0, (len - nGeneratedSamples) * 4);
+		memset(pBuffer, 0, (len - nAvailable) * 4);
 
-		AudioMixBuffer_pos_read += nGeneratedSamples;
-		nGeneratedSamples = 0;
-		
+		nRead += nAvailable;
+		nAudioPhase = 0;
+		bAudioRefill = true;
+		AudioStats.nUnderruns++;
 	}
 
-	AudioMixBuffer_pos_read = AudioMixBuffer_pos_read & AUDIOMIXBUFFER_SIZE_MASK;
-//fprintf ( stderr , "audio cb out len=%d gensmpl=%d idx=%d\n" , len , nGeneratedSamples , AudioMixBuffer_pos_read );
+	/* Hand the consumed part of the ring back to the emulation thread */
+	AudioStats.nConsumed += nRead - nFirst;
+	SDL_AtomicSet(&AudioMixBuffer_nRead, nRead);
+//fprintf ( stderr , "audio cb out len=%d step=%d read=%u\n" , len , nStep , nRead );
 }
 
 
@@ -126,6 +244,15 @@ void Audio_Init(void)
 		return;
 	}
 
+	/* Offline rendering: samples are only recorded to WAV/AVI files,
+	 * as fast as emulation runs, so there's no audio device to feed */
+	if (bAudioOffline)
+	{
+		Log_Printf(LOG_DEBUG, "Sound: Offline rendering\n");
+		bSoundWorking = false;
+		return;
+	}
+
 	/* Init the SDL's audio subsystem: */
 	if (SDL_WasInit(SDL_INIT_AUDIO) == 0)
 	{
@@ -210,7 +337,8 @@ void Audio_UnInit(void)
  */
 void Audio_Lock(void)
 {
-	SDL_LockAudio();
+	if (bSoundWorking)
+		SDL_LockAudio();
 }
 
 
@@ -220,7 +348,8 @@ void Audio_Lock(void)
  */
 void Audio_Unlock(void)
 {
-	SDL_UnlockAudio();
+	if (bSoundWorking)
+		SDL_UnlockAudio();
 }
 
 
@@ -285,3 +414,15 @@ void Audio_EnableAudio(bool bEnable)
 		bPlayingBuffer = false;
 	}
 }
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Copy the audio callback statistics. They're updated by the audio
+ * thread without locking, so the copy is only a consistent snapshot
+ * of each individual counter, which is good enough for monitoring.
+ */
+void Audio_GetStats(AUDIO_STATS *pStats)
+{
+	*pStats = AudioStats;
+}
@@ -20,10 +20,20 @@
      and much less disk bandwidth. Compression levels 3 or 4 give good
      tradeoff between cpu usage and file size and should not slow down Hatari
      with recent computers.
+   - ZMBV : lossless codec from DOSBox. Only the 16x16 blocks that changed
+     since the previous frame are stored, then compressed with zlib's fastest
+     level. This needs much less cpu than PNG and gives smaller files for
+     most demos and games, as only a small part of the screen changes
+     between 2 frames.
 
   PNG compression will often give a x20 ratio when compared to BMP and should
   be used if you have a powerful enough cpu.
 
+  Video frames are copied to a queue in the emulation thread, then encoded by
+  other threads (PNG frames are compressed in parallel, ZMBV frames in order
+  by a single thread). Encoded frames and their audio are written to the file
+  in the emulation thread, in the order they were recorded.
+
   Sound is saved as 16 bits pcm stereo, using the current Hatari sound output
   frequency. For best accuracy, sound frequency should be a multiple of the
   video frequency (to get an integer number of samples per frame) ; this means
@@ -62,7 +72,7 @@
 	INFO
       LIST
 	movi
-	  00db
+	  00db (or 00dc for compressed frames)
 	  01wb
 	  ...
 	  ix00
@@ -100,6 +110,9 @@ const char AVIRecord_fileid[] = "Hatari avi_record.c";
 #if HAVE_LIBPNG
 #include <png.h>
 #endif
+#if HAVE_ZLIB_H
+#include <zlib.h>
+#endif
 
 #include "pixel_convert.h"				/* inline functions */
 
@@ -150,6 +163,7 @@ typedef struct
 
 #define AVI_INDEX_OF_INDEXES	0x00			/* Possibles values for index_type */
 #define AVI_INDEX_OF_CHUNKS	0x01
+#define AVI_INDEX_DELTA_FRAME	0x80000000		/* Set in the size of an index entry for non keyframes */
 
 typedef struct
 {
@@ -353,6 +367,7 @@ typedef struct {
 
 #define	VIDEO_STREAM_RGB			0x00000000		/* fourcc for BMP video frames */
 #define	VIDEO_STREAM_PNG			"MPNG"			/* fourcc for PNG video frames */
+#define	VIDEO_STREAM_ZMBV			"ZMBV"			/* fourcc for ZMBV video frames */
 
 #define	AVIF_HASINDEX				0x00000010		/* index at the end of the file */
 #define	AVIF_ISINTERLEAVED			0x00000100		/* data are interleaved */
@@ -370,6 +385,36 @@ typedef struct {
 
 
 
+#define	AVI_ENCODE_QUEUE_SIZE			8			/* Max number of video frames waiting to be encoded / written */
+#define	AVI_ENCODE_THREADS_MAX			4			/* Max number of threads compressing video frames in parallel */
+
+#define	AVI_ENCODE_SLOT_FREE			0
+#define	AVI_ENCODE_SLOT_QUEUED			1			/* waiting for an encoder thread */
+#define	AVI_ENCODE_SLOT_ENCODING		2
+#define	AVI_ENCODE_SLOT_DONE			3			/* waiting to be written to the file */
+
+#define	AVI_ZMBV_FLAG_KEYFRAME			0x01
+#define	AVI_ZMBV_FORMAT_32BPP			8
+#define	AVI_ZMBV_BLOCK_SIZE			16			/* 16x16 pixels blocks */
+#define	AVI_ZMBV_KEYFRAME_INTERVAL		300			/* Store a full frame every 300 frames */
+
+typedef struct {
+  int		State;					/* AVI_ENCODE_SLOT_xxx */
+  SDL_Surface	*Frame;					/* copy of the (cropped) screen */
+
+  Uint8		*VideoData;				/* encoded video frame */
+  int		VideoSize;
+  int		VideoAllocSize;
+  bool		KeyFrame;
+  bool		VideoError;
+
+  Uint8		*AudioData;				/* pcm audio frame to write after the video frame */
+  int		AudioSamples;				/* -1 if no audio frame */
+  int		AudioAllocSize;
+} RECORD_AVI_ENCODE_SLOT;
+
+
+
 typedef struct {
   /* Input params to start recording */
   int		VideoCodec;
@@ -412,6 +457,28 @@ typedef struct {
   int			AviFrameIndex_AllocSize;	/* Number of elements allocated in *pAviFrameIndex */
   int			AviFrameIndex_Count;		/* Number of elements used in *pAviFrameIndex (must be <AllocSize) */
 
+  /* Video frames are encoded by other threads, then written in order */
+  SDL_Thread		*EncodeThreads[ AVI_ENCODE_THREADS_MAX ];
+  int			EncodeThreadsCount;
+  SDL_mutex		*EncodeMutex;
+  SDL_cond		*EncodeCond;
+  bool			EncodeQuit;
+  RECORD_AVI_ENCODE_SLOT	EncodeQueue[ AVI_ENCODE_QUEUE_SIZE ];
+  int			EncodeQueueHead;		/* oldest frame in the queue, next one to be written */
+  int			EncodeQueueCount;
+  RECORD_AVI_ENCODE_SLOT	AudioSlot;		/* for audio frames written without a video frame */
+
+#if HAVE_ZLIB_H
+  /* ZMBV encoder state */
+  z_stream		ZmbvStream;
+  bool			ZmbvStreamInit;
+  int			ZmbvFrameCount;
+  int			ZmbvBlocks;
+  Uint8			*ZmbvCurFrame;			/* 32 bits BGRX pixels */
+  Uint8			*ZmbvPrevFrame;
+  Uint8			*ZmbvWork;			/* uncompressed frame data */
+#endif
+
 } RECORD_AVI_PARAMS;
 
 
@@ -448,11 +515,23 @@ static bool	Avi_CreateNewMoviChunk ( RECORD_AVI_PARAMS *pAviParams , AVI_FILE_HE
 
 static int	Avi_GetBmpSize ( int Width , int Height , int BitCount );
 
-static bool	Avi_RecordVideoStream_BMP ( RECORD_AVI_PARAMS *pAviParams );
+static bool	Avi_EncodeSlot_Reserve ( RECORD_AVI_ENCODE_SLOT *pSlot , int Size );
+static bool	Avi_EncodeFrame_BMP ( RECORD_AVI_PARAMS *pAviParams , RECORD_AVI_ENCODE_SLOT *pSlot );
 #if HAVE_LIBPNG
-static bool	Avi_RecordVideoStream_PNG ( RECORD_AVI_PARAMS *pAviParams );
+static bool	Avi_EncodeFrame_PNG ( RECORD_AVI_PARAMS *pAviParams , RECORD_AVI_ENCODE_SLOT *pSlot );
+#endif
+#if HAVE_ZLIB_H
+static bool	Avi_EncodeFrame_ZMBV ( RECORD_AVI_PARAMS *pAviParams , RECORD_AVI_ENCODE_SLOT *pSlot );
 #endif
-static bool	Avi_RecordAudioStream_PCM ( RECORD_AVI_PARAMS *pAviParams , Sint16 pSamples[][2], int SampleIndex, int SampleLength );
+static bool	Avi_EncodeFrame ( RECORD_AVI_PARAMS *pAviParams , RECORD_AVI_ENCODE_SLOT *pSlot );
+static int	Avi_EncodeThread ( void *data );
+static bool	Avi_StartEncoders ( RECORD_AVI_PARAMS *pAviParams );
+static void	Avi_StopEncoders ( RECORD_AVI_PARAMS *pAviParams );
+
+static bool	Avi_WriteAudioFrame ( RECORD_AVI_PARAMS *pAviParams , Uint8 *pPcm , int SampleLength );
+static bool	Avi_WriteEncodedSlot ( RECORD_AVI_PARAMS *pAviParams , RECORD_AVI_ENCODE_SLOT *pSlot );
+static bool	Avi_WriteEncodedFrames ( RECORD_AVI_PARAMS *pAviParams , bool WaitAll );
+static void	Avi_ConvertAudio_PCM ( Uint8 *pPcm , Sint16 pSamples[][2] , int SampleIndex , int SampleLength );
 
 static void	Avi_BuildFileHeader ( RECORD_AVI_PARAMS *pAviParams , AVI_FILE_HEADER *pAviFileHeader );
 
@@ -642,6 +721,8 @@ static	bool	Avi_WriteMoviIndex ( RECORD_AVI_PARAMS *pAviParams , AVI_FILE_HEADER
 			Avi_Store4cc ( IndexChunk.chunk_id , "00db" );
 		else if ( pAviParams->VideoCodec == AVI_RECORD_VIDEO_CODEC_PNG )
 			Avi_Store4cc ( IndexChunk.chunk_id , "00dc" );
+		else if ( pAviParams->VideoCodec == AVI_RECORD_VIDEO_CODEC_ZMBV )
+			Avi_Store4cc ( IndexChunk.chunk_id , "00dc" );
 		Avi_StoreU64 ( IndexChunk.base_offset , pAviParams->VideoFrames_Base_Offset );
 		*pDuration = pAviParams->AviFrameIndex_Count;			/* For video super index, duration=entries_in_use */
 	}
@@ -877,236 +958,672 @@ static int	Avi_GetBmpSize ( int Width , int Height , int BitCount )
 }
 
 
-static bool	Avi_RecordVideoStream_BMP ( RECORD_AVI_PARAMS *pAviParams )
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Make sure the encoded data buffer of a slot can hold at least Size bytes
+ */
+static bool	Avi_EncodeSlot_Reserve ( RECORD_AVI_ENCODE_SLOT *pSlot , int Size )
 {
-	AVI_CHUNK	Chunk;
-	int		SizeImage;
+	Uint8	*mem;
+
+	if ( Size <= pSlot->VideoAllocSize )
+		return true;
+
+	mem = realloc ( pSlot->VideoData , Size );
+	if ( mem == NULL )
+		return false;
+	pSlot->VideoData = mem;
+	pSlot->VideoAllocSize = Size;
+	return true;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Convert a screen copy to a BMP frame : 24 bits BGR pixels, stored
+ * from bottom to top (origin is in bottom left corner)
+ */
+static bool	Avi_EncodeFrame_BMP ( RECORD_AVI_PARAMS *pAviParams , RECORD_AVI_ENCODE_SLOT *pSlot )
+{
+	SDL_Surface	*Frame = pSlot->Frame;
 	Uint8		*pBitmapIn , *pBitmapOut;
-	int		y, src_y;
-	int		NeedLock;
-	Uint8		*LineBuf = alloca(3 * pAviParams->Width);		/* temp buffer to convert to 24-bit BGR format */
+	int		y , src_y;
 
-	SizeImage = Avi_GetBmpSize ( pAviParams->Width , pAviParams->Height , pAviParams->BitCount );
+	if ( Avi_EncodeSlot_Reserve ( pSlot , Avi_GetBmpSize ( pAviParams->Width , pAviParams->Height , pAviParams->BitCount ) ) == false )
+		return false;
 
-	/* Write the video frame header */
-	Avi_Store4cc ( Chunk.ChunkName , "00db" );				/* stream 0, uncompressed DIB bytes */
-	Avi_StoreU32 ( Chunk.ChunkSize , SizeImage );				/* max size of RGB image */
-	if ( fwrite ( &Chunk , sizeof ( Chunk ) , 1 , pAviParams->FileOut ) != 1 )
+	pBitmapOut = pSlot->VideoData;
+	for ( y=0 ; y<pAviParams->Height ; y++ )
 	{
-		perror ( "Avi_RecordVideoStream_BMP" );
-		Log_AlertDlg ( LOG_ERROR, "AVI recording : failed to write bmp frame header" );
-		return false;
+		/* the screen size can have changed since recording started */
+		src_y = Frame->h - 1 - ( y * Frame->h + pAviParams->Height/2 ) / pAviParams->Height;
+		if ( src_y < 0 )
+			src_y = 0;
+		pBitmapIn = (Uint8 *)Frame->pixels + Frame->pitch * src_y;
+		switch ( Frame->format->BytesPerPixel ) {
+		 case 2:
+			PixelConvert_16to24Bits_BGR(pBitmapOut, (Uint16 *)pBitmapIn, pAviParams->Width, Frame);
+			break;
+		 case 4:
+			PixelConvert_32to24Bits_BGR(pBitmapOut, (Uint32 *)pBitmapIn, pAviParams->Width, Frame);
+			break;
+		 default:
+			abort();
+		}
+		pBitmapOut += pAviParams->Width * 3;
 	}
 
+	pSlot->VideoSize = pAviParams->Width * pAviParams->Height * 3;
+	pSlot->KeyFrame = true;
+	return true;
+}
+
 
-	/* Write the video frame data */
-	NeedLock = SDL_MUSTLOCK( pAviParams->Surface );
 
+#if HAVE_LIBPNG
+/*-----------------------------------------------------------------------*/
+/**
+ * Compress a screen copy to a PNG frame
+ */
+static bool	Avi_EncodeFrame_PNG ( RECORD_AVI_PARAMS *pAviParams , RECORD_AVI_ENCODE_SLOT *pSlot )
+{
+	SCREENSNAPSHOT_PNG_BUFFER	PngBuf;
+	int				SizeImage;
+
+	PngBuf.Data = pSlot->VideoData;
+	PngBuf.Size = 0;
+	PngBuf.AllocSize = pSlot->VideoAllocSize;
+
+	SizeImage = ScreenSnapShot_SavePNG_ToBuffer ( pSlot->Frame ,
+		pAviParams->Width , pAviParams->Height , &PngBuf ,
+		pAviParams->VideoCodecCompressionLevel , PNG_FILTER_NONE );
+
+	pSlot->VideoData = PngBuf.Data;
+	pSlot->VideoAllocSize = PngBuf.AllocSize;
+	pSlot->VideoSize = PngBuf.Size;
+	pSlot->KeyFrame = true;
+	return SizeImage > 0;
+}
+#endif  /* HAVE_LIBPNG */
+
+
+
+#if HAVE_ZLIB_H
+/*-----------------------------------------------------------------------*/
+/**
+ * Compress a screen copy to a ZMBV frame (DOSBox capture codec, supported
+ * by most players). Every AVI_ZMBV_KEYFRAME_INTERVAL frames, we store
+ * a keyframe with the whole image. Other frames only store the blocks
+ * that changed since the previous frame, xor'ed with the previous frame
+ * (we don't search for motion vectors, this is not worth the cpu for
+ * emulated screens).
+ * All frames share the same zlib stream, which is reset on each keyframe,
+ * so frames must be compressed one after the other, in order.
+ */
+static bool	Avi_EncodeFrame_ZMBV ( RECORD_AVI_PARAMS *pAviParams , RECORD_AVI_ENCODE_SLOT *pSlot )
+{
+	SDL_Surface	*Frame = pSlot->Frame;
+	z_stream	*pStream = &pAviParams->ZmbvStream;
+	int		Pitch = pAviParams->Width * 4;
+	Uint8		*pCur , *pPrev , *pOut , *pVectors;
+	int		x , y , bx , by , bw , bh;
+	int		InSize , HeaderSize;
+	int		ret;
+
+	/* Convert the frame to 32 bits BGRX pixels */
+	pCur = pAviParams->ZmbvCurFrame;
 	for ( y=0 ; y<pAviParams->Height ; y++ )
 	{
-		if ( NeedLock )
-			SDL_LockSurface ( pAviParams->Surface );
-
-		/* Points to the top left pixel after cropping borders. For BMP
-		 * format, frame is stored from bottom to top (origin is in
-		 * bottom left corner) and bytes are in BGR order (not RGB) */
-		src_y = pAviParams->Surface->h - 1 - pAviParams->CropTop - pAviParams->CropBottom;
-		src_y = src_y - (y * (src_y + 1) + pAviParams->Height/2) / pAviParams->Height;
-		pBitmapIn = (Uint8 *)pAviParams->Surface->pixels
-			+ pAviParams->Surface->pitch * src_y
-			+ pAviParams->CropLeft * pAviParams->Surface->format->BytesPerPixel;
-
-		pBitmapOut = LineBuf;
-		switch ( pAviParams->Surface->format->BytesPerPixel ) {
+		int src_y = ( y * Frame->h + pAviParams->Height/2 ) / pAviParams->Height;
+		Uint8 *pIn = (Uint8 *)Frame->pixels + Frame->pitch * ( src_y < Frame->h ? src_y : Frame->h - 1 );
+		switch ( Frame->format->BytesPerPixel ) {
 		 case 2:
-			PixelConvert_16to24Bits_BGR(LineBuf, (Uint16 *)pBitmapIn, pAviParams->Width, pAviParams->Surface);
+			PixelConvert_16to32Bits_BGRX(pCur + y * Pitch, (Uint16 *)pIn, pAviParams->Width, Frame);
 			break;
 		 case 4:
-			PixelConvert_32to24Bits_BGR(LineBuf, (Uint32 *)pBitmapIn, pAviParams->Width, pAviParams->Surface);
+			PixelConvert_32to32Bits_BGRX(pCur + y * Pitch, (Uint32 *)pIn, pAviParams->Width, Frame);
 			break;
 		 default:
 			abort();
 		}
+	}
 
-		if ( NeedLock )
-			SDL_UnlockSurface ( pAviParams->Surface );
+	pSlot->KeyFrame = ( pAviParams->ZmbvFrameCount % AVI_ZMBV_KEYFRAME_INTERVAL ) == 0;
+	pAviParams->ZmbvFrameCount++;
 
-		if ( (int)fwrite ( pBitmapOut , 1 , pAviParams->Width*3 , pAviParams->FileOut ) != pAviParams->Width*3 )
-		{
-			perror ( "Avi_RecordVideoStream_BMP" );
-			Log_AlertDlg ( LOG_ERROR, "AVI recording : failed to write bmp video frame" );
+	if ( Avi_EncodeSlot_Reserve ( pSlot , 1024 ) == false )
+		return false;
+	pOut = pSlot->VideoData;
+
+	if ( pSlot->KeyFrame )
+	{
+		pOut[0] = AVI_ZMBV_FLAG_KEYFRAME;
+		pOut[1] = 0;							/* version 0.1 */
+		pOut[2] = 1;
+		pOut[3] = 1;							/* zlib compression */
+		pOut[4] = AVI_ZMBV_FORMAT_32BPP;
+		pOut[5] = AVI_ZMBV_BLOCK_SIZE;
+		pOut[6] = AVI_ZMBV_BLOCK_SIZE;
+		HeaderSize = 7;
+
+		if ( deflateReset ( pStream ) != Z_OK )
 			return false;
+		pStream->next_in = pCur;
+		InSize = Pitch * pAviParams->Height;
+	}
+	else
+	{
+		pOut[0] = 0;
+		HeaderSize = 1;
+
+		/* For each block : 2 bytes for the motion vector (always 0) */
+		/* and the 'xor data follow' flag, then the xor data of */
+		/* all the changed blocks */
+		pPrev = pAviParams->ZmbvPrevFrame;
+		pVectors = pAviParams->ZmbvWork;
+		InSize = ( pAviParams->ZmbvBlocks * 2 + 3 ) & ~3;
+		memset ( pVectors , 0 , InSize );
+
+		for ( by=0 ; by<pAviParams->Height ; by+=AVI_ZMBV_BLOCK_SIZE )
+		{
+			bh = pAviParams->Height - by < AVI_ZMBV_BLOCK_SIZE ? pAviParams->Height - by : AVI_ZMBV_BLOCK_SIZE;
+			for ( bx=0 ; bx<Pitch ; bx+=AVI_ZMBV_BLOCK_SIZE*4 )
+			{
+				bw = Pitch - bx < AVI_ZMBV_BLOCK_SIZE*4 ? Pitch - bx : AVI_ZMBV_BLOCK_SIZE*4;
+
+				for ( y=by ; y<by+bh ; y++ )
+					if ( memcmp ( pCur + y * Pitch + bx , pPrev + y * Pitch + bx , bw ) != 0 )
+						break;
+
+				if ( y < by+bh )					/* block changed */
+				{
+					*pVectors = 1;
+					for ( y=by ; y<by+bh ; y++ )
+						for ( x=bx ; x<bx+bw ; x++ )
+							pAviParams->ZmbvWork[ InSize++ ] = pCur[ y * Pitch + x ] ^ pPrev[ y * Pitch + x ];
+				}
+				pVectors += 2;
+			}
 		}
+
+		pStream->next_in = pAviParams->ZmbvWork;
+	}
+	pStream->avail_in = InSize;
+
+	/* Compress, growing the output buffer if needed */
+	pSlot->VideoSize = HeaderSize;
+	do
+	{
+		if ( pSlot->VideoAllocSize - pSlot->VideoSize < 1024 )
+			if ( Avi_EncodeSlot_Reserve ( pSlot , 2 * pSlot->VideoAllocSize ) == false )
+				return false;
+
+		pStream->next_out = pSlot->VideoData + pSlot->VideoSize;
+		pStream->avail_out = pSlot->VideoAllocSize - pSlot->VideoSize;
+		ret = deflate ( pStream , Z_SYNC_FLUSH );
+		pSlot->VideoSize = pSlot->VideoAllocSize - pStream->avail_out;
+		if ( ret != Z_OK && ret != Z_BUF_ERROR )
+			return false;
 	}
+	while ( pStream->avail_out == 0 );
 
+	/* Current frame becomes the reference for the next one */
+	pAviParams->ZmbvCurFrame = pAviParams->ZmbvPrevFrame;
+	pAviParams->ZmbvPrevFrame = pCur;
 	return true;
 }
+#endif  /* HAVE_ZLIB_H */
 
 
 
+/*-----------------------------------------------------------------------*/
+/**
+ * Encode the screen copy of a slot with the selected codec
+ */
+static bool	Avi_EncodeFrame ( RECORD_AVI_PARAMS *pAviParams , RECORD_AVI_ENCODE_SLOT *pSlot )
+{
+	if ( pAviParams->VideoCodec == AVI_RECORD_VIDEO_CODEC_BMP )
+		return Avi_EncodeFrame_BMP ( pAviParams , pSlot );
 #if HAVE_LIBPNG
-static bool	Avi_RecordVideoStream_PNG ( RECORD_AVI_PARAMS *pAviParams )
+	else if ( pAviParams->VideoCodec == AVI_RECORD_VIDEO_CODEC_PNG )
+		return Avi_EncodeFrame_PNG ( pAviParams , pSlot );
+#endif
+#if HAVE_ZLIB_H
+	else if ( pAviParams->VideoCodec == AVI_RECORD_VIDEO_CODEC_ZMBV )
+		return Avi_EncodeFrame_ZMBV ( pAviParams , pSlot );
+#endif
+	return false;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Encoder thread main loop : take the oldest queued frame, encode it
+ * and mark it as done, so it can be written by Avi_WriteEncodedFrames().
+ */
+static int	Avi_EncodeThread ( void *data )
 {
-	AVI_CHUNK	Chunk;
-	int		SizeImage;
-	off_t		ChunkPos;
-	Uint8	TempSize[4];
-	
+	RECORD_AVI_PARAMS	*pAviParams = data;
+	RECORD_AVI_ENCODE_SLOT	*pSlot;
+	int			i;
 
-	/* Write the video frame header */
-	ChunkPos = ftello ( pAviParams->FileOut );
-	Avi_Store4cc ( Chunk.ChunkName , "00dc" );				/* stream 0, compressed DIB bytes */
-	Avi_StoreU32 ( Chunk.ChunkSize , 0 );					/* size of PNG image (-> completed later) */
-	if ( fwrite ( &Chunk , sizeof ( Chunk ) , 1 , pAviParams->FileOut ) != 1 )
-		goto png_error;
-
-	/* Write the video frame data */
-	SizeImage = ScreenSnapShot_SavePNG_ToFile(pAviParams->Surface,
-		pAviParams->Width, pAviParams->Height, pAviParams->FileOut,
-		pAviParams->VideoCodecCompressionLevel , PNG_FILTER_NONE ,
-		pAviParams->CropLeft , pAviParams->CropRight , pAviParams->CropTop , pAviParams->CropBottom );
-	if ( SizeImage <= 0 )
-		goto png_error;
-
-	/* Update the size of the video chunk */
-	Avi_StoreU32 ( TempSize , SizeImage );
-	if ( fseeko ( pAviParams->FileOut , ChunkPos+4 , SEEK_SET ) != 0 )
-		goto png_error;
-	if ( fwrite ( TempSize , sizeof ( TempSize ) , 1 , pAviParams->FileOut ) != 1 )
-		goto png_error;
+	SDL_LockMutex ( pAviParams->EncodeMutex );
+	while ( !pAviParams->EncodeQuit )
+	{
+		pSlot = NULL;
+		for ( i=0 ; i<pAviParams->EncodeQueueCount ; i++ )
+		{
+			pSlot = &pAviParams->EncodeQueue[ ( pAviParams->EncodeQueueHead + i ) % AVI_ENCODE_QUEUE_SIZE ];
+			if ( pSlot->State == AVI_ENCODE_SLOT_QUEUED )
+				break;
+			pSlot = NULL;
+		}
+		if ( pSlot == NULL )
+		{
+			SDL_CondWait ( pAviParams->EncodeCond , pAviParams->EncodeMutex );
+			continue;
+		}
 
-	/* Go to the end of the video frame data */
-	if ( fseeko ( pAviParams->FileOut , 0 , SEEK_END ) != 0 )
-		goto png_error;
-	return true;
+		pSlot->State = AVI_ENCODE_SLOT_ENCODING;
+		SDL_UnlockMutex ( pAviParams->EncodeMutex );
 
-png_error:
-	perror ( "Avi_RecordVideoStream_PNG" );
-	Log_AlertDlg ( LOG_ERROR, "AVI recording : failed to write png frame" );
-	return false;
-}
-#endif  /* HAVE_LIBPNG */
+		pSlot->VideoError = !Avi_EncodeFrame ( pAviParams , pSlot );
 
+		SDL_LockMutex ( pAviParams->EncodeMutex );
+		pSlot->State = AVI_ENCODE_SLOT_DONE;
+		SDL_CondBroadcast ( pAviParams->EncodeCond );
+	}
+	SDL_UnlockMutex ( pAviParams->EncodeMutex );
+	return 0;
+}
 
 
-bool	Avi_RecordVideoStream ( void )
+/*-----------------------------------------------------------------------*/
+/**
+ * Start the encoder threads. PNG frames are compressed in parallel, but
+ * ZMBV frames depend on the previous one, so they use a single thread.
+ * If no thread can be started, frames will be encoded when queued.
+ */
+static bool	Avi_StartEncoders ( RECORD_AVI_PARAMS *pAviParams )
 {
-	off_t		Pos_Start , Pos_End;
+	int	Count , i;
 
-	Pos_Start = ftello ( AviParams.FileOut );
-
-	if ( AviParams.VideoCodec == AVI_RECORD_VIDEO_CODEC_BMP )
+#if HAVE_ZLIB_H
+	if ( pAviParams->VideoCodec == AVI_RECORD_VIDEO_CODEC_ZMBV )
 	{
-		if ( Avi_RecordVideoStream_BMP ( &AviParams ) == false )
-		{
+		int FrameSize = pAviParams->Width * pAviParams->Height * 4;
+
+		pAviParams->ZmbvBlocks = ( ( pAviParams->Width + AVI_ZMBV_BLOCK_SIZE - 1 ) / AVI_ZMBV_BLOCK_SIZE )
+				       * ( ( pAviParams->Height + AVI_ZMBV_BLOCK_SIZE - 1 ) / AVI_ZMBV_BLOCK_SIZE );
+		pAviParams->ZmbvCurFrame = calloc ( 1 , FrameSize );
+		pAviParams->ZmbvPrevFrame = calloc ( 1 , FrameSize );
+		pAviParams->ZmbvWork = malloc ( FrameSize + pAviParams->ZmbvBlocks * 2 + 4 );
+		if ( !pAviParams->ZmbvCurFrame || !pAviParams->ZmbvPrevFrame || !pAviParams->ZmbvWork )
 			return false;
-		}
+		if ( deflateInit ( &pAviParams->ZmbvStream , Z_BEST_SPEED ) != Z_OK )
+			return false;
+		pAviParams->ZmbvStreamInit = true;
 	}
-#if HAVE_LIBPNG
-	else if ( AviParams.VideoCodec == AVI_RECORD_VIDEO_CODEC_PNG )
+#endif
+
+	pAviParams->EncodeMutex = SDL_CreateMutex();
+	pAviParams->EncodeCond = SDL_CreateCond();
+	if ( !pAviParams->EncodeMutex || !pAviParams->EncodeCond )
+		return false;
+
+	Count = 1;
+	if ( pAviParams->VideoCodec == AVI_RECORD_VIDEO_CODEC_PNG )
 	{
-		if ( Avi_RecordVideoStream_PNG ( &AviParams ) == false )
+		/* keep one cpu for the emulation */
+		Count = SDL_GetCPUCount() - 1;
+		if ( Count < 1 )
+			Count = 1;
+		else if ( Count > AVI_ENCODE_THREADS_MAX )
+			Count = AVI_ENCODE_THREADS_MAX;
+	}
+
+	pAviParams->EncodeQuit = false;
+	for ( i=0 ; i<Count ; i++ )
+	{
+		pAviParams->EncodeThreads[ i ] = SDL_CreateThread ( Avi_EncodeThread , "avi_encode" , pAviParams );
+		if ( pAviParams->EncodeThreads[ i ] == NULL )
 		{
-			return false;
+			Log_Printf ( LOG_WARN , "AVI recording : failed to start encoder thread: %s\n" , SDL_GetError() );
+			break;
 		}
+		pAviParams->EncodeThreadsCount++;
+	}
+	Log_Printf ( LOG_DEBUG , "AVI recording : using %d encoder thread(s)\n" , pAviParams->EncodeThreadsCount );
+	return true;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Stop the encoder threads (all queued frames must have been written)
+ * and free the encoding buffers
+ */
+static void	Avi_StopEncoders ( RECORD_AVI_PARAMS *pAviParams )
+{
+	int	i;
+
+	if ( pAviParams->EncodeMutex )
+	{
+		SDL_LockMutex ( pAviParams->EncodeMutex );
+		pAviParams->EncodeQuit = true;
+		SDL_CondBroadcast ( pAviParams->EncodeCond );
+		SDL_UnlockMutex ( pAviParams->EncodeMutex );
 	}
+	for ( i=0 ; i<pAviParams->EncodeThreadsCount ; i++ )
+		SDL_WaitThread ( pAviParams->EncodeThreads[ i ] , NULL );
+	pAviParams->EncodeThreadsCount = 0;
+
+	if ( pAviParams->EncodeCond )
+		SDL_DestroyCond ( pAviParams->EncodeCond );
+	if ( pAviParams->EncodeMutex )
+		SDL_DestroyMutex ( pAviParams->EncodeMutex );
+	pAviParams->EncodeCond = NULL;
+	pAviParams->EncodeMutex = NULL;
+
+	for ( i=0 ; i<AVI_ENCODE_QUEUE_SIZE ; i++ )
+	{
+		if ( pAviParams->EncodeQueue[ i ].Frame )
+			SDL_FreeSurface ( pAviParams->EncodeQueue[ i ].Frame );
+		free ( pAviParams->EncodeQueue[ i ].VideoData );
+		free ( pAviParams->EncodeQueue[ i ].AudioData );
+	}
+	free ( pAviParams->AudioSlot.AudioData );
+	memset ( pAviParams->EncodeQueue , 0 , sizeof ( pAviParams->EncodeQueue ) );
+	memset ( &pAviParams->AudioSlot , 0 , sizeof ( pAviParams->AudioSlot ) );
+	pAviParams->EncodeQueueHead = 0;
+	pAviParams->EncodeQueueCount = 0;
+
+#if HAVE_ZLIB_H
+	if ( pAviParams->ZmbvStreamInit )
+		deflateEnd ( &pAviParams->ZmbvStream );
+	pAviParams->ZmbvStreamInit = false;
+	free ( pAviParams->ZmbvCurFrame );
+	free ( pAviParams->ZmbvPrevFrame );
+	free ( pAviParams->ZmbvWork );
+	pAviParams->ZmbvCurFrame = pAviParams->ZmbvPrevFrame = pAviParams->ZmbvWork = NULL;
 #endif
+}
+
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Write an audio frame (already converted to little endian pcm) and
+ * store its index
+ */
+static bool	Avi_WriteAudioFrame ( RECORD_AVI_PARAMS *pAviParams , Uint8 *pPcm , int SampleLength )
+{
+	AVI_CHUNK	Chunk;
+	off_t		Pos_Start;
+
+	Pos_Start = ftello ( pAviParams->FileOut );
+
+	/* Write the audio frame header + data */
+	Avi_Store4cc ( Chunk.ChunkName , "01wb" );				/* stream 1, wave bytes */
+	Avi_StoreU32 ( Chunk.ChunkSize , SampleLength * 4 );			/* 16 bits, stereo -> 4 bytes */
+	if ( fwrite ( &Chunk , sizeof ( Chunk ) , 1 , pAviParams->FileOut ) != 1
+	  || ( SampleLength > 0 && fwrite ( pPcm , SampleLength * 4 , 1 , pAviParams->FileOut ) != 1 ) )
+	{
+		perror ( "Avi_WriteAudioFrame" );
+		Log_AlertDlg ( LOG_ERROR, "AVI recording : failed to write pcm frame" );
+		return false;
+	}
+
+	pAviParams->TotalAudioFrames++;
+	pAviParams->TotalAudioSamples += SampleLength;
+
+	/* Store index for this audio frame */
+	Pos_Start += 8;								/* skip header */
+	return Avi_FrameIndex_Add ( pAviParams , &AviFileHeader , 1 , Pos_Start , SampleLength * 4 );
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Write an encoded video frame, followed by the audio frame that was
+ * recorded after it (if any), and store their index
+ */
+static bool	Avi_WriteEncodedSlot ( RECORD_AVI_PARAMS *pAviParams , RECORD_AVI_ENCODE_SLOT *pSlot )
+{
+	AVI_CHUNK	Chunk;
+	off_t		Pos_Start;
+	Uint32		Length;
+
+	if ( pSlot->VideoError )
+	{
+		Log_AlertDlg ( LOG_ERROR, "AVI recording : failed to encode video frame" );
+		return false;
+	}
+
+	Pos_Start = ftello ( pAviParams->FileOut );
+
+	/* Write the video frame header + data */
+	if ( pAviParams->VideoCodec == AVI_RECORD_VIDEO_CODEC_BMP )
+		Avi_Store4cc ( Chunk.ChunkName , "00db" );			/* stream 0, uncompressed DIB bytes */
 	else
+		Avi_Store4cc ( Chunk.ChunkName , "00dc" );			/* stream 0, compressed DIB bytes */
+	Avi_StoreU32 ( Chunk.ChunkSize , pSlot->VideoSize );
+	if ( fwrite ( &Chunk , sizeof ( Chunk ) , 1 , pAviParams->FileOut ) != 1
+	  || fwrite ( pSlot->VideoData , pSlot->VideoSize , 1 , pAviParams->FileOut ) != 1 )
 	{
+		perror ( "Avi_WriteEncodedSlot" );
+		Log_AlertDlg ( LOG_ERROR, "AVI recording : failed to write video frame" );
 		return false;
 	}
 
-	Pos_End = ftello ( AviParams.FileOut );
-	AviParams.TotalVideoFrames++;
+	pAviParams->TotalVideoFrames++;
 
 	/* Store index for this video frame */
 	Pos_Start += 8;								/* skip header */
-	if ( Avi_FrameIndex_Add ( &AviParams , &AviFileHeader , 0 , Pos_Start , (Uint32)( Pos_End - Pos_Start ) ) == false )
+	Length = pSlot->VideoSize;
+	if ( !pSlot->KeyFrame )
+		Length |= AVI_INDEX_DELTA_FRAME;
+	if ( Avi_FrameIndex_Add ( pAviParams , &AviFileHeader , 0 , Pos_Start , Length ) == false )
 		return false;
 
-	if (AviParams.TotalVideoFrames % ( AviParams.Fps / AviParams.Fps_scale ) == 0)
+	if (pAviParams->TotalVideoFrames % ( pAviParams->Fps / pAviParams->Fps_scale ) == 0)
 	{
 		char str[20];
 		int secs , hours , mins;
 
-		secs = AviParams.TotalVideoFrames / ( AviParams.Fps / AviParams.Fps_scale );
+		secs = pAviParams->TotalVideoFrames / ( pAviParams->Fps / pAviParams->Fps_scale );
 		hours = secs / 3600;
 		mins = ( secs % 3600 ) / 60;
 		secs = secs % 60;
 		snprintf ( str , 20 , "%d:%02d:%02d" , hours , mins , secs );
 		Main_SetTitle(str);
 	}
+
+	if ( pSlot->AudioSamples >= 0 )
+		return Avi_WriteAudioFrame ( pAviParams , pSlot->AudioData , pSlot->AudioSamples );
 	return true;
 }
 
 
-
-static bool	Avi_RecordAudioStream_PCM ( RECORD_AVI_PARAMS *pAviParams , Sint16 pSamples[][2] , int SampleIndex , int SampleLength )
+/*-----------------------------------------------------------------------*/
+/**
+ * Write all the frames at the head of the queue that are already encoded.
+ * If WaitAll is true, wait until the whole queue is written, else only wait
+ * when the queue is full, until one slot is free again.
+ * Frames are always written in the order they were recorded, so
+ * Avi_FrameIndex_Add() sees them in the same order as before.
+ */
+static bool	Avi_WriteEncodedFrames ( RECORD_AVI_PARAMS *pAviParams , bool WaitAll )
 {
-	AVI_CHUNK	Chunk;
-	Sint16		sample[2];
-	int		i;
-	int		idx;
+	RECORD_AVI_ENCODE_SLOT	*pSlot;
+	bool			ok = true;
 
-	/* Write the audio frame header */
-	Avi_Store4cc ( Chunk.ChunkName , "01wb" );				/* stream 1, wave bytes */
-	Avi_StoreU32 ( Chunk.ChunkSize , SampleLength * 4 );			/* 16 bits, stereo -> 4 bytes */
-	if ( fwrite ( &Chunk , sizeof ( Chunk ) , 1 , pAviParams->FileOut ) != 1 )
+	SDL_LockMutex ( pAviParams->EncodeMutex );
+	while ( pAviParams->EncodeQueueCount > 0 )
 	{
-		perror ( "Avi_RecordAudioStream_PCM" );
-		Log_AlertDlg ( LOG_ERROR, "AVI recording : failed to write pcm frame header" );
-		return false;
+		pSlot = &pAviParams->EncodeQueue[ pAviParams->EncodeQueueHead ];
+		if ( pSlot->State != AVI_ENCODE_SLOT_DONE )
+		{
+			if ( !WaitAll && pAviParams->EncodeQueueCount < AVI_ENCODE_QUEUE_SIZE )
+				break;
+			SDL_CondWait ( pAviParams->EncodeCond , pAviParams->EncodeMutex );
+			continue;
+		}
+		SDL_UnlockMutex ( pAviParams->EncodeMutex );
+
+		if ( ok )
+			ok = Avi_WriteEncodedSlot ( pAviParams , pSlot );
+
+		SDL_LockMutex ( pAviParams->EncodeMutex );
+		pSlot->State = AVI_ENCODE_SLOT_FREE;
+		pAviParams->EncodeQueueHead = ( pAviParams->EncodeQueueHead + 1 ) % AVI_ENCODE_QUEUE_SIZE;
+		pAviParams->EncodeQueueCount--;
+		if ( !ok && !WaitAll )
+			break;
 	}
+	SDL_UnlockMutex ( pAviParams->EncodeMutex );
+	return ok;
+}
 
-	/* Write the audio frame data */
-	idx = SampleIndex & AUDIOMIXBUFFER_SIZE_MASK;
-	for ( i = 0 ; i < SampleLength; i++ )
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Copy the current screen (after cropping) to a free slot of the queue,
+ * it will then be encoded by one of the encoder threads and written later
+ * by Avi_WriteEncodedFrames().
+ */
+bool	Avi_RecordVideoStream ( void )
+{
+	RECORD_AVI_ENCODE_SLOT	*pSlot;
+	SDL_Surface		*Surface = AviParams.Surface;
+	Uint8			*pSrc;
+	int			y , LineSize;
+	int			Width , Height;
+
+	/* Write the frames that are already encoded, wait for a free slot */
+	if ( Avi_WriteEncodedFrames ( &AviParams , false ) == false )
+		return false;
+
+	pSlot = &AviParams.EncodeQueue[ ( AviParams.EncodeQueueHead + AviParams.EncodeQueueCount ) % AVI_ENCODE_QUEUE_SIZE ];
+	/* The screen size can change during recording, frames are then
+	 * scaled to the video size by the encoders */
+	Width = Surface->w - AviParams.CropLeft - AviParams.CropRight;
+	Height = Surface->h - AviParams.CropTop - AviParams.CropBottom;
+	if ( pSlot->Frame == NULL || pSlot->Frame->format->BitsPerPixel != Surface->format->BitsPerPixel
+	    || pSlot->Frame->w != Width || pSlot->Frame->h != Height )
 	{
-		/* Convert sample to little endian */
-		sample[0] = SDL_SwapLE16 ( pSamples[ idx ][0]);
-		sample[1] = SDL_SwapLE16 ( pSamples[ idx ][1]);
-		idx = ( idx+1 ) & AUDIOMIXBUFFER_SIZE_MASK;
-		/* And store */
-		if ( fwrite ( &sample , sizeof ( sample ) , 1 , pAviParams->FileOut ) != 1 )
+		if ( pSlot->Frame )
+			SDL_FreeSurface ( pSlot->Frame );
+		pSlot->Frame = SDL_CreateRGBSurface ( 0 , Width , Height ,
+				Surface->format->BitsPerPixel , Surface->format->Rmask ,
+				Surface->format->Gmask , Surface->format->Bmask , Surface->format->Amask );
+		if ( pSlot->Frame == NULL )
 		{
-			perror ( "Avi_RecordAudioStream_PCM" );
-			Log_AlertDlg ( LOG_ERROR, "AVI recording : failed to write pcm frame" );
+			Log_AlertDlg ( LOG_ERROR, "AVI recording : failed to alloc video frame" );
 			return false;
 		}
 	}
 
+	/* Copy the screen, the pixel conversion is done by the encoder */
+	if ( SDL_MUSTLOCK ( Surface ) )
+		SDL_LockSurface ( Surface );
+	LineSize = Width * Surface->format->BytesPerPixel;
+	pSrc = (Uint8 *)Surface->pixels + Surface->pitch * AviParams.CropTop
+		+ AviParams.CropLeft * Surface->format->BytesPerPixel;
+	for ( y=0 ; y<Height ; y++ )
+	{
+		memcpy ( (Uint8 *)pSlot->Frame->pixels + pSlot->Frame->pitch * y , pSrc , LineSize );
+		pSrc += Surface->pitch;
+	}
+	if ( SDL_MUSTLOCK ( Surface ) )
+		SDL_UnlockSurface ( Surface );
+
+	pSlot->AudioSamples = -1;
+	pSlot->VideoError = false;
+
+	if ( AviParams.EncodeThreadsCount == 0 )
+	{
+		/* No encoder thread, encode it now */
+		pSlot->VideoError = !Avi_EncodeFrame ( &AviParams , pSlot );
+		pSlot->State = AVI_ENCODE_SLOT_DONE;
+	}
+	else
+		pSlot->State = AVI_ENCODE_SLOT_QUEUED;
+
+	SDL_LockMutex ( AviParams.EncodeMutex );
+	AviParams.EncodeQueueCount++;
+	SDL_CondBroadcast ( AviParams.EncodeCond );
+	SDL_UnlockMutex ( AviParams.EncodeMutex );
 	return true;
 }
 
 
 
+/*-----------------------------------------------------------------------*/
+/**
+ * Convert audio samples to 16 bits little endian stereo pcm
+ */
+static void	Avi_ConvertAudio_PCM ( Uint8 *pPcm , Sint16 pSamples[][2] , int SampleIndex , int SampleLength )
+{
+	Sint16		*pOut = (Sint16 *)pPcm;
+	int		i;
+	int		idx;
+
+	idx = SampleIndex & AUDIOMIXBUFFER_SIZE_MASK;
+	for ( i = 0 ; i < SampleLength; i++ )
+	{
+		*pOut++ = SDL_SwapLE16 ( pSamples[ idx ][0] );
+		*pOut++ = SDL_SwapLE16 ( pSamples[ idx ][1] );
+		idx = ( idx+1 ) & AUDIOMIXBUFFER_SIZE_MASK;
+	}
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Record the audio frame for the last video frame. If this video frame
+ * is still in the queue, the audio is stored with it, so both are written
+ * together in the same order as before ; else it's written immediately.
+ */
 bool	Avi_RecordAudioStream ( Sint16 pSamples[][2] , int SampleIndex , int SampleLength )
 {
-	off_t		Pos_Start , Pos_End;
+	RECORD_AVI_ENCODE_SLOT	*pSlot = NULL;
+	Uint8			*mem;
 
-	Pos_Start = ftello ( AviParams.FileOut );
+	if ( AviParams.AudioCodec != AVI_RECORD_AUDIO_CODEC_PCM )
+		return false;
 
-	if ( AviParams.AudioCodec == AVI_RECORD_AUDIO_CODEC_PCM )
+	if ( AviParams.EncodeQueueCount > 0 )
 	{
-		if ( Avi_RecordAudioStream_PCM ( &AviParams , pSamples , SampleIndex , SampleLength ) == false )
-		{
-			return false;
-		}
+		pSlot = &AviParams.EncodeQueue[ ( AviParams.EncodeQueueHead + AviParams.EncodeQueueCount - 1 ) % AVI_ENCODE_QUEUE_SIZE ];
+		if ( pSlot->AudioSamples >= 0 )
+			pSlot = NULL;						/* already has some audio */
 	}
-	else
+
+	if ( pSlot == NULL )
 	{
-		return false;
+		/* Write all pending frames first, to keep video/audio order */
+		if ( Avi_WriteEncodedFrames ( &AviParams , true ) == false )
+			return false;
+		pSlot = &AviParams.AudioSlot;
 	}
 
-	Pos_End = ftello ( AviParams.FileOut );
-	AviParams.TotalAudioFrames++;
-	AviParams.TotalAudioSamples += SampleLength;
+	if ( SampleLength * 4 > pSlot->AudioAllocSize )
+	{
+		mem = realloc ( pSlot->AudioData , SampleLength * 4 );
+		if ( mem == NULL )
+			return false;
+		pSlot->AudioData = mem;
+		pSlot->AudioAllocSize = SampleLength * 4;
+	}
+	Avi_ConvertAudio_PCM ( pSlot->AudioData , pSamples , SampleIndex , SampleLength );
 
-	/* Store index for this audio frame */
-	Pos_Start += 8;								/* skip header */
-	if ( Avi_FrameIndex_Add ( &AviParams , &AviFileHeader , 1 , Pos_Start , (Uint32)( Pos_End - Pos_Start ) ) == false )
-		return false;
+	if ( pSlot == &AviParams.AudioSlot )
+		return Avi_WriteAudioFrame ( &AviParams , pSlot->AudioData , SampleLength );
 
+	pSlot->AudioSamples = SampleLength;
 	return true;
 }
 
@@ -1132,6 +1649,8 @@ static void	Avi_BuildFileHeader ( RECORD_AVI_PARAMS *pAviParams , AVI_FILE_HEADE
 		SizeImage = Avi_GetBmpSize ( Width , Height , BitCount );			/* size of a BMP image */
 	else if ( pAviParams->VideoCodec == AVI_RECORD_VIDEO_CODEC_PNG )
 		SizeImage = Avi_GetBmpSize ( Width , Height , BitCount );			/* max size of a PNG image */
+	else if ( pAviParams->VideoCodec == AVI_RECORD_VIDEO_CODEC_ZMBV )
+		SizeImage = Avi_GetBmpSize ( Width , Height , BitCount );			/* max size of a ZMBV image */
 
 
 	/* RIFF / AVI headers */
@@ -1175,6 +1694,8 @@ static void	Avi_BuildFileHeader ( RECORD_AVI_PARAMS *pAviParams , AVI_FILE_HEADE
 		Avi_StoreU32 ( pAviFileHeader->VideoStream.Header.stream_handler , VIDEO_STREAM_RGB );
 	else if ( pAviParams->VideoCodec == AVI_RECORD_VIDEO_CODEC_PNG )
 		Avi_Store4cc ( pAviFileHeader->VideoStream.Header.stream_handler , VIDEO_STREAM_PNG );
+	else if ( pAviParams->VideoCodec == AVI_RECORD_VIDEO_CODEC_ZMBV )
+		Avi_Store4cc ( pAviFileHeader->VideoStream.Header.stream_handler , VIDEO_STREAM_ZMBV );
 	Avi_StoreU32 ( pAviFileHeader->VideoStream.Header.flags , 0 );
 	Avi_StoreU16 ( pAviFileHeader->VideoStream.Header.priority , 0 );
 	Avi_StoreU16 ( pAviFileHeader->VideoStream.Header.language , 0 );
@@ -1221,6 +1742,20 @@ static void	Avi_BuildFileHeader ( RECORD_AVI_PARAMS *pAviParams , AVI_FILE_HEADE
 		Avi_StoreU32 ( pAviFileHeader->VideoStream.Format.clr_used , 0 );		/* no color map */
 		Avi_StoreU32 ( pAviFileHeader->VideoStream.Format.clr_important , 0 );		/* no color map */
 	}
+	else if ( pAviParams->VideoCodec == AVI_RECORD_VIDEO_CODEC_ZMBV )
+	{
+		Avi_StoreU32 ( pAviFileHeader->VideoStream.Format.size , sizeof ( AVI_STREAM_FORMAT_VIDS ) - 8 );
+		Avi_StoreU32 ( pAviFileHeader->VideoStream.Format.width , Width );
+		Avi_StoreU32 ( pAviFileHeader->VideoStream.Format.height , Height );
+		Avi_StoreU16 ( pAviFileHeader->VideoStream.Format.planes , 1 );			/* always 1 */
+		Avi_StoreU16 ( pAviFileHeader->VideoStream.Format.bit_count , BitCount );
+		Avi_Store4cc ( pAviFileHeader->VideoStream.Format.compression , VIDEO_STREAM_ZMBV );
+		Avi_StoreU32 ( pAviFileHeader->VideoStream.Format.size_image , SizeImage );	/* max size if uncompressed */
+		Avi_StoreU32 ( pAviFileHeader->VideoStream.Format.xpels_meter , 0 );
+		Avi_StoreU32 ( pAviFileHeader->VideoStream.Format.ypels_meter , 0 );
+		Avi_StoreU32 ( pAviFileHeader->VideoStream.Format.clr_used , 0 );		/* no color map */
+		Avi_StoreU32 ( pAviFileHeader->VideoStream.Format.clr_important , 0 );		/* no color map */
+	}
 
 	Avi_Store4cc ( pAviFileHeader->VideoStream.SuperIndex.ChunkName , "indx" );
 	Avi_StoreU32 ( pAviFileHeader->VideoStream.SuperIndex.ChunkSize , sizeof ( AVI_STREAM_SUPER_INDEX ) - 8 );
@@ -1232,6 +1767,8 @@ static void	Avi_BuildFileHeader ( RECORD_AVI_PARAMS *pAviParams , AVI_FILE_HEADE
 		Avi_Store4cc ( pAviFileHeader->VideoStream.SuperIndex.chunk_id , "00db" );
 	else if ( pAviParams->VideoCodec == AVI_RECORD_VIDEO_CODEC_PNG )
 		Avi_Store4cc ( pAviFileHeader->VideoStream.SuperIndex.chunk_id , "00dc" );
+	else if ( pAviParams->VideoCodec == AVI_RECORD_VIDEO_CODEC_ZMBV )
+		Avi_Store4cc ( pAviFileHeader->VideoStream.SuperIndex.chunk_id , "00dc" );
 
 
 	/* Audio Stream  : strl ( strh + strf + indx ) */
@@ -1319,6 +1856,13 @@ static bool	Avi_StartRecording_WithParams ( RECORD_AVI_PARAMS *pAviParams , char
 		return false;
 	}
 #endif
+#if !HAVE_ZLIB_H
+	if ( pAviParams->VideoCodec == AVI_RECORD_VIDEO_CODEC_ZMBV )
+	{
+		Log_AlertDlg ( LOG_ERROR, "AVI recording : Hatari was not built with zlib support" );
+		return false;
+	}
+#endif
 
 	/* Open the file */
 	pAviParams->FileOut = fopen ( AviFileName , "wb+" );
@@ -1383,6 +1927,13 @@ static bool	Avi_StartRecording_WithParams ( RECORD_AVI_PARAMS *pAviParams , char
 		return false;
 	}
 
+	/* Start the video encoders */
+	if ( Avi_StartEncoders ( pAviParams ) == false )
+	{
+		Avi_StopEncoders ( pAviParams );
+		Log_AlertDlg ( LOG_ERROR, "AVI recording : failed to init video encoder" );
+		return false;
+	}
 
 	/* We're ok to record */
 	Log_AlertDlg ( LOG_INFO, "AVI recording has been started");
@@ -1398,6 +1949,9 @@ static bool	Avi_StopRecording_WithParams ( RECORD_AVI_PARAMS *pAviParams )
 	if ( bRecordingAvi == false )						/* no recording ? */
 		return true;
 
+	/* Write the frames still in the encoders' queue */
+	Avi_WriteEncodedFrames ( pAviParams , true );
+	Avi_StopEncoders ( pAviParams );
 
 	/* Complete the current 'movi' chunk */
 	if ( Avi_CloseMoviChunk ( pAviParams , &AviFileHeader ) == false )
@@ -209,6 +209,7 @@ void Change_CopyChangedParamsToConfiguration(CNF_PARAMS *current, CNF_PARAMS *ch
 	     || changed->Screen.bAllowOverscan != current->Screen.bAllowOverscan
 	     || changed->Screen.bShowStatusbar != current->Screen.bShowStatusbar
 	     || changed->Screen.bUseSdlRenderer != current->Screen.bUseSdlRenderer
+	     || changed->Screen.nCpuScale != current->Screen.nCpuScale
 	     || changed->Screen.bResizable != current->Screen.bResizable
 	     || changed->Screen.bUseVsync != current->Screen.bUseVsync
 	    ))
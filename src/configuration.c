@@ -25,6 +25,7 @@ const char Configuration_fileid[] = "Hatari configuration.c";
 #include "memorySnapShot.h"
 #include "paths.h"
 #include "screen.h"
+#include "screenScale.h"
 #include "statusbar.h"
 #include "vdi.h"
 #include "video.h"
@@ -98,6 +99,8 @@ static const struct Config_Tag configs_Screen[] =
 	{ "nMaxHeight", Int_Tag, &ConfigureParams.Screen.nMaxHeight },
 	{ "nZoomFactor", Float_Tag, &ConfigureParams.Screen.nZoomFactor },
 	{ "bUseSdlRenderer", Bool_Tag, &ConfigureParams.Screen.bUseSdlRenderer },
+	{ "bRenderThread", Bool_Tag, &ConfigureParams.Screen.bRenderThread },
+	{ "nCpuScale", Int_Tag, &ConfigureParams.Screen.nCpuScale },
 	{ "bUseVsync", Bool_Tag, &ConfigureParams.Screen.bUseVsync },
 	{ NULL , Error_Tag, NULL }
 };
@@ -317,6 +320,7 @@ static const struct Config_Tag configs_HardDisk[] =
 	{ "nWriteProtection", Int_Tag, &ConfigureParams.HardDisk.nWriteProtection },
 	{ "bFilenameConversion", Bool_Tag, &ConfigureParams.HardDisk.bFilenameConversion },
 	{ "bGemdosHostTime", Bool_Tag, &ConfigureParams.HardDisk.bGemdosHostTime },
+	{ "nImageSync", Int_Tag, &ConfigureParams.HardDisk.nImageSync },
 	{ NULL , Error_Tag, NULL }
 };
 
@@ -482,6 +486,7 @@ static const struct Config_Tag configs_System[] =
 	{ "bPatchTimerD", Bool_Tag, &ConfigureParams.System.bPatchTimerD },
 	{ "bFastBoot", Bool_Tag, &ConfigureParams.System.bFastBoot },
 	{ "bFastForward", Bool_Tag, &ConfigureParams.System.bFastForward },
+	{ "nFastForwardTurbo", Int_Tag, &ConfigureParams.System.nFastForwardTurbo },
 	{ "bAddressSpace24", Bool_Tag, &ConfigureParams.System.bAddressSpace24 },
 	{ "bCycleExactCpu", Bool_Tag, &ConfigureParams.System.bCycleExactCpu },
 	{ "n_FPUType", Int_Tag, &ConfigureParams.System.n_FPUType },
@@ -573,6 +578,7 @@ void Configuration_SetDefault(void)
 	ConfigureParams.HardDisk.nWriteProtection = WRITEPROT_OFF;
 	ConfigureParams.HardDisk.nGemdosDrive = DRIVE_C;
 	ConfigureParams.HardDisk.bUseHardDiskDirectories = false;
+	ConfigureParams.HardDisk.nImageSync = HDSYNC_FLUSH;
 	for (i = 0; i < MAX_HARDDRIVES; i++)
 	{
 		strcpy(ConfigureParams.HardDisk.szHardDiskDirectories[i], psWorkingDir);
@@ -721,6 +727,8 @@ void Configuration_SetDefault(void)
 	ConfigureParams.Screen.DisableVideo = false;
 	ConfigureParams.Screen.nZoomFactor = 1.0;
 	ConfigureParams.Screen.bUseSdlRenderer = true;
+	ConfigureParams.Screen.bRenderThread = false;
+	ConfigureParams.Screen.nCpuScale = SCALE_MODE_OFF;
 	ConfigureParams.Screen.bUseVsync = false;
 
 	/* Set defaults for Sound */
@@ -773,6 +781,7 @@ void Configuration_SetDefault(void)
 	ConfigureParams.System.bPatchTimerD = false;
 	ConfigureParams.System.bFastBoot = false;
 	ConfigureParams.System.bFastForward = false;
+	ConfigureParams.System.nFastForwardTurbo = 0;
 
 	/* Set defaults for Video */
 #if HAVE_LIBPNG
@@ -828,6 +837,10 @@ void Configuration_Apply(bool bReset)
 	{
 		ConfigureParams.Screen.nForceBpp = 0;
 	}
+	if (ConfigureParams.Screen.nCpuScale < 0 || ConfigureParams.Screen.nCpuScale >= SCALE_MODE_COUNT)
+	{
+		ConfigureParams.Screen.nCpuScale = SCALE_MODE_OFF;
+	}
 
 	/* Check/convert ST RAM size in KB */
 	size = STMemory_RAM_Validate_Size_KB ( ConfigureParams.Memory.STRamSize_KB );
@@ -21,7 +21,7 @@ static void ConvertMediumRes_640x32Bit(void)
 	{
 
 		eax = STScreenLineOffset[y] + STScreenLeftSkipBytes;  /* Offset for this line + Amount to skip on left hand side */
-		edi = (Uint32 *)((Uint8 *)pSTScreen + eax);        /* ST format screen 4-plane 16 colors */
+		edi = (Uint32 *)((Uint8 *)pSTScreenSrc + eax);     /* ST format screen 4-plane 16 colors */
 		ebp = (Uint32 *)((Uint8 *)pSTScreenCopy + eax);    /* Previous ST format screen */
 		esi = PCScreen;                                    /* PC format screen */
 
@@ -37,47 +37,27 @@ static void ConvertMediumRes_640x32Bit(void)
 
 static void Line_ConvertMediumRes_640x32Bit(Uint32 *edi, Uint32 *ebp, Uint32 *esi, Uint32 eax)
 {
-	Uint32 ebx, ecx;
+	Uint8 *pixels;
 	int x, update;
 
-	x = STScreenWidthBytes >> 2;   /* Amount to draw across in 16-pixels (4 bytes) */
 	update = ScrUpdateFlag & PALETTEMASK_UPDATEMASK;
 
+	if (!Convert_ChangedLineToChunky(edi, ebp, 2, update))
+		return;
+
+	pixels = ChunkyLine;
+	x = STScreenWidthBytes >> 2;   /* Amount to draw across in 16-pixels (4 bytes) */
+
 	do  /* x-loop */
 	{
 		/* Do 16 pixels at one time */
-		ebx = *edi;
-
-		if (update || ebx != *ebp)      /* Does differ? */
+		if (update || *edi != *ebp)      /* Does differ? */
 		{
-			/* copy word */
-
-			bScreenContentsChanged = true;
-
-#if SDL_BYTEORDER == SDL_BIG_ENDIAN
-			/* Plot in 'right-order' on big endian systems */
-			MED_BUILD_PIXELS_0 ;              /* Generate 'ecx' as pixels [12,13,14,15] */
-			PLOT_MED_640_32BIT(12) ;
-			MED_BUILD_PIXELS_1 ;              /* Generate 'ecx' as pixels [4,5,6,7] */
-			PLOT_MED_640_32BIT(4) ;
-			MED_BUILD_PIXELS_2 ;              /* Generate 'ecx' as pixels [8,9,10,11] */
-			PLOT_MED_640_32BIT(8) ;
-			MED_BUILD_PIXELS_3 ;              /* Generate 'ecx' as pixels [0,1,2,3] */
-			PLOT_MED_640_32BIT(0) ;
-#else
-			/* Plot in 'wrong-order', as ebx is 68000 endian */
-			MED_BUILD_PIXELS_0 ;              /* Generate 'ecx' as pixels [4,5,6,7] */
-			PLOT_MED_640_32BIT(4) ;
-			MED_BUILD_PIXELS_1 ;              /* Generate 'ecx' as pixels [12,13,14,15] */
-			PLOT_MED_640_32BIT(12) ;
-			MED_BUILD_PIXELS_2 ;              /* Generate 'ecx' as pixels [0,1,2,3] */
-			PLOT_MED_640_32BIT(0) ;
-			MED_BUILD_PIXELS_3 ;              /* Generate 'ecx' as pixels [8,9,10,11] */
-			PLOT_MED_640_32BIT(8) ;
-#endif
+			Plot_Pixels_32Bit(esi, pixels, 16);
 		}
 
 		esi += 16;                      /* Next PC pixels */
+		pixels += 16;                   /* Next color indexes */
 		edi += 1;                       /* Next ST pixels */
 		ebp += 1;                       /* Next ST copy pixels */
 	}
@@ -14,98 +14,57 @@ static void ConvertMediumRes_640x32Bit_Spec(void)
 	Uint32 *esi;
 	Uint32 eax;
 	int y;
+	bool bDrawn;
 
 	Spec512_StartFrame();            /* Start frame, track palettes */
 
 	for (y = STScreenStartHorizLine; y < STScreenEndHorizLine; y++)
 	{
 		eax = STScreenLineOffset[y] + STScreenLeftSkipBytes;  /* Offset for this line + Amount to skip on left hand side */
-		edi = (Uint32 *)((Uint8 *)pSTScreen + eax);        /* ST format screen 4-plane 16 colors */
+		edi = (Uint32 *)((Uint8 *)pSTScreenSrc + eax);     /* ST format screen 4-plane 16 colors */
 		ebp = (Uint32 *)((Uint8 *)pSTScreenCopy + eax);    /* Previous ST format screen */
 		esi = PCScreen;                                    /* PC format screen */
 
 		if (HBLPaletteMasks[y] & 0x00030000)               /* Test resolution */
-			Line_ConvertMediumRes_640x32Bit_Spec(edi, ebp, esi, eax);	/* med res line */
+			bDrawn = Line_ConvertMediumRes_640x32Bit_Spec(edi, ebp, esi, y);	/* med res line */
 		else
-			Line_ConvertLowRes_640x32Bit_Spec(edi, ebp, esi, eax);		/* low res line (double on X) */
+			bDrawn = Line_ConvertLowRes_640x32Bit_Spec(edi, ebp, esi, y);	/* low res line (double on X) */
 
-		PCScreen = Double_ScreenLine32(PCScreen, PCScreenBytesPerLine);
+		if (bDrawn)
+			PCScreen = Double_ScreenLine32(PCScreen, PCScreenBytesPerLine);
+		else
+			PCScreen = (Uint32 *)((Uint8 *)PCScreen + 2 * PCScreenBytesPerLine);   /* Skip unchanged line and its double */
 	}
-
-        bScreenContentsChanged = true;
 }
 
 
-static void Line_ConvertMediumRes_640x32Bit_Spec(Uint32 *edi, Uint32 *ebp, Uint32 *esi, Uint32 eax)
+static bool Line_ConvertMediumRes_640x32Bit_Spec(Uint32 *edi, Uint32 *ebp, Uint32 *esi, int y)
 {
-	int x;
-	Uint32 ebx, ecx;
-	Uint32 pixelspace[5]; /* Workspace to store pixels to so can print in right order for Spec512 */
-
-	/* on x86, unaligned access macro touches also
-	 * next byte, zero it for code checkers
-	 */
-	pixelspace[4] = 0;
+	int x, n, count;
+	bool bDrawn;
 
 	Spec512_StartScanLine();        /* Build up palettes for every 4 pixels, store in 'ScanLinePalettes' */
 
-	x = STScreenWidthBytes >> 2;   /* Amount to draw across in 16-pixels (4 bytes) */
-
-	do  /* x-loop */
+	bDrawn = Convert_ChangedSpecLineToChunky(edi, ebp, 2, y);
+	if (bDrawn)
 	{
-		/* Do 16 pixels at one time */
-		ebx = *edi;
+		count = STScreenWidthBytes << 2;   /* Amount of pixels to draw */
 
-#if SDL_BYTEORDER == SDL_BIG_ENDIAN
-		/* Plot in 'right-order' on big endian systems */
-		MED_BUILD_PIXELS_0 ;              /* Generate 'ecx' as pixels [12,13,14,15] */
-		pixelspace[3] = ecx;
-		MED_BUILD_PIXELS_1 ;              /* Generate 'ecx' as pixels [4,5,6,7] */
-		pixelspace[1] = ecx;
-		MED_BUILD_PIXELS_2 ;              /* Generate 'ecx' as pixels [8,9,10,11] */
-		pixelspace[2] = ecx;
-		MED_BUILD_PIXELS_3 ;              /* Generate 'ecx' as pixels [0,1,2,3] */
-		pixelspace[0] = ecx;
-#else
-		/* Plot in 'wrong-order', as ebx is 68000 endian */
-		MED_BUILD_PIXELS_0 ;              /* Generate 'ecx' as pixels [4,5,6,7] */
-		pixelspace[1] = ecx;
-		MED_BUILD_PIXELS_1 ;              /* Generate 'ecx' as pixels [12,13,14,15] */
-		pixelspace[3] = ecx;
-		MED_BUILD_PIXELS_2 ;              /* Generate 'ecx' as pixels [0,1,2,3] */
-		pixelspace[0] = ecx;
-		MED_BUILD_PIXELS_3 ;              /* Generate 'ecx' as pixels [8,9,10,11] */
-		pixelspace[2] = ecx;
-#endif
 		/* And plot, the Spec512 is offset by 1 pixel and works on 'chunks' of 4 pixels */
-		/* So, we plot 1_4_4_4_3 to give 16 pixels, changing palette between */
-		/* (last one is used for first of next 16-pixels) */
+		/* So, we plot 1_4_4_..._4_3 to give the line, changing palette between. */
 		/* NOTE : In med res, we display 16 pixels in 8 cycles, so palette should be */
 		/* updated every 8 pixels, not every 4 pixels (as in low res) */
-		ecx = pixelspace[0];
-		PLOT_SPEC512_LEFT_MED_640_32BIT(0);
-//		Spec512_UpdatePaletteSpan();
-
-		ecx = GET_SPEC512_OFFSET_PIXELS(pixelspace, 1);
-		PLOT_SPEC512_MID_MED_640_32BIT(1);
-		Spec512_UpdatePaletteSpan();
-
-		ecx = GET_SPEC512_OFFSET_PIXELS(pixelspace, 5);
-		PLOT_SPEC512_MID_MED_640_32BIT(5);
-//		Spec512_UpdatePaletteSpan();
-
-		ecx = GET_SPEC512_OFFSET_PIXELS(pixelspace, 9);
-		PLOT_SPEC512_MID_MED_640_32BIT(9);
-		Spec512_UpdatePaletteSpan();
-
-		ecx = GET_SPEC512_OFFSET_FINAL_PIXELS(pixelspace);
-		PLOT_SPEC512_END_MED_640_32BIT(13);
-
-		esi += 16;                      /* Next PC pixels */
-		edi += 1;                       /* Next ST pixels */
-		ebp += 1;                       /* Next ST copy pixels */
+		/* Chunks which don't change the palette are plotted together */
+		Plot_Pixels_32Bit(esi, ChunkyLine, 5);
+		for (x = 5; x < count; x += n)
+		{
+			n = 8 * Spec512_UpdatePaletteSpans((count - x + 5) / 8);
+			if (n > count - x)
+				n = count - x;
+			Plot_Pixels_32Bit(esi + x, ChunkyLine + x, n);
+		}
 	}
-	while (--x);                        /* Loop on X */
 
 	Spec512_EndScanLine();
+	return bDrawn;
 }
@@ -13,21 +13,21 @@
 static void ConvertLowRes_320x16Bit(void);
 static void ConvertLowRes_640x16Bit(void);
 static void ConvertLowRes_320x16Bit_Spec(void);
-static void Line_ConvertLowRes_640x16Bit_Spec(Uint32 *edi, Uint32 *ebp, Uint32 *esi, Uint32 eax);
+static bool Line_ConvertLowRes_640x16Bit_Spec(Uint32 *edi, Uint32 *ebp, Uint32 *esi, int y);
 static void ConvertLowRes_640x16Bit_Spec(void);
 static void Line_ConvertMediumRes_640x16Bit(Uint32 *edi, Uint32 *ebp, Uint16 *esi, Uint32 eax);
 static void ConvertMediumRes_640x16Bit(void);
-static void Line_ConvertMediumRes_640x16Bit_Spec(Uint32 *edi, Uint32 *ebp, Uint16 *esi, Uint32 eax);
+static bool Line_ConvertMediumRes_640x16Bit_Spec(Uint32 *edi, Uint32 *ebp, Uint16 *esi, int y);
 static void ConvertMediumRes_640x16Bit_Spec(void);
 
 static void ConvertLowRes_320x32Bit(void);
 static void ConvertLowRes_640x32Bit(void);
 static void ConvertLowRes_320x32Bit_Spec(void);
-static void Line_ConvertLowRes_640x32Bit_Spec(Uint32 *edi, Uint32 *ebp, Uint32 *esi, Uint32 eax);
+static bool Line_ConvertLowRes_640x32Bit_Spec(Uint32 *edi, Uint32 *ebp, Uint32 *esi, int y);
 static void ConvertLowRes_640x32Bit_Spec(void);
 static void Line_ConvertMediumRes_640x32Bit(Uint32 *edi, Uint32 *ebp, Uint32 *esi, Uint32 eax);
 static void ConvertMediumRes_640x32Bit(void);
-static void Line_ConvertMediumRes_640x32Bit_Spec(Uint32 *edi, Uint32 *ebp, Uint32 *esi, Uint32 eax);
+static bool Line_ConvertMediumRes_640x32Bit_Spec(Uint32 *edi, Uint32 *ebp, Uint32 *esi, int y);
 static void ConvertMediumRes_640x32Bit_Spec(void);
 
 #endif /* HATARI_CONVERTROUTINES_H */
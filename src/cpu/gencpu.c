@@ -1936,9 +1936,9 @@ static void genflags(flagtypes type, wordsizes size, const char *value, const ch
 		/* At least some of those casts are fairly important! */
 		switch (type) {
 		case flag_logical_noclobber:
-			out("{uae_u32 oldcznv = GET_CZNV & ~(FLAGVAL_Z | FLAGVAL_N);\n");
+			out("{uae_u32 oldcznv = GET_CZNV() & ~(FLAGVAL_Z | FLAGVAL_N);\n");
 			if (strcmp(value, "0") == 0) {
-				out("SET_CZNV(olcznv | FLAGVAL_Z);\n");
+				out("SET_CZNV(oldcznv | FLAGVAL_Z);\n");
 			} else {
 				switch (size) {
 				case sz_byte: out("optflag_testb((uae_s8)(%s));\n", value); break;
@@ -9956,6 +9956,11 @@ int main(int argc, char *argv[])
 #else
 
 	using_debugmem = 1;
+#if defined(WINUAE_FOR_HATARI) && !defined(NOFLAGS_SUPPORT_GENCPU)
+	/* Compute each instruction's CZNV flags with a single store, see the */
+	/* optflag_xxx() macros in machdep/m68k.h */
+	using_optimized_flags = 1;
+#endif
 
 	headerfile = fopen("cputbl.h", "wb");
 
@@ -3,6 +3,8 @@
 #include "sysdeps.h"
 #include "m68k.h"
 
+#ifndef WINUAE_FOR_HATARI	/* Hatari uses the inline version from m68k.h */
+
 /*
  * Test CCR condition
  */
@@ -84,3 +86,5 @@ int cctrue(int cc)
 }
 
 #endif
+
+#endif /* WINUAE_FOR_HATARI */
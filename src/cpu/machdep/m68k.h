@@ -11,7 +11,9 @@
   * Machine dependent structure for holding the 68k CCR flags
   */
 
+#ifndef WINUAE_FOR_HATARI
 extern int cctrue(int cc);
+#endif
 
 #ifndef SAHF_SETO_PROFITABLE
 
@@ -126,3 +128,100 @@ extern struct flag_struct regflags;
 #define COPY_CARRY()	(regflags.x = regflags.cznv >> (FLAGBIT_C - FLAGBIT_X))
 
 #endif
+
+#ifdef WINUAE_FOR_HATARI
+
+/*
+ * Test CCR condition (inlined, as it's called with a constant by the
+ * Bcc/DBcc/Scc/TRAPcc opcode handlers)
+ */
+STATIC_INLINE int cctrue(int cc)
+{
+    uae_u32 cznv = regflags.cznv;
+
+    switch (cc) {
+    case 0:  return 1;                              /*              T  */
+    case 1:  return 0;                              /*              F  */
+    case 2:  return (cznv & (FLAGVAL_C | FLAGVAL_Z)) == 0;              /* !CFLG && !ZFLG       HI */
+    case 3:  return (cznv & (FLAGVAL_C | FLAGVAL_Z)) != 0;              /*  CFLG || ZFLG        LS */
+    case 4:  return (cznv & FLAGVAL_C) == 0;                    /* !CFLG            CC */
+    case 5:  return (cznv & FLAGVAL_C) != 0;                    /*  CFLG            CS */
+    case 6:  return (cznv & FLAGVAL_Z) == 0;                    /* !ZFLG            NE */
+    case 7:  return (cznv & FLAGVAL_Z) != 0;                    /*  ZFLG            EQ */
+    case 8:  return (cznv & FLAGVAL_V) == 0;                    /* !VFLG            VC */
+    case 9:  return (cznv & FLAGVAL_V) != 0;                    /*  VFLG            VS */
+    case 10: return (cznv & FLAGVAL_N) == 0;                    /* !NFLG            PL */
+    case 11: return (cznv & FLAGVAL_N) != 0;                    /*  NFLG            MI */
+#if FLAGBIT_N > FLAGBIT_V
+    case 12: return (((cznv << (FLAGBIT_N - FLAGBIT_V)) ^ cznv) & FLAGVAL_N) == 0;  /*  NFLG == VFLG        GE */
+    case 13: return (((cznv << (FLAGBIT_N - FLAGBIT_V)) ^ cznv) & FLAGVAL_N) != 0;  /*  NFLG != VFLG        LT */
+    case 14: cznv &= (FLAGVAL_N | FLAGVAL_Z | FLAGVAL_V);               /* !ZFLG && (NFLG == VFLG)   GT */
+        return (((cznv << (FLAGBIT_N - FLAGBIT_V)) ^ cznv) & (FLAGVAL_N | FLAGVAL_Z)) == 0;
+    case 15: cznv &= (FLAGVAL_N | FLAGVAL_Z | FLAGVAL_V);               /* ZFLG || (NFLG != VFLG)   LE */
+        return (((cznv << (FLAGBIT_N - FLAGBIT_V)) ^ cznv) & (FLAGVAL_N | FLAGVAL_Z)) != 0;
+#else
+    case 12: return (((cznv << (FLAGBIT_V - FLAGBIT_N)) ^ cznv) & FLAGVAL_V) == 0;  /*  NFLG == VFLG        GE */
+    case 13: return (((cznv << (FLAGBIT_V - FLAGBIT_N)) ^ cznv) & FLAGVAL_V) != 0;  /*  NFLG != VFLG        LT */
+    case 14: cznv &= (FLAGVAL_N | FLAGVAL_Z | FLAGVAL_V);               /* !ZFLG && (NFLG == VFLG)   GT */
+        return (((cznv << (FLAGBIT_V - FLAGBIT_N)) ^ cznv) & (FLAGVAL_V | FLAGVAL_Z)) == 0;
+    case 15: cznv &= (FLAGVAL_N | FLAGVAL_Z | FLAGVAL_V);               /* ZFLG || (NFLG != VFLG)   LE */
+        return (((cznv << (FLAGBIT_V - FLAGBIT_N)) ^ cznv) & (FLAGVAL_V | FLAGVAL_Z)) != 0;
+#endif
+    }
+    return 0;
+}
+
+/*
+ * Flag helpers for gencpu's "optimized flags" mode (see genflags()).
+ * All the CZNV flags of an instruction are computed from the operands
+ * and the result and stored with a single write to regflags.cznv,
+ * instead of one read-modify-write per flag.
+ */
+#define optflag_test(v, type, bits) \
+	SET_CZNV(((uae_u32)((type)(v) == 0) << FLAGBIT_Z) \
+		 | (((uae_u32)(type)(v) >> ((bits) - 1)) << FLAGBIT_N))
+
+#define optflag_testb(v)	optflag_test(v, uae_u8, 8)
+#define optflag_testw(v)	optflag_test(v, uae_u16, 16)
+#define optflag_testl(v)	optflag_test(v, uae_u32, 32)
+
+/* newv, src and dst as in the generated code : newv is the unmasked result */
+#define optflag_arith(newv, src, dst, type, bits, sub) do { \
+	type optflag_s = (type)(src), optflag_d = (type)(dst), optflag_r = (type)(newv); \
+	uae_u32 optflag_c = (sub) ? optflag_s > optflag_d : optflag_r < optflag_s; \
+	uae_u32 optflag_v = (sub) ? (type)((optflag_s ^ optflag_d) & (optflag_r ^ optflag_d)) \
+				  : (type)((optflag_s ^ optflag_r) & (optflag_d ^ optflag_r)); \
+	SET_CZNV(((uae_u32)(optflag_r == 0) << FLAGBIT_Z) \
+		 | (((uae_u32)optflag_r >> ((bits) - 1)) << FLAGBIT_N) \
+		 | (optflag_c << FLAGBIT_C) \
+		 | ((optflag_v >> ((bits) - 1)) << FLAGBIT_V)); \
+} while (0)
+
+#define optflag_add(newv, src, dst, type, bits) do { \
+	newv = (uae_u32)(type)(dst) + (type)(src); \
+	optflag_arith(newv, src, dst, type, bits, 0); \
+	COPY_CARRY(); \
+} while (0)
+
+#define optflag_sub(newv, src, dst, type, bits) do { \
+	newv = (uae_u32)(type)(dst) - (type)(src); \
+	optflag_arith(newv, src, dst, type, bits, 1); \
+	COPY_CARRY(); \
+} while (0)
+
+#define optflag_cmp(src, dst, type, bits) do { \
+	uae_u32 optflag_newv = (uae_u32)(type)(dst) - (type)(src); \
+	optflag_arith(optflag_newv, src, dst, type, bits, 1); \
+} while (0)
+
+#define optflag_addb(v, s, d)	optflag_add(v, s, d, uae_u8, 8)
+#define optflag_addw(v, s, d)	optflag_add(v, s, d, uae_u16, 16)
+#define optflag_addl(v, s, d)	optflag_add(v, s, d, uae_u32, 32)
+#define optflag_subb(v, s, d)	optflag_sub(v, s, d, uae_u8, 8)
+#define optflag_subw(v, s, d)	optflag_sub(v, s, d, uae_u16, 16)
+#define optflag_subl(v, s, d)	optflag_sub(v, s, d, uae_u32, 32)
+#define optflag_cmpb(s, d)	optflag_cmp(s, d, uae_u8, 8)
+#define optflag_cmpw(s, d)	optflag_cmp(s, d, uae_u16, 16)
+#define optflag_cmpl(s, d)	optflag_cmp(s, d, uae_u32, 32)
+
+#endif /* WINUAE_FOR_HATARI */
@@ -56,6 +56,10 @@ static uae_u32 TTmem_mask;
 #define IdeMem_mask  (IdeMem_size - 1)
 #define IOmem_mask  (IOmem_size - 1)
 
+/* Inline access to plain ST RAM, see get_long() & co in memory.h */
+uae_u8 *STmem_direct_base;
+uae_u32 STmem_direct_limit;
+
 /* Some prototypes: */
 static int REGPARAM3 STmem_check (uaecptr addr, uae_u32 size) REGPARAM;
 static uae_u8 * REGPARAM3 STmem_xlate (uaecptr addr) REGPARAM;
@@ -1866,6 +1870,7 @@ void memory_uninit (void)
 		free(STmemory);
 		STmemory = NULL;
 	}
+	STmem_direct_limit = 0;
 
 	if (STmem_size <= 0x800000 && ROMmemory) {
 		free(ROMmemory);
@@ -1876,6 +1881,32 @@ void memory_uninit (void)
 }
 
 
+/*
+ * Update the size of the RAM region that can be accessed directly by
+ * the CPU core without calling the STmem_bank functions : this is the
+ * contiguous run of 64 KB banks after STMEM_DIRECT_START which are
+ * mapped to STmem_bank. If MMU/MCU translation is used or if a bank
+ * is replaced (debugger's memwatch for example), the region is reduced
+ * accordingly (or disabled).
+ */
+static void STmem_direct_update(void)
+{
+	int bnr;
+
+	STmem_direct_limit = 0;
+	if (!STmemory)
+		return;
+
+	for (bnr = STMEM_DIRECT_START >> 16; bnr < (int)(STmem_size >> 16); bnr++)
+		if (mem_banks[bnr] != &STmem_bank)
+			break;
+
+	STmem_direct_base = STmemory + STMEM_DIRECT_START;
+	if ((bnr << 16) > STMEM_DIRECT_START)
+		STmem_direct_limit = (bnr << 16) - STMEM_DIRECT_START;
+}
+
+
 static void map_banks2 (addrbank *bank, int start, int size, int realsize, int quick)
 {
 #ifndef WINUAE_FOR_HATARI
@@ -1965,6 +1996,8 @@ static void map_banks2 (addrbank *bank, int start, int size, int realsize, int q
 	if (quick <= 0)
 		debug_bankchange (old);
 	fill_ce_banks ();
+#else
+	STmem_direct_update ();
 #endif
 }
 
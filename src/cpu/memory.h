@@ -550,6 +550,53 @@ uae_u32 memory_get_byte(uaecptr);
 uae_u32 memory_get_longi(uaecptr);
 uae_u32 memory_get_wordi(uaecptr);
 
+#ifdef WINUAE_FOR_HATARI
+/*
+ * Fast path for plain ST RAM : when the region starting at STMEM_DIRECT_START
+ * is mapped to the standard ST RAM bank (no MMU/MCU translation, no debug
+ * bank), accesses are done inline on the host memory instead of going through
+ * the addrbank functions. STmem_direct_limit is the size of this region and
+ * is updated each time the banks are remapped (0 disables the fast path).
+ * The first 64 KB are excluded because of the supervisor checks in SysMem_bank.
+ */
+#define STMEM_DIRECT_START	0x10000
+extern uae_u8 *STmem_direct_base;
+extern uae_u32 STmem_direct_limit;
+
+#define STMEM_DIRECT(addr)	((uae_u32)((addr) - STMEM_DIRECT_START) < STmem_direct_limit)
+#define STMEM_DIRECT_PTR(addr)	(STmem_direct_base + (uae_u32)((addr) - STMEM_DIRECT_START))
+
+STATIC_INLINE uae_u32 get_long(uaecptr addr)
+{
+	if (STMEM_DIRECT(addr))
+		return do_get_mem_long(STMEM_DIRECT_PTR(addr));
+	return memory_get_long(addr);
+}
+STATIC_INLINE uae_u32 get_word (uaecptr addr)
+{
+	if (STMEM_DIRECT(addr))
+		return do_get_mem_word(STMEM_DIRECT_PTR(addr));
+	return memory_get_word(addr);
+}
+STATIC_INLINE uae_u32 get_byte (uaecptr addr)
+{
+	if (STMEM_DIRECT(addr))
+		return *STMEM_DIRECT_PTR(addr);
+	return memory_get_byte(addr);
+}
+STATIC_INLINE uae_u32 get_longi(uaecptr addr)
+{
+	if (STMEM_DIRECT(addr))
+		return do_get_mem_long(STMEM_DIRECT_PTR(addr));
+	return memory_get_longi(addr);
+}
+STATIC_INLINE uae_u32 get_wordi(uaecptr addr)
+{
+	if (STMEM_DIRECT(addr))
+		return do_get_mem_word(STMEM_DIRECT_PTR(addr));
+	return memory_get_wordi(addr);
+}
+#else
 STATIC_INLINE uae_u32 get_long(uaecptr addr)
 {
 	return memory_get_long(addr);
@@ -570,6 +617,7 @@ STATIC_INLINE uae_u32 get_wordi(uaecptr addr)
 {
 	return memory_get_wordi(addr);
 }
+#endif
 
 // do split memory access if it can cross memory banks
 STATIC_INLINE uae_u32 get_long_compatible(uaecptr addr)
@@ -699,14 +747,32 @@ void memory_put_byte(uaecptr, uae_u32);
 
 STATIC_INLINE void put_long (uaecptr addr, uae_u32 l)
 {
+#ifdef WINUAE_FOR_HATARI
+	if (STMEM_DIRECT(addr)) {
+		do_put_mem_long(STMEM_DIRECT_PTR(addr), l);
+		return;
+	}
+#endif
 	memory_put_long(addr, l);
 }
 STATIC_INLINE void put_word (uaecptr addr, uae_u32 w)
 {
+#ifdef WINUAE_FOR_HATARI
+	if (STMEM_DIRECT(addr)) {
+		do_put_mem_word(STMEM_DIRECT_PTR(addr), w);
+		return;
+	}
+#endif
 	memory_put_word(addr, w);
 }
 STATIC_INLINE void put_byte (uaecptr addr, uae_u32 b)
 {
+#ifdef WINUAE_FOR_HATARI
+	if (STMEM_DIRECT(addr)) {
+		*STMEM_DIRECT_PTR(addr) = b;
+		return;
+	}
+#endif
 	memory_put_byte(addr, b);
 }
 
@@ -4829,6 +4829,12 @@ static int do_specialties (int cycles)
 		m68k_reset_delay = 0;
 		unset_special(SPCFLAG_CHECK);
 	}
+#else
+	/* Hatari doesn't use the reset delay / halt loop, but the flag is still */
+	/* set on reset : clear it, else do_specialties() is called after each */
+	/* instruction */
+	if (regs.spcflags & SPCFLAG_CHECK)
+		unset_special(SPCFLAG_CHECK);
 #endif
 
 #ifdef ACTION_REPLAY
@@ -5193,6 +5199,202 @@ static void m68k_run_1 (void)
 
 #else
 
+#ifdef WINUAE_FOR_HATARI
+/*
+ * Fused "move/clr (An)+ ; dbf Dn,loop" superinstructions for the 68000
+ * prefetch core.
+ *
+ * Copy and clear loops of the form
+ *	loop:	move.x	(Ay)+,(Ax)+	(or Dy,(Ax)+ or clr.x (Ax)+)
+ *		dbf	Dn,loop
+ * are very common in ST programs. Once such a loop is detected, the first
+ * iteration is run through the normal opcode handlers to get the cycles and
+ * opcode families of both instructions, then the following iterations are
+ * emulated directly on ST RAM without going through the opcode table,
+ * prefetch and address bank functions for each instruction.
+ *
+ * Cycles, pairing, registers, flags and prefetch state are updated exactly
+ * as the normal path would do, and we go back to the main loop as soon as
+ * an interrupt, a special flag or a video/MFP update is pending, when the
+ * loop counter is about to expire or when an access would not be a plain
+ * ST RAM access (or would modify the loop itself).
+ */
+static bool m68k_run_1_fastloop_account(struct regstruct *r, int cycles)
+{
+	if (!regs.loop_mode)
+		regs.ird = regs.opcode;
+	cpu_cycles = adjust_cycles (cycles);
+	do_cycles(cpu_cycles);
+	regs.instruction_cnt++;
+	M68000_AddCyclesWithPairing(cpu_cycles * 2 / CYCLE_UNIT + WaitStateCycles);
+	WaitStateCycles = 0;
+
+	/* Return to the main loop if it has something to do after this instruction */
+	if (CycInt_Pending() || MFP_UpdateNeeded || r->spcflags || savestate_state == STATE_SAVE)
+		return false;
+	regs.ipl = regs.ipl_pin;
+	return true;
+}
+
+/* Return true if [addr, addr+size) is plain ST RAM outside of the loop code at pc */
+static inline bool m68k_run_1_fastloop_addr(uaecptr addr, int size, uaecptr pc)
+{
+	if (size > 1 && (addr & 1))
+		return false;
+	if (!STMEM_DIRECT(addr) || !STMEM_DIRECT(addr + size - 1))
+		return false;
+	return addr + size <= pc || addr >= pc + 6;
+}
+
+/*
+ * Called with r->ir being the opcode at PC and r->irc a "dbf Dn" opcode.
+ * Return false if this is not a fusable loop, in which case nothing was
+ * executed. Else execute one or more instructions and return true, with
+ * the cycles of the last executed instruction accounted for, but not yet
+ * the interrupts / special flags processing after it.
+ */
+static bool m68k_run_1_fastloop(struct regstruct *r)
+{
+	uaecptr pc = m68k_getpci();
+	uae_u16 opcode = r->ir;
+	uae_u16 dbf = r->irc;
+	int dreg = dbf & 7;
+	int size, srcreg, dstreg;
+	bool src_postinc;
+	int move_cycles, move_family, move_instrcycles;
+	int dbf_cycles, dbf_family, dbf_instrcycles;
+	uae_u32 src;
+
+	if (currprefs.cpu_model != 68000 || r->spcflags || regs.t1 || regs.t0
+	    || LOG_TRACE_LEVEL(TRACE_CPU_DISASM))
+		return false;
+	if ((pc & 1) || !STMEM_DIRECT(pc) || !STMEM_DIRECT(pc + 5))
+		return false;
+
+	/* Decode the loop body */
+	switch (opcode & 0xf1f8) {
+	case 0x10d8: size = 1; src_postinc = true; break;	/* move.b (Ay)+,(Ax)+ */
+	case 0x30d8: size = 2; src_postinc = true; break;	/* move.w (Ay)+,(Ax)+ */
+	case 0x20d8: size = 4; src_postinc = true; break;	/* move.l (Ay)+,(Ax)+ */
+	case 0x10c0: size = 1; src_postinc = false; break;	/* move.b Dy,(Ax)+ */
+	case 0x30c0: size = 2; src_postinc = false; break;	/* move.w Dy,(Ax)+ */
+	case 0x20c0: size = 4; src_postinc = false; break;	/* move.l Dy,(Ax)+ */
+	default:
+		switch (opcode & 0xfff8) {
+		case 0x4218: size = 1; break;			/* clr.b (Ax)+ */
+		case 0x4258: size = 2; break;			/* clr.w (Ax)+ */
+		case 0x4298: size = 4; break;			/* clr.l (Ax)+ */
+		default:
+			return false;
+		}
+		src_postinc = false;
+		srcreg = -1;
+		dstreg = opcode & 7;
+		goto decoded;
+	}
+	srcreg = opcode & 7;
+	dstreg = (opcode >> 9) & 7;
+decoded:
+	/* The prefetched words must match memory and the branch must go back to pc */
+	if (do_get_mem_word(STMEM_DIRECT_PTR(pc)) != opcode
+	    || do_get_mem_word(STMEM_DIRECT_PTR(pc + 2)) != dbf
+	    || do_get_mem_word(STMEM_DIRECT_PTR(pc + 4)) != 0xfffc)
+		return false;
+
+	/* First iteration goes through the normal handlers to get the timings */
+	r->instruction_pc = pc;
+	move_cycles = (*cpufunctbl[opcode])(opcode) & 0xffff;
+	move_family = OpcodeFamily;
+	move_instrcycles = CurrentInstrCycles;
+	if (!m68k_run_1_fastloop_account(r, move_cycles)
+	    || m68k_getpci() != pc + 2 || r->ir != dbf)
+		return true;
+
+	r->opcode = dbf;
+	r->instruction_pc = pc + 2;
+	dbf_cycles = (*cpufunctbl[dbf])(dbf) & 0xffff;
+	dbf_family = OpcodeFamily;
+	dbf_instrcycles = CurrentInstrCycles;
+	if (!m68k_run_1_fastloop_account(r, dbf_cycles)
+	    || m68k_getpci() != pc || r->ir != opcode || r->irc != dbf)
+		return true;
+
+	/* Following iterations, as long as the dbf branch will be taken */
+	while ((m68k_dreg(regs, dreg) & 0xffff) != 0) {
+		uaecptr srca = 0, dsta;
+		int srcinc, dstinc;
+
+		srcinc = (size == 1 && src_postinc) ? areg_byteinc[srcreg] : size;
+		dstinc = size == 1 ? areg_byteinc[dstreg] : size;
+		if (src_postinc) {
+			srca = m68k_areg(regs, srcreg);
+			if (!m68k_run_1_fastloop_addr(srca, size, pc))
+				break;
+		}
+		dsta = m68k_areg(regs, dstreg);
+		/* With Ax == Ay, the destination is after the source increment */
+		if (src_postinc && srcreg == dstreg)
+			dsta += srcinc;
+		if (!m68k_run_1_fastloop_addr(dsta, size, pc))
+			break;
+
+		/* Loop body */
+		r->opcode = opcode;
+		r->instruction_pc = pc;
+		OpcodeFamily = move_family;
+		CurrentInstrCycles = move_instrcycles;
+		if (srcreg < 0)
+			src = 0;
+		else if (!src_postinc)
+			src = m68k_dreg(regs, srcreg);
+		else if (size == 1)
+			src = do_get_mem_byte(STMEM_DIRECT_PTR(srca));
+		else if (size == 2)
+			src = do_get_mem_word(STMEM_DIRECT_PTR(srca));
+		else
+			src = do_get_mem_long(STMEM_DIRECT_PTR(srca));
+		if (src_postinc)
+			m68k_areg(regs, srcreg) += srcinc;
+		m68k_areg(regs, dstreg) += dstinc;
+		CLEAR_CZNV();
+		if (size == 1) {
+			do_put_mem_byte(STMEM_DIRECT_PTR(dsta), src);
+			SET_ZFLG(((uae_s8)(src)) == 0);
+			SET_NFLG(((uae_s8)(src)) < 0);
+			src = (uae_s8)src;
+		} else if (size == 2) {
+			do_put_mem_word(STMEM_DIRECT_PTR(dsta), src);
+			SET_ZFLG(((uae_s16)(src)) == 0);
+			SET_NFLG(((uae_s16)(src)) < 0);
+		} else {
+			do_put_mem_long(STMEM_DIRECT_PTR(dsta), src);
+			SET_ZFLG(((uae_s32)(src)) == 0);
+			SET_NFLG(((uae_s32)(src)) < 0);
+		}
+		regs.write_buffer = src;
+		m68k_setpci_j(pc + 2);
+		r->ir = dbf;
+		r->irc = regs.read_buffer = regs.db = 0xfffc;
+		if (!m68k_run_1_fastloop_account(r, move_cycles))
+			break;
+
+		/* dbf Dn,loop (taken) */
+		r->opcode = dbf;
+		r->instruction_pc = pc + 2;
+		OpcodeFamily = dbf_family;
+		CurrentInstrCycles = dbf_instrcycles;
+		m68k_dreg(regs, dreg) = (m68k_dreg(regs, dreg) & ~0xffff)
+					| ((m68k_dreg(regs, dreg) - 1) & 0xffff);
+		m68k_setpci_j(pc);
+		r->ir = opcode;
+		r->irc = regs.read_buffer = regs.db = dbf;
+		if (!m68k_run_1_fastloop_account(r, dbf_cycles))
+			break;
+	}
+	return true;
+}
+#endif
+
 /* It's really sad to have two almost identical functions for this, but we
 do it all for performance... :(
 This version emulates 68000's prefetch "cache" */
@@ -5244,6 +5446,11 @@ static void m68k_run_1 (void)
 				}
 #endif
 
+#ifdef WINUAE_FOR_HATARI
+				/* Copy/clear loops with a dbf are run by m68k_run_1_fastloop() */
+				if ((r->irc & 0xfff8) == 0x51c8 && m68k_run_1_fastloop(r))
+					goto fastloop_done;
+#endif
 				r->instruction_pc = m68k_getpc ();
 				cpu_cycles = (*cpufunctbl[r->opcode])(r->opcode) & 0xffff;
 				if (!regs.loop_mode)
@@ -5257,6 +5464,7 @@ static void m68k_run_1 (void)
 				/* TODO  [NP] do this in all m68k_run_xx() */
 				M68000_AddCyclesWithPairing(cpu_cycles * 2 / CYCLE_UNIT + WaitStateCycles);
 				WaitStateCycles = 0;
+fastloop_done:
 
 				/* We can have several interrupts at the same time before the next CPU instruction */
 				/* We must check for pending interrupt and call do_specialties_interrupt() only */
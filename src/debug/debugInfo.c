@@ -41,6 +41,7 @@ const char DebugInfo_fileid[] = "Hatari debuginfo.c";
 #include "tos.h"
 #include "scc.h"
 #include "screen.h"
+#include "sound.h"
 #include "vdi.h"
 #include "video.h"
 #include "videl.h"
@@ -682,6 +683,7 @@ static const struct {
 	{ true, "registers", DebugInfo_CpuRegister,NULL, "Show CPU register contents" },
 	{ false,"rtc",       Rtc_Info,             NULL, "Show (Mega ST/STE) RTC register contents" },
 	{ false,"scc",       SCC_Info,             NULL, "Show SCC register contents" },
+	{ false,"sound",     Sound_Info,           NULL, "Show sound generation and audio callback statistics" },
 	{ false,"vdi",       VDI_Info,             NULL, "Show VDI vector contents (with <value>, show opcodes)" },
 	{ false,"videl",     Videl_Info,           NULL, "Show Falcon Videl register contents" },
 	{ false,"video",     Video_Info,           NULL, "Show Video information" },
@@ -42,6 +42,8 @@
 #include "memory.h"
 #include "configuration.h"
 #include "psg.h"
+#include "sound.h"
+#include "audio.h"
 #include "dmaSnd.h"
 #include "blitter.h"
 #include "profile.h"
@@ -784,6 +786,52 @@ static int RemoteDebug_infoym(int nArgc, char *psArgs[], RemoteDebugState* state
 	return 0;
 }
 
+// -----------------------------------------------------------------------------
+/* "infosound" returns audio pipeline statistics since startup */
+/* returns "OK" + VBLs, samples generated, samples buffered, buffer overflows, */
+/* generation/DMA sound/crossbar time in microseconds, callbacks, samples */
+/* consumed, underruns, refill callbacks, skips, skipped samples and the */
+/* AUDIO_FILL_HISTO_SIZE buffer fill histogram values (low 32 bits of each) */
+static int RemoteDebug_infosound(int nArgc, char *psArgs[], RemoteDebugState* state)
+{
+	SOUND_STATS sound;
+	AUDIO_STATS audio;
+	uint32_t vals[13];
+	double usPerTick;
+	int i;
+
+	Sound_GetStats(&sound);
+	Audio_GetStats(&audio);
+	usPerTick = 1000000.0 / SDL_GetPerformanceFrequency();
+
+	vals[0] = sound.nVBLs;
+	vals[1] = sound.nGenerated;
+	vals[2] = (uint32_t)SDL_AtomicGet(&AudioMixBuffer_nWritten) - (uint32_t)SDL_AtomicGet(&AudioMixBuffer_nRead);
+	vals[3] = sound.nOverflows;
+	vals[4] = sound.TimeGenerate * usPerTick;
+	vals[5] = sound.TimeDmaSnd * usPerTick;
+	vals[6] = sound.TimeCrossbar * usPerTick;
+	vals[7] = audio.nCallbacks;
+	vals[8] = audio.nConsumed;
+	vals[9] = audio.nUnderruns;
+	vals[10] = audio.nRefills;
+	vals[11] = audio.nSkips;
+	vals[12] = audio.nSkipped;
+
+	send_str(state, "OK");
+	for (i = 0; i < ARRAY_SIZE(vals); ++i)
+	{
+		send_sep(state);
+		send_hex(state, vals[i]);
+	}
+	for (i = 0; i < AUDIO_FILL_HISTO_SIZE; ++i)
+	{
+		send_sep(state);
+		send_hex(state, audio.FillHisto[i]);
+	}
+	return 0;
+}
+
 // -----------------------------------------------------------------------------
 /* "profile <int>" Enables/disables CPU profiling. */
 /* returns "OK <val>" if successful */
@@ -877,6 +925,7 @@ static const rdbcommand_t remoteDebugCommandList[] = {
 	{ RemoteDebug_console,	"console"	, false		},
 	{ RemoteDebug_setstd,	"setstd"	, true		},
 	{ RemoteDebug_infoym,	"infoym"	, false		},
+	{ RemoteDebug_infosound,"infosound"	, false		},
 	{ RemoteDebug_profile,	"profile"	, true		},
 	{ RemoteDebug_resetwarm,"resetwarm"	, true		},
 	{ RemoteDebug_resetcold,"resetcold"	, true		},
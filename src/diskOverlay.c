@@ -0,0 +1,518 @@
+/*
+  Hatari - diskOverlay.c
+
+  This file is distributed under the GNU General Public License, version 2
+  or at your option any later version. Read the file gpl.txt for details.
+
+  Copy-on-write overlay files for hard disk and floppy images.
+
+  When an overlay directory is given with the "--disk-overlay" option,
+  disk images are only read, and all writes to them go instead to
+  a per-image delta file in that directory. Several Hatari instances
+  can then share the same (read-only) base image, as long as each of
+  them uses its own overlay directory.
+
+  Delta file is named after the image file base name and a hash of
+  its canonical path, so that images with the same name in different
+  directories get separate delta files.  Delta file contains a header
+  identifying the image by its size, modification time and canonical
+  path, a bitmap telling which image blocks have been written, and
+  the block data at the same offsets as in the image itself. If the
+  image doesn't match the header (e.g. it has been replaced), delta
+  file contents are discarded. The data area is left sparse, so a new delta file
+  takes (nearly) no disk space regardless of the image size. The delta
+  file is kept between runs, unless "--disk-overlay-discard" is
+  enabled, in which case it's started empty and removed right away
+  (so that it goes away also when Hatari exits without cleanup),
+  or if the host doesn't allow that, when the image is ejected /
+  unmounted.
+*/
+const char DiskOverlay_fileid[] = "Hatari diskOverlay.c";
+
+#include <errno.h>
+#include <sys/stat.h>
+#include <SDL_endian.h>
+
+#include "main.h"
+#include "diskOverlay.h"
+#include "file.h"
+#include "log.h"
+#include "str.h"
+#include "utils.h"
+
+#ifdef HAVE_MMAP
+# include <sys/mman.h>
+#endif
+#if defined(HAVE_FSYNC) || defined(HAVE_FTRUNCATE)
+# include <unistd.h>
+#endif
+
+#define OVERLAY_MAGIC       "HATARIOV"
+#define OVERLAY_VERSION     2
+#define OVERLAY_HEADER_SIZE 512     /* bitmap follows the header */
+#define OVERLAY_HEADER_PATH 32      /* magic, version, block / image size and mtime precede path */
+#define OVERLAY_DATA_ALIGN  4096
+
+static char *OverlayDir;            /* NULL when overlays are disabled */
+static bool bOverlayDiscard;
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Set directory for overlay files and enable overlays.
+ * Return false if directory doesn't exist.
+ */
+bool DiskOverlay_SetDir(const char *dir)
+{
+	if (!File_DirExists(dir))
+		return false;
+	free(OverlayDir);
+	OverlayDir = strdup(dir);
+	return OverlayDir != NULL;
+}
+
+/**
+ * Set whether overlay file contents are discarded when image is closed
+ */
+void DiskOverlay_SetDiscard(bool discard)
+{
+	bOverlayDiscard = discard;
+}
+
+/**
+ * Return true if image writes should go to overlay files
+ */
+bool DiskOverlay_IsEnabled(void)
+{
+	return OverlayDir != NULL;
+}
+
+/**
+ * Return true if overlay file contents are kept after image is closed
+ */
+bool DiskOverlay_KeepsChanges(void)
+{
+	return !bOverlayDiscard;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Store canonical absolute name of given file to 'path', which needs
+ * to be FILENAME_MAX bytes. Symbolic links are resolved when possible,
+ * so that all names of the same image give the same result.
+ */
+static void DiskOverlay_CanonicalName(const char *filename, char *path)
+{
+#ifdef HAVE_REALPATH
+	if (realpath(filename, path))
+		return;
+#endif
+	/* e.g. file that doesn't exist yet */
+	strlcpy(path, filename, FILENAME_MAX);
+	File_MakeAbsoluteName(path);
+}
+
+/**
+ * Return (malloc'ed) name of a file in the overlay directory, based on
+ * the base name of given file and a hash of its canonical path, with
+ * optional extension added to it. Hash goes before the file name
+ * extension, i.e. "disk.st" becomes "disk-<hash>.st".
+ */
+char *DiskOverlay_FileName(const char *filename, const char *ext)
+{
+	char path[FILENAME_MAX], name[FILENAME_MAX];
+	const char *base, *dot, *c;
+	Uint32 crc;
+
+	DiskOverlay_CanonicalName(filename, path);
+	crc32_reset(&crc);
+	for (c = path; *c; c++)
+		crc32_add_byte(&crc, *c);
+
+	base = strrchr(filename, PATHSEP);
+	base = base ? base + 1 : filename;
+	dot = strrchr(base, '.');
+	if (!dot || dot == base)
+		dot = base + strlen(base);
+	snprintf(name, sizeof(name), "%.*s-%08x%s", (int)(dot - base), base, crc, dot);
+
+	return File_MakePath(OverlayDir, name, ext);
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Fill delta file header for given image of given size. Image mtime
+ * and (canonical) path are included so that delta file gets discarded
+ * if it's used with another image, or the image has been replaced.
+ * Path is truncated if it doesn't fit, the file name hash covers it.
+ */
+static void DiskOverlay_InitHeader(Uint8 *header, const char *imagename, off_t size)
+{
+	char path[FILENAME_MAX];
+	struct stat st;
+	Uint64 mtime;
+	Uint32 val[6];
+	size_t len;
+
+	mtime = stat(imagename, &st) == 0 ? (Uint64)st.st_mtime : 0;
+	DiskOverlay_CanonicalName(imagename, path);
+
+	memset(header, 0, OVERLAY_HEADER_SIZE);
+	memcpy(header, OVERLAY_MAGIC, 8);
+	val[0] = SDL_SwapBE32(OVERLAY_VERSION);
+	val[1] = SDL_SwapBE32(DISK_OVERLAY_BLOCK_SIZE);
+	val[2] = SDL_SwapBE32((Uint64)size >> 32);
+	val[3] = SDL_SwapBE32((Uint64)size & 0xffffffff);
+	val[4] = SDL_SwapBE32(mtime >> 32);
+	val[5] = SDL_SwapBE32(mtime & 0xffffffff);
+	memcpy(header + 8, val, sizeof(val));
+	len = strlen(path);
+	if (len > OVERLAY_HEADER_SIZE - OVERLAY_HEADER_PATH - 1)
+		len = OVERLAY_HEADER_SIZE - OVERLAY_HEADER_PATH - 1;
+	memcpy(header + OVERLAY_HEADER_PATH, path, len);
+}
+
+/**
+ * (Re-)initialize delta file to have no blocks. Earlier file contents
+ * are truncated away, so that their data blocks don't take disk space.
+ * Return zero on success, negative errno otherwise.
+ */
+static int DiskOverlay_Reset(DISK_OVERLAY *ov, const Uint8 *header, off_t bitmap_size)
+{
+	Uint8 zeros[OVERLAY_DATA_ALIGN];
+	off_t left;
+	int n;
+
+#ifdef HAVE_FTRUNCATE
+	if (fflush(ov->fp) != 0 || ftruncate(fileno(ov->fp), 0) != 0)
+		return -errno;
+#else
+	/* re-opening drops the lock, so it needs to be taken again */
+	File_UnLock(ov->fp);
+	ov->fp = freopen(ov->filename, "wb+", ov->fp);
+	if (!ov->fp)
+		return -errno;
+	if (!File_Lock(ov->fp))
+		return -EBUSY;
+#endif
+	memset(zeros, 0, sizeof(zeros));
+	if (fseeko(ov->fp, 0, SEEK_SET) != 0 ||
+	    fwrite(header, OVERLAY_HEADER_SIZE, 1, ov->fp) != 1)
+		return -errno;
+	for (left = bitmap_size; left > 0; left -= n)
+	{
+		n = left < (off_t)sizeof(zeros) ? left : (off_t)sizeof(zeros);
+		if (fwrite(zeros, n, 1, ov->fp) != 1)
+			return -errno;
+	}
+	/* extend file to its full size, leaving data area as a hole */
+	if (fseeko(ov->fp, ov->data_offset + ov->size - 1, SEEK_SET) != 0 ||
+	    fputc(0, ov->fp) == EOF || fflush(ov->fp) != 0)
+		return -errno;
+	return 0;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Open (or create) and lock overlay file for given image of given size,
+ * and map it to memory if possible. Return NULL on error.
+ */
+DISK_OVERLAY *DiskOverlay_Open(const char *imagename, off_t size)
+{
+	Uint8 header[OVERLAY_HEADER_SIZE], expected[OVERLAY_HEADER_SIZE];
+	DISK_OVERLAY *ov;
+	off_t blocks, bitmap_size;
+	size_t n;
+
+	ov = calloc(1, sizeof(*ov));
+	if (!ov)
+		return NULL;
+	ov->filename = DiskOverlay_FileName(imagename, "ovl");
+	if (!ov->filename)
+		goto error;
+
+	blocks = (size + DISK_OVERLAY_BLOCK_SIZE - 1) / DISK_OVERLAY_BLOCK_SIZE;
+	bitmap_size = (blocks + 7) / 8;
+	ov->size = size;
+	ov->data_offset = (OVERLAY_HEADER_SIZE + bitmap_size + OVERLAY_DATA_ALIGN - 1)
+	                  / OVERLAY_DATA_ALIGN * OVERLAY_DATA_ALIGN;
+
+	/* don't truncate file before it's locked, it may be in use */
+	if (!(ov->fp = fopen(ov->filename, "rb+")) &&
+	    !(ov->fp = fopen(ov->filename, "wb+")))
+	{
+		Log_AlertDlg(LOG_ERROR, "Cannot open overlay file\n'%s'!\n", ov->filename);
+		goto error;
+	}
+	if (!File_Lock(ov->fp))
+	{
+		Log_AlertDlg(LOG_ERROR, "Locking overlay file failed (used by another Hatari?)\n'%s'!\n",
+			     ov->filename);
+		goto error;
+	}
+
+	DiskOverlay_InitHeader(expected, imagename, size);
+	n = fread(header, sizeof(header), 1, ov->fp);
+	if (bOverlayDiscard || n != 1 || memcmp(header, expected, sizeof(header)) != 0)
+	{
+		if (!bOverlayDiscard && n == 1)
+			Log_AlertDlg(LOG_WARN, "Overlay file doesn't match image '%s', discarding its contents\n'%s'.\n",
+				     imagename, ov->filename);
+		if (DiskOverlay_Reset(ov, expected, bitmap_size) != 0)
+		{
+			Log_AlertDlg(LOG_ERROR, "Initializing overlay file failed\n'%s'!\n", ov->filename);
+			goto error;
+		}
+	}
+
+#ifdef HAVE_MMAP
+	if ((Uint64)(ov->data_offset + size) <= SIZE_MAX)
+	{
+		void *map = mmap(NULL, ov->data_offset + size, PROT_READ|PROT_WRITE,
+				 MAP_SHARED, fileno(ov->fp), 0);
+		if (map != MAP_FAILED)
+			ov->map = map;
+		else
+			Log_Printf(LOG_DEBUG, "Mapping overlay file failed (%s), using file I/O.\n",
+				   strerror(errno));
+	}
+#endif
+	if (ov->map)
+	{
+		ov->bitmap = ov->map + OVERLAY_HEADER_SIZE;
+	}
+	else
+	{
+		ov->bitmap = malloc(bitmap_size);
+		if (!ov->bitmap ||
+		    fseeko(ov->fp, OVERLAY_HEADER_SIZE, SEEK_SET) != 0 ||
+		    fread(ov->bitmap, bitmap_size, 1, ov->fp) != 1)
+		{
+			Log_AlertDlg(LOG_ERROR, "Reading overlay file failed\n'%s'!\n", ov->filename);
+			free(ov->bitmap);
+			goto error;
+		}
+	}
+
+	/* file stays usable until it's closed */
+	if (bOverlayDiscard && remove(ov->filename) != 0)
+		ov->remove_on_close = true;
+
+	Log_Printf(LOG_INFO, "Writes to '%s' go to overlay file '%s'.\n",
+		   imagename, ov->filename);
+	return ov;
+
+error:
+	if (ov->fp)
+	{
+		File_UnLock(ov->fp);
+		fclose(ov->fp);
+	}
+	free(ov->filename);
+	free(ov);
+	return NULL;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Close given overlay, and remove its file if changes are discarded
+ * and that wasn't possible while it was open
+ */
+void DiskOverlay_Close(DISK_OVERLAY *ov)
+{
+	if (!ov)
+		return;
+
+	if (ov->map)
+	{
+#ifdef HAVE_MMAP
+		munmap(ov->map, ov->data_offset + ov->size);
+#endif
+	}
+	else
+	{
+		free(ov->bitmap);
+	}
+	File_UnLock(ov->fp);
+	fclose(ov->fp);
+	if (ov->remove_on_close && remove(ov->filename) != 0)
+		Log_Printf(LOG_WARN, "Removing overlay file '%s' failed: %s\n",
+			   ov->filename, strerror(errno));
+	free(ov->filename);
+	free(ov);
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Return true if given block is in the delta file
+ */
+static inline bool DiskOverlay_HasBlock(DISK_OVERLAY *ov, off_t block)
+{
+	return ov->bitmap[block >> 3] & (1 << (block & 7));
+}
+
+/**
+ * Return true if any of the blocks in given image range are in the delta file
+ */
+bool DiskOverlay_Intersects(DISK_OVERLAY *ov, off_t offset, int len)
+{
+	off_t block, last;
+
+	if (offset < 0 || len <= 0 || offset + len > ov->size)
+		return false;
+
+	last = (offset + len - 1) / DISK_OVERLAY_BLOCK_SIZE;
+	for (block = offset / DISK_OVERLAY_BLOCK_SIZE; block <= last; block++)
+	{
+		if (DiskOverlay_HasBlock(ov, block))
+			return true;
+	}
+	return false;
+}
+
+/**
+ * Return pointer to given image range in the delta file mapping, or NULL
+ * if the delta file isn't mapped, or doesn't have all of the range blocks.
+ * The data must not be modified through the pointer.
+ */
+Uint8 *DiskOverlay_Map(DISK_OVERLAY *ov, off_t offset, int len)
+{
+	off_t block, last;
+
+	if (!ov->map || offset < 0 || len < 0 || offset + len > ov->size)
+		return NULL;
+
+	last = (offset + len - 1) / DISK_OVERLAY_BLOCK_SIZE;
+	for (block = offset / DISK_OVERLAY_BLOCK_SIZE; block <= last; block++)
+	{
+		if (!DiskOverlay_HasBlock(ov, block))
+			return NULL;
+	}
+	return ov->map + ov->data_offset + offset;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Copy the parts of given image range that are in the delta file to
+ * 'buf', leave rest of it as-is. I.e. caller should read the range
+ * from the base image first. Return zero on success, negative errno
+ * otherwise.
+ */
+int DiskOverlay_Read(DISK_OVERLAY *ov, off_t offset, Uint8 *buf, int len)
+{
+	off_t block, end, last, start, stop;
+
+	if (offset < 0 || len < 0 || offset + len > ov->size)
+		return -EINVAL;
+	if (len == 0)
+		return 0;
+
+	last = (offset + len - 1) / DISK_OVERLAY_BLOCK_SIZE;
+	for (block = offset / DISK_OVERLAY_BLOCK_SIZE; block <= last; block = end)
+	{
+		end = block + 1;
+		if (!DiskOverlay_HasBlock(ov, block))
+			continue;
+
+		/* copy whole run of delta file blocks at once */
+		while (end <= last && DiskOverlay_HasBlock(ov, end))
+			end++;
+		start = block * DISK_OVERLAY_BLOCK_SIZE;
+		if (start < offset)
+			start = offset;
+		stop = end * DISK_OVERLAY_BLOCK_SIZE;
+		if (stop > offset + len)
+			stop = offset + len;
+
+		if (ov->map)
+		{
+			memcpy(buf + (start - offset), ov->map + ov->data_offset + start, stop - start);
+		}
+		else
+		{
+			if (fseeko(ov->fp, ov->data_offset + start, SEEK_SET) != 0)
+				return -errno;
+			if (fread(buf + (start - offset), stop - start, 1, ov->fp) != 1)
+				return -EIO;
+		}
+	}
+	return 0;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Write 'len' bytes from 'buf' to given image offset in the delta file.
+ * Written range needs to cover whole blocks (last block of the image
+ * can be partial). Return zero on success, negative errno otherwise.
+ */
+int DiskOverlay_Write(DISK_OVERLAY *ov, off_t offset, const Uint8 *buf, int len)
+{
+	off_t block, first, last;
+
+	if (offset < 0 || len < 0 || offset + len > ov->size ||
+	    offset % DISK_OVERLAY_BLOCK_SIZE ||
+	    (len % DISK_OVERLAY_BLOCK_SIZE && offset + len != ov->size))
+		return -EINVAL;
+	if (len == 0)
+		return 0;
+
+	/* data first, so that bitmap never refers to unwritten data */
+	if (ov->map)
+	{
+		memcpy(ov->map + ov->data_offset + offset, buf, len);
+	}
+	else
+	{
+		if (fseeko(ov->fp, ov->data_offset + offset, SEEK_SET) != 0)
+			return -errno;
+		if (fwrite(buf, len, 1, ov->fp) != 1)
+			return -EIO;
+	}
+
+	first = offset / DISK_OVERLAY_BLOCK_SIZE;
+	last = (offset + len - 1) / DISK_OVERLAY_BLOCK_SIZE;
+	for (block = first; block <= last; block++)
+		ov->bitmap[block >> 3] |= 1 << (block & 7);
+
+	if (!ov->map)
+	{
+		first >>= 3;
+		last >>= 3;
+		if (fseeko(ov->fp, OVERLAY_HEADER_SIZE + first, SEEK_SET) != 0)
+			return -errno;
+		if (fwrite(ov->bitmap + first, last - first + 1, 1, ov->fp) != 1)
+			return -EIO;
+	}
+	return 0;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Sync delta file contents to the disk, unless they're discarded anyway.
+ * Return zero on success, negative errno otherwise.
+ */
+int DiskOverlay_Sync(DISK_OVERLAY *ov)
+{
+	if (bOverlayDiscard)
+		return 0;
+
+#ifdef HAVE_MMAP
+	if (ov->map && msync(ov->map, ov->data_offset + ov->size, MS_SYNC) != 0)
+		return -errno;
+#endif
+	if (fflush(ov->fp) != 0)
+		return -errno;
+#ifdef HAVE_FSYNC
+	if (fsync(fileno(ov->fp)) != 0)
+		return -errno;
+#endif
+	return 0;
+}
@@ -90,6 +90,14 @@
 	Sampling frequency = selectable
 	Bass turnover = 118.276Hz    (8.2nF on LM1992 bass)
 	Treble turnover = 8438.756Hz (8.2nF on LM1992 treble)
+
+	Host samples are generated in blocks: the DMA frames needed for the
+	whole block are first pulled from the FIFO, then low pass filtered,
+	resampled and mixed to the YM2149 output, and finally volume and
+	tone are applied to the block. Filters keep their state between
+	blocks, so the result doesn't depend on the block sizes. There's
+	an SSE2 version of the LMC1992 filtering, handling both channels
+	at the same time.
 */
 
 
@@ -107,6 +115,11 @@ const char DmaSnd_fileid[] = "Hatari dmaSnd.c";
 #include "mfp.h"
 #include "sound.h"
 #include "stMemory.h"
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+# define DMASND_HAVE_SSE2 1
+# include <emmintrin.h>
+#endif
 #include "crossbar.h"
 #include "screen.h"
 #include "video.h"
@@ -118,19 +131,26 @@ const char DmaSnd_fileid[] = "Hatari dmaSnd.c";
 #define DMASND_FIFO_SIZE	8			/* 8 bytes : size of the DMA Audio's FIFO, filled on every HBL */
 #define DMASND_FIFO_SIZE_MASK	(DMASND_FIFO_SIZE-1)	/* mask to keep FIFO_pos in 0-7 range */
 
+#define DMASND_BLOCK_SIZE	256			/* Max number of host samples generated at a time */
+#define DMASND_BLOCK_FRAMES	1024			/* Max number of DMA frames pulled for them */
+
 
 /* Global variables that can be changed/read from other parts of Hatari */
 
-static void DmaSnd_Apply_LMC(int nMixBufIdx, int nSamplesToGenerate);
 static void DmaSnd_Set_Tone_Level(int set_bass, int set_treb);
-static float DmaSnd_IIRfilterL(float xn);
-static float DmaSnd_IIRfilterR(float xn);
 static struct first_order_s *DmaSnd_Treble_Shelf(float g, float fc, float Fs);
 static struct first_order_s *DmaSnd_Bass_Shelf(float g, float fc, float Fs);
-static Sint16 DmaSnd_LowPassFilterLeft(Sint16 in);
-static Sint16 DmaSnd_LowPassFilterRight(Sint16 in);
+static void DmaSnd_LowPassBlock(const Sint16 *in, Sint16 *out, int count);
+static void DmaSnd_LMC_BlockGeneric(Sint16 (*buf)[2], int count, bool hpf);
+#if DMASND_HAVE_SSE2
+static void DmaSnd_LMC_BlockSSE2(Sint16 (*buf)[2], int count, bool hpf);
+#endif
 static bool DmaSnd_LowPass;
 
+/* Apply LMC1992 volume and tone to 'count' stereo samples, with YM2149
+ * subsonic high pass filter if 'hpf' is set, best version for the host */
+static void (*DmaSnd_LMC_Block)(Sint16 (*buf)[2], int count, bool hpf) = DmaSnd_LMC_BlockGeneric;
+
 
 Uint16 nDmaSoundControl;                /* Sound control register */
 
@@ -179,9 +199,18 @@ struct lmc1992_s {
 	float right_gain;
 };
 
+/* Sample blocks and filter states, kept between the generated blocks */
+struct dmasnd_filter_s {
+	Sint16 raw[2 + DMASND_BLOCK_FRAMES][2];	/* DMA frames pulled from FIFO, after 2 previous ones */
+	Sint16 frames[1 + DMASND_BLOCK_FRAMES][2];/* low pass filtered DMA frames, after the previous one */
+	Sint32 hpf_x1[2], hpf_y1[2], hpf_y0[2];	/* subsonic high pass filter state per channel */
+	float iir_w1[2], iir_w2[2];		/* LMC1992 IIR filter wn-1 and wn-2 per channel */
+};
+
 static struct dma_s dma;
 static struct microwire_s microwire;
 static struct lmc1992_s lmc1992;
+static struct dmasnd_filter_s filter;
 
 /* dB = 20log(gain)  :  gain = antilog(dB/20)                                */
 /* Table gain values = (int)(powf(10.0, dB/20.0)*65536.0 + 0.5)  2dB steps   */
@@ -235,6 +264,50 @@ static void	DmaSnd_StartNewFrame(void);
 static inline int DmaSnd_EndOfFrameReached(void);
 
 
+/**
+ * Select given LMC1992 filtering kernel. Return its name, or NULL if
+ * the kernel isn't supported by the build or the host CPU.
+ */
+const char *DmaSnd_SelectKernel(int kernel)
+{
+	const char *name;
+
+	switch (kernel)
+	{
+	case DMASND_KERNEL_AUTO:
+		name = DmaSnd_SelectKernel(DMASND_KERNEL_SSE2);
+		if (!name)
+			name = DmaSnd_SelectKernel(DMASND_KERNEL_GENERIC);
+		return name;
+
+	case DMASND_KERNEL_GENERIC:
+		DmaSnd_LMC_Block = DmaSnd_LMC_BlockGeneric;
+		return "generic";
+
+	case DMASND_KERNEL_SSE2:
+#if DMASND_HAVE_SSE2
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("sse2"))
+		{
+			DmaSnd_LMC_Block = DmaSnd_LMC_BlockSSE2;
+			return "SSE2";
+		}
+#endif
+		return NULL;
+	}
+	return NULL;
+}
+
+/**
+ * Select the best filtering kernel for the host CPU, return its name
+ */
+const char *DmaSnd_Init(void)
+{
+	return DmaSnd_SelectKernel(DMASND_KERNEL_AUTO);
+}
+
+
+/*-----------------------------------------------------------------------*/
 /**
  * Reset DMA sound variables.
  */
@@ -530,181 +603,189 @@ static inline int DmaSnd_EndOfFrameReached(void)
  */
 
 
-void DmaSnd_GenerateSamples(int nMixBufIdx, int nSamplesToGenerate)
+
+/**
+ * Mix the latest DMA frame to 'count' samples in 'buf', when DMA sound
+ * is not playing.
+ */
+static void DmaSnd_MixIdle(Sint16 (*buf)[2], int count)
 {
 	int i;
-	int nBufIdx;
-	Sint8 MonoByte , LeftByte , RightByte;
-	unsigned n;
-	Sint64 FreqRatio;
-
 
-	/* DMA Audio OFF and FIFO empty : process YM2149's output */
-	if ( !(nDmaSoundControl & DMASNDCTRL_PLAY) && ( dma.FIFO_NbBytes == 0 ) )
-	{
-		for (i = 0; i < nSamplesToGenerate; i++)
-		{
-			nBufIdx = (nMixBufIdx + i) & AUDIOMIXBUFFER_SIZE_MASK;
-
-			switch (microwire.mixing) {
-				case 1:
-					/* DMA and YM2149 mixing */
-					AudioMixBuffer[nBufIdx][0] = AudioMixBuffer[nBufIdx][0] + dma.FrameLeft * -((256*3/4)/4)/4;
-					AudioMixBuffer[nBufIdx][1] = AudioMixBuffer[nBufIdx][1] + dma.FrameRight * -((256*3/4)/4)/4;
-					break;
-				default:
-					/* mixing=0 DMA only */
-					/* mixing=2 DMA and input 2 (YM2149 LPF) -> DMA */
-					/* mixing=3 DMA and input 3 -> DMA */
-					AudioMixBuffer[nBufIdx][0] = dma.FrameLeft * -((256*3/4)/4)/4;
-					AudioMixBuffer[nBufIdx][1] = dma.FrameRight * -((256*3/4)/4)/4;
-					break;
+	switch (microwire.mixing) {
+		case 1:
+			/* DMA and YM2149 mixing */
+			for (i = 0; i < count; i++)
+			{
+				buf[i][0] = buf[i][0] + dma.FrameLeft * -((256*3/4)/4)/4;
+				buf[i][1] = buf[i][1] + dma.FrameRight * -((256*3/4)/4)/4;
 			}
-		}
-
-		/* Apply LMC1992 sound modifications (Bass and Treble) */
-		DmaSnd_Apply_LMC ( nMixBufIdx , nSamplesToGenerate );
-
-		return;
+			break;
+		default:
+			/* mixing=0 DMA only */
+			/* mixing=2 DMA and input 2 (YM2149 LPF) -> DMA */
+			/* mixing=3 DMA and input 3 -> DMA */
+			for (i = 0; i < count; i++)
+			{
+				buf[i][0] = dma.FrameLeft * -((256*3/4)/4)/4;
+				buf[i][1] = dma.FrameRight * -((256*3/4)/4)/4;
+			}
+			break;
 	}
+}
 
-	/* DMA Anti-alias filter */
-	if (DmaSnd_DetectSampleRate() >  nAudioFrequency)
-		DmaSnd_LowPass = true;
-	else
-		DmaSnd_LowPass = false;
 
+/**
+ * Pull 'count' DMA frames from the FIFO to 'frames' (in mono mode,
+ * same byte is used for both channels).
+ */
+static void DmaSnd_FIFO_PullFrames(Sint16 (*frames)[2], int count)
+{
+	int i;
 
-	/* DMA Audio ON or FIFO not empty yet */
+	if (dma.soundMode & DMASNDMODE_MONO)
+	{
+		for (i = 0; i < count; i++)
+			frames[i][0] = frames[i][1] = DmaSnd_FIFO_PullByte();
+	}
+	else
+	{
+		for (i = 0; i < count; i++)
+		{
+			frames[i][0] = DmaSnd_FIFO_PullByte();
+			frames[i][1] = DmaSnd_FIFO_PullByte();
+		}
+	}
+}
 
-	/* Compute ratio between DMA's sound frequency and host computer's sound frequency, */
-	/* use << 32 to simulate floating point precision */
-	FreqRatio = ( ((Sint64)DmaSnd_DetectSampleRate()) << 32 ) / nAudioFrequency;
 
+/**
+ * Resample DMA frames to 'count' samples in 'buf' and mix them with the
+ * YM2149 samples there, when DMA sound is playing. 'FreqRatio' is the
+ * ratio between DMA's and host's sound frequency.
+ */
+static void DmaSnd_MixPlaying(Sint16 (*buf)[2], int count, Sint64 FreqRatio)
+{
+	Sint16 (*frames)[2] = filter.frames;
+	int i, k, nFirst, nFrames;
+
+	/* First frame is pulled before the first sample (when starting),
+	 * the others after each sample when the frequency counter wraps */
+	nFirst = DmaInitSample ? 1 : 0;
+	DmaInitSample = false;
+	nFrames = nFirst + ((frameCounter_float + count * FreqRatio) >> 32);
+	if (nFrames > DMASND_BLOCK_FRAMES)		/* only with < 50 Hz host frequency */
+		nFrames = DMASND_BLOCK_FRAMES;
+
+	DmaSnd_FIFO_PullFrames(&filter.raw[2], nFrames);
+	DmaSnd_LowPassBlock(filter.raw[2], frames[1], nFrames);
+	memmove(filter.raw[0], filter.raw[nFrames], 2 * sizeof(filter.raw[0]));
+
+	/* Samples before the first pulled frame use the previous one */
+	frames[0][0] = dma.FrameLeft;
+	frames[0][1] = dma.FrameRight;
+
+	k = nFirst;
 	if (dma.soundMode & DMASNDMODE_MONO)
 	{
 		/* Mono 8-bit */
-		for (i = 0; i < nSamplesToGenerate; i++)
+		for (i = 0; i < count; i++)
 		{
-			if ( DmaInitSample )
-			{
-				MonoByte = DmaSnd_FIFO_PullByte ();
-				dma.FrameLeft  = DmaSnd_LowPassFilterLeft( (Sint16)MonoByte );
-				dma.FrameRight = DmaSnd_LowPassFilterRight( (Sint16)MonoByte );
-				DmaInitSample = false;
-			}
-
-			nBufIdx = (nMixBufIdx + i) & AUDIOMIXBUFFER_SIZE_MASK;
-
-			switch (microwire.mixing) {
-				case 1:
-					/* DMA and YM2149 mixing */
-					AudioMixBuffer[nBufIdx][0] = AudioMixBuffer[nBufIdx][0] + dma.FrameLeft * -((256*3/4)/4)/4;
-					break;
-				default:
-					/* mixing=0 DMA only */
-					/* mixing=2 DMA and input 2 (YM2149 LPF) -> DMA */
-					/* mixing=3 DMA and input 3 -> DMA */
-					AudioMixBuffer[nBufIdx][0] = dma.FrameLeft * -((256*3/4)/4)/4;
-					break;
-			}
-
-			AudioMixBuffer[nBufIdx][1] = AudioMixBuffer[nBufIdx][0];	/* right = left */
-
-			/* Increase freq counter */
+			if (microwire.mixing == 1)
+				/* DMA and YM2149 mixing */
+				buf[i][0] = buf[i][0] + frames[k][0] * -((256*3/4)/4)/4;
+			else
+				/* DMA only, see DmaSnd_MixIdle() */
+				buf[i][0] = frames[k][0] * -((256*3/4)/4)/4;
+			buf[i][1] = buf[i][0];			/* right = left */
+
+			/* Increase freq counter, skip to the latest pulled frame */
 			frameCounter_float += FreqRatio;
-			n = frameCounter_float >> 32;				/* number of samples to skip */
-			while ( n > 0 )						/* pull as many bytes from the FIFO as needed */
-			{
-				MonoByte = DmaSnd_FIFO_PullByte ();
-				dma.FrameLeft  = DmaSnd_LowPassFilterLeft( (Sint16)MonoByte );
-				dma.FrameRight = DmaSnd_LowPassFilterRight( (Sint16)MonoByte );
-				n--;
-			}
-			frameCounter_float &= 0xffffffff;			/* only keep the fractional part */
+			k += frameCounter_float >> 32;
+			frameCounter_float &= 0xffffffff;	/* only keep the fractional part */
 		}
 	}
 	else
 	{
 		/* Stereo 8-bit */
-		for (i = 0; i < nSamplesToGenerate; i++)
+		for (i = 0; i < count; i++)
 		{
-			if ( DmaInitSample )
+			if (microwire.mixing == 1)
 			{
-				LeftByte = DmaSnd_FIFO_PullByte ();
-				RightByte = DmaSnd_FIFO_PullByte ();
-				dma.FrameLeft  = DmaSnd_LowPassFilterLeft( (Sint16)LeftByte );
-				dma.FrameRight = DmaSnd_LowPassFilterRight( (Sint16)RightByte );
-				DmaInitSample = false;
+				/* DMA and YM2149 mixing */
+				buf[i][0] = buf[i][0] + frames[k][0] * -((256*3/4)/4)/4;
+				buf[i][1] = buf[i][1] + frames[k][1] * -((256*3/4)/4)/4;
 			}
-
-			nBufIdx = (nMixBufIdx + i) & AUDIOMIXBUFFER_SIZE_MASK;
-
-			switch (microwire.mixing) {
-				case 1:
-					/* DMA and YM2149 mixing */
-					AudioMixBuffer[nBufIdx][0] = AudioMixBuffer[nBufIdx][0] + dma.FrameLeft * -((256*3/4)/4)/4;
-					AudioMixBuffer[nBufIdx][1] = AudioMixBuffer[nBufIdx][1] + dma.FrameRight * -((256*3/4)/4)/4;
-					break;
-				default:
-					/* mixing=0 DMA only */
-					/* mixing=2 DMA and input 2 (YM2149 LPF) -> DMA */
-					/* mixing=3 DMA and input 3 -> DMA */
-					AudioMixBuffer[nBufIdx][0] = dma.FrameLeft * -((256*3/4)/4)/4;
-					AudioMixBuffer[nBufIdx][1] = dma.FrameRight * -((256*3/4)/4)/4;
-					break;
+			else
+			{
+				/* DMA only, see DmaSnd_MixIdle() */
+				buf[i][0] = frames[k][0] * -((256*3/4)/4)/4;
+				buf[i][1] = frames[k][1] * -((256*3/4)/4)/4;
 			}
 
-			/* Increase freq counter */
+			/* Increase freq counter, skip to the latest pulled frame */
 			frameCounter_float += FreqRatio;
-			n = frameCounter_float >> 32;				/* number of samples to skip */
-			while ( n > 0 )						/* pull as many bytes from the FIFO as needed */
-			{
-				LeftByte = DmaSnd_FIFO_PullByte ();
-				RightByte = DmaSnd_FIFO_PullByte ();
-				dma.FrameLeft  = DmaSnd_LowPassFilterLeft( (Sint16)LeftByte );
-				dma.FrameRight = DmaSnd_LowPassFilterRight( (Sint16)RightByte );
-				n--;
-			}
-			frameCounter_float &= 0xffffffff;			/* only keep the fractional part */
+			k += frameCounter_float >> 32;
+			frameCounter_float &= 0xffffffff;	/* only keep the fractional part */
 		}
 	}
 
-	/* Apply LMC1992 sound modifications (Bass and Treble) */
-	DmaSnd_Apply_LMC ( nMixBufIdx , nSamplesToGenerate );
+	dma.FrameLeft = frames[nFrames][0];
+	dma.FrameRight = frames[nFrames][1];
 }
 
 
-/*-----------------------------------------------------------------------*/
-/**
- * Apply LMC1992 sound modifications (Bass and Treble)
- * The Bass and Treble get samples at nAudioFrequency rate.
- * The tone control's sampling frequency must be at least 22050 Hz to sound good.
- */
-static void DmaSnd_Apply_LMC(int nMixBufIdx, int nSamplesToGenerate)
+void DmaSnd_GenerateSamples(int nMixBufIdx, int nSamplesToGenerate)
 {
-	int nBufIdx;
-	int i;
-	Sint32 sample;
-
-	/* Apply LMC1992 sound modifications (Left, Right and Master Volume) */
-	for (i = 0; i < nSamplesToGenerate; i++) {
-		nBufIdx = (nMixBufIdx + i) & AUDIOMIXBUFFER_SIZE_MASK;
-
-		sample = DmaSnd_IIRfilterL( Subsonic_IIR_HPF_Left( AudioMixBuffer[nBufIdx][0]));
-		if (sample<-32767)						/* check for overflow to clip waveform */
-			sample = -32767;
-		else if (sample>32767)
-			sample = 32767;
-		AudioMixBuffer[nBufIdx][0] = sample;
-
-		sample = DmaSnd_IIRfilterR( Subsonic_IIR_HPF_Right(AudioMixBuffer[nBufIdx][1]));
-		if (sample<-32767)						/* check for overflow to clip waveform */
-			sample = -32767;
-		else if (sample>32767)
-			sample = 32767;
-		AudioMixBuffer[nBufIdx][1] = sample;
- 	}
+	int nBlock, nMaxBlock = DMASND_BLOCK_SIZE;
+	Sint64 FreqRatio = 0;
+	bool bPlaying;
+
+	/* DMA Audio OFF and FIFO empty : process YM2149's output */
+	bPlaying = (nDmaSoundControl & DMASNDCTRL_PLAY) || ( dma.FIFO_NbBytes > 0 );
+
+	if (bPlaying)
+	{
+		/* DMA Anti-alias filter */
+		if (DmaSnd_DetectSampleRate() >  nAudioFrequency)
+			DmaSnd_LowPass = true;
+		else
+			DmaSnd_LowPass = false;
+
+		/* Compute ratio between DMA's sound frequency and host computer's sound frequency, */
+		/* use << 32 to simulate floating point precision */
+		FreqRatio = ( ((Sint64)DmaSnd_DetectSampleRate()) << 32 ) / nAudioFrequency;
+
+		/* Each sample needs at most (FreqRatio >> 32) + 1 new DMA frames */
+		nMaxBlock = (DMASND_BLOCK_FRAMES - 1) / ((FreqRatio >> 32) + 1);
+		if (nMaxBlock > DMASND_BLOCK_SIZE)
+			nMaxBlock = DMASND_BLOCK_SIZE;
+		else if (nMaxBlock < 1)
+			nMaxBlock = 1;
+	}
+
+	while (nSamplesToGenerate > 0)
+	{
+		/* Don't go over the end of the ring buffer */
+		nMixBufIdx &= AUDIOMIXBUFFER_SIZE_MASK;
+		nBlock = AUDIOMIXBUFFER_SIZE - nMixBufIdx;
+		if (nBlock > nMaxBlock)
+			nBlock = nMaxBlock;
+		if (nBlock > nSamplesToGenerate)
+			nBlock = nSamplesToGenerate;
+
+		if (bPlaying)
+			DmaSnd_MixPlaying(&AudioMixBuffer[nMixBufIdx], nBlock, FreqRatio);
+		else
+			DmaSnd_MixIdle(&AudioMixBuffer[nMixBufIdx], nBlock);
+
+		/* Apply LMC1992 sound modifications (Volume, Bass and Treble) */
+		DmaSnd_LMC_Block(&AudioMixBuffer[nMixBufIdx], nBlock,
+		                 YM2149_HPF_Filter != YM2149_HPF_FILTER_NONE);
+
+		nMixBufIdx += nBlock;
+		nSamplesToGenerate -= nBlock;
+	}
 }
 
 
@@ -1251,95 +1332,139 @@ void DmaSnd_MicrowireMask_WriteWord(void)
 /*-------------------Bass / Treble filter ---------------------------*/
 
 /**
- * Left voice Filter for Bass/Treble.
+ * Low pass filter 'count' stereo interleaved DMA frames from 'in' to 'out'.
+ * 'in' is preceded by the two previous frames. Filter Gain = 4.
  */
-static float DmaSnd_IIRfilterL(float xn)
+static void DmaSnd_LowPassBlock(const Sint16 *in, Sint16 *out, int count)
 {
-	static float data[2] = { 0.0, 0.0 };
-	float a, yn;
+	int i;
 
-	/* Input coefficients */
-	/* biquad1  Note: 'a' coefficients are subtracted */
-	a  = lmc1992.left_gain * xn;		/* a=g*xn;               */
-	a -= lmc1992.coef[0] * data[0];		/* a1;  wn-1             */
-	a -= lmc1992.coef[1] * data[1];		/* a2;  wn-2             */
-						/* If coefficient scale  */
-						/* factor = 0.5 then     */
-						/* multiply by 2         */
-	/* Output coefficients */
-	yn  = lmc1992.coef[2] * a;		/* b0;                   */
-	yn += lmc1992.coef[3] * data[0];	/* b1;                   */
-	yn += lmc1992.coef[4] * data[1];	/* b2;                   */
-
-	data[1] = data[0];			/* wn-1 -> wn-2;         */
-	data[0] = a;				/* wn -> wn-1            */
-	return yn;
+	count *= 2;
+	if (DmaSnd_LowPass)
+	{
+		for (i = 0; i < count; i++)
+			out[i] = in[i-4] + (in[i-2]<<1) + in[i];
+	}
+	else
+	{
+		for (i = 0; i < count; i++)
+			out[i] = in[i-2] << 2;
+	}
 }
 
-
 /**
- * Right voice Filter for Bass/Treble.
+ * Apply YM2149 subsonic high pass filter (if 'hpf' is set, see
+ * Subsonic_IIR_HPF_Left() in sound.c) and LMC1992 IIR filter for volume,
+ * bass and treble to 'count' stereo samples in 'buf'.
  */
-static float DmaSnd_IIRfilterR(float xn)
+static void DmaSnd_LMC_BlockGeneric(Sint16 (*buf)[2], int count, bool hpf)
 {
-	static float data[2] = { 0.0, 0.0 };
+	float gain[2] = { lmc1992.left_gain, lmc1992.right_gain };
 	float a, yn;
+	Sint32 xn, sample;
+	int i, c;
 
-	/* Input coefficients */
-	/* biquad1  Note: 'a' coefficients are subtracted */
-	a  = lmc1992.right_gain * xn;		/* a=g*xn;               */
-	a -= lmc1992.coef[0]*data[0];		/* a1;  wn-1             */
-	a -= lmc1992.coef[1]*data[1];		/* a2;  wn-2             */
-						/* If coefficient scale  */
-						/* factor = 0.5 then     */
-						/* multiply by 2         */
-	/* Output coefficients */
-	yn  = lmc1992.coef[2]*a;		/* b0;                   */
-	yn += lmc1992.coef[3]*data[0];		/* b1;                   */
-	yn += lmc1992.coef[4]*data[1];		/* b2;                   */
-
-	data[1] = data[0];			/* wn-1 -> wn-2;         */
-	data[0] = a;				/* wn -> wn-1            */
-	return yn;
-}
-
-/**
- * LowPass Filter Left
- */
-static Sint16 DmaSnd_LowPassFilterLeft(Sint16 in)
-{
-	static	Sint16	lowPassFilter[2] = { 0, 0 };
-	static	Sint16	out = 0;
-
-	if (DmaSnd_LowPass)
-		out = lowPassFilter[0] + (lowPassFilter[1]<<1) + in;
-	else
-		out = lowPassFilter[1] << 2;
-
-	lowPassFilter[0] = lowPassFilter[1];
-	lowPassFilter[1] = in;
+	for (i = 0; i < count; i++)
+	{
+		for (c = 0; c < 2; c++)
+		{
+			xn = buf[i][c];
+			if (hpf)
+			{
+				filter.hpf_y1[c] += ((xn - filter.hpf_x1[c])<<15) - (filter.hpf_y0[c]<<6);  /*  64*y0  */
+				filter.hpf_y0[c] = filter.hpf_y1[c]>>15;
+				filter.hpf_x1[c] = xn;
+				xn = (ymsample)filter.hpf_y0[c];
+			}
 
-	return out; /* Filter Gain = 4 */
+			/* Input coefficients */
+			/* biquad1  Note: 'a' coefficients are subtracted */
+			a  = gain[c] * xn;			/* a=g*xn;               */
+			a -= lmc1992.coef[0] * filter.iir_w1[c];/* a1;  wn-1             */
+			a -= lmc1992.coef[1] * filter.iir_w2[c];/* a2;  wn-2             */
+								/* If coefficient scale  */
+								/* factor = 0.5 then     */
+								/* multiply by 2         */
+			/* Output coefficients */
+			yn  = lmc1992.coef[2] * a;		/* b0;                   */
+			yn += lmc1992.coef[3] * filter.iir_w1[c];/* b1;                   */
+			yn += lmc1992.coef[4] * filter.iir_w2[c];/* b2;                   */
+
+			filter.iir_w2[c] = filter.iir_w1[c];	/* wn-1 -> wn-2;         */
+			filter.iir_w1[c] = a;			/* wn -> wn-1            */
+
+			sample = yn;
+			if (sample<-32767)			/* check for overflow to clip waveform */
+				sample = -32767;
+			else if (sample>32767)
+				sample = 32767;
+			buf[i][c] = sample;
+		}
+	}
 }
 
+#if DMASND_HAVE_SSE2
 /**
- * LowPass Filter Right
+ * SSE2 version of the above, filtering both channels at the same time
+ * with the same floating point operations, so results are identical.
  */
-static Sint16 DmaSnd_LowPassFilterRight(Sint16 in)
+__attribute__((target("sse2")))
+static void DmaSnd_LMC_BlockSSE2(Sint16 (*buf)[2], int count, bool hpf)
 {
-	static	Sint16	lowPassFilter[2] = { 0, 0 };
-	static	Sint16	out = 0;
+	const __m128 g = _mm_setr_ps(lmc1992.left_gain, lmc1992.right_gain, 0, 0);
+	const __m128 a1 = _mm_set1_ps(lmc1992.coef[0]);
+	const __m128 a2 = _mm_set1_ps(lmc1992.coef[1]);
+	const __m128 b0 = _mm_set1_ps(lmc1992.coef[2]);
+	const __m128 b1 = _mm_set1_ps(lmc1992.coef[3]);
+	const __m128 b2 = _mm_set1_ps(lmc1992.coef[4]);
+	const __m128i clip = _mm_set1_epi16(-32767);
+	__m128 w1 = _mm_setr_ps(filter.iir_w1[0], filter.iir_w1[1], 0, 0);
+	__m128 w2 = _mm_setr_ps(filter.iir_w2[0], filter.iir_w2[1], 0, 0);
+	__m128i x1 = _mm_setr_epi32(filter.hpf_x1[0], filter.hpf_x1[1], 0, 0);
+	__m128i y1 = _mm_setr_epi32(filter.hpf_y1[0], filter.hpf_y1[1], 0, 0);
+	__m128i y0 = _mm_setr_epi32(filter.hpf_y0[0], filter.hpf_y0[1], 0, 0);
+	__m128 a, yn;
+	__m128i xn;
+	Uint32 pair;
+	int i;
 
-	if (DmaSnd_LowPass)
-		out = lowPassFilter[0] + (lowPassFilter[1]<<1) + in;
-	else
-		out = lowPassFilter[1] << 2;
+	for (i = 0; i < count; i++)
+	{
+		/* sign extend left and right sample to 32 bits */
+		memcpy(&pair, buf[i], sizeof(pair));
+		xn = _mm_cvtsi32_si128(pair);
+		xn = _mm_srai_epi32(_mm_unpacklo_epi16(xn, xn), 16);
+		if (hpf)
+		{
+			y1 = _mm_add_epi32(y1, _mm_sub_epi32(_mm_slli_epi32(_mm_sub_epi32(xn, x1), 15),
+			                                     _mm_slli_epi32(y0, 6)));
+			y0 = _mm_srai_epi32(y1, 15);
+			x1 = xn;
+			xn = _mm_srai_epi32(_mm_slli_epi32(y0, 16), 16);	/* as 16-bit ymsample */
+		}
 
-	lowPassFilter[0] = lowPassFilter[1];
-	lowPassFilter[1] = in;
+		a = _mm_mul_ps(g, _mm_cvtepi32_ps(xn));
+		a = _mm_sub_ps(a, _mm_mul_ps(a1, w1));
+		a = _mm_sub_ps(a, _mm_mul_ps(a2, w2));
+		yn = _mm_mul_ps(b0, a);
+		yn = _mm_add_ps(yn, _mm_mul_ps(b1, w1));
+		yn = _mm_add_ps(yn, _mm_mul_ps(b2, w2));
+		w2 = w1;
+		w1 = a;
+
+		/* saturate to -32768...32767, then clip to -32767 */
+		xn = _mm_max_epi16(_mm_packs_epi32(_mm_cvttps_epi32(yn), _mm_setzero_si128()), clip);
+		pair = _mm_cvtsi128_si32(xn);
+		memcpy(buf[i], &pair, sizeof(pair));
+	}
 
-	return out; /* Filter Gain = 4 */
+	_mm_storel_pi((__m64 *)filter.iir_w1, w1);
+	_mm_storel_pi((__m64 *)filter.iir_w2, w2);
+	_mm_storel_epi64((__m128i *)filter.hpf_x1, x1);
+	_mm_storel_epi64((__m128i *)filter.hpf_y1, y1);
+	_mm_storel_epi64((__m128i *)filter.hpf_y0, y0);
 }
+#endif	/* DMASND_HAVE_SSE2 */
 
 /**
  * Set Bass and Treble tone level
@@ -24,6 +24,16 @@
 
   Transfers between 2 devices can use handshaking or continuous mode
 
+  When none of the transfers driven by a clock involves the DSP or DMA
+  record, its clock interrupt handles a block of up to CROSSBAR_BLOCK_TICKS
+  ticks at once instead of one tick per interrupt. Blocks end at the tick
+  where DMA play reaches the end of its frame, so that SNDINT/SOUNDINT
+  still change at the right cycle, and the ticks whose time has already
+  passed are processed before anything reads the frame counter or the DAC
+  buffer, or before the crossbar setup changes. DSP SSI transfers always
+  get an interrupt per word, as the DSP program runs in lockstep with the
+  CPU and reacts to each SSI clock.
+
   Hardware I/O registers:
     $FF8900 (byte) : Sound DMA control
     $FF8901 (byte) : Sound DMA control
@@ -113,12 +123,16 @@ const char crossbar_fileid[] = "Hatari Crossbar.c";
 
 #define DACBUFFER_SIZE    2048
 #define DECIMAL_PRECISION 65536
+#define CROSSBAR_BLOCK_TICKS 256	/* Max number of clock ticks handled by one interrupt */
 
 
 /* Crossbar internal functions */
 static int  Crossbar_DetectSampleRate(Uint16 clock);
 static void Crossbar_Start_InterruptHandler_25Mhz(void);
 static void Crossbar_Start_InterruptHandler_32Mhz(void);
+static int  Crossbar_BlockTicks(Uint32 freq);
+static void Crossbar_CatchUp_Clocks(void);
+static void Crossbar_Sync_Clocks(void);
 
 /* Dma_Play sound functions */
 static void Crossbar_setDmaPlay_Settings(void);
@@ -304,6 +318,22 @@ static struct codec_s adc;
 static struct dsp_s dspXmit;
 static struct dsp_s dspReceive;
 
+/* Block of clock ticks handled by the next 25 Mhz / 32 Mhz interrupt */
+struct clock_block_s {
+	Uint64 startClock;		/* CPU clock when the block was started */
+	Uint32 cycles;			/* CPU cycles until the end of the block */
+	Uint32 pendingCycles;		/* delayed cycles removed from the block length */
+	Uint32 tickCycles;		/* clockXX_cycles when the block was started */
+	Uint32 tickCyclesDecimal;	/* clockXX_cycles_decimal when the block was started */
+	Uint32 counterStart;		/* clockXX_cycles_counter when the block was started */
+	Uint32 ticks;			/* number of clock ticks in the block */
+	Uint32 ticksDone;		/* ticks already processed */
+};
+
+static struct clock_block_s block25;
+static struct clock_block_s block32;
+static Uint32 nMaxBlockTicks = CROSSBAR_BLOCK_TICKS;
+
 /**
  * Reset Crossbar variables.
  */
@@ -420,6 +450,8 @@ void Crossbar_MemorySnapShot_Capture(bool bSave)
 	MemorySnapShot_Store(&adc, sizeof(adc));
 	MemorySnapShot_Store(&dspXmit, sizeof(dspXmit));
 	MemorySnapShot_Store(&dspReceive, sizeof(dspReceive));
+	MemorySnapShot_Store(&block25, sizeof(block25));
+	MemorySnapShot_Store(&block32, sizeof(block32));
 
 	/* After restoring, update the clock/freq counters */
 	if ( !bSave )
@@ -546,6 +578,8 @@ void Crossbar_DmaCtrlReg_WriteByte(void)
 {
 	Uint8 sndCtrl = IoMem_ReadByte(0xff8901);
 
+	Crossbar_Sync_Clocks();
+
 	LOG_TRACE(TRACE_CROSSBAR, "Crossbar : $ff8901 (additional Sound DMA control) write: 0x%02x\n", sndCtrl);
 
 	crossbar.dmaSelected = (sndCtrl & 0x80) >> 7;
@@ -706,6 +740,8 @@ void Crossbar_FrameStartLow_WriteByte(void)
  */
 void Crossbar_FrameCountHigh_ReadByte(void)
 {
+	Crossbar_CatchUp_Clocks();
+
 	if (crossbar.dmaSelected == 0) {
 		/* DMA Play selected */
 		IoMem_WriteByte(0xff8909, (dmaPlay.frameStartAddr + dmaPlay.frameCounter) >> 16);
@@ -743,6 +779,8 @@ void Crossbar_FrameCountHigh_WriteByte(void)
  */
 void Crossbar_FrameCountMed_ReadByte(void)
 {
+	Crossbar_CatchUp_Clocks();
+
 	if (crossbar.dmaSelected == 0) {
 		/* DMA Play selected */
 		IoMem_WriteByte(0xff890b, (dmaPlay.frameStartAddr + dmaPlay.frameCounter) >> 8);
@@ -780,6 +818,8 @@ void Crossbar_FrameCountMed_WriteByte(void)
  */
 void Crossbar_FrameCountLow_ReadByte(void)
 {
+	Crossbar_CatchUp_Clocks();
+
 	if (crossbar.dmaSelected == 0) {
 		/* DMA Play selected */
 		IoMem_WriteByte(0xff890d, (dmaPlay.frameStartAddr + dmaPlay.frameCounter));
@@ -930,6 +970,8 @@ void Crossbar_DmaTrckCtrl_WriteByte(void)
 {
 	Uint8 sndCtrl = IoMem_ReadByte(0xff8920);
 
+	Crossbar_Sync_Clocks();
+
 	LOG_TRACE(TRACE_CROSSBAR, "Crossbar : $ff8920 (sound mode control) write: 0x%02x\n", sndCtrl);
 
 	crossbar.playTracks = (sndCtrl & 3) + 1;
@@ -943,6 +985,8 @@ void Crossbar_SoundModeCtrl_WriteByte(void)
 {
 	Uint8 sndCtrl = IoMem_ReadByte(0xff8921);
 
+	Crossbar_Sync_Clocks();
+
 	LOG_TRACE(TRACE_CROSSBAR, "crossbar : $ff8921 (additional sound mode control) write: 0x%02x\n", sndCtrl);
 
 	crossbar.is16Bits = (sndCtrl & 0x40) >> 6;
@@ -987,6 +1031,8 @@ void Crossbar_SrcControler_WriteWord(void)
 {
 	Uint16 nCbSrc = IoMem_ReadWord(0xff8930);
 
+	Crossbar_Sync_Clocks();
+
 	LOG_TRACE(TRACE_CROSSBAR, "Crossbar : $ff8930 (source device) write: 0x%04x\n", nCbSrc);
 
 	dspXmit.isTristated = 1 - ((nCbSrc >> 7) & 0x1);
@@ -1035,6 +1081,8 @@ void Crossbar_DstControler_WriteWord(void)
 {
 	Uint16 destCtrl = IoMem_ReadWord(0xff8932);
 
+	Crossbar_Sync_Clocks();
+
 	LOG_TRACE(TRACE_CROSSBAR, "Crossbar : $ff8932 (destination device) write: 0x%04x\n", destCtrl);
 
 	dspReceive.isTristated = 1 - ((destCtrl & 0x80) >> 7);
@@ -1088,6 +1136,8 @@ void Crossbar_FreqDivInt_WriteByte(void)
 {
 	Uint8 clkDiv = IoMem_ReadByte(0xff8935);
 
+	Crossbar_Sync_Clocks();
+
 	LOG_TRACE(TRACE_CROSSBAR, "Crossbar : $ff8935 (int. clock divider) write: 0x%02x\n", clkDiv);
 
 	crossbar.int_freq_divider = clkDiv & 0xf;
@@ -1267,31 +1317,196 @@ static int Crossbar_DetectSampleRate(Uint16 clock)
 	return Falcon_SampleRates_32Mhz[crossbar.int_freq_divider - 1];
 }
 
+/**
+ * Return how many ticks of the given clock (CROSSBAR_FREQ_25MHZ or
+ * CROSSBAR_FREQ_32MHZ) can be handled by a single interrupt.
+ * This is 1 when the transfers done by the clock involve the DSP (its program
+ * reacts to each SSI clock) or DMA record (its end of frame interrupt),
+ * else up to the tick where DMA play reaches the end of its frame.
+ */
+static int Crossbar_BlockTicks(Uint32 freq)
+{
+	Sint32 remaining;
+	Uint32 ticks = nMaxBlockTicks;
+	bool dspXmitUsed, dmaPlayUsed, adcUsed;
+
+	if (freq == CROSSBAR_FREQ_25MHZ) {
+		adcUsed = true;
+		dspXmitUsed = crossbar.isInSteFreqMode || crossbar.dspXmit_freq == CROSSBAR_FREQ_25MHZ;
+		dmaPlayUsed = crossbar.isInSteFreqMode || crossbar.dmaPlay_freq == CROSSBAR_FREQ_25MHZ;
+	}
+	else {
+		adcUsed = false;
+		dspXmitUsed = !crossbar.isInSteFreqMode && crossbar.dspXmit_freq == CROSSBAR_FREQ_32MHZ;
+		dmaPlayUsed = !crossbar.isInSteFreqMode && crossbar.dmaPlay_freq == CROSSBAR_FREQ_32MHZ;
+	}
+
+	if (dspXmitUsed && !dspXmit.isTristated &&
+	    (dmaRecord.isConnectedToDspInHandShakeMode || dspXmit.isConnectedToCodec ||
+	     dspXmit.isConnectedToDma || dspXmit.isConnectedToDsp))
+		return 1;
+
+	if (adcUsed && ((adc.isConnectedToDsp && !dspReceive.isTristated) ||
+			(adc.isConnectedToDma && dmaRecord.isRunning)))
+		return 1;
+
+	if (dmaPlayUsed && dmaPlay.isRunning) {
+		if (dmaPlay.isConnectedToDspInHandShakeMode ||
+		    (dmaPlay.isConnectedToDsp && !dspReceive.isTristated) ||
+		    (dmaPlay.isConnectedToDma && dmaRecord.isRunning))
+			return 1;
+
+		/* A tick reads at most 2 bytes, so end of frame can't be
+		 * reached before this many ticks */
+		remaining = dmaPlay.frameEndAddr - (dmaPlay.frameStartAddr + dmaPlay.frameCounter);
+		if (remaining <= 2)
+			return 1;
+		if ((Uint32)(remaining + 1) / 2 < ticks)
+			ticks = (remaining + 1) / 2;
+	}
+
+	return ticks;
+}
+
+/**
+ * Return the number of CPU cycles from block start to the end of its
+ * first 'ticks' ticks (without removing the delayed cycles), and the
+ * corresponding fractional cycles counter in 'counter'.
+ */
+static Uint32 Crossbar_Block_TicksCycles(struct clock_block_s *block, Uint32 ticks, Uint32 *counter)
+{
+	Uint32 cycles = 0;
+	Uint32 i;
+
+	*counter = block->counterStart;
+	for (i = 0; i < ticks; i++) {
+		cycles += block->tickCycles;
+		*counter += block->tickCyclesDecimal;
+		if (*counter >= DECIMAL_PRECISION) {
+			*counter -= DECIMAL_PRECISION;
+			cycles++;
+		}
+	}
+	return cycles;
+}
+
+/**
+ * Process the ticks of a block whose time has already passed,
+ * except the last one which is processed by the clock interrupt.
+ */
+static void Crossbar_CatchUp_Block(struct clock_block_s *block, void (*tick)(void))
+{
+	Uint64 clock;
+	Uint32 cycles, counter;
+
+	if (block->ticksDone + 1 >= block->ticks)
+		return;
+
+	/* Tick times are relative to the start of the block, before removing delayed cycles */
+	clock = Cycles_GetClockCounterImmediate() + block->pendingCycles;
+	cycles = Crossbar_Block_TicksCycles(block, block->ticksDone + 1, &counter);
+
+	while (block->ticksDone + 1 < block->ticks && block->startClock + cycles <= clock) {
+		block->ticksDone++;
+		tick();
+
+		cycles += block->tickCycles;
+		counter += block->tickCyclesDecimal;
+		if (counter >= DECIMAL_PRECISION) {
+			counter -= DECIMAL_PRECISION;
+			cycles++;
+		}
+	}
+}
+
+/**
+ * End a block at its next tick (after catching up), so that a change in the
+ * crossbar setup is taken into account from that tick on.
+ */
+static void Crossbar_Truncate_Block(struct clock_block_s *block, Uint32 *cycles_counter,
+				    Uint32 *pendingCyclesOver, interrupt_id handler)
+{
+	Uint64 clock, endClock;
+	Uint32 next = block->ticksDone + 1;
+	Uint32 cycles;
+
+	if (next >= block->ticks)
+		return;
+
+	cycles = Crossbar_Block_TicksCycles(block, next, cycles_counter);
+	if (cycles >= block->pendingCycles) {
+		block->cycles = cycles - block->pendingCycles;
+	}
+	else {
+		/* Keep the delayed cycles not used by the shorter block */
+		*pendingCyclesOver += block->pendingCycles - cycles;
+		block->pendingCycles = cycles;
+		block->cycles = 0;
+	}
+	block->ticks = next;
+
+	clock = Cycles_GetClockCounterImmediate();
+	endClock = block->startClock + block->cycles;
+	CycInt_AddRelativeInterrupt(endClock > clock ? endClock - clock : 0, INT_CPU_CYCLE, handler);
+}
+
+static void Crossbar_Tick_25Mhz(void);
+static void Crossbar_Tick_32Mhz(void);
+
+/**
+ * Process the clock ticks whose time has already passed
+ */
+static void Crossbar_CatchUp_Clocks(void)
+{
+	Crossbar_CatchUp_Block(&block25, Crossbar_Tick_25Mhz);
+	Crossbar_CatchUp_Block(&block32, Crossbar_Tick_32Mhz);
+}
+
+/**
+ * Process the clock ticks whose time has already passed and handle the
+ * following ones one at a time until the next interrupt, called before
+ * registers changing the crossbar setup are modified.
+ */
+static void Crossbar_Sync_Clocks(void)
+{
+	Crossbar_CatchUp_Clocks();
+	Crossbar_Truncate_Block(&block25, &crossbar.clock25_cycles_counter,
+				&crossbar.pendingCyclesOver25, INTERRUPT_CROSSBAR_25MHZ);
+	Crossbar_Truncate_Block(&block32, &crossbar.clock32_cycles_counter,
+				&crossbar.pendingCyclesOver32, INTERRUPT_CROSSBAR_32MHZ);
+}
+
 /**
  * Start internal 25 Mhz clock interrupt.
  */
 static void Crossbar_Start_InterruptHandler_25Mhz(void)
 {
 	Uint32 cycles_25;
+	int ticks;
 
 //fprintf ( stderr , "start int25 %x %x %x %x\n" , crossbar.clock25_cycles, crossbar.clock25_cycles_counter, crossbar.clock25_cycles_decimal, crossbar.pendingCyclesOver25 );
-	cycles_25 = crossbar.clock25_cycles;
-	crossbar.clock25_cycles_counter += crossbar.clock25_cycles_decimal;
-
-	if (crossbar.clock25_cycles_counter >= DECIMAL_PRECISION) {
-		crossbar.clock25_cycles_counter -= DECIMAL_PRECISION;
-		cycles_25 ++;
-	}
+	ticks = Crossbar_BlockTicks(CROSSBAR_FREQ_25MHZ);
+	block25.tickCycles = crossbar.clock25_cycles;
+	block25.tickCyclesDecimal = crossbar.clock25_cycles_decimal;
+	block25.counterStart = crossbar.clock25_cycles_counter;
+	cycles_25 = Crossbar_Block_TicksCycles(&block25, ticks, &crossbar.clock25_cycles_counter);
 
 	if (crossbar.pendingCyclesOver25 >= cycles_25) {
+		block25.pendingCycles = cycles_25;
 		crossbar.pendingCyclesOver25 -= cycles_25;
 		cycles_25 = 0;
 	}
 	else {
+		block25.pendingCycles = crossbar.pendingCyclesOver25;
 		cycles_25 -= crossbar.pendingCyclesOver25;
 		crossbar.pendingCyclesOver25 = 0;
 	}
 
+	block25.startClock = Cycles_GetClockCounterImmediate();
+	block25.cycles = cycles_25;
+	block25.ticks = ticks;
+	block25.ticksDone = 0;
+
 	CycInt_AddRelativeInterrupt(cycles_25, INT_CPU_CYCLE, INTERRUPT_CROSSBAR_25MHZ);
 }
 
@@ -1301,49 +1516,45 @@ static void Crossbar_Start_InterruptHandler_25Mhz(void)
 static void Crossbar_Start_InterruptHandler_32Mhz(void)
 {
 	Uint32 cycles_32;
+	int ticks;
 
 //fprintf ( stderr , "start int32 %x %x %x %x\n" , crossbar.clock32_cycles, crossbar.clock32_cycles_counter, crossbar.clock32_cycles_decimal, crossbar.pendingCyclesOver32 );
-	cycles_32 = crossbar.clock32_cycles;
-	crossbar.clock32_cycles_counter += crossbar.clock32_cycles_decimal;
-
-	if (crossbar.clock32_cycles_counter >= DECIMAL_PRECISION) {
-		crossbar.clock32_cycles_counter -= DECIMAL_PRECISION;
-		cycles_32 ++;
-	}
+	ticks = Crossbar_BlockTicks(CROSSBAR_FREQ_32MHZ);
+	block32.tickCycles = crossbar.clock32_cycles;
+	block32.tickCyclesDecimal = crossbar.clock32_cycles_decimal;
+	block32.counterStart = crossbar.clock32_cycles_counter;
+	cycles_32 = Crossbar_Block_TicksCycles(&block32, ticks, &crossbar.clock32_cycles_counter);
 
 	if (crossbar.pendingCyclesOver32 >= cycles_32){
+		block32.pendingCycles = cycles_32;
 		crossbar.pendingCyclesOver32 -= cycles_32;
 		cycles_32 = 0;
 	}
 	else {
+		block32.pendingCycles = crossbar.pendingCyclesOver32;
 		cycles_32 -= crossbar.pendingCyclesOver32;
 		crossbar.pendingCyclesOver32 = 0;
 	}
 
+	block32.startClock = Cycles_GetClockCounterImmediate();
+	block32.cycles = cycles_32;
+	block32.ticks = ticks;
+	block32.ticksDone = 0;
+
 	CycInt_AddRelativeInterrupt(cycles_32, INT_CPU_CYCLE, INTERRUPT_CROSSBAR_32MHZ);
 }
 
 
 /**
- * Execute transfers for internal 25 Mhz clock.
+ * Execute transfers for one tick of internal 25 Mhz clock.
  */
-void Crossbar_InterruptHandler_25Mhz(void)
+static void Crossbar_Tick_25Mhz(void)
 {
-//fprintf ( stderr , "int25 %x\n" , crossbar.pendingCyclesOver25 );
-	/* How many cycle was this sound interrupt delayed (>= 0) */
-	crossbar.pendingCyclesOver25 += -INT_CONVERT_FROM_INTERNAL ( PendingInterruptCount , INT_CPU_CYCLE );
-
-	/* Remove this interrupt from list and re-order */
-	CycInt_AcknowledgeInterrupt();
-
 	/* If transfer mode is in Ste mode, use only this clock for all the transfers */
 	if (crossbar.isInSteFreqMode) {
 		Crossbar_Process_DSPXmit_Transfer();
 		Crossbar_Process_DMAPlay_Transfer();
 		Crossbar_Process_ADCXmit_Transfer();
-
-		/* Restart the 25 Mhz clock interrupt */
-		Crossbar_Start_InterruptHandler_25Mhz();
 		return;
 	}
 
@@ -1358,27 +1569,15 @@ void Crossbar_InterruptHandler_25Mhz(void)
 	if (crossbar.dmaPlay_freq == CROSSBAR_FREQ_25MHZ) {
 		Crossbar_Process_DMAPlay_Transfer();
 	}
-
-	/* Restart the 25 Mhz clock interrupt */
-	Crossbar_Start_InterruptHandler_25Mhz();
 }
 
 /**
- * Execute transfers for internal 32 Mhz clock.
+ * Execute transfers for one tick of internal 32 Mhz clock.
  */
-void Crossbar_InterruptHandler_32Mhz(void)
+static void Crossbar_Tick_32Mhz(void)
 {
-//fprintf ( stderr , "int32 %x\n" , crossbar.pendingCyclesOver32 );
-	/* How many cycle was this sound interrupt delayed (>= 0) */
-	crossbar.pendingCyclesOver32 += -INT_CONVERT_FROM_INTERNAL ( PendingInterruptCount , INT_CPU_CYCLE );
-
-	/* Remove this interrupt from list and re-order */
-	CycInt_AcknowledgeInterrupt();
-
 	/* If transfer mode is in Ste mode, don't use this clock for all the transfers */
 	if (crossbar.isInSteFreqMode) {
-		/* Restart the 32 Mhz clock interrupt */
-		Crossbar_Start_InterruptHandler_32Mhz();
 		return;
 	}
 
@@ -1391,6 +1590,45 @@ void Crossbar_InterruptHandler_32Mhz(void)
 	if (crossbar.dmaPlay_freq == CROSSBAR_FREQ_32MHZ) {
 		Crossbar_Process_DMAPlay_Transfer();
 	}
+}
+
+/**
+ * Execute the remaining ticks of the block for internal 25 Mhz clock.
+ */
+void Crossbar_InterruptHandler_25Mhz(void)
+{
+//fprintf ( stderr , "int25 %x\n" , crossbar.pendingCyclesOver25 );
+	/* How many cycle was this sound interrupt delayed (>= 0) */
+	crossbar.pendingCyclesOver25 += -INT_CONVERT_FROM_INTERNAL ( PendingInterruptCount , INT_CPU_CYCLE );
+
+	/* Remove this interrupt from list and re-order */
+	CycInt_AcknowledgeInterrupt();
+
+	while (block25.ticksDone < block25.ticks) {
+		block25.ticksDone++;
+		Crossbar_Tick_25Mhz();
+	}
+
+	/* Restart the 25 Mhz clock interrupt */
+	Crossbar_Start_InterruptHandler_25Mhz();
+}
+
+/**
+ * Execute the remaining ticks of the block for internal 32 Mhz clock.
+ */
+void Crossbar_InterruptHandler_32Mhz(void)
+{
+//fprintf ( stderr , "int32 %x\n" , crossbar.pendingCyclesOver32 );
+	/* How many cycle was this sound interrupt delayed (>= 0) */
+	crossbar.pendingCyclesOver32 += -INT_CONVERT_FROM_INTERNAL ( PendingInterruptCount , INT_CPU_CYCLE );
+
+	/* Remove this interrupt from list and re-order */
+	CycInt_AcknowledgeInterrupt();
+
+	while (block32.ticksDone < block32.ticks) {
+		block32.ticksDone++;
+		Crossbar_Tick_32Mhz();
+	}
 
 	/* Restart the 32 Mhz clock interrupt */
 	Crossbar_Start_InterruptHandler_32Mhz();
@@ -1866,6 +2104,9 @@ void Crossbar_GenerateSamples(int nMixBufIdx, int nSamplesToGenerate)
 	Sint16 adc_leftData, adc_rightData, dac_LeftData, dac_RightData;
 	Sint16 dac_read_left, dac_read_right;
 
+	/* Put the DAC samples of already passed clock ticks in the buffer */
+	Crossbar_CatchUp_Clocks();
+
 //fprintf ( stderr , "gen %03x %03x %03x %03x\n" , dac.writePosition , dac.readPosition , (dac.writePosition-dac.readPosition)%DACBUFFER_SIZE , nSamplesToGenerate );
 //fprintf ( stderr,  "codecAdcInput %d wordCount %d codecInputSource %d\n" , crossbar.codecAdcInput, dac.wordCount, crossbar.codecInputSource);
 //Uint32 read_pos_in = dac.readPosition;
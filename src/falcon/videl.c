@@ -961,6 +961,9 @@ bool VIDEL_renderScreen(void)
 		return false;
 	}
 
+	/* restore area potentially left under overlay led */
+	Statusbar_OverlayRestore(sdlscrn);
+
 	if (!Screen_Lock())
 		return false;
 
@@ -990,6 +993,7 @@ bool VIDEL_renderScreen(void)
 	                  videl.upperBorderSize, videl.lowerBorderSize);
 
 	Screen_UnLock();
+	Statusbar_OverlayBackup(sdlscrn);
 	Screen_GenConvUpdate(Statusbar_Update(sdlscrn, false), false);
 
 	return true;
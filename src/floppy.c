@@ -29,6 +29,7 @@ const char Floppy_fileid[] = "Hatari floppy.c";
 
 #include "main.h"
 #include "configuration.h"
+#include "diskOverlay.h"
 #include "file.h"
 #include "floppy.h"
 #include "gemdos.h"
@@ -68,8 +69,12 @@ static const char * const pszDiskImageNameExts[] =
 };
 
 
+/* Overlay files taking the writes to ST, MSA and DIM images */
+static DISK_OVERLAY *FloppyOverlay[MAX_FLOPPYDRIVES];
+
 /* local functions */
 static bool	Floppy_EjectBothDrives(void);
+static void	Floppy_OpenOverlay(int Drive, bool bRestore);
 static void	Floppy_DriveTransitionSetState ( int Drive , int State );
 
 
@@ -157,7 +162,10 @@ void Floppy_MemorySnapShot_Capture(bool bSave)
 		/* FDC_DRIVES[].DiskInserted that was restored just before), we must call FDC_InsertFloppy */
 		/* for each restored drive with an inserted disk to set FDC_DRIVES[].DiskInserted=true */
 		if ( !bSave && ( EmulationDrives[i].bDiskInserted ) )
+		{
+			Floppy_OpenOverlay ( i , true );
 			FDC_InsertFloppy ( i );
+		}
 	}
 }
 
@@ -210,6 +218,11 @@ bool Floppy_IsWriteProtected(int Drive)
 	{
 		return true;
 	}
+	else if (DiskOverlay_IsEnabled())
+	{
+		/* Writes go to the overlay, not to the image file */
+		return false;
+	}
 	else
 	{
 		struct stat FloppyStat;
@@ -512,6 +525,40 @@ int	Floppy_DriveTransitionUpdateState ( int Drive )
 }
 
 
+/*-----------------------------------------------------------------------*/
+/**
+ * Open overlay file for the ST, MSA or DIM image in given drive, if
+ * overlays are enabled. On insert, apply the changes stored in it
+ * earlier to the image. On snapshot restore, the restored image is
+ * what the overlay needs to have instead, so write all of it there
+ * (overlay can have blocks written after the snapshot was saved).
+ */
+static void Floppy_OpenOverlay(int Drive, bool bRestore)
+{
+	int ImageType = EmulationDrives[Drive].ImageType;
+
+	if (!DiskOverlay_IsEnabled() || (ImageType != FLOPPY_IMAGE_TYPE_ST
+	    && ImageType != FLOPPY_IMAGE_TYPE_MSA && ImageType != FLOPPY_IMAGE_TYPE_DIM))
+		return;
+
+	FloppyOverlay[Drive] = DiskOverlay_Open(EmulationDrives[Drive].sFileName,
+						EmulationDrives[Drive].nImageBytes);
+	if (!FloppyOverlay[Drive])
+		return;
+	if (bRestore)
+	{
+		if (DiskOverlay_Write(FloppyOverlay[Drive], 0, EmulationDrives[Drive].pBuffer,
+				      EmulationDrives[Drive].nImageBytes) != 0)
+			Log_AlertDlg(LOG_ERROR, "Writing floppy overlay file failed!");
+	}
+	else if (DiskOverlay_Read(FloppyOverlay[Drive], 0, EmulationDrives[Drive].pBuffer,
+				  EmulationDrives[Drive].nImageBytes) != 0)
+	{
+		Log_AlertDlg(LOG_ERROR, "Reading floppy overlay file failed!");
+	}
+}
+
+
 /*-----------------------------------------------------------------------*/
 /**
  * Insert previously set disk file image into floppy drive.
@@ -595,6 +642,7 @@ bool Floppy_InsertDiskIntoDrive(int Drive)
 	EmulationDrives[Drive].nImageBytes = nImageBytes;
 	EmulationDrives[Drive].bDiskInserted = true;
 	EmulationDrives[Drive].bContentsChanged = false;
+	Floppy_OpenOverlay(Drive, false);
 
 	if ( ( ImageType == FLOPPY_IMAGE_TYPE_ST ) || ( ImageType == FLOPPY_IMAGE_TYPE_MSA )
 	  || ( ImageType == FLOPPY_IMAGE_TYPE_DIM ) )
@@ -634,8 +682,15 @@ bool Floppy_EjectDiskFromDrive(int Drive)
 		/* OK, has contents changed? If so, need to save */
 		if (EmulationDrives[Drive].bContentsChanged)
 		{
+			/* With overlays, the image file itself is never written.
+			 * Changes to STX images go to the overlay directory */
+			if (FloppyOverlay[Drive] && EmulationDrives[Drive].bOKToSave)
+				Log_Printf(LOG_INFO, "Changes to floppy image '%s' are in its overlay file.", psFileName);
+			else if (DiskOverlay_IsEnabled() && (!DiskOverlay_KeepsChanges()
+				 || !STX_FileNameIsSTX(psFileName, true)))
+				Log_Printf(LOG_INFO, "Using overlays, discarded the contents of floppy image\n '%s'.", psFileName);
 			/* Is OK to save image (if boot-sector is bad, don't allow a save) */
-			if (EmulationDrives[Drive].bOKToSave)
+			else if (EmulationDrives[Drive].bOKToSave)
 			{
 				/* Save as .MSA, .ST, .DIM, .IPF or .STX image? */
 				if (MSA_FileNameIsMSA(psFileName, true))
@@ -667,6 +722,10 @@ bool Floppy_EjectDiskFromDrive(int Drive)
 		bEjected = true;
 	}
 
+	/* Close overlay file used by this image */
+	DiskOverlay_Close(FloppyOverlay[Drive]);
+	FloppyOverlay[Drive] = NULL;
+
 	/* Free data used by this IPF image */
 	if ( EmulationDrives[Drive].ImageType == FLOPPY_IMAGE_TYPE_IPF )
 		IPF_Eject ( Drive );
@@ -957,6 +1016,12 @@ bool Floppy_WriteSectors(int Drive, Uint8 *pBuffer, Uint16 Sector,
 
 		/* Write sectors (usually 512 bytes per sector) */
 		memcpy(pDiskBuffer+Offset, pBuffer, (int)Count*NUMBYTESPERSECTOR);
+		/* With overlays, changes are written to the overlay file right away */
+		if (FloppyOverlay[Drive] && EmulationDrives[Drive].bOKToSave &&
+		    DiskOverlay_Write(FloppyOverlay[Drive], Offset, pBuffer, (int)Count*NUMBYTESPERSECTOR) != 0)
+		{
+			Log_Printf(LOG_ERROR, "Writing to floppy overlay file failed.\n");
+		}
 		/* And set 'changed' flag */
 		EmulationDrives[Drive].bContentsChanged = true;
 
@@ -17,6 +17,7 @@
 const char floppy_stx_fileid[] = "Hatari floppy_stx.c";
 
 #include "main.h"
+#include "diskOverlay.h"
 #include "file.h"
 #include "floppy.h"
 #include "floppy_stx.h"
@@ -311,17 +312,27 @@ bool STX_FileNameIsSTX(const char *pszFileName, bool bAllowGZ)
 /**
  * Create a filename to save modifications made to an STX file
  * We replace the ".stx" or ".stx.gz" extension with ".wd1772"
+ * When using overlays, the file is in the overlay directory instead
+ * of next to the STX file.
  * Return true if OK
  */
 bool	STX_FileNameToSave ( const char *FilenameSTX , char *FilenameSave )
 {
-	if ( File_ChangeFileExtension ( FilenameSTX , ".stx.gz" , FilenameSave , WD1772_SAVE_FILE_EXT ) )
-		return true;
-	
-	else if ( File_ChangeFileExtension ( FilenameSTX , ".stx" , FilenameSave , WD1772_SAVE_FILE_EXT ) )
-		return true;
+	char	*FilenameOverlay;
+
+	if ( ( File_ChangeFileExtension ( FilenameSTX , ".stx.gz" , FilenameSave , WD1772_SAVE_FILE_EXT ) == false )
+	  && ( File_ChangeFileExtension ( FilenameSTX , ".stx" , FilenameSave , WD1772_SAVE_FILE_EXT ) == false ) )
+		return false;
 
-	return false;
+	if ( DiskOverlay_IsEnabled() )
+	{
+		FilenameOverlay = DiskOverlay_FileName ( FilenameSave , NULL );
+		if ( !FilenameOverlay )
+			return false;
+		snprintf ( FilenameSave , FILENAME_MAX , "%s" , FilenameOverlay );
+		free ( FilenameOverlay );
+	}
+	return true;
 }
 
 
@@ -820,7 +831,9 @@ bool	STX_Insert ( int Drive , const char *FilenameSTX , Uint8 *pImageBuffer , lo
 		return false;
 
 	/* Try to load an optional ".wd1772" save file. In case of error, we continue anyway with the current STX image */
-	if ( ( STX_FileNameToSave ( FilenameSTX , FilenameSave ) )
+	/* (when overlay changes are discarded, always start from the STX image) */
+	if ( ( !DiskOverlay_IsEnabled() || DiskOverlay_KeepsChanges() )
+	  && ( STX_FileNameToSave ( FilenameSTX , FilenameSave ) )
 	  && ( File_Exists ( FilenameSave ) ) )
 	{
 		Log_Printf ( LOG_INFO , "STX : STX_Insert drive=%d file=%s buf=%p size=%ld load wd1172 %s\n" , Drive , FilenameSTX , pImageBuffer , ImageSize , FilenameSave );
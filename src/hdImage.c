@@ -0,0 +1,412 @@
+/*
+  Hatari - hdImage.c
+
+  This file is distributed under the GNU General Public License, version 2
+  or at your option any later version. Read the file gpl.txt for details.
+
+  Hard disk image access shared by the ACSI, SCSI and IDE emulation.
+
+  When the host supports it, the whole image is memory mapped, so that
+  sectors can be transferred straight between the mapping and ST-RAM
+  (or the IDE data buffer) without going through the stdio buffers
+  and an intermediate copy. Otherwise (or if mapping the image fails,
+  e.g. for a huge image on a 32-bit host) the image is accessed with
+  stdio calls.
+
+  When written data is synced to the disk is selected with the
+  "--hd-sync" option, see HDImage_Write() and HDImage_Flush().
+
+  With "--disk-overlay", the image is opened read-only and writes go
+  to an overlay file instead, see diskOverlay.c.
+*/
+const char HDImage_fileid[] = "Hatari hdImage.c";
+
+#include <errno.h>
+#include <SDL_endian.h>
+
+#include "main.h"
+#include "configuration.h"
+#include "diskOverlay.h"
+#include "file.h"
+#include "hdImage.h"
+#include "log.h"
+
+#ifdef HAVE_MMAP
+# include <sys/mman.h>
+#endif
+#if defined(HAVE_MMAP) || defined(HAVE_FSYNC)
+# include <unistd.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+# define HDIMAGE_HAVE_SSE2 1
+# include <emmintrin.h>
+#endif
+
+static void HDImage_ByteSwapGeneric(Uint8 *dst, const Uint8 *src, int len);
+#if HDIMAGE_HAVE_SSE2
+static void HDImage_ByteSwapSSE2(Uint8 *dst, const Uint8 *src, int len);
+#endif
+
+/* Swap the bytes of 'len' / 2 16-bit words, 'dst' can be same as 'src' */
+static void (*HDImage_ByteSwapWords)(Uint8 *dst, const Uint8 *src, int len) = HDImage_ByteSwapGeneric;
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Swap the bytes of 16-bit words, one word at a time
+ */
+static void HDImage_ByteSwapGeneric(Uint8 *dst, const Uint8 *src, int len)
+{
+	Uint8 b;
+	int i;
+
+	for (i = 0; i < len - 1; i += 2)
+	{
+		b = src[i];
+		dst[i] = src[i + 1];
+		dst[i + 1] = b;
+	}
+}
+
+#if HDIMAGE_HAVE_SSE2
+/**
+ * SSE2 version of the above, 8 words at a time
+ */
+__attribute__((target("sse2")))
+static void HDImage_ByteSwapSSE2(Uint8 *dst, const Uint8 *src, int len)
+{
+	__m128i v;
+	int i;
+
+	for (i = 0; i + 16 <= len; i += 16)
+	{
+		v = _mm_loadu_si128((const __m128i *)(src + i));
+		v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+		_mm_storeu_si128((__m128i *)(dst + i), v);
+	}
+	HDImage_ByteSwapGeneric(dst + i, src + i, len - i);
+}
+#endif	/* HDIMAGE_HAVE_SSE2 */
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Copy 'len' bytes from 'src' to 'dst', swapping the bytes of each
+ * 16-bit word. 'dst' can be the same as 'src'.
+ */
+void HDImage_ByteSwap(Uint8 *dst, const Uint8 *src, int len)
+{
+	HDImage_ByteSwapWords(dst, src, len);
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Sync written data in given image range to the disk.
+ * Return zero on success, negative errno otherwise.
+ */
+static int HDImage_Sync(HD_IMAGE *img, off_t offset, off_t len)
+{
+	if (img->overlay)
+		return DiskOverlay_Sync(img->overlay);
+#ifdef HAVE_MMAP
+	if (img->map)
+	{
+		/* msync() range needs to start at a page boundary */
+		off_t page = sysconf(_SC_PAGESIZE);
+		len += offset % page;
+		offset -= offset % page;
+		if (msync(img->map + offset, len, MS_SYNC) != 0)
+			return -errno;
+	}
+#endif
+	if (fflush(img->fp) != 0)
+		return -errno;
+#ifdef HAVE_FSYNC
+	if (fsync(fileno(img->fp)) != 0)
+		return -errno;
+#endif
+	return 0;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Open (and lock) given image file of given size, and map it to memory
+ * if possible. If the file can't be opened for writing, it's opened
+ * read-only. With overlays, the file is always opened read-only (and
+ * not locked, so that it can be shared) and writes go to the overlay.
+ * Return zero on success, negative errno otherwise.
+ */
+int HDImage_Open(HD_IMAGE *img, const char *hdtype, const char *filename, off_t size)
+{
+	memset(img, 0, sizeof(*img));
+
+#if HDIMAGE_HAVE_SSE2
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse2"))
+		HDImage_ByteSwapWords = HDImage_ByteSwapSSE2;
+#endif
+
+	if (DiskOverlay_IsEnabled())
+	{
+		if (!(img->fp = fopen(filename, "rb")))
+		{
+			Log_AlertDlg(LOG_ERROR, "Cannot open %s HD file for reading\n'%s'!\n",
+				     hdtype, filename);
+			return -ENOENT;
+		}
+		if (!(img->overlay = DiskOverlay_Open(filename, size)))
+		{
+			fclose(img->fp);
+			img->fp = NULL;
+			return -EIO;
+		}
+	}
+	else if (!(img->fp = fopen(filename, "rb+")))
+	{
+		if (!(img->fp = fopen(filename, "rb")))
+		{
+			Log_AlertDlg(LOG_ERROR, "Cannot open %s HD file for reading\n'%s'!\n",
+				     hdtype, filename);
+			return -ENOENT;
+		}
+		Log_AlertDlg(LOG_WARN, "%s HD file is read-only, no writes will go through\n'%s'.\n",
+			     hdtype, filename);
+		img->read_only = true;
+	}
+	else if (!File_Lock(img->fp))
+	{
+		Log_AlertDlg(LOG_ERROR, "Locking %s HD file for writing failed\n'%s'!\n",
+			     hdtype, filename);
+		fclose(img->fp);
+		img->fp = NULL;
+		return -ENOLCK;
+	}
+	img->size = size;
+
+#ifdef HAVE_MMAP
+	if ((Uint64)size <= SIZE_MAX)
+	{
+		bool writable = !img->read_only && !img->overlay;
+		void *map = mmap(NULL, size, writable ? PROT_READ|PROT_WRITE : PROT_READ,
+				 MAP_SHARED, fileno(img->fp), 0);
+		if (map != MAP_FAILED)
+			img->map = map;
+		else
+			Log_Printf(LOG_DEBUG, "Mapping %s HD file failed (%s), using file I/O.\n",
+				   hdtype, strerror(errno));
+	}
+#endif
+	return 0;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Close given image, syncing its data unless syncing is disabled
+ */
+void HDImage_Close(HD_IMAGE *img)
+{
+	if (!img->fp)
+		return;
+
+	HDImage_Flush(img);
+	DiskOverlay_Close(img->overlay);
+#ifdef HAVE_MMAP
+	if (img->map)
+		munmap(img->map, img->size);
+#endif
+	File_UnLock(img->fp);
+	fclose(img->fp);
+	memset(img, 0, sizeof(*img));
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Return pointer to given range of the image mapping, for transferring
+ * the data directly from it, or NULL if the image isn't mapped or the
+ * range is invalid. The data must not be modified through the pointer,
+ * use HDImage_Write() for that.
+ */
+Uint8 *HDImage_Map(HD_IMAGE *img, off_t offset, int len)
+{
+	if (!img->map || offset < 0 || len < 0 || offset + len > img->size)
+		return NULL;
+	/* range needs to come either all from base image, or all from overlay */
+	if (img->overlay && DiskOverlay_Intersects(img->overlay, offset, len))
+		return DiskOverlay_Map(img->overlay, offset, len);
+	return img->map + offset;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Read 'len' bytes from given image offset to 'buf', optionally swapping
+ * the bytes of each 16-bit word. Return zero on success, negative errno
+ * otherwise.
+ */
+int HDImage_Read(HD_IMAGE *img, off_t offset, Uint8 *buf, int len, bool byteswap)
+{
+	int ret;
+
+	if (!img->fp)
+		return -ENODEV;
+	if (offset < 0 || len < 0 || offset + len > img->size)
+		return -EINVAL;
+
+	if (img->map && !img->overlay)
+	{
+		if (byteswap)
+			HDImage_ByteSwapWords(buf, img->map + offset, len);
+		else
+			memcpy(buf, img->map + offset, len);
+		return 0;
+	}
+
+	if (img->map)
+	{
+		memcpy(buf, img->map + offset, len);
+	}
+	else
+	{
+		if (fseeko(img->fp, offset, SEEK_SET) != 0)
+			return -errno;
+		ret = fread(buf, 1, len, img->fp);
+		if (ret != len)
+			return -EIO;
+	}
+	if (img->overlay)
+	{
+		ret = DiskOverlay_Read(img->overlay, offset, buf, len);
+		if (ret < 0)
+			return ret;
+	}
+	if (byteswap)
+		HDImage_ByteSwapWords(buf, buf, len);
+	return 0;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Write data to the overlay file, merging it with the current image
+ * contents if it doesn't cover whole overlay blocks.
+ * Return zero on success, negative errno otherwise.
+ */
+static int HDImage_OverlayWrite(HD_IMAGE *img, off_t offset, const Uint8 *buf, int len, bool byteswap)
+{
+	off_t start, end;
+	Uint8 *tmp;
+	int ret;
+
+	start = offset / DISK_OVERLAY_BLOCK_SIZE * DISK_OVERLAY_BLOCK_SIZE;
+	end = (offset + len + DISK_OVERLAY_BLOCK_SIZE - 1) / DISK_OVERLAY_BLOCK_SIZE * DISK_OVERLAY_BLOCK_SIZE;
+	if (end > img->size)
+		end = img->size;
+	if (start == offset && end == offset + len && !byteswap)
+		return DiskOverlay_Write(img->overlay, offset, buf, len);
+
+	tmp = malloc(end - start);
+	if (!tmp)
+		return -ENOMEM;
+	if (start != offset || end != offset + len)
+	{
+		ret = HDImage_Read(img, start, tmp, end - start, false);
+		if (ret < 0)
+		{
+			free(tmp);
+			return ret;
+		}
+	}
+	if (byteswap)
+		HDImage_ByteSwapWords(tmp + (offset - start), buf, len);
+	else
+		memcpy(tmp + (offset - start), buf, len);
+	ret = DiskOverlay_Write(img->overlay, start, tmp, end - start);
+	free(tmp);
+	return ret;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Write 'len' bytes from 'buf' to given image offset, optionally swapping
+ * the bytes of each 16-bit word. Sync them to the disk if "--hd-sync"
+ * is set to "write". Return zero on success, negative errno otherwise.
+ */
+int HDImage_Write(HD_IMAGE *img, off_t offset, const Uint8 *buf, int len, bool byteswap)
+{
+	Uint8 *tmp;
+	int ret;
+
+	if (!img->fp)
+		return -ENODEV;
+	if (img->read_only)
+		return -EACCES;
+	if (offset < 0 || len < 0 || offset + len > img->size)
+		return -EINVAL;
+
+	if (img->overlay)
+	{
+		ret = HDImage_OverlayWrite(img, offset, buf, len, byteswap);
+		if (ret < 0)
+			return ret;
+	}
+	else if (img->map)
+	{
+		if (byteswap)
+			HDImage_ByteSwapWords(img->map + offset, buf, len);
+		else
+			memcpy(img->map + offset, buf, len);
+	}
+	else
+	{
+		if (fseeko(img->fp, offset, SEEK_SET) != 0)
+			return -errno;
+		if (byteswap)
+		{
+			tmp = malloc(len);
+			if (!tmp)
+				return -ENOMEM;
+			HDImage_ByteSwapWords(tmp, buf, len);
+			ret = fwrite(tmp, 1, len, img->fp);
+			free(tmp);
+		}
+		else
+		{
+			ret = fwrite(buf, 1, len, img->fp);
+		}
+		if (ret != len)
+			return -EIO;
+	}
+	img->dirty = true;
+
+	if (ConfigureParams.HardDisk.nImageSync == HDSYNC_WRITE)
+	{
+		img->dirty = false;
+		return HDImage_Sync(img, offset, len);
+	}
+	return 0;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Emulated drive cache flush: sync all data written to the image
+ * to the disk, unless "--hd-sync" is set to "none"
+ */
+void HDImage_Flush(HD_IMAGE *img)
+{
+	int ret;
+
+	if (!img->fp || !img->dirty || ConfigureParams.HardDisk.nImageSync == HDSYNC_NONE)
+		return;
+
+	img->dirty = false;
+	ret = HDImage_Sync(img, 0, img->size);
+	if (ret < 0)
+		Log_Printf(LOG_ERROR, "Syncing HD image failed: %s\n", strerror(-ret));
+}
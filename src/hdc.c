@@ -148,6 +148,7 @@ static Uint8 *HDC_PrepRespBuf(SCSI_CTRLR *ctr, int size)
 		ctr->buffer = realloc(ctr->buffer, size);
 	}
 
+	ctr->data = ctr->buffer;
 	return ctr->buffer;
 }
 
@@ -186,8 +187,7 @@ static void HDC_Cmd_Seek(SCSI_CTRLR *ctr)
 	LOG_TRACE(TRACE_SCSI_CMD, "HDC: SEEK (%s), LBA=%i",
 	          HDC_CmdInfoStr(ctr), dev->nLastBlockAddr);
 
-	if (dev->nLastBlockAddr < dev->hdSize &&
-	    fseeko(dev->image_file, (off_t)dev->nLastBlockAddr * dev->blockSize, SEEK_SET) == 0)
+	if (dev->nLastBlockAddr < dev->hdSize)
 	{
 		LOG_TRACE(TRACE_SCSI_CMD, " -> OK\n");
 		ctr->status = HD_STATUS_OK;
@@ -521,9 +521,7 @@ static void HDC_Cmd_WriteSector(SCSI_CTRLR *ctr)
 	LOG_TRACE(TRACE_SCSI_CMD, "HDC: WRITE SECTOR (%s) with LBA 0x%x",
 	          HDC_CmdInfoStr(ctr), dev->nLastBlockAddr);
 
-	/* seek to the position */
-	if (dev->nLastBlockAddr >= dev->hdSize ||
-	    fseeko(dev->image_file, (off_t)dev->nLastBlockAddr * dev->blockSize, SEEK_SET) != 0)
+	if (dev->nLastBlockAddr >= dev->hdSize)
 	{
 		ctr->status = HD_STATUS_ERROR;
 		dev->nLastError = HD_REQSENS_INVADDR;
@@ -534,7 +532,8 @@ static void HDC_Cmd_WriteSector(SCSI_CTRLR *ctr)
 		if (ctr->data_len)
 		{
 			HDC_PrepRespBuf(ctr, ctr->data_len);
-			ctr->dmawrite_to_fh = dev->image_file;
+			ctr->dmawrite_to = &dev->image;
+			ctr->dmawrite_offset = (off_t)dev->nLastBlockAddr * dev->blockSize;
 			ctr->status = HD_STATUS_OK;
 			dev->nLastError = HD_REQSENS_OK;
 		}
@@ -558,26 +557,35 @@ static void HDC_Cmd_WriteSector(SCSI_CTRLR *ctr)
 static void HDC_Cmd_ReadSector(SCSI_CTRLR *ctr)
 {
 	SCSI_DEV *dev = &ctr->devs[ctr->target];
+	off_t offset;
 	Uint8 *buf;
-	int n;
+	int len;
 
 	dev->nLastBlockAddr = HDC_GetLBA(ctr);
 
 	LOG_TRACE(TRACE_SCSI_CMD, "HDC: READ SECTOR (%s) with LBA 0x%x",
 	          HDC_CmdInfoStr(ctr), dev->nLastBlockAddr);
 
-	/* seek to the position */
-	if (dev->nLastBlockAddr >= dev->hdSize ||
-	    fseeko(dev->image_file, (off_t)dev->nLastBlockAddr * dev->blockSize, SEEK_SET) != 0)
+	offset = (off_t)dev->nLastBlockAddr * dev->blockSize;
+	len = dev->blockSize * HDC_GetCount(ctr);
+	if (dev->nLastBlockAddr >= dev->hdSize)
 	{
 		ctr->status = HD_STATUS_ERROR;
 		dev->nLastError = HD_REQSENS_INVADDR;
 	}
+	else if ((buf = HDImage_Map(&dev->image, offset, len)))
+	{
+		/* Sectors are transferred directly from the image mapping */
+		ctr->data = buf;
+		ctr->data_len = len;
+		ctr->offset = 0;
+		ctr->status = HD_STATUS_OK;
+		dev->nLastError = HD_REQSENS_OK;
+	}
 	else
 	{
-		buf = HDC_PrepRespBuf(ctr, dev->blockSize * HDC_GetCount(ctr));
-		n = fread(buf, dev->blockSize, HDC_GetCount(ctr), dev->image_file);
-		if (n == HDC_GetCount(ctr))
+		buf = HDC_PrepRespBuf(ctr, len);
+		if (HDImage_Read(&dev->image, offset, buf, len, false) == 0)
 		{
 			ctr->status = HD_STATUS_OK;
 			dev->nLastError = HD_REQSENS_OK;
@@ -596,6 +604,23 @@ static void HDC_Cmd_ReadSector(SCSI_CTRLR *ctr)
 }
 
 
+/**
+ * Synchronize cache - sync written sectors to the host disk,
+ * depending on the "--hd-sync" option
+ */
+static void HDC_Cmd_SyncCache(SCSI_CTRLR *ctr)
+{
+	SCSI_DEV *dev = &ctr->devs[ctr->target];
+
+	LOG_TRACE(TRACE_SCSI_CMD, "HDC: SYNCHRONIZE CACHE (%s).\n", HDC_CmdInfoStr(ctr));
+
+	HDImage_Flush(&dev->image);
+	ctr->status = HD_STATUS_OK;
+	dev->nLastError = HD_REQSENS_OK;
+	dev->bSetLastBlockAddr = false;
+}
+
+
 /**
  * Test unit ready
  */
@@ -643,6 +668,10 @@ static void HDC_EmulateCommandPacket(SCSI_CTRLR *ctr)
 		HDC_Cmd_Seek(ctr);
 		break;
 
+	 case HD_SYNC_CACHE1:
+		HDC_Cmd_SyncCache(ctr);
+		break;
+
 	 case HD_SHIP:
 		LOG_TRACE(TRACE_SCSI_CMD, "HDC: SHIP (%s).\n", HDC_CmdInfoStr(ctr));
 		ctr->status = 0xFF;
@@ -691,7 +720,8 @@ static void HDC_EmulateCommandPacket(SCSI_CTRLR *ctr)
 
 /*---------------------------------------------------------------------*/
 /**
- * Return given image file (primary) partition count.
+ * Return given image (primary) partition count. Image is read through
+ * its overlay file, if it has one.
  * With tracing enabled, print also partition table.
  *
  * Supports both DOS and Atari master boot record partition
@@ -724,21 +754,17 @@ static void HDC_EmulateCommandPacket(SCSI_CTRLR *ctr)
  * Extended partition tables are described in AHDI release notes:
  *	https://www.dev-docs.org/docs/htm/search.php?find=AHDI
  */
-int HDC_PartitionCount(FILE *fp, const Uint64 tracelevel, int *pIsByteSwapped)
+int HDC_PartitionCount(HD_IMAGE *img, const Uint64 tracelevel, int *pIsByteSwapped)
 {
 	unsigned char *pinfo, bootsector[512];
 	Uint32 start, sectors, total = 0;
 	int i, parts = 0;
-	off_t offset;
-
-	if (!fp)
-		return 0;
-	offset = ftello(fp);
 
-	if (fseeko(fp, 0, SEEK_SET) != 0
-	    || fread(bootsector, sizeof(bootsector), 1, fp) != 1)
+	/* read through the image overlay, partitioning may have changed */
+	if (!img->fp
+	    || HDImage_Read(img, 0, bootsector, sizeof(bootsector), false) != 0)
 	{
-		perror("HDC_PartitionCount");
+		Log_Printf(LOG_WARN, "HDC_PartitionCount: reading the boot sector failed\n");
 		return 0;
 	}
 
@@ -828,8 +854,6 @@ int HDC_PartitionCount(FILE *fp, const Uint64 tracelevel, int *pIsByteSwapped)
 		LOG_TRACE(tracelevel, "- Total size: %.1f MB in %d partitions\n", total/2048.0, parts);
 	}
 
-	if (fseeko(fp, offset, SEEK_SET) != 0)
-		perror("HDC_PartitionCount");
 	return parts;
 }
 
@@ -881,7 +905,7 @@ off_t HDC_CheckAndGetSize(const char *hdtype, const char *filename, unsigned lon
 int HDC_InitDevice(const char *hdtype, SCSI_DEV *dev, char *filename, unsigned long blockSize)
 {
 	off_t filesize;
-	FILE *fp;
+	int ret;
 
 	dev->enabled = false;
 	Log_Printf(LOG_INFO, "Mounting %s HD image '%s'\n", hdtype, filename);
@@ -891,28 +915,12 @@ int HDC_InitDevice(const char *hdtype, SCSI_DEV *dev, char *filename, unsigned l
 	if (filesize < 0)
 		return filesize;
 
-	if (!(fp = fopen(filename, "rb+")))
-	{
-		if (!(fp = fopen(filename, "rb")))
-		{
-			Log_AlertDlg(LOG_ERROR, "Cannot open %s HD file for reading\n'%s'!\n",
-				     hdtype, filename);
-			return -ENOENT;
-		}
-		Log_AlertDlg(LOG_WARN, "%s HD file is read-only, no writes will go through\n'%s'.\n",
-			     hdtype, filename);
-	}
-	else if (!File_Lock(fp))
-	{
-		Log_AlertDlg(LOG_ERROR, "Locking %s HD file for writing failed\n'%s'!\n",
-			     hdtype, filename);
-		fclose(fp);
-		return -ENOLCK;
-	}
+	ret = HDImage_Open(&dev->image, hdtype, filename, filesize);
+	if (ret < 0)
+		return ret;
 
 	dev->blockSize = blockSize;
 	dev->hdSize = filesize / dev->blockSize;
-	dev->image_file = fp;
 	dev->enabled = true;
 
 	return 0;
@@ -943,7 +951,7 @@ bool HDC_Init(void)
 			continue;
 		if (HDC_InitDevice("ACSI", &AcsiBus.devs[i], ConfigureParams.Acsi[i].sDeviceFile, ConfigureParams.Acsi[i].nBlockSize) == 0)
 		{
-			nAcsiPartitions += HDC_PartitionCount(AcsiBus.devs[i].image_file, TRACE_SCSI_CMD, NULL);
+			nAcsiPartitions += HDC_PartitionCount(&AcsiBus.devs[i].image, TRACE_SCSI_CMD, NULL);
 			bAcsiEmuOn = true;
 		}
 		else
@@ -968,9 +976,7 @@ void HDC_UnInit(void)
 	{
 		if (!AcsiBus.devs[i].enabled)
 			continue;
-		File_UnLock(AcsiBus.devs[i].image_file);
-		fclose(AcsiBus.devs[i].image_file);
-		AcsiBus.devs[i].image_file = NULL;
+		HDImage_Close(&AcsiBus.devs[i].image);
 		AcsiBus.devs[i].enabled = false;
 	}
 	free(AcsiBus.buffer);
@@ -1081,21 +1087,21 @@ static void Acsi_DmaTransfer(void)
 	if ((nDmaMode & 0xc0) != 0x00 || AcsiBus.data_len == 0)
 		return;
 
-	if ((AcsiBus.dmawrite_to_fh && (nDmaMode & 0x100) == 0)
-	    || (!AcsiBus.dmawrite_to_fh && (nDmaMode & 0x100) != 0))
+	if ((AcsiBus.dmawrite_to && (nDmaMode & 0x100) == 0)
+	    || (!AcsiBus.dmawrite_to && (nDmaMode & 0x100) != 0))
 	{
 		Log_Printf(LOG_WARN, "DMA direction does not match SCSI command!\n");
 		return;
 	}
 
-	if (AcsiBus.dmawrite_to_fh)
+	if (AcsiBus.dmawrite_to)
 	{
 		/* write - if allowed */
 		if (STMemory_CheckAreaType(nDmaAddr, AcsiBus.data_len, ABFLAG_RAM | ABFLAG_ROM))
 		{
 #ifndef DISALLOW_HDC_WRITE
-			int wlen = fwrite(&STRam[nDmaAddr], 1, AcsiBus.data_len, AcsiBus.dmawrite_to_fh);
-			if (wlen != AcsiBus.data_len)
+			if (HDImage_Write(AcsiBus.dmawrite_to, AcsiBus.dmawrite_offset,
+			                  &STRam[nDmaAddr], AcsiBus.data_len, false) != 0)
 			{
 				Log_Printf(LOG_ERROR, "Could not write all bytes to ACSI HD image.\n");
 				AcsiBus.status = HD_STATUS_ERROR;
@@ -1108,9 +1114,9 @@ static void Acsi_DmaTransfer(void)
 				   nDmaAddr, AcsiBus.data_len);
 			AcsiBus.bDmaError = true;
 		}
-		AcsiBus.dmawrite_to_fh = NULL;
+		AcsiBus.dmawrite_to = NULL;
 	}
-	else if (!STMemory_SafeCopy(nDmaAddr, AcsiBus.buffer, AcsiBus.data_len, "ACSI DMA"))
+	else if (!STMemory_SafeCopy(nDmaAddr, AcsiBus.data, AcsiBus.data_len, "ACSI DMA"))
 	{
 		AcsiBus.bDmaError = true;
 		AcsiBus.status = HD_STATUS_ERROR;
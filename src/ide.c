@@ -394,7 +394,7 @@ struct BlockDriverState {
     void (*change_cb)(void *opaque);
     void *change_opaque;
 
-    FILE *fhndl;
+    HD_IMAGE img;
     off_t file_size;
     int media_changed;
     int byteswap;
@@ -490,7 +490,7 @@ static void bdrv_set_change_cb(BlockDriverState *bs,
  */
 static int bdrv_is_inserted(BlockDriverState *bs)
 {
-	return (bs->fhndl != NULL);
+	return (bs->img.fp != NULL);
 }
 
 
@@ -514,37 +514,22 @@ static int bdrv_read(BlockDriverState *bs, int64_t sector_num,
 {
 	int ret, len;
 
-	if (!bs->fhndl)
+	if (!bs->img.fp)
 		return -ENOMEDIUM;
 
 	len = nb_sectors * bs->sector_size;
 
-	if (fseeko(bs->fhndl, sector_num * bs->sector_size, SEEK_SET) != 0)
-	{
-		perror("bdrv_read");
-		return -errno;
-	}
-	ret = fread(buf, 1, len, bs->fhndl);
-	if (ret != len)
+	ret = HDImage_Read(&bs->img, sector_num * bs->sector_size, buf, len, bs->byteswap);
+	if (ret < 0)
 	{
-		Log_Printf(LOG_ERROR, "IDE: bdrv_read error (%d != %d length) at sector %lu!\n",
-		           ret, len, (unsigned long)sector_num);
-		return -EINVAL;
+		Log_Printf(LOG_ERROR, "IDE: bdrv_read error (%s, %d length) at sector %lu!\n",
+		           strerror(-ret), len, (unsigned long)sector_num);
+		return ret;
 	}
 
 	bs->rd_bytes += (unsigned) len;
 	bs->rd_ops ++;
 
-	if (bs->byteswap)
-	{
-		uint16_t *buf16 = (uint16_t *)buf;
-		while (len > 0) {
-			*buf16 = SDL_Swap16(*buf16);
-			buf16++;
-			len -= 2;
-		}
-	}
-
 	return 0;
 }
 
@@ -558,43 +543,21 @@ static int bdrv_read(BlockDriverState *bs, int64_t sector_num,
 static int bdrv_write(BlockDriverState *bs, int64_t sector_num,
                       const uint8_t *buf, int nb_sectors)
 {
-	int ret, len, idx;
-	uint16_t *buf16;
+	int ret, len;
 
-	if (!bs->fhndl)
+	if (!bs->img.fp)
 		return -ENOMEDIUM;
 	if (bs->read_only)
 		return -EACCES;
 
 	len = nb_sectors * bs->sector_size;
 
-	if (fseeko(bs->fhndl, sector_num * bs->sector_size, SEEK_SET) != 0)
-	{
-		perror("bdrv_write");
-		return -errno;
-	}
-
-	if (!bs->byteswap)
-	{
-		ret = fwrite(buf, 1, len, bs->fhndl);
-	}
-	else
-	{
-		buf16 = malloc(len);
-		if (!buf16)
-			return -ENOMEM;
-		for (idx = 0; idx < len; idx += 2)
-		{
-			buf16[idx / 2] = SDL_Swap16(*(const uint16_t *)&buf[idx]);
-		}
-		ret = fwrite(buf16, 1, len, bs->fhndl);
-		free(buf16);
-	}
-	if (ret != len)
+	ret = HDImage_Write(&bs->img, sector_num * bs->sector_size, buf, len, bs->byteswap);
+	if (ret < 0)
 	{
-		Log_Printf(LOG_ERROR, "IDE: bdrv_write error (%d != %d length) at sector %lu!\n",
-		           ret, len,  (unsigned long)sector_num);
-		return -EIO;
+		Log_Printf(LOG_ERROR, "IDE: bdrv_write error (%s, %d length) at sector %lu!\n",
+		           strerror(-ret), len,  (unsigned long)sector_num);
+		return ret;
 	}
 
 	bs->wr_bytes += (unsigned) len;
@@ -620,27 +583,9 @@ static int bdrv_open(BlockDriverState *bs, const char *filename, unsigned long b
 		return -1;
 	}
 
-	bs->fhndl = fopen(filename, "rb+");
-	if (!bs->fhndl) {
-		/* Maybe the file is read-only? */
-		bs->fhndl = fopen(filename, "rb");
-		if (!bs->fhndl)
-		{
-			perror("bdrv_open");
-			Log_AlertDlg(LOG_ERROR, "Cannot open IDE HD for reading\n'%s'.\n", filename);
-			return -1;
-		}
-		Log_AlertDlg(LOG_WARN, "IDE HD file is read-only, no writes will go through\n'%s'.\n",
-			     filename);
-		bs->read_only = 1;
-	}
-	else if (!File_Lock(bs->fhndl))
-	{
-		Log_AlertDlg(LOG_ERROR, "Locking IDE HD file for writing failed\n'%s'!\n", filename);
-		fclose(bs->fhndl);
-		bs->fhndl = NULL;
+	if (HDImage_Open(&bs->img, "IDE", filename, bs->file_size) < 0)
 		return -1;
-	}
+	bs->read_only = bs->img.read_only;
 
 	/* call the change callback */
 	bs->media_changed = 1;
@@ -652,14 +597,12 @@ static int bdrv_open(BlockDriverState *bs, const char *filename, unsigned long b
 
 static void bdrv_flush(BlockDriverState *bs)
 {
-	fflush(bs->fhndl);
+	HDImage_Flush(&bs->img);
 }
 
 static void bdrv_close(BlockDriverState *bs)
 {
-	File_UnLock(bs->fhndl);
-	fclose(bs->fhndl);
-	bs->fhndl = NULL;
+	HDImage_Close(&bs->img);
 }
 
 /**
@@ -2719,7 +2662,7 @@ void Ide_Init(void)
 				ConfigureParams.Ide[i].bUseDevice = false;
 				continue;
 			}
-			nIDEPartitions += HDC_PartitionCount(hd_table[i]->fhndl, TRACE_IDE, &is_byteswap);
+			nIDEPartitions += HDC_PartitionCount(&hd_table[i]->img, TRACE_IDE, &is_byteswap);
 			/* Our IDE implementation is little endian by default,
 			 * so we need to byteswap if the image is not swapped! */
 			if (ConfigureParams.Ide[i].nByteSwap == BYTESWAP_AUTO)
@@ -12,8 +12,23 @@ extern int nAudioFrequency;
 extern bool bSoundWorking;
 extern int SoundBufferSize;
 extern int SdlAudioBufferSize;
+extern bool bAudioOffline;
 extern int pulse_swallowing_count;
 
+/* Buffer fill histogram buckets, in quarters of the target latency */
+#define AUDIO_FILL_HISTO_SIZE	9
+
+/* Audio callback statistics, counted since startup */
+typedef struct
+{
+	Uint32 nCallbacks;		/* Audio callback calls */
+	Uint32 nConsumed;		/* Samples read from AudioMixBuffer[] */
+	Uint32 nUnderruns;		/* Callbacks which ran out of samples */
+	Uint32 nRefills;		/* Callbacks which played silence waiting for enough samples */
+	Uint32 nSkips;			/* Resyncs which skipped to the most recent samples */
+	Uint32 nSkipped;		/* Samples dropped by those */
+	Uint32 FillHisto[AUDIO_FILL_HISTO_SIZE];	/* Buffered samples on callback entry */
+} AUDIO_STATS;
 
 extern void Audio_Init(void);
 extern void Audio_UnInit(void);
@@ -22,5 +37,6 @@ extern void Audio_Unlock(void);
 extern void Audio_FreeSoundBuffer(void);
 extern void Audio_SetOutputAudioFreq(int Frequency);
 extern void Audio_EnableAudio(bool bEnable);
+extern void Audio_GetStats(AUDIO_STATS *pStats);
 
 #endif  /* HATARI_AUDIO_H */
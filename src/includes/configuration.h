@@ -227,6 +227,13 @@ typedef enum
   GEMDOS_LOWER
 } GEMDOS_CHR_CONV;
 
+typedef enum
+{
+  HDSYNC_NONE,				/* leave writing back to the host OS */
+  HDSYNC_FLUSH,				/* on emulated drive cache flush and unmount */
+  HDSYNC_WRITE				/* after every write */
+} HDSYNC;
+
 typedef struct
 {
   int nGemdosDrive;
@@ -237,6 +244,7 @@ typedef struct
   bool bGemdosHostTime;
   bool bBootFromHardDisk;
   char szHardDiskDirectories[MAX_HARDDRIVES][FILENAME_MAX];
+  HDSYNC nImageSync;			/* when ACSI/SCSI/IDE image writes are synced to disk */
 } CNF_HARDDISK;
 
 /* SCSI/ACSI/IDE configuration */
@@ -304,6 +312,8 @@ typedef struct
   bool bResizable;
   bool bUseVsync;
   bool bUseSdlRenderer;
+  bool bRenderThread;             /* Convert ST/STE screen in a separate thread */
+  int nCpuScale;                  /* SCALE_MODE_* for scaling window on the CPU */
   float nZoomFactor;
   int nSpec512Threshold;
   int nForceBpp;
@@ -389,6 +399,7 @@ typedef struct
   bool bPatchTimerD;
   bool bFastBoot;                 /* Enable to patch TOS for fast boot */
   bool bFastForward;
+  int nFastForwardTurbo;          /* >0 : fast forward with less accuracy, drawing every Nth frame */
   bool bAddressSpace24;           /* true if using a 24-bit address bus */
   VIDEOTIMINGMODE VideoTimingMode;
 
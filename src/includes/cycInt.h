@@ -121,6 +121,11 @@ static inline void CycInt_Process_Clock(Uint64 Clock)
 	while ( ( PendingInterruptCount <= 0 ) && ( PendingInterruptFunction ) )
 		CALL_VAR(PendingInterruptFunction);
 }
+/* Return true if an interrupt handler should be called before the next instruction */
+static inline bool CycInt_Pending(void)
+{
+	return ( PendingInterruptCount <= 0 ) && ( PendingInterruptFunction );
+}
 
 #else
 
@@ -140,6 +145,11 @@ static inline void CycInt_Process_Clock(Uint64 Clock)
 	while ( CycInt_ActiveInt_Cycles <= ( Clock << CYCINT_SHIFT ) )
 		CycInt_CallActiveHandler( Clock );
 }
+/* Return true if an interrupt handler should be called before the next instruction */
+static inline bool CycInt_Pending(void)
+{
+	return CycInt_ActiveInt_Cycles <= ( CyclesGlobalClockCounter << CYCINT_SHIFT );
+}
 
 #endif
 
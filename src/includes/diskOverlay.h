@@ -0,0 +1,44 @@
+/*
+  Hatari - diskOverlay.h
+
+  This file is distributed under the GNU General Public License, version 2
+  or at your option any later version. Read the file gpl.txt for details.
+
+  Copy-on-write overlay (delta) files for hard disk and floppy images.
+*/
+
+#ifndef HATARI_DISKOVERLAY_H
+#define HATARI_DISKOVERLAY_H
+
+#include <sys/types.h>  /* For off_t */
+
+/* Overlay granularity, writes need to be aligned to this */
+#define DISK_OVERLAY_BLOCK_SIZE 512
+
+/**
+ * Opened overlay file
+ */
+typedef struct {
+	FILE *fp;                   /* Delta file */
+	char *filename;             /* Delta file name */
+	Uint8 *map;                 /* Mapping of the whole delta file, NULL if not mapped */
+	Uint8 *bitmap;              /* Bit for each block, set when it's in the delta file */
+	off_t size;                 /* Size of the overlaid image */
+	off_t data_offset;          /* Offset of the block data in the delta file */
+	bool remove_on_close;       /* Discarded file couldn't be removed while open */
+} DISK_OVERLAY;
+
+extern bool DiskOverlay_SetDir(const char *dir);
+extern void DiskOverlay_SetDiscard(bool discard);
+extern bool DiskOverlay_IsEnabled(void);
+extern bool DiskOverlay_KeepsChanges(void);
+extern char *DiskOverlay_FileName(const char *filename, const char *ext);
+extern DISK_OVERLAY *DiskOverlay_Open(const char *imagename, off_t size);
+extern void DiskOverlay_Close(DISK_OVERLAY *ov);
+extern bool DiskOverlay_Intersects(DISK_OVERLAY *ov, off_t offset, int len);
+extern Uint8 *DiskOverlay_Map(DISK_OVERLAY *ov, off_t offset, int len);
+extern int DiskOverlay_Read(DISK_OVERLAY *ov, off_t offset, Uint8 *buf, int len);
+extern int DiskOverlay_Write(DISK_OVERLAY *ov, off_t offset, const Uint8 *buf, int len);
+extern int DiskOverlay_Sync(DISK_OVERLAY *ov);
+
+#endif /* HATARI_DISKOVERLAY_H */
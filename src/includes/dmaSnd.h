@@ -12,8 +12,17 @@
 #define DMASNDCTRL_PLAYLOOP     0x02
 #define DMASNDMODE_MONO         0x80
 
+enum {
+	DMASND_KERNEL_AUTO,
+	DMASND_KERNEL_GENERIC,
+	DMASND_KERNEL_SSE2,
+	DMASND_KERNEL_COUNT
+};
+
 extern Uint16 nDmaSoundControl;
 
+extern const char *DmaSnd_SelectKernel(int kernel);
+extern const char *DmaSnd_Init(void);
 extern void DmaSnd_Reset(bool bCold);
 extern void DmaSnd_MemorySnapShot_Capture(bool bSave);
 
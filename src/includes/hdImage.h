@@ -0,0 +1,36 @@
+/*
+  Hatari - hdImage.h
+
+  This file is distributed under the GNU General Public License, version 2
+  or at your option any later version. Read the file gpl.txt for details.
+
+  Hard disk image access shared by the ACSI, SCSI and IDE emulation.
+*/
+
+#ifndef HATARI_HDIMAGE_H
+#define HATARI_HDIMAGE_H
+
+#include <sys/types.h>  /* For off_t */
+#include "diskOverlay.h"
+
+/**
+ * Opened hard disk image file
+ */
+typedef struct {
+	FILE *fp;                   /* Image file, NULL when not open */
+	Uint8 *map;                 /* Mapping of the whole image, NULL if not mapped */
+	off_t size;                 /* Image size in bytes */
+	DISK_OVERLAY *overlay;      /* Overlay file taking the writes, or NULL */
+	bool read_only;             /* Image couldn't be opened for writing */
+	bool dirty;                 /* Written since the last sync */
+} HD_IMAGE;
+
+extern int HDImage_Open(HD_IMAGE *img, const char *hdtype, const char *filename, off_t size);
+extern void HDImage_Close(HD_IMAGE *img);
+extern Uint8 *HDImage_Map(HD_IMAGE *img, off_t offset, int len);
+extern int HDImage_Read(HD_IMAGE *img, off_t offset, Uint8 *buf, int len, bool byteswap);
+extern int HDImage_Write(HD_IMAGE *img, off_t offset, const Uint8 *buf, int len, bool byteswap);
+extern void HDImage_Flush(HD_IMAGE *img);
+extern void HDImage_ByteSwap(Uint8 *dst, const Uint8 *src, int len);
+
+#endif /* HATARI_HDIMAGE_H */
@@ -12,6 +12,7 @@
 #define HATARI_HDC_H
 
 #include <sys/types.h>  /* For off_t */
+#include "hdImage.h"
 
 /* Opcodes */
 /* The following are multi-sector transfers with seek implied */
@@ -33,6 +34,7 @@
 #define HD_REQ_SENSE       0x03               /* Request sense */
 #define HD_SHIP            0x1B               /* Ship drive */
 #define HD_READ_CAPACITY1  0x25               /* Read capacity (class 1) */
+#define HD_SYNC_CACHE1     0x35               /* Synchronize cache (class 1) */
 #define HD_REPORT_LUNS     0xa0               /* Report Luns */
 
 /* Status codes */
@@ -54,7 +56,7 @@
  */
 typedef struct scsi_data {
 	bool enabled;
-	FILE *image_file;
+	HD_IMAGE image;
 	Uint32 nLastBlockAddr;      /* The specified sector number */
 	bool bSetLastBlockAddr;
 	Uint8 nLastError;
@@ -80,9 +82,11 @@ typedef struct {
 	short int status;           /* return code from the HDC operation */
 	Uint8 *buffer;              /* Response buffer */
 	int buffer_size;
+	Uint8 *data;                /* Data to send: buffer, or image mapping */
 	int data_len;
 	int offset;                 /* Current offset into data buffer */
-	FILE *dmawrite_to_fh;
+	HD_IMAGE *dmawrite_to;      /* Image for received data, or NULL */
+	off_t dmawrite_offset;      /* ...and offset into it */
 	SCSI_DEV devs[8];
 } SCSI_CTRLR;
 
@@ -99,7 +103,7 @@ extern int HDC_InitDevice(const char *hdtype, SCSI_DEV *dev, char *filename, uns
 extern void HDC_ResetCommandStatus(void);
 extern short int HDC_ReadCommandByte(int addr);
 extern void HDC_WriteCommandByte(int addr, Uint8 byte);
-extern int HDC_PartitionCount(FILE *fp, const Uint64 tracelevel, int *pIsByteSwapped);
+extern int HDC_PartitionCount(HD_IMAGE *img, const Uint64 tracelevel, int *pIsByteSwapped);
 extern off_t HDC_CheckAndGetSize(const char *hdtype, const char *filename, unsigned long blockSize);
 extern bool HDC_WriteCommandPacket(SCSI_CTRLR *ctr, Uint8 b);
 extern void HDC_DmaTransfer(void);
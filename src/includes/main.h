@@ -56,12 +56,15 @@
 
 
 extern bool bQuitProgram;
+extern bool bFastForwardTurbo;
 
 extern bool Main_PauseEmulation(bool visualize);
 extern bool Main_UnPauseEmulation(void);
 extern void Main_RequestQuit(int exitval);
 extern void Main_SetQuitValue(int exitval);
 extern Uint32 Main_SetRunVBLs(Uint32 vbls);
+extern void Main_SetPreviewFrames(int frames);
+extern int Main_GetPreviewFrames(void);
 extern const char* Main_SetVBLSlowdown(int factor);
 extern void Main_WaitOnVbl(void);
 extern void Main_WarpMouse(int x, int y, bool restore);
@@ -10,6 +10,9 @@
 extern bool bLoadAutoSave;
 extern bool bLoadMemorySave;
 extern bool AviRecordOnStartup;
+extern bool SoundRecordOnStartup;
+extern bool YMRenderOnStartup;
+extern char YMRenderFileName[FILENAME_MAX];
 extern bool BenchmarkMode;
 
 extern bool Opt_IsAtariProgram(const char *path);
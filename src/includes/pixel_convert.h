@@ -90,3 +90,47 @@ static inline void PixelConvert_32to24Bits_BGR(Uint8 *dst, Uint32 *src, int dw,
 		*dst++ = (((sval & fmt->Rmask) >> fmt->Rshift) << fmt->Rloss);
 	}
 }
+
+
+
+/*----------------------------------------------------------------------*/
+/* Convert pixels to 32-bit BGRX (4 bytes per pixel, used in ZMBV format)*/
+/*----------------------------------------------------------------------*/
+
+/**
+ * Unpack 16-bit RGB pixels to 32-bit BGRX pixels
+ */
+static inline void PixelConvert_16to32Bits_BGRX(Uint8 *dst, Uint16 *src, int dw, SDL_Surface *surf)
+{
+	SDL_PixelFormat *fmt = surf->format;
+	Uint16 sval;
+	int dx;
+
+	for (dx = 0; dx < dw; dx++)
+	{
+		sval = src[(dx * surf->w + dw/2) / dw];
+		*dst++ = (((sval & fmt->Bmask) >> fmt->Bshift) << fmt->Bloss);
+		*dst++ = (((sval & fmt->Gmask) >> fmt->Gshift) << fmt->Gloss);
+		*dst++ = (((sval & fmt->Rmask) >> fmt->Rshift) << fmt->Rloss);
+		*dst++ = 0;
+	}
+}
+
+/**
+ *  unpack 32-bit RGBA pixels to 32-bit BGRX pixels
+ */
+static inline void PixelConvert_32to32Bits_BGRX(Uint8 *dst, Uint32 *src, int dw, SDL_Surface *surf)
+{
+	SDL_PixelFormat *fmt = surf->format;
+	Uint32 sval;
+	int dx;
+
+	for (dx = 0; dx < dw; dx++)
+	{
+		sval = src[(dx * surf->w + dw/2) / dw];
+		*dst++ = (((sval & fmt->Bmask) >> fmt->Bshift) << fmt->Bloss);
+		*dst++ = (((sval & fmt->Gmask) >> fmt->Gshift) << fmt->Gloss);
+		*dst++ = (((sval & fmt->Rmask) >> fmt->Rshift) << fmt->Rloss);
+		*dst++ = 0;
+	}
+}
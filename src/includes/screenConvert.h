@@ -8,6 +8,8 @@
 void Screen_RemapPalette(void);
 void Screen_SetPaletteColor(Uint8 idx, Uint8 red, Uint8 green, Uint8 blue);
 void ScreenConv_MemorySnapShot_Capture(bool bSave);
+void ScreenConv_SetFullUpdate(void);
+bool ScreenConv_GetChangedRows(int *first, int *last);
 
 void Screen_GenConvert(uint32_t vaddr, void *fvram, int vw, int vh,
                        int vbpp, int nextline, int hscroll,
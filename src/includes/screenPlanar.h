@@ -0,0 +1,51 @@
+/*
+  Hatari - screenPlanar.h
+
+  This file is distributed under the GNU General Public License, version 2
+  or at your option any later version. Read the file gpl.txt for details.
+*/
+
+#ifndef HATARI_SCREENPLANAR_H
+#define HATARI_SCREENPLANAR_H
+
+enum {
+	PLANAR_KERNEL_AUTO,
+	PLANAR_KERNEL_GENERIC,
+	PLANAR_KERNEL_SSE2,
+	PLANAR_KERNEL_NEON,
+	PLANAR_KERNEL_COUNT
+};
+
+/**
+ * Convert 'blocks' groups of 16 pixels stored as 'planes' big endian
+ * bitplane words each (Atari interleaved bitplane format, 1-8 planes)
+ * to 'blocks' * 16 bytes of color indexes.
+ */
+extern void (*ScreenPlanar_ToChunky)(const Uint8 *planar, int planes,
+                                     int blocks, Uint8 *chunky);
+
+/* Host 32-bit pixel format for the true color conversion */
+typedef struct {
+	int Rshift, Gshift, Bshift;
+	Uint32 Amask;
+} SCREENPLANAR_RGB32;
+
+/**
+ * Convert 'count' Falcon true color pixels (big endian RGB565 words)
+ * to host 16-bit RGB565 pixels.
+ */
+extern void (*ScreenPlanar_HiColorTo16bpp)(const Uint8 *src, int count,
+                                           Uint16 *dst);
+
+/**
+ * Convert 'count' Falcon true color pixels (big endian RGB565 words)
+ * to host 32-bit pixels with 8-bit color channels in given format.
+ */
+extern void (*ScreenPlanar_HiColorTo32bpp)(const Uint8 *src, int count,
+                                           Uint32 *dst,
+                                           const SCREENPLANAR_RGB32 *fmt);
+
+extern const char *ScreenPlanar_SelectKernel(int kernel);
+extern const char *ScreenPlanar_Init(void);
+
+#endif /* HATARI_SCREENPLANAR_H */
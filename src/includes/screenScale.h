@@ -0,0 +1,74 @@
+/*
+  Hatari - screenScale.h
+
+  This file is distributed under the GNU General Public License, version 2
+  or at your option any later version. Read the file gpl.txt for details.
+*/
+
+#ifndef HATARI_SCREENSCALE_H
+#define HATARI_SCREENSCALE_H
+
+#include <SDL_rect.h>    /* for SDL_Rect */
+
+/* Values for ConfigureParams.Screen.nCpuScale */
+enum {
+	SCALE_MODE_OFF,		/* scaling (if any) done by SDL renderer */
+	SCALE_MODE_NEAREST,	/* integer factor, pixels repeated */
+	SCALE_MODE_SCANLINES,	/* integer factor, last line of each pixel dimmed */
+	SCALE_MODE_SHARP,	/* any factor, sharp-bilinear filtering */
+	SCALE_MODE_COUNT
+};
+
+enum {
+	SCALE_KERNEL_AUTO,
+	SCALE_KERNEL_GENERIC,
+	SCALE_KERNEL_SSE2,
+	SCALE_KERNEL_COUNT
+};
+
+/* Source pixel pair for a linearly filtered destination pixel */
+typedef struct {
+	Uint16 index;		/* left/upper source pixel */
+	Uint16 weight;		/* weight of the next pixel, 0-256 */
+} SCREENSCALE_TAP;
+
+/**
+ * Repeat each of 'count' 32-bit source pixels 'factor' times to 'dst'.
+ */
+extern void (*ScreenScale_RowNearest)(const Uint32 *src, int count,
+                                      int factor, Uint32 *dst);
+
+/**
+ * Darken 'count' 32-bit pixels to 3/4 brightness for scanlines,
+ * 'amask' bits (alpha channel) are kept set.
+ */
+extern void (*ScreenScale_RowDim)(const Uint32 *src, int count,
+                                  Uint32 amask, Uint32 *dst);
+
+/**
+ * Blend 'count' pixels of rows 'a' and 'b' to 'dst', 'weight' (0-256)
+ * being the share of row 'b'.
+ */
+extern void (*ScreenScale_RowBlend)(const Uint32 *a, const Uint32 *b,
+                                    int weight, int count, Uint32 *dst);
+
+/**
+ * Produce 'count' pixels from the source row, each one from the pixel
+ * pair given by its tap.
+ */
+extern void (*ScreenScale_RowLinear)(const Uint32 *src, const SCREENSCALE_TAP *taps,
+                                     int count, Uint32 *dst);
+
+extern bool ScreenScale_SetSize(int mode, int src_w, int src_h,
+                                int dst_w, int dst_h, Uint32 amask,
+                                SDL_Rect *area);
+extern void ScreenScale_Rows(const Uint8 *src, int src_pitch, int y, int h,
+                             Uint8 *dst, int dst_pitch, SDL_Rect *rect);
+extern void ScreenScale_MapPosition(int *x, int *y);
+extern void ScreenScale_MapMotion(int *dx, int *dy);
+extern void ScreenScale_UnInit(void);
+
+extern const char *ScreenScale_SelectKernel(int kernel);
+extern const char *ScreenScale_Init(void);
+
+#endif /* HATARI_SCREENSCALE_H */
@@ -10,10 +10,24 @@
 
 #include <SDL_video.h>
 
+/* Memory buffer for ScreenSnapShot_SavePNG_ToBuffer() */
+typedef struct {
+	Uint8 *Data;
+	int Size;			/* bytes used */
+	int AllocSize;			/* bytes allocated */
+} SCREENSNAPSHOT_PNG_BUFFER;
+
 extern int ScreenSnapShot_SavePNG_ToFile(SDL_Surface *surface, int destw,
 		int desth, FILE *fp, int png_compression_level, int png_filter,
 		int CropLeft , int CropRight , int CropTop , int CropBottom );
+extern int ScreenSnapShot_SavePNG_ToBuffer(SDL_Surface *surface, int destw,
+		int desth, SCREENSNAPSHOT_PNG_BUFFER *buf, int png_compression_level, int png_filter);
 extern void ScreenSnapShot_SaveScreen(void);
 extern void ScreenSnapShot_SaveToFile(const char *filename);
+extern bool ScreenSnapShot_SetFrameLog(const char *filename);
+extern bool ScreenSnapShot_SetFrameDumpDir(const char *dirname);
+extern bool ScreenSnapShot_IsFrameLogging(void);
+extern void ScreenSnapShot_CloseFrameLog(void);
+extern void ScreenSnapShot_LogFrame(int nVBL);
 
 #endif /* ifndef HATARI_SCREENSNAPSHOT_H */
@@ -11,21 +11,21 @@
 #ifndef HATARI_SOUND_H
 #define HATARI_SOUND_H
 
+#include <SDL_atomic.h>
+
 
 /* definitions common for all sound rendering engines */
 
 
 extern Uint8	SoundRegs[ 14 ];		/* store YM regs 0 to 13 */
-extern int	nGeneratedSamples;
 extern bool	bEnvelopeFreqFlag;
 
 #define AUDIOMIXBUFFER_SIZE    16384		/* Size of circular buffer to store samples (eg 44Khz), must be a power of 2 */
 #define AUDIOMIXBUFFER_SIZE_MASK ( AUDIOMIXBUFFER_SIZE - 1 )	/* To limit index values inside AudioMixBuffer[] */
 extern Sint16	AudioMixBuffer[AUDIOMIXBUFFER_SIZE][2];	/* Ring buffer to store mixed audio output (YM2149, DMA sound, ...) */
 extern int	AudioMixBuffer_pos_write;	/* Current writing position into above buffer */
-extern int	AudioMixBuffer_pos_read;	/* Current reading position into above buffer */
-
-extern bool	Sound_BufferIndexNeedReset;
+extern SDL_atomic_t AudioMixBuffer_nWritten;	/* Samples written to above buffer, only updated by Sound_Update() */
+extern SDL_atomic_t AudioMixBuffer_nRead;	/* Samples read from above buffer, only updated by audio callback */
 
 /* STSound sound renderer active */
 #include <SDL_types.h>
@@ -64,14 +64,28 @@ extern int	YM2149_HPF_Filter;
 #define		YM2149_RESAMPLE_METHOD_NEAREST			0
 #define		YM2149_RESAMPLE_METHOD_WEIGHTED_AVERAGE_2	1
 #define		YM2149_RESAMPLE_METHOD_WEIGHTED_AVERAGE_N	2
+#define		YM2149_RESAMPLE_METHOD_POLYPHASE		3
 extern int	YM2149_Resample_Method;
 
+/* Sound generation statistics, counted since startup */
+typedef struct
+{
+	Uint64	nVBLs;
+	Uint64	nGenerated;			/* Samples generated into AudioMixBuffer[] */
+	Uint32	nOverflows;			/* Sound_Update() calls which found AudioMixBuffer[] full */
+	Uint64	TimeGenerate;			/* Performance counter ticks spent in Sound_GenerateSamples() */
+	Uint64	TimeDmaSnd;			/* ... of which in DmaSnd_GenerateSamples() */
+	Uint64	TimeCrossbar;			/* ... of which in Crossbar_GenerateSamples() */
+} SOUND_STATS;
+
 
 extern void Sound_Init(void);
 extern void Sound_Reset(void);
-extern void Sound_ResetBufferIndex(void);
 extern void Sound_MemorySnapShot_Capture(bool bSave);
 extern void Sound_Stats_Show (void);
+extern bool Sound_Stats_SetLogFile(const char *pszFileName);
+extern void Sound_GetStats(SOUND_STATS *pStats);
+extern void Sound_Info(FILE *fp, Uint32 dummy);
 extern void Sound_Update(Uint64 CPU_Clock);
 extern void Sound_Update_VBL(void);
 extern void Sound_WriteReg( int reg , Uint8 data );
@@ -80,7 +94,6 @@ extern void Sound_EndRecording(void);
 extern bool Sound_AreWeRecording(void);
 extern void Sound_SetYmVolumeMixing(void);
 extern ymsample Subsonic_IIR_HPF_Left(ymsample x0);
-extern ymsample Subsonic_IIR_HPF_Right(ymsample x0);
 
 
 #endif  /* HATARI_SOUND_H */
@@ -16,5 +16,7 @@ extern void Spec512_ScanWholeLine(void);
 extern void Spec512_StartScanLine(void);
 extern void Spec512_EndScanLine(void);
 extern void Spec512_UpdatePaletteSpan(void);
+extern int Spec512_UpdatePaletteSpans(int MaxSpans);
+extern Uint64 Spec512_GetScanLineHash(void);
 
 #endif  /* HATARI_SPEC512_H */
@@ -6,7 +6,12 @@
 */
 
 extern bool bRecordingYM;
+extern bool bRecordingYMDump;
 
 extern bool YMFormat_BeginRecording(const char *pszYMFileName);
 extern void YMFormat_EndRecording(void);
 extern void YMFormat_UpdateRecording(void);
+extern bool YMFormat_BeginDump(const char *filename);
+extern void YMFormat_DumpWrite(Uint64 Clock, int Reg, Uint8 Data);
+extern void YMFormat_EndDump(void);
+extern bool YMFormat_Render(const char *pszYMFile, char *pszWavFile);
@@ -365,6 +365,9 @@ void M68000_CheckCpuSettings(void)
 	changed_prefs.cpu_compatible = ConfigureParams.System.bCompatibleCpu;
 	changed_prefs.cpu_cycle_exact = ConfigureParams.System.bCycleExactCpu;
 	changed_prefs.cpu_memory_cycle_exact = ConfigureParams.System.bCycleExactCpu;
+	/* Use the faster non cycle exact core while in fast forward turbo mode */
+	if ( bFastForwardTurbo )
+		changed_prefs.cpu_cycle_exact = changed_prefs.cpu_memory_cycle_exact = false;
 	changed_prefs.address_space_24 = ConfigureParams.System.bAddressSpace24;
 	changed_prefs.fpu_model = ConfigureParams.System.n_FPUType;
 	changed_prefs.fpu_strict = ConfigureParams.System.bCompatibleFPU;
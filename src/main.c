@@ -46,6 +46,8 @@ const char Main_fileid[] = "Hatari main.c";
 #include "rs232.h"
 #include "scc.h"
 #include "screen.h"
+#include "screenScale.h"
+#include "screenSnapShot.h"
 #include "sdlgui.h"
 #include "shortcut.h"
 #include "sound.h"
@@ -56,6 +58,7 @@ const char Main_fileid[] = "Hatari main.c";
 #include "tos.h"
 #include "video.h"
 #include "avi_record.h"
+#include "ymFormat.h"
 #include "debugui.h"
 #include "remotedebug.h"
 #include "clocks_timings.h"
@@ -74,6 +77,7 @@ const char Main_fileid[] = "Hatari main.c";
 #endif
 
 bool bQuitProgram = false;                /* Flag to quit program cleanly */
+bool bFastForwardTurbo = false;           /* Fast forward with reduced accuracy is active */
 static int nQuitValue;                    /* exit value */
 
 static Uint32 nRunVBLs;                   /* Whether and how many VBLS to run before exit */
@@ -81,6 +85,11 @@ static Uint32 nFirstMilliTick;            /* Ticks when VBL counting started */
 static Uint32 nVBLCount;                  /* Frame count */
 static int nVBLSlowdown = 1;		  /* host VBL wait multiplier */
 
+static int nPreviewFrames;                /* Preview mode: draw only every Nth frame */
+static Uint32 nPreviewVBLs;               /* Preview mode VBL timing statistics */
+static Uint32 nPreviewFirstMilliTick;
+static Sint64 nPreviewPrevTicks, nPreviewTotalTicks, nPreviewMaxTicks;
+
 static bool bEmulationActive = true;      /* Run emulation when started */
 static bool bAccurateDelays;              /* Host system has an accurate SDL_Delay()? */
 
@@ -223,7 +232,6 @@ bool Main_UnPauseEmulation(void)
 	if ( bEmulationActive )
 		return false;
 
-	Sound_BufferIndexNeedReset = true;
 	Audio_EnableAudio(ConfigureParams.Sound.bEnableSound);
 	bEmulationActive = true;
 
@@ -292,6 +300,69 @@ Uint32 Main_SetRunVBLs(Uint32 vbls)
 	return 0;
 }
 
+/*-----------------------------------------------------------------------*/
+/**
+ * Set preview mode frame interval: only every Nth frame is drawn,
+ * and emulation time of each VBL is recorded for the report shown
+ * at exit. Zero disables preview mode.
+ */
+void Main_SetPreviewFrames(int frames)
+{
+	nPreviewFrames = frames;
+}
+
+/**
+ * Return preview mode frame interval, zero when not in preview mode
+ */
+int Main_GetPreviewFrames(void)
+{
+	return nPreviewFrames;
+}
+
+/**
+ * Record time spent on emulating the VBL that just ended
+ */
+static void Main_PreviewVbl(void)
+{
+	Sint64 ticks = Time_GetTicks();
+	Sint64 delta = ticks - nPreviewPrevTicks;
+
+	if (!nPreviewPrevTicks)
+	{
+		/* first VBL includes start up, count from its end */
+		nPreviewFirstMilliTick = Main_GetTicks();
+		nPreviewPrevTicks = ticks;
+		return;
+	}
+	nPreviewPrevTicks = ticks;
+	nPreviewVBLs++;
+	nPreviewTotalTicks += delta;
+	if (delta > nPreviewMaxTicks)
+		nPreviewMaxTicks = delta;
+}
+
+/**
+ * Show preview mode VBL timings. Host CPU time is also given as
+ * emulated VBLs per second, as that tells the throughput of a single
+ * host core regardless of the other load on the host.
+ */
+static void Main_PreviewReport(void)
+{
+	Uint32 interval;
+
+	if (!nPreviewVBLs)
+		return;
+
+	interval = Main_GetTicks() - nPreviewFirstMilliTick;
+	Log_Printf(LOG_INFO, "PREVIEW: %u VBLs (every %d. drawn), %.3f ms/VBL (max %.3f ms), %.1f VBL/s of CPU time (%.2fs)\n",
+	           nPreviewVBLs, nPreviewFrames,
+	           nPreviewTotalTicks / (1000.0 * nPreviewVBLs),
+	           nPreviewMaxTicks / 1000.0,
+	           interval ? (1000.0 * nPreviewVBLs) / interval : 0.0,
+	           interval / 1000.0);
+	nPreviewVBLs = 0;
+}
+
 /*-----------------------------------------------------------------------*/
 /**
  * Set VBL wait slowdown factor/multiplayer
@@ -307,6 +378,32 @@ const char* Main_SetVBLSlowdown(int factor)
 	return NULL;
 }
 
+/*-----------------------------------------------------------------------*/
+/**
+ * Enter or leave the fast forward "turbo" mode when fast forward was
+ * toggled (from the shortcut, remote debugger, natfeats, ...) and
+ * turbo mode is enabled with ConfigureParams.System.nFastForwardTurbo.
+ * While in turbo mode, the CPU runs without cycle exactness, only every
+ * Nth frame is drawn and YM2149 samples are not synthesized (see
+ * M68000_CheckCpuSettings(), Video_DrawScreen() and YM2149_Run()).
+ * None of this changes the emulated machine's state, so the normal mode
+ * is restored as soon as fast forward is disabled.
+ */
+static void Main_CheckFastForwardTurbo(void)
+{
+	bool bTurbo = ConfigureParams.System.bFastForward
+	              && ConfigureParams.System.nFastForwardTurbo > 0;
+
+	if (bTurbo == bFastForwardTurbo)
+		return;
+
+	bFastForwardTurbo = bTurbo;
+	Log_Printf(LOG_DEBUG, "Fast forward turbo mode %s\n", bTurbo ? "on" : "off");
+
+	/* Switch CPU core at the end of the current instruction */
+	M68000_CheckCpuSettings();
+}
+
 /*-----------------------------------------------------------------------*/
 /**
  * This function waits on each emulated VBL to synchronize the real time
@@ -324,11 +421,20 @@ void Main_WaitOnVbl(void)
 	Sint64 FrameDuration_micro;
 	Sint64 nDelay;
 
+	Main_CheckFastForwardTurbo();
+
+	if (nPreviewFrames)
+		Main_PreviewVbl();
+
 	nVBLCount++;
 	if (nRunVBLs &&	nVBLCount >= nRunVBLs)
 	{
 		/* show VBLs/s */
 		Main_PauseEmulation(true);
+		Main_PreviewReport();
+		/* finish sound recordings, e.g. for batch conversions */
+		if (Sound_AreWeRecording())
+			Sound_EndRecording();
 		exit(0);
 	}
 
@@ -626,7 +732,8 @@ void Main_EventHandler(bool remoteDebugging)
 			Log_Printf(LOG_DEBUG, "SDL2 window event: 0x%x\n", event.window.event);
 			switch(event.window.event) {
 			case SDL_WINDOWEVENT_EXPOSED:
-				if (!ConfigureParams.Screen.bUseSdlRenderer)
+				if (!ConfigureParams.Screen.bUseSdlRenderer &&
+				    ConfigureParams.Screen.nCpuScale == SCALE_MODE_OFF)
 				{
 					/* Hack: Redraw screen here when going into
 					 * fullscreen mode without SDL renderer */
@@ -779,6 +886,7 @@ static void Main_Init(void)
 	IoMem_Init();
 	NvRam_Init();
 	Sound_Init();
+	Log_Printf(LOG_DEBUG, "DMA sound filtering: %s\n", DmaSnd_Init());
 	
 	/* done as last, needs CPU & DSP running... */
 	DebugUI_Init();
@@ -792,6 +900,7 @@ static void Main_Init(void)
  */
 static void Main_UnInit(void)
 {
+	Main_PreviewReport();
 	RemoteDebug_UnInit();
 	Screen_ReturnFromFullScreen();
 	Floppy_UnInit();
@@ -812,6 +921,7 @@ static void Main_UnInit(void)
 	SDLGui_UnInit();
 	DSP_UnInit();
 	Screen_UnInit();
+	ScreenSnapShot_CloseFrameLog();
 	Exit680x0();
 
 	IPF_Exit();
@@ -944,6 +1054,13 @@ int main(int argc, char *argv[])
 	/* monitor type option might require "reset" -> true */
 	Configuration_Apply(true);
 
+	/* Only render a YM file to WAV, without emulating the machine ? */
+	if (YMRenderOnStartup)
+	{
+		Control_RemoveFifo();
+		return YMFormat_Render(YMRenderFileName, ConfigureParams.Sound.szYMCaptureFileName) ? 0 : 1;
+	}
+
 #ifdef WIN32
 	Win_OpenCon();
 #endif
@@ -974,6 +1091,9 @@ int main(int argc, char *argv[])
 			1 << CLOCKS_TIMINGS_SHIFT_VBL ,
 			ConfigureParams.Video.AviRecordVcodec );
 
+	if ( SoundRecordOnStartup )	/* Immediately starts sound recording ? */
+		Sound_BeginRecording ( ConfigureParams.Sound.szYMCaptureFileName );
+
 	/* Run emulation */
 	Main_UnPauseEmulation();
 	M68000_Start();                 /* Start emulation */
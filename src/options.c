@@ -22,15 +22,19 @@ const char Options_fileid[] = "Hatari options.c";
 
 #include "main.h"
 #include "version.h"
+#include "audio.h"
 #include "options.h"
 #include "configuration.h"
 #include "console.h"
 #include "control.h"
 #include "debugui.h"
+#include "diskOverlay.h"
 #include "file.h"
 #include "floppy.h"
 #include "fdc.h"
 #include "screen.h"
+#include "screenScale.h"
+#include "screenSnapShot.h"
 #include "statusbar.h"
 #include "sound.h"
 #include "video.h"
@@ -51,6 +55,9 @@ const char Options_fileid[] = "Hatari options.c";
 bool bLoadAutoSave;        /* Load autosave memory snapshot at startup */
 bool bLoadMemorySave;      /* Load memory snapshot provided via option at startup */
 bool AviRecordOnStartup;   /* Start avi recording at startup */
+bool SoundRecordOnStartup; /* Start sound recording at startup */
+bool YMRenderOnStartup;    /* Only render YM file to sound recording file */
+char YMRenderFileName[FILENAME_MAX];
 bool BenchmarkMode;	   /* Start in benchmark mode (try to run at maximum emulation */
 			   /* speed allowed by the CPU). Disable audio/video for best results */
 
@@ -69,6 +76,7 @@ enum {
 	OPT_KBD_LAYOUT,
 	OPT_LANGUAGE,
 	OPT_FASTFORWARD,
+	OPT_FASTFORWARD_TURBO,
 	OPT_AUTOSTART,
 
 	OPT_MONO,		/* common display options */
@@ -86,12 +94,14 @@ enum {
 	OPT_MAXWIDTH,
 	OPT_MAXHEIGHT,
 	OPT_ZOOM,
+	OPT_CPU_SCALE,
 	OPT_FORCEBPP,
 	OPT_DISABLE_VIDEO,
 
 	OPT_BORDERS,		/* ST/STE display options */
 	OPT_SPEC512,
 	OPT_VIDEO_TIMING,
+	OPT_RENDER_THREAD,
 
 	OPT_RESOLUTION,		/* TT/Falcon display options */
 	OPT_FORCE_MAX,
@@ -150,6 +160,9 @@ enum {
 	OPT_IDEMASTERHDIMAGE,
 	OPT_IDESLAVEHDIMAGE,
 	OPT_IDEBYTESWAP,
+	OPT_HDSYNC,
+	OPT_DISKOVERLAY,
+	OPT_DISKOVERLAY_DISCARD,
 
 	OPT_MEMSIZE,		/* memory options */
 	OPT_TT_RAM,
@@ -180,6 +193,10 @@ enum {
 	OPT_SOUND,
 	OPT_SOUNDBUFFERSIZE,
 	OPT_SOUNDSYNC,
+	OPT_SOUNDOFFLINE,
+	OPT_SOUNDRECORD,
+	OPT_YM_RENDER,
+	OPT_SOUNDSTATS,
 	OPT_YM_MIXING,
 
 #ifdef WIN32
@@ -203,6 +220,9 @@ enum {
 	OPT_ALERTLEVEL,
 	OPT_RUNVBLS,
 	OPT_BENCHMARK,
+	OPT_PREVIEW,
+	OPT_FRAMELOG,
+	OPT_FRAMEDUMPDIR,
 	OPT_ERROR,
 	OPT_CONTINUE
 };
@@ -237,6 +257,8 @@ static const opt_t HatariOptions[] = {
 	  "<x>", "Set (TT/Falcon) NVRAM language" },
 	{ OPT_FASTFORWARD, NULL, "--fast-forward",
 	  "<bool>", "Help skipping stuff on fast machine" },
+	{ OPT_FASTFORWARD_TURBO, NULL, "--fast-forward-turbo",
+	  "<x>", "Less accurate fast forward, showing every <x>th frame (0=off)" },
 	{ OPT_AUTOSTART, NULL, "--auto",
 	  "<x>", "Atari program autostarting with Atari path" },
 
@@ -271,6 +293,8 @@ static const opt_t HatariOptions[] = {
 	  "<x>", "Maximum Hatari screen height before scaling" },
 	{ OPT_ZOOM, "-z", "--zoom",
 	  "<x>", "Hatari screen/window scaling factor (1.0 - 8.0)" },
+	{ OPT_CPU_SCALE, NULL, "--cpu-scale",
+	  "<x>", "Scale window on CPU instead of GPU (x = off/nearest/scanlines/sharp)" },
 	{ OPT_FORCEBPP, NULL, "--bpp",
 	  "<x>", "Force internal bitdepth (x = 15/16/32, 0=disable)" },
 	{ OPT_DISABLE_VIDEO,   NULL, "--disable-video",
@@ -283,6 +307,8 @@ static const opt_t HatariOptions[] = {
 	  "<x>", "Spec512 palette threshold (0 <= x <= 512, 0=disable)" },
 	{ OPT_VIDEO_TIMING,   NULL, "--video-timing",
 	  "<x>", "Wakeup State for MMU/GLUE (x=ws1/ws2/ws3/ws4/random, default ws3)" },
+	{ OPT_RENDER_THREAD, NULL, "--render-thread",
+	  "<bool>", "Convert screen in a separate thread" },
 
 	{ OPT_HEADER, NULL, NULL, NULL, "TT/Falcon specific display" },
 	{ OPT_RESOLUTION, NULL, "--desktop",
@@ -308,7 +334,7 @@ static const opt_t HatariOptions[] = {
 	{ OPT_AVIRECORD, NULL, "--avirecord",
 	  NULL, "Start AVI recording" },
 	{ OPT_AVIRECORD_VCODEC, NULL, "--avi-vcodec",
-	  "<x>", "Select AVI video codec (x = bmp/png)" },
+	  "<x>", "Select AVI video codec (x = bmp/png/zmbv)" },
 	{ OPT_AVI_PNG_LEVEL, NULL, "--png-level",
 	  "<x>", "Select AVI PNG compression level (x = 0-9)" },
 	{ OPT_AVIRECORD_FPS, NULL, "--avi-fps",
@@ -401,6 +427,12 @@ static const opt_t HatariOptions[] = {
 	  "<file>", "Emulate an IDE 1 (slave) harddrive with an image <file>" },
 	{ OPT_IDEBYTESWAP,   NULL, "--ide-swap",
 	  "<id>=<x>", "Set IDE (0/1) byte-swap option (off/on/auto)" },
+	{ OPT_HDSYNC,   NULL, "--hd-sync",
+	  "<x>", "When to sync HD image writes to disk (none/flush/write)" },
+	{ OPT_DISKOVERLAY,   NULL, "--disk-overlay",
+	  "<dir>", "Write floppy & HD image changes to overlay files in <dir>" },
+	{ OPT_DISKOVERLAY_DISCARD,   NULL, "--disk-overlay-discard",
+	  "<bool>", "Start with empty overlay files & remove them afterwards" },
 
 	{ OPT_HEADER, NULL, NULL, NULL, "Memory" },
 	{ OPT_MEMSIZE,   "-s", "--memsize",
@@ -461,6 +493,14 @@ static const opt_t HatariOptions[] = {
 	  "<x>", "Sound buffer size in ms (x=0/10-100, 0=SDL default)" },
 	{ OPT_SOUNDSYNC,   NULL, "--sound-sync",
 	  "<bool>", "Sound synchronized emulation (on|off, off=default)" },
+	{ OPT_SOUNDOFFLINE,   NULL, "--sound-offline",
+	  "<bool>", "Render sound only for recording, without audio device" },
+	{ OPT_SOUNDRECORD,   NULL, "--sound-record",
+	  "<file>", "Record sound to <file> (.wav, .ym or .ymd) from startup" },
+	{ OPT_YM_RENDER,   NULL, "--ym-render",
+	  "<file>", "Render .ym/.ymd <file> to --sound-record .wav file and exit" },
+	{ OPT_SOUNDSTATS,   NULL, "--sound-stats",
+	  "<file>", "Log audio pipeline statistics to CSV <file> every second" },
 	{ OPT_YM_MIXING,   NULL, "--ym-mixing",
 	  "<x>", "YM sound mixing method (x=linear/table/model)" },
 
@@ -506,6 +546,12 @@ static const opt_t HatariOptions[] = {
 	  "<x>", "Exit after x VBLs" },
 	{ OPT_BENCHMARK, NULL, "--benchmark",
 	  NULL, "Start in benchmark mode (use with --run-vbls)" },
+	{ OPT_PREVIEW, NULL, "--preview",
+	  "<x>", "Benchmark mode drawing only every x:th frame at 1:1 size" },
+	{ OPT_FRAMELOG, NULL, "--frame-log",
+	  "<file>", "Log hashes of all emulated frames to <file>" },
+	{ OPT_FRAMEDUMPDIR, NULL, "--frame-dump-dir",
+	  "<dir>", "Save frames with new hashes to <dir> (use with --frame-log)" },
 
 	{ OPT_ERROR, NULL, NULL, NULL, NULL }
 };
@@ -932,6 +978,12 @@ static bool Opt_ValidateOptions(void)
 	{
 		return Opt_ShowError(opt_id, val, err);
 	}
+	if (YMRenderOnStartup && !(SoundRecordOnStartup &&
+	    File_DoesFileExtensionMatch(ConfigureParams.Sound.szYMCaptureFileName, ".wav")))
+	{
+		return Opt_ShowError(OPT_YM_RENDER, YMRenderFileName,
+				     "Rendering needs a .wav file given with --sound-record");
+	}
 	return true;
 }
 
@@ -1053,6 +1105,7 @@ bool Opt_ParseParameters(int argc, const char * const argv[])
 	int dev, port, freq, temp, drive;
 	const char *errstr, *str;
 	int i, ok = true;
+	bool bDiscard = false;
 	float zoom;
 	int val;
 
@@ -1089,6 +1142,16 @@ bool Opt_ParseParameters(int argc, const char * const argv[])
 			ok = Opt_Bool(argv[++i], OPT_FASTFORWARD, &ConfigureParams.System.bFastForward);
 			break;
 
+		case OPT_FASTFORWARD_TURBO:
+			val = atoi(argv[++i]);
+			if (val < 0)
+			{
+				return Opt_ShowError(OPT_FASTFORWARD_TURBO, argv[i],
+						     "Invalid frame interval value");
+			}
+			ConfigureParams.System.nFastForwardTurbo = val;
+			break;
+
 		case OPT_AUTOSTART:
 			if (!(ok = INF_SetAutoStart(argv[++i], OPT_AUTOSTART)))
 			{
@@ -1255,6 +1318,20 @@ bool Opt_ParseParameters(int argc, const char * const argv[])
 			ConfigureParams.Screen.nMaxHeight += STATUSBAR_MAX_HEIGHT;
 			break;
 
+		case OPT_CPU_SCALE:
+			i += 1;
+			if (strcasecmp(argv[i], "off") == 0)
+				ConfigureParams.Screen.nCpuScale = SCALE_MODE_OFF;
+			else if (strcasecmp(argv[i], "nearest") == 0)
+				ConfigureParams.Screen.nCpuScale = SCALE_MODE_NEAREST;
+			else if (strcasecmp(argv[i], "scanlines") == 0)
+				ConfigureParams.Screen.nCpuScale = SCALE_MODE_SCANLINES;
+			else if (strcasecmp(argv[i], "sharp") == 0)
+				ConfigureParams.Screen.nCpuScale = SCALE_MODE_SHARP;
+			else
+				return Opt_ShowError(OPT_CPU_SCALE, argv[i], "Unknown scaling mode");
+			break;
+
 		case OPT_VIDEO_TIMING:
 			i += 1;
 			if (strcasecmp(argv[i], "random") == 0)
@@ -1271,6 +1348,10 @@ bool Opt_ParseParameters(int argc, const char * const argv[])
 				return Opt_ShowError(OPT_VIDEO_TIMING, argv[i], "Unknown video timing mode");
 			break;
 
+		case OPT_RENDER_THREAD:
+			ok = Opt_Bool(argv[++i], OPT_RENDER_THREAD, &ConfigureParams.Screen.bRenderThread);
+			break;
+
 			/* Falcon/TT display options */
 		case OPT_RESOLUTION:
 			ok = Opt_Bool(argv[++i], OPT_RESOLUTION, &ConfigureParams.Screen.bKeepResolution);
@@ -1311,6 +1392,10 @@ bool Opt_ParseParameters(int argc, const char * const argv[])
 			{
 				ConfigureParams.Video.AviRecordVcodec = AVI_RECORD_VIDEO_CODEC_PNG;
 			}
+			else if (strcasecmp(argv[i], "zmbv") == 0)
+			{
+				ConfigureParams.Video.AviRecordVcodec = AVI_RECORD_VIDEO_CODEC_ZMBV;
+			}
 			else
 			{
 				return Opt_ShowError(OPT_AVIRECORD_VCODEC, argv[i], "Unknown video codec");
@@ -1720,6 +1805,34 @@ bool Opt_ParseParameters(int argc, const char * const argv[])
 				return Opt_ShowError(OPT_IDEBYTESWAP, argv[i], "Invalid byte-swap setting");
 			break;
 
+		case OPT_HDSYNC:
+			i += 1;
+			if (strcasecmp(argv[i], "none") == 0)
+				ConfigureParams.HardDisk.nImageSync = HDSYNC_NONE;
+			else if (strcasecmp(argv[i], "flush") == 0)
+				ConfigureParams.HardDisk.nImageSync = HDSYNC_FLUSH;
+			else if (strcasecmp(argv[i], "write") == 0)
+				ConfigureParams.HardDisk.nImageSync = HDSYNC_WRITE;
+			else
+				return Opt_ShowError(OPT_HDSYNC, argv[i], "Unknown option value");
+			break;
+
+		case OPT_DISKOVERLAY:
+			i += 1;
+			if (!DiskOverlay_SetDir(argv[i]))
+			{
+				return Opt_ShowError(OPT_DISKOVERLAY, argv[i], "Given overlay directory doesn't exist");
+			}
+			break;
+
+		case OPT_DISKOVERLAY_DISCARD:
+			ok = Opt_Bool(argv[++i], OPT_DISKOVERLAY_DISCARD, &bDiscard);
+			if (ok)
+			{
+				DiskOverlay_SetDiscard(bDiscard);
+			}
+			break;
+
 			/* Memory options */
 		case OPT_MEMSIZE:
 			memsize = atoi(argv[++i]);
@@ -2034,6 +2147,40 @@ bool Opt_ParseParameters(int argc, const char * const argv[])
 			ok = Opt_Bool(argv[++i], OPT_SOUNDSYNC, &ConfigureParams.Sound.bEnableSoundSync);
 			break;
 
+		case OPT_SOUNDOFFLINE:
+			ok = Opt_Bool(argv[++i], OPT_SOUNDOFFLINE, &bAudioOffline);
+			break;
+
+		case OPT_SOUNDRECORD:
+			i += 1;
+			if (strcasecmp(argv[i], "none") != 0 &&
+			    !File_DoesFileExtensionMatch(argv[i], ".wav") &&
+			    !File_DoesFileExtensionMatch(argv[i], ".ym") &&
+			    !File_DoesFileExtensionMatch(argv[i], ".ymd"))
+			{
+				return Opt_ShowError(OPT_SOUNDRECORD, argv[i], "Unknown sound recording format");
+			}
+			/* false -> file is created if it doesn't exist */
+			ok = Opt_StrCpy(OPT_SOUNDRECORD, false, ConfigureParams.Sound.szYMCaptureFileName,
+					argv[i], sizeof(ConfigureParams.Sound.szYMCaptureFileName),
+					&SoundRecordOnStartup);
+			break;
+
+		case OPT_YM_RENDER:
+			i += 1;
+			ok = Opt_StrCpy(OPT_YM_RENDER, true, YMRenderFileName,
+					argv[i], sizeof(YMRenderFileName),
+					&YMRenderOnStartup);
+			break;
+
+		case OPT_SOUNDSTATS:
+			i += 1;
+			if (!Sound_Stats_SetLogFile(argv[i]))
+			{
+				return Opt_ShowError(OPT_SOUNDSTATS, argv[i], "Can't open sound statistics file!");
+			}
+			break;
+
 		case OPT_MICROPHONE:
 			ok = Opt_Bool(argv[++i], OPT_MICROPHONE, &ConfigureParams.Sound.bEnableMicrophone);
 			break;
@@ -2246,6 +2393,44 @@ bool Opt_ParseParameters(int argc, const char * const argv[])
 			BenchmarkMode = true;
 			break;
 
+		case OPT_PREVIEW:
+			val = atoi(argv[++i]);
+			if (val < 1)
+			{
+				return Opt_ShowError(OPT_PREVIEW, argv[i], "Invalid preview frame interval");
+			}
+			Main_SetPreviewFrames(val);
+			BenchmarkMode = true;
+			/* draw in emulation thread at 1:1 size (ST-low not
+			 * doubled), without statusbar or window updates
+			 */
+			ConfigureParams.Screen.nMaxWidth = NUM_VISIBLE_LINE_PIXELS;
+			ConfigureParams.Screen.nMaxHeight = NUM_VISIBLE_LINES;
+			ConfigureParams.Screen.bForceMax = false;
+			ConfigureParams.Screen.nZoomFactor = 1.0;
+			ConfigureParams.Screen.bAspectCorrect = false;
+			ConfigureParams.Screen.bShowStatusbar = false;
+			ConfigureParams.Screen.bShowDriveLed = false;
+			ConfigureParams.Screen.bRenderThread = false;
+			ConfigureParams.Screen.nCpuScale = SCALE_MODE_OFF;
+			break;
+
+		case OPT_FRAMELOG:
+			i += 1;
+			if (!ScreenSnapShot_SetFrameLog(argv[i]))
+			{
+				return Opt_ShowError(OPT_FRAMELOG, argv[i], "Can't open frame log file!");
+			}
+			break;
+
+		case OPT_FRAMEDUMPDIR:
+			i += 1;
+			if (!ScreenSnapShot_SetFrameDumpDir(argv[i]))
+			{
+				return Opt_ShowError(OPT_FRAMEDUMPDIR, argv[i], "Given frame dump dir doesn't exist!");
+			}
+			break;
+
 		case OPT_ERROR:
 			/* unknown option or missing option parameter */
 			return false;
@@ -192,6 +192,7 @@ const char PSG_fileid[] = "Hatari psg.c";
 #include "statusbar.h"
 #include "mfp.h"
 #include "fdc.h"
+#include "ymFormat.h"
 
 
 static Uint8 PSGRegisterSelect;		/* Write to 0xff8800 sets the register number used in read/write accesses */
@@ -362,6 +363,8 @@ void PSG_Set_DataRegister(Uint8 val)
 	{
 		/* Copy sound related registers 0..13 to the sound module's internal buffer */
 		Sound_WriteReg ( PSGRegisterSelect , PSGRegisters[PSGRegisterSelect] );
+		if ( bRecordingYMDump )
+			YMFormat_DumpWrite ( Cycles_GetClockCounterOnWriteAccess() , PSGRegisterSelect , PSGRegisters[PSGRegisterSelect] );
 	}
 
 	else if ( PSGRegisterSelect == PSG_REG_IO_PORTA )
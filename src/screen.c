@@ -22,6 +22,11 @@
   for a screen. So not displaying the last two lines fixes garbage that could
   appear in the last two lines when displaying 47 lines (Digiworld 2 by ICE,
   Tyranny by DHS).
+  Optionally the low/medium resolution conversion can be run in a separate
+  render thread. The frame is then converted while the emulation continues
+  with the next one, and shown on the following VBL. The SDL texture upload
+  and presentation itself stays in the main thread, as SDL renderers may
+  only be used from the thread which created them.
 */
 
 const char Screen_fileid[] = "Hatari screen.c";
@@ -39,6 +44,9 @@ const char Screen_fileid[] = "Hatari screen.c";
 #include "options.h"
 #include "screen.h"
 #include "screenConvert.h"
+#include "screenPlanar.h"
+#include "screenScale.h"
+#include "screenSnapShot.h"
 #include "control.h"
 #include "convert/routines.h"
 #include "resolution.h"
@@ -78,6 +86,7 @@ FRAMEBUFFER *pFrameBuffer;    /* Pointer into current 'FrameBuffer' */
 
 static FRAMEBUFFER FrameBuffer;     /* Store frame buffer details to tell how to update */
 static Uint8 *pSTScreenCopy;        /* Keep track of current and previous ST screen data */
+static Uint8 *pSTScreenSrc;         /* ST screen being converted */
 static Uint8 *pPCScreenDest;        /* Destination PC buffer */
 static int STScreenEndHorizLine;    /* End lines to be converted */
 static int PCScreenBytesPerLine;
@@ -95,30 +104,161 @@ static bool bScreenContentsChanged;     /* true if buffer changed and requires b
 static bool bScrDoubleY;                /* true if double on Y */
 static int ScrUpdateFlag;               /* Bit mask of how to update screen */
 static bool bRGBTableInSync;            /* Is RGB table up to date? */
+static Uint32 TVLineMask;               /* Mask for halving intensity of TV-mode lines */
+static Uint32 LinePaletteMasks[NUM_VISIBLE_LINES];  /* Palette/resolution masks for converted frame */
+static int ConvertLineY;                /* ST line being converted */
+static bool LineChanged[NUM_VISIBLE_LINES];  /* ST lines changed in converted frame */
+static Uint64 SpecLineHash[NUM_VISIBLE_LINES];  /* Spectrum 512 palette hashes for drawn lines */
+static bool bSpecLineHashValid;         /* Is screen content from previous Spectrum 512 frame? */
+
+#define MAX_BLIT_RECTS 8
+static SDL_Rect BlitRects[MAX_BLIT_RECTS];  /* Screen areas to update for converted frame */
+static int nBlitRects;
+
+/* Render thread, converting ST low/medium resolution frames in the background */
+static SDL_Thread *pRenderThread;
+static SDL_mutex *pRenderMutex;
+static SDL_cond *pRenderCond;
+static bool bRenderBusy;                /* Render thread is converting a frame */
+static bool bRenderQuit;                /* Render thread should exit */
+static bool bRenderFramePending;        /* Converted frame not yet shown */
+static bool bRenderPixelsInSync;        /* Render buffer contents match sdlscrn */
+static bool bRenderFullUpdate;          /* Whole screen needs update for converted frame */
+static void (*pRenderDrawFunction)(void);
+static Uint8 *pRenderPixels;            /* Render thread destination, copied to sdlscrn */
+static int RenderPixelsSize;
+static Uint8 *pSTScreenSpare;           /* 3rd ST screen buffer, needed with render thread */
 
 /* These are used for the generic screen conversion functions */
 static int genconv_width_req, genconv_height_req, genconv_bpp;
 
 
 static bool Screen_DrawFrame(bool bForceFlip);
+static void Screen_RenderDrop(void);
+static void Screen_RenderUnInit(void);
 
 SDL_Window *sdlWindow;
 static SDL_Renderer *sdlRenderer;
 static SDL_Texture *sdlTexture;
 static bool bUseSdlRenderer;            /* true when using SDL2 renderer */
 static bool bIsSoftwareRenderer;
+static bool bTextureNeedsUpdate;        /* true when texture has no contents yet */
+static bool bUseCpuScaler;              /* true when scaling sdlscrn to window surface on CPU */
+static int nCpuScaleMode;               /* SCALE_MODE_* used for that */
+static int nScaleSrcW, nScaleSrcH;      /* Sizes for which the CPU scaling is set up */
+static int nScaleWinW, nScaleWinH;
+
+/**
+ * Scale given areas of the screen surface to the window surface on
+ * the CPU, and update the changed window areas.
+ */
+static void Screen_ScaleRects(SDL_Surface *screen, int numrects, SDL_Rect *rects)
+{
+	SDL_Rect scaled[MAX_BLIT_RECTS+1], area;
+	SDL_Surface *winsurf;
+	int i, count;
+
+	/* window surface is re-created when window size changes */
+	winsurf = SDL_GetWindowSurface(sdlWindow);
+	if (!winsurf)
+		return;
+
+	if (screen->w != nScaleSrcW || screen->h != nScaleSrcH ||
+	    winsurf->w != nScaleWinW || winsurf->h != nScaleWinH)
+	{
+		nScaleSrcW = nScaleSrcH = nScaleWinW = nScaleWinH = 0;
+		if (!ScreenScale_SetSize(nCpuScaleMode, screen->w, screen->h,
+		                         winsurf->w, winsurf->h,
+		                         winsurf->format->Amask, &area))
+		{
+			Log_Printf(LOG_ERROR, "Failed to set up %dx%d -> %dx%d CPU scaling!\n",
+			           screen->w, screen->h, winsurf->w, winsurf->h);
+			return;
+		}
+		nScaleSrcW = screen->w;
+		nScaleSrcH = screen->h;
+		nScaleWinW = winsurf->w;
+		nScaleWinH = winsurf->h;
+		/* black borders around the scaled screen */
+		SDL_FillRect(winsurf, NULL, SDL_MapRGB(winsurf->format, 0, 0, 0));
+		numrects = 0;
+	}
+
+	if (numrects <= 0 || numrects > ARRAY_SIZE(scaled))
+	{
+		ScreenScale_Rows(screen->pixels, screen->pitch, 0, screen->h,
+		                 winsurf->pixels, winsurf->pitch, &area);
+		SDL_UpdateWindowSurface(sdlWindow);
+		return;
+	}
+	count = 0;
+	for (i = 0; i < numrects; i++)
+	{
+		ScreenScale_Rows(screen->pixels, screen->pitch, rects[i].y, rects[i].h,
+		                 winsurf->pixels, winsurf->pitch, &scaled[count]);
+		if (scaled[count].h > 0)
+			count++;
+	}
+	if (count)
+		SDL_UpdateWindowSurfaceRects(sdlWindow, scaled, count);
+}
+
+/**
+ * Map mouse event positions in the CPU scaled window to screen
+ * surface positions, like SDL renderer does with its scaling
+ */
+static int Screen_ScaleMouseEvent(void *data, SDL_Event *event)
+{
+	switch (event->type)
+	{
+	case SDL_MOUSEMOTION:
+		ScreenScale_MapPosition(&event->motion.x, &event->motion.y);
+		ScreenScale_MapMotion(&event->motion.xrel, &event->motion.yrel);
+		break;
+	case SDL_MOUSEBUTTONDOWN:
+	case SDL_MOUSEBUTTONUP:
+		ScreenScale_MapPosition(&event->button.x, &event->button.y);
+		break;
+	}
+	return 1;
+}
 
 void SDL_UpdateRects(SDL_Surface *screen, int numrects, SDL_Rect *rects)
 {
+	int i;
+
+	/* nothing is shown in preview mode */
+	if (Main_GetPreviewFrames())
+		return;
+
 	if (bUseSdlRenderer)
 	{
-		SDL_UpdateTexture(sdlTexture, NULL, screen->pixels, screen->pitch);
+		/* texture keeps its contents, so only given areas need uploading */
+		if (bTextureNeedsUpdate)
+		{
+			SDL_UpdateTexture(sdlTexture, NULL, screen->pixels, screen->pitch);
+			bTextureNeedsUpdate = false;
+		}
+		else
+		{
+			for (i = 0; i < numrects; i++)
+			{
+				SDL_UpdateTexture(sdlTexture, &rects[i], (Uint8 *)screen->pixels
+				                  + rects[i].y * screen->pitch
+				                  + rects[i].x * screen->format->BytesPerPixel,
+				                  screen->pitch);
+			}
+		}
 		/* Need to clear the renderer context for certain accelerated cards */
 		if (!bIsSoftwareRenderer)
 			SDL_RenderClear(sdlRenderer);
 		SDL_RenderCopy(sdlRenderer, sdlTexture, NULL, NULL);
 		SDL_RenderPresent(sdlRenderer);
 	}
+	else if (bUseCpuScaler)
+	{
+		Screen_ScaleRects(screen, numrects, rects);
+	}
 	else
 	{
 		SDL_UpdateWindowSurfaceRects(sdlWindow, rects, numrects);
@@ -191,7 +331,7 @@ static void Screen_ConvertHighRes(void)
 {
 	int linewidth = 640 / 16;
 
-	Screen_GenConvert(VideoBase, pSTScreen, 640, 400, 1, linewidth, 0, 0, 0, 0, 0);
+	Screen_GenConvert(VideoBase, pSTScreenSrc, 640, 400, 1, linewidth, 0, 0, 0, 0, 0);
 	bScreenContentsChanged = true;
 }
 
@@ -288,7 +428,7 @@ static void Screen_FreeSDL2Resources(void)
 	}
 	if (sdlscrn)
 	{
-		if (bUseSdlRenderer)
+		if (bUseSdlRenderer || bUseCpuScaler)
 			SDL_FreeSurface(sdlscrn);
 		sdlscrn = NULL;
 	}
@@ -378,6 +518,7 @@ void Screen_SetTextureScale(int width, int height, int win_width, int win_height
 			       width, height, sdlscrn->format->BitsPerPixel);
 			exit(-3);
 		}
+		bTextureNeedsUpdate = true;
 	}
 }
 
@@ -398,6 +539,9 @@ static bool Screen_SetSDLVideoSize(int width, int height, int bitdepth, bool bFo
 
 	if (bitdepth == 0 || bitdepth == 24)
 		bitdepth = 32;
+	/* CPU scaling supports only 32-bit window surfaces */
+	if (ConfigureParams.Screen.nCpuScale != SCALE_MODE_OFF)
+		bitdepth = 32;
 
 	/* Check if we really have to change the video mode: */
 	if (sdlscrn != NULL && sdlscrn->w == width && sdlscrn->h == height
@@ -413,12 +557,16 @@ static bool Screen_SetSDLVideoSize(int width, int height, int bitdepth, bool bFo
 		Control_ReparentWindow(width, height, bInFullScreen);
 	}
 
-	bUseSdlRenderer = ConfigureParams.Screen.bUseSdlRenderer && !bUseDummyMode;
+	/* CPU scaling works also with the dummy driver, for benchmarking */
+	bUseCpuScaler = ConfigureParams.Screen.nCpuScale != SCALE_MODE_OFF
+	                && !Main_GetPreviewFrames();
+	bUseSdlRenderer = ConfigureParams.Screen.bUseSdlRenderer && !bUseDummyMode
+	                  && !Main_GetPreviewFrames() && !bUseCpuScaler;
 
 	/* SDL Video attributes: */
 	win_width = width;
 	win_height = height;
-	if (bUseSdlRenderer)
+	if (bUseSdlRenderer || bUseCpuScaler)
 	{
 		scale = ConfigureParams.Screen.nZoomFactor;
 		win_width *= scale;
@@ -427,7 +575,7 @@ static bool Screen_SetSDLVideoSize(int width, int height, int bitdepth, bool bFo
 	if (bInFullScreen)
 	{
 		sdlVideoFlags = SDL_WINDOW_BORDERLESS | SDL_WINDOW_INPUT_GRABBED;
-		if (ConfigureParams.Screen.bKeepResolution)
+		if (ConfigureParams.Screen.bKeepResolution || bUseCpuScaler)
 			sdlVideoFlags |= SDL_WINDOW_FULLSCREEN_DESKTOP;
 		else
 			sdlVideoFlags |= SDL_WINDOW_FULLSCREEN;
@@ -437,12 +585,12 @@ static bool Screen_SetSDLVideoSize(int width, int height, int bitdepth, bool bFo
 		int deskw, deskh;
 		if (getenv("PARENT_WIN_ID") != NULL)	/* Embedded window? */
 			sdlVideoFlags = SDL_WINDOW_BORDERLESS|SDL_WINDOW_HIDDEN;
-		else if (ConfigureParams.Screen.bResizable && bUseSdlRenderer)
+		else if (ConfigureParams.Screen.bResizable && (bUseSdlRenderer || bUseCpuScaler))
 			sdlVideoFlags = SDL_WINDOW_RESIZABLE;
 		else
 			sdlVideoFlags = 0;
 		/* Make sure that window is not bigger than current desktop */
-		if (bUseSdlRenderer)
+		if (bUseSdlRenderer || bUseCpuScaler)
 		{
 			Resolution_GetDesktopSize(&deskw, &deskh);
 			if (win_width > deskw)
@@ -540,12 +688,39 @@ static bool Screen_SetSDLVideoSize(int width, int height, int bitdepth, bool bFo
 
 		Screen_SetTextureScale(width, height, win_width, win_height, true);
 	}
+	else if (bUseCpuScaler)
+	{
+		SDL_Surface *winsurf = SDL_GetWindowSurface(sdlWindow);
+
+		if (winsurf && winsurf->format->BitsPerPixel == 32)
+		{
+			sdlscrn = SDL_CreateRGBSurface(0, width, height, 32,
+			                               winsurf->format->Rmask,
+			                               winsurf->format->Gmask,
+			                               winsurf->format->Bmask,
+			                               winsurf->format->Amask);
+		}
+		else
+		{
+			Log_Printf(LOG_WARN, "No 32-bit window surface, CPU scaling disabled.\n");
+			bUseCpuScaler = false;
+			SDL_SetWindowSize(sdlWindow, width, height);
+			sdlscrn = SDL_GetWindowSurface(sdlWindow);
+		}
+		nCpuScaleMode = ConfigureParams.Screen.nCpuScale;
+		nScaleSrcW = nScaleSrcH = 0;
+		bIsSoftwareRenderer = true;
+	}
 	else
 	{
 		sdlscrn = SDL_GetWindowSurface(sdlWindow);
 		bIsSoftwareRenderer = true;
 	}
 
+	SDL_DelEventWatch(Screen_ScaleMouseEvent, NULL);
+	if (bUseCpuScaler)
+		SDL_AddEventWatch(Screen_ScaleMouseEvent, NULL);
+
 	/* Exit if we can not open a screen */
 	if (!sdlscrn)
 	{
@@ -681,6 +856,9 @@ static void Screen_ChangeResolution(bool bForceChange)
 {
 	int hbpp = ConfigureParams.Screen.nForceBpp;
 
+	/* Render thread output is for the old screen surface */
+	Screen_RenderDrop();
+
 	if (bUseVDIRes)
 	{
 		Screen_SetGenConvSize(VDIWidth, VDIHeight, hbpp, bForceChange);
@@ -742,6 +920,10 @@ void Screen_Init(void)
 	}
 	pFrameBuffer = &FrameBuffer;  /* TODO: Replace pFrameBuffer with FrameBuffer everywhere */
 
+	/* Select bitplane conversion routine for the host CPU */
+	Log_Printf(LOG_DEBUG, "Bitplane to chunky conversion: %s\n", ScreenPlanar_Init());
+	Log_Printf(LOG_DEBUG, "CPU window scaling: %s\n", ScreenScale_Init());
+
 	/* Set initial window resolution */
 	bInFullScreen = ConfigureParams.Screen.bFullScreen;
 	Screen_ChangeResolution(false);
@@ -771,6 +953,8 @@ void Screen_Init(void)
  */
 void Screen_UnInit(void)
 {
+	Screen_RenderUnInit();
+
 	/* Free memory used for copies */
 	free(FrameBuffer.pSTScreen);
 	free(FrameBuffer.pSTScreenCopy);
@@ -781,6 +965,8 @@ void Screen_UnInit(void)
 		SDL_DestroyWindow(sdlWindow);
 		sdlWindow = NULL;
 	}
+	SDL_DelEventWatch(Screen_ScaleMouseEvent, NULL);
+	ScreenScale_UnInit();
 }
 
 
@@ -822,6 +1008,7 @@ void Screen_SetFullUpdate(void)
 {
 	/* Update frame buffers */
 	FrameBuffer.bFullUpdate = true;
+	ScreenConv_SetFullUpdate();
 }
 
 
@@ -832,6 +1019,7 @@ void Screen_SetFullUpdate(void)
 static void Screen_ClearScreen(void)
 {
 	SDL_FillRect(sdlscrn, &STScreenRect, SDL_MapRGB(sdlscrn->format, 0, 0, 0));
+	ScreenConv_SetFullUpdate();
 }
 
 
@@ -1130,7 +1318,7 @@ static void Screen_SetFullUpdateMask(void)
  */
 static void Screen_SetConvertDetails(void)
 {
-	pSTScreen = pFrameBuffer->pSTScreen;          /* Source in ST memory */
+	pSTScreenSrc = pFrameBuffer->pSTScreen;       /* Source in ST memory */
 	pSTScreenCopy = pFrameBuffer->pSTScreenCopy;  /* Previous ST screen */
 	pPCScreenDest = sdlscrn->pixels;              /* Destination PC screen */
 
@@ -1142,6 +1330,9 @@ static void Screen_SetConvertDetails(void)
 	pHBLPalettes = pFrameBuffer->HBLPalettes;     /* HBL palettes pointer */
 	/* Not in TV-Mode? Then double up on Y: */
 	bScrDoubleY = !(ConfigureParams.Screen.nMonitorType == MONITOR_TYPE_TV);
+	TVLineMask = ((sdlscrn->format->Rmask >> 1) & sdlscrn->format->Rmask)
+	           | ((sdlscrn->format->Gmask >> 1) & sdlscrn->format->Gmask)
+	           | ((sdlscrn->format->Bmask >> 1) & sdlscrn->format->Bmask);
 
 	if (ConfigureParams.Screen.bAllowOverscan)  /* Use borders? */
 	{
@@ -1207,22 +1398,247 @@ void Screen_UnLock(void)
  */
 static void Screen_Blit(SDL_Rect *sbar_rect)
 {
-	unsigned char *pTmpScreen;
-	int count = 1;
-	SDL_Rect rects[2];
+	int count = nBlitRects;
+	SDL_Rect rects[MAX_BLIT_RECTS+1];
 
-	rects[0] = STScreenRect;
+	memcpy(rects, BlitRects, count * sizeof(SDL_Rect));
 	if (sbar_rect)
+		rects[count++] = *sbar_rect;
+	SDL_UpdateRects(sdlscrn, count, rects);
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Set BlitRects[] to cover the screen lines marked in LineChanged[]
+ * by the conversion, or whole screen if 'bFullUpdate' is set or there
+ * are too many separate areas.
+ */
+static void Screen_SetBlitRects(bool bFullUpdate)
+{
+	int y, start, count = 0;
+
+	for (y = STScreenStartHorizLine; y < STScreenEndHorizLine && !bFullUpdate; y++)
 	{
-		rects[1] = *sbar_rect;
-		count = 2;
+		if (!LineChanged[y])
+			continue;
+		if (count == MAX_BLIT_RECTS)
+		{
+			bFullUpdate = true;
+			break;
+		}
+		for (start = y; y < STScreenEndHorizLine && LineChanged[y]; y++)
+			;
+		BlitRects[count].x = 0;
+		BlitRects[count].y = PCScreenOffsetY + (start - STScreenStartHorizLine) * nScreenZoomY;
+		BlitRects[count].w = STScreenRect.w;
+		BlitRects[count].h = (y - start) * nScreenZoomY;
+		count++;
 	}
-	SDL_UpdateRects(sdlscrn, count, rects);
 
-	/* Swap copy/raster buffers in screen. */
-	pTmpScreen = pFrameBuffer->pSTScreenCopy;
-	pFrameBuffer->pSTScreenCopy = pFrameBuffer->pSTScreen;
-	pFrameBuffer->pSTScreen = pTmpScreen;
+	if (bFullUpdate)
+	{
+		BlitRects[0] = STScreenRect;
+		count = 1;
+	}
+	nBlitRects = count;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Render thread main loop, runs the conversion function of each
+ * frame handed to it by Screen_RenderStart().
+ */
+static int Screen_RenderThread(void *data)
+{
+	SDL_LockMutex(pRenderMutex);
+	while (!bRenderQuit)
+	{
+		if (!bRenderBusy)
+		{
+			SDL_CondWait(pRenderCond, pRenderMutex);
+			continue;
+		}
+		SDL_UnlockMutex(pRenderMutex);
+
+		CALL_VAR(pRenderDrawFunction);
+
+		SDL_LockMutex(pRenderMutex);
+		bRenderBusy = false;
+		SDL_CondBroadcast(pRenderCond);
+	}
+	SDL_UnlockMutex(pRenderMutex);
+	return 0;
+}
+
+/**
+ * Wait until the render thread has converted the frame given to it
+ */
+static void Screen_RenderWait(void)
+{
+	if (!pRenderThread)
+		return;
+
+	SDL_LockMutex(pRenderMutex);
+	while (bRenderBusy)
+		SDL_CondWait(pRenderCond, pRenderMutex);
+	SDL_UnlockMutex(pRenderMutex);
+}
+
+/**
+ * Wait for the render thread and throw away the frame it converted,
+ * e.g. because the screen surface is going to change.
+ */
+static void Screen_RenderDrop(void)
+{
+	Screen_RenderWait();
+	if (bRenderFramePending)
+	{
+		bRenderFramePending = false;
+		Screen_SetFullUpdate();
+	}
+	bRenderPixelsInSync = false;
+}
+
+/**
+ * Start render thread
+ */
+static bool Screen_RenderInit(void)
+{
+	pSTScreenSpare = malloc(MAX_VDI_BYTES);
+	pRenderMutex = SDL_CreateMutex();
+	pRenderCond = SDL_CreateCond();
+	if (pSTScreenSpare && pRenderMutex && pRenderCond)
+	{
+		memcpy(pSTScreenSpare, pFrameBuffer->pSTScreenCopy, MAX_VDI_BYTES);
+		bRenderQuit = bRenderBusy = false;
+		pRenderThread = SDL_CreateThread(Screen_RenderThread, "render", NULL);
+	}
+	if (!pRenderThread)
+	{
+		Log_Printf(LOG_WARN, "Failed to start render thread: %s\n", SDL_GetError());
+		free(pSTScreenSpare);
+		pSTScreenSpare = NULL;
+		if (pRenderCond)
+			SDL_DestroyCond(pRenderCond);
+		if (pRenderMutex)
+			SDL_DestroyMutex(pRenderMutex);
+		pRenderCond = NULL;
+		pRenderMutex = NULL;
+		return false;
+	}
+	bRenderFramePending = bRenderPixelsInSync = false;
+	return true;
+}
+
+/**
+ * Stop render thread and free its resources
+ */
+static void Screen_RenderUnInit(void)
+{
+	if (!pRenderThread)
+		return;
+
+	Screen_RenderDrop();
+	SDL_LockMutex(pRenderMutex);
+	bRenderQuit = true;
+	SDL_CondBroadcast(pRenderCond);
+	SDL_UnlockMutex(pRenderMutex);
+	SDL_WaitThread(pRenderThread, NULL);
+	pRenderThread = NULL;
+
+	SDL_DestroyCond(pRenderCond);
+	SDL_DestroyMutex(pRenderMutex);
+	pRenderCond = NULL;
+	pRenderMutex = NULL;
+	free(pSTScreenSpare);
+	pSTScreenSpare = NULL;
+	free(pRenderPixels);
+	pRenderPixels = NULL;
+	RenderPixelsSize = 0;
+}
+
+/**
+ * Hand the frame prepared by Screen_SetConvertDetails() over to the render
+ * thread, which converts it into its own buffer. The ST screen buffers are
+ * rotated so that emulation can build up the next frame in the third one.
+ * Return false if render buffer couldn't be allocated.
+ */
+static bool Screen_RenderStart(void (*pDrawFunction)(void))
+{
+	int size = STScreenRect.h * sdlscrn->pitch;
+
+	if (size != RenderPixelsSize)
+	{
+		free(pRenderPixels);
+		pRenderPixels = malloc(size);
+		RenderPixelsSize = pRenderPixels ? size : 0;
+		if (!pRenderPixels)
+			return false;
+		bRenderPixelsInSync = false;
+	}
+	/* unchanged blocks aren't converted, so buffer needs to have
+	 * the same (possibly cleared) contents as the screen surface
+	 */
+	if (!bRenderPixelsInSync || pFrameBuffer->bFullUpdate)
+	{
+		memcpy(pRenderPixels, sdlscrn->pixels, size);
+		bRenderPixelsInSync = true;
+	}
+	pPCScreenDest = pRenderPixels + (pPCScreenDest - (Uint8 *)sdlscrn->pixels);
+
+	/* converted frame becomes the previous one, and the previous
+	 * one is free to be overwritten by the next frame
+	 */
+	pFrameBuffer->pSTScreen = pSTScreenSpare;
+	pFrameBuffer->pSTScreenCopy = pSTScreenSrc;
+	pSTScreenSpare = pSTScreenCopy;
+
+	bScreenContentsChanged = false;
+	bRenderFullUpdate = pFrameBuffer->bFullUpdate;
+	pRenderDrawFunction = pDrawFunction;
+	bRenderFramePending = true;
+
+	SDL_LockMutex(pRenderMutex);
+	bRenderBusy = true;
+	SDL_CondBroadcast(pRenderCond);
+	SDL_UnlockMutex(pRenderMutex);
+	return true;
+}
+
+/**
+ * Copy changed areas of the frame converted by the render thread to
+ * the (locked) screen surface. Return true if its contents changed.
+ */
+static bool Screen_RenderFinish(void)
+{
+	SDL_Rect *rect;
+	int i;
+
+	if (!bRenderFramePending)
+		return false;
+
+	bRenderFramePending = false;
+	if (!bScreenContentsChanged)
+		return false;
+
+	if (STScreenRect.h * sdlscrn->pitch != RenderPixelsSize)
+	{
+		/* surface changed under us, redraw everything */
+		bRenderPixelsInSync = false;
+		Screen_SetFullUpdate();
+		return false;
+	}
+	Screen_SetBlitRects(bRenderFullUpdate);
+	for (i = 0; i < nBlitRects; i++)
+	{
+		rect = &BlitRects[i];
+		memcpy((Uint8 *)sdlscrn->pixels + rect->y * sdlscrn->pitch,
+		       pRenderPixels + rect->y * sdlscrn->pitch,
+		       rect->h * sdlscrn->pitch);
+	}
+	return true;
 }
 
 
@@ -1238,16 +1654,28 @@ static bool Screen_DrawFrame(bool bForceFlip)
 	void (*pDrawFunction)(void);
 	static bool bPrevFrameWasSpec512 = false;
 	SDL_Rect *sbar_rect;
+	unsigned char *pTmpScreen;
+	bool bChanged, bThreaded, bLineChanges, bFullUpdate;
 
 	assert(!bUseVDIRes);
 
+	/* Start or stop the render thread according to configuration */
+	if (ConfigureParams.Screen.bRenderThread && !pRenderThread)
+	{
+		if (!Screen_RenderInit())
+			ConfigureParams.Screen.bRenderThread = false;
+	}
+	else if (!ConfigureParams.Screen.bRenderThread && pRenderThread)
+	{
+		Screen_RenderUnInit();
+	}
+	/* Wait for previous frame, render thread uses the tables updated below */
+	Screen_RenderWait();
+
 	/* Scan palette/resolution masks for each line and build up palette/difference tables */
 	new_res = Screen_ComparePaletteMask(STRes);
 	/* Did we change resolution this frame - allocate new screen if did so */
 	Screen_DidResolutionChange(new_res);
-	/* Is need full-update, tag as such */
-	if (pFrameBuffer->bFullUpdate)
-		Screen_SetFullUpdateMask();
 
 	/* restore area potentially left under overlay led
 	 * and saved by Statusbar_OverlayBackup()
@@ -1260,13 +1688,24 @@ static bool Screen_DrawFrame(bool bForceFlip)
 		return false;
 	}
 
+	/* Previous frame from render thread needs to be on screen
+	 * before it's shown or this frame is drawn on top of it
+	 */
+	nBlitRects = 0;
+	bChanged = Screen_RenderFinish();
+
+	/* Is need full-update, tag as such */
+	if (pFrameBuffer->bFullUpdate)
+		Screen_SetFullUpdateMask();
+
 	bScreenContentsChanged = false;      /* Did change (ie needs blit?) */
 
 	/* Set details */
 	Screen_SetConvertDetails();
 
 	/* Clear screen on full update to clear out borders and also interleaved lines */
-	if (pFrameBuffer->bFullUpdate)
+	bFullUpdate = pFrameBuffer->bFullUpdate;
+	if (bFullUpdate)
 		Screen_ClearScreen();
 
 	/* Call drawing for full-screen */
@@ -1274,6 +1713,10 @@ static bool Screen_DrawFrame(bool bForceFlip)
 	/* Check if is Spec512 image */
 	if (Spec512_IsImage())
 	{
+		/* Unchanged lines can be skipped only if screen still
+		 * has them from the previous Spectrum 512 frame
+		 */
+		bSpecLineHashValid = bPrevFrameWasSpec512 && !bFullUpdate && !bChanged;
 		bPrevFrameWasSpec512 = true;
 		/* What mode were we in? Keep to 320xH or 640xH */
 		if (pDrawFunction==ConvertLowRes_320x16Bit)
@@ -1297,9 +1740,31 @@ static bool Screen_DrawFrame(bool bForceFlip)
 		Screen_SetFullUpdateMask();
 		bPrevFrameWasSpec512 = false;
 	}
+	memcpy(LinePaletteMasks, HBLPaletteMasks, sizeof(LinePaletteMasks));
+	memset(LineChanged, 0, sizeof(LineChanged));
 
-	if (pDrawFunction)
-		CALL_VAR(pDrawFunction);
+	/* Only the low/medium resolution conversions mark changed lines.
+	 * Mono and Spec512 conversions also read emulation state which
+	 * changes during next frame, so those can't be left to the render
+	 * thread. Forced updates are done directly too, emulation may be
+	 * paused, and so are logged frames which need to be on screen
+	 * right after this.
+	 */
+	bLineChanges = pDrawFunction && STRes != ST_HIGH_RES;
+	bThreaded = pRenderThread && bLineChanges && !Spec512_IsImage()
+	            && !bForceFlip && !ScreenSnapShot_IsFrameLogging()
+	            && Screen_RenderStart(pDrawFunction);
+	if (!bThreaded)
+	{
+		if (pDrawFunction)
+			CALL_VAR(pDrawFunction);
+		if (bScreenContentsChanged)
+			Screen_SetBlitRects(bFullUpdate || !bLineChanges || bChanged);
+		bChanged |= bScreenContentsChanged;
+		bRenderPixelsInSync = false;
+	}
+	if (bForceFlip)
+		Screen_SetBlitRects(true);
 
 	/* Unlock screen */
 	Screen_UnLock();
@@ -1313,12 +1778,20 @@ static bool Screen_DrawFrame(bool bForceFlip)
 	pFrameBuffer->VerticalOverscanCopy = VerticalOverscan;
 
 	/* And show to user */
-	if (bScreenContentsChanged || bForceFlip || sbar_rect)
+	if (bChanged || bForceFlip || sbar_rect)
 	{
 		Screen_Blit(sbar_rect);
+
+		/* Swap copy/raster buffers in screen (render thread rotates them itself) */
+		if (!bThreaded)
+		{
+			pTmpScreen = pFrameBuffer->pSTScreenCopy;
+			pFrameBuffer->pSTScreenCopy = pFrameBuffer->pSTScreen;
+			pFrameBuffer->pSTScreen = pTmpScreen;
+		}
 	}
 
-	return bScreenContentsChanged;
+	return bChanged;
 }
 
 
@@ -1448,18 +1921,33 @@ void Screen_SetGenConvSize(int width, int height, int bpp, bool bForceChange)
 void Screen_GenConvUpdate(SDL_Rect *extra, bool forced)
 {
 	SDL_Rect rects[2];
-	int count = 1;
+	int count = 0;
+	int first, last;
 
 	/* Don't update anything on screen if video output is disabled */
 	if ( ConfigureParams.Screen.DisableVideo )
 		return;
 
 	rects[0] = STScreenRect;
+	if (forced) {
+		count = 1;
+	} else if (ScreenConv_GetChangedRows(&first, &last)) {
+		/* only the lines changed by the last conversion */
+		if (first < STScreenRect.y)
+			first = STScreenRect.y;
+		if (last > STScreenRect.y + STScreenRect.h - 1)
+			last = STScreenRect.y + STScreenRect.h - 1;
+		if (first <= last) {
+			rects[0].y = first;
+			rects[0].h = last - first + 1;
+			count = 1;
+		}
+	}
 	if (extra) {
-		rects[1] = *extra;
-		count = 2;
+		rects[count++] = *extra;
 	}
-	SDL_UpdateRects(sdlscrn, count, rects);
+	if (count)
+		SDL_UpdateRects(sdlscrn, count, rects);
 }
 
 Uint32 Screen_GetGenConvWidth(void)
@@ -1498,23 +1986,15 @@ Uint32 Screen_GetGenConvHeight(void)
  */
 static int AdjustLinePaletteRemap(int y)
 {
-#if SDL_BYTEORDER == SDL_BIG_ENDIAN
-	static const int endiantable[16] = {0,2,1,3,8,10,9,11,4,6,5,7,12,14,13,15};
-#endif
 	Uint16 *actHBLPal;
 	int i;
 
 	/* Copy palette and convert to RGB in display format */
-	actHBLPal = pHBLPalettes + (y<<4);    /* offset in palette */
+	actHBLPal = pFrameBuffer->HBLPalettes + (y<<4);    /* offset in palette */
 	for (i=0; i<16; i++)
-	{
-#if SDL_BYTEORDER == SDL_BIG_ENDIAN
-		STRGBPalette[endiantable[i]] = ST2RGB[*actHBLPal++];
-#else
 		STRGBPalette[i] = ST2RGB[*actHBLPal++];
-#endif
-	}
-	ScrUpdateFlag = HBLPaletteMasks[y];
+	ScrUpdateFlag = LinePaletteMasks[y];
+	ConvertLineY = y;
 	return ScrUpdateFlag;
 }
 
@@ -1545,10 +2025,9 @@ static void Convert_StartFrame(void)
  */
 static Uint32* Double_ScreenLine32(Uint32 *line, int size)
 {
-	SDL_PixelFormat *fmt;
 	int fmt_size = size/4;
 	Uint32 *next;
-	Uint32 mask;
+	Uint32 mask = TVLineMask;
 
 	next = line + fmt_size;
 	/* copy as-is */
@@ -1558,10 +2037,6 @@ static Uint32* Double_ScreenLine32(Uint32 *line, int size)
 		return next + fmt_size;
 	}
 	/* TV-mode -- halve the intensity while copying */
-	fmt = sdlscrn->format;
-	mask = ((fmt->Rmask >> 1) & fmt->Rmask)
-	     | ((fmt->Gmask >> 1) & fmt->Gmask)
-	     | ((fmt->Bmask >> 1) & fmt->Bmask);
 	do {
 		*next++ = (*line++ >> 1) & mask;
 	}
@@ -1575,10 +2050,9 @@ static Uint32* Double_ScreenLine32(Uint32 *line, int size)
  */
 static Uint16* Double_ScreenLine16(Uint16 *line, int size)
 {
-	SDL_PixelFormat *fmt;
 	int fmt_size = size/2;
 	Uint16 *next;
-	Uint16 mask;
+	Uint16 mask = TVLineMask;
 
 	next = line + fmt_size;
 	/* copy as-is */
@@ -1588,10 +2062,6 @@ static Uint16* Double_ScreenLine16(Uint16 *line, int size)
 		return next + fmt_size;
 	}
 	/* TV-mode -- halve the intensity while copying */
-	fmt = sdlscrn->format;
-	mask = ((fmt->Rmask >> 1) & fmt->Rmask)
-	     | ((fmt->Gmask >> 1) & fmt->Gmask)
-	     | ((fmt->Bmask >> 1) & fmt->Bmask);
 	do {
 		*next++ = (*line++ >> 1) & mask;
 	}
@@ -1600,7 +2070,7 @@ static Uint16* Double_ScreenLine16(Uint16 *line, int size)
 	return next;
 }
 
-/* lookup tables and conversion macros */
+/* line buffer and plotting helpers */
 #include "convert/macros.h"
 
 /* Conversion routines */
@@ -13,6 +13,7 @@
 #include "memorySnapShot.h"
 #include "screen.h"
 #include "screenConvert.h"
+#include "screenPlanar.h"
 #include "statusbar.h"
 #include "stMemory.h"
 #include "video.h"
@@ -25,6 +26,7 @@ struct screen_zoom_s {
 	Uint16 prev_scrheight;
 	int *zoomxtable;
 	int *zoomytable;
+	int coefx;		/* integer horizontal zoom, 0 if table is needed */
 };
 
 static struct screen_zoom_s screen_zoom;
@@ -40,14 +42,61 @@ static struct
 	Uint32		native[256];
 } palette;
 
+/* Host pixel format for true color conversion, updated once per frame */
+static SCREENPLANAR_RGB32 HiColorFormat;
+static bool bHiColorMapRGB;		/* format needs SDL_MapRGB() */
+
+/* Conversion parameters which affect the whole frame */
+struct genconv_params_s {
+	SDL_Surface *surf;
+	void *pixels;
+	int pitch, bpp;
+	int scrwidth, scrheight;
+	int zoomx, zoomy;
+	int vw, vh, vbpp, nextline, hscroll;
+	int leftBorder, rightBorder, upperBorder, lowerBorder;
+	bool bSampleHold;
+};
+
+/* Source data of the lines converted on the previous frame. Lines
+ * that haven't changed since are skipped, as long as the conversion
+ * parameters and the palette stay the same.
+ */
+static struct
+{
+	struct genconv_params_s params;
+	bool bFullUpdate;	/* convert all lines on next call */
+	Uint8 *lines;		/* 'numlines' * 'linebytes' of source data */
+	bool *valid;		/* whether line has valid data */
+	int linebytes;
+	int numlines;
+	int firstrow, lastrow;	/* changed host rows, -1 if none */
+} genconv;
+
+
+/**
+ * Force all lines to be converted on next Screen_GenConvert() call
+ */
+void ScreenConv_SetFullUpdate(void)
+{
+	genconv.bFullUpdate = true;
+}
+
 void Screen_SetPaletteColor(Uint8 idx, Uint8 red, Uint8 green, Uint8 blue)
 {
+	Uint32 native;
+
 	// set the SDL standard RGB palette settings
 	palette.standard[idx].r = red;
 	palette.standard[idx].g = green;
 	palette.standard[idx].b = blue;
 	// convert the color to native
-	palette.native[idx] = SDL_MapRGB(sdlscrn->format, red, green, blue);
+	native = SDL_MapRGB(sdlscrn->format, red, green, blue);
+	if (native != palette.native[idx])
+	{
+		palette.native[idx] = native;
+		genconv.bFullUpdate = true;
+	}
 }
 
 void Screen_RemapPalette(void)
@@ -60,6 +109,7 @@ void Screen_RemapPalette(void)
 	for(i = 0; i < 256; i++, native++, standard++) {
 		*native = SDL_MapRGB(fmt, standard->r, standard->g, standard->b);
 	}
+	genconv.bFullUpdate = true;
 }
 
 void ScreenConv_MemorySnapShot_Capture(bool bSave)
@@ -95,267 +145,318 @@ static inline Uint32 idx2pal(Uint8 idx)
 }
 
 /**
- * Performs conversion from the TOS's bitplane word order (big endian) data
- * into the native 16-bit chunky pixels.
+ * Check whether given source line differs from the one converted on the
+ * previous frame, and remember it for the next frame if it does.
  */
-static void Screen_BitplaneToChunky16(Uint16 *atariBitplaneData, Uint16 bpp,
-                                      Uint16 *hvram)
+static bool ScreenConv_LineChanged(int line, const void *src, int bytes)
 {
-	Uint32 a, b, c, d, x;
+	Uint8 *prev;
 
-	/* Obviously the different cases can be broken out in various
-	 * ways to lessen the amount of work needed for <8 bit modes.
-	 * It's doubtful if the usage of those modes warrants it, though.
-	 * The branches below should be ~100% correctly predicted and
-	 * thus be more or less for free.
-	 */
-	if (bpp >= 4) {
-		d = *(Uint32 *)&atariBitplaneData[0];
-		c = *(Uint32 *)&atariBitplaneData[2];
-		if (bpp == 4) {
-			a = b = 0;
-		} else {
-			b = *(Uint32 *)&atariBitplaneData[4];
-			a = *(Uint32 *)&atariBitplaneData[6];
-		}
+	if (line >= genconv.numlines || bytes > genconv.linebytes)
+		return true;
+	prev = genconv.lines + line * genconv.linebytes;
+	if (!genconv.bFullUpdate && genconv.valid[line] &&
+	    memcmp(prev, src, bytes) == 0)
+		return false;
 
-		x = a;
-		a =  (a & 0xf0f0f0f0)       | ((c & 0xf0f0f0f0) >> 4);
-		c = ((x & 0x0f0f0f0f) << 4) |  (c & 0x0f0f0f0f);
-	} else {
-		a = b = c = 0;
-		if (bpp == 2) {
-			d = *(Uint32 *)&atariBitplaneData[0];
-		} else {
-#if SDL_BYTEORDER == SDL_BIG_ENDIAN
-			d = atariBitplaneData[0]<<16;
-#else
-			d = atariBitplaneData[0];
-#endif
-		}
-	}
+	memcpy(prev, src, bytes);
+	genconv.valid[line] = true;
+	return true;
+}
 
-	x = b;
-	b =  (b & 0xf0f0f0f0)       | ((d & 0xf0f0f0f0) >> 4);
-	d = ((x & 0x0f0f0f0f) << 4) |  (d & 0x0f0f0f0f);
-
-	x = a;
-	a =  (a & 0xcccccccc)       | ((b & 0xcccccccc) >> 2);
-	b = ((x & 0x33333333) << 2) |  (b & 0x33333333);
-	x = c;
-	c =  (c & 0xcccccccc)       | ((d & 0xcccccccc) >> 2);
-	d = ((x & 0x33333333) << 2) |  (d & 0x33333333);
-
-#if SDL_BYTEORDER == SDL_BIG_ENDIAN
-	a = (a & 0x5555aaaa) | ((a & 0x00005555) << 17) | ((a & 0xaaaa0000) >> 17);
-	b = (b & 0x5555aaaa) | ((b & 0x00005555) << 17) | ((b & 0xaaaa0000) >> 17);
-	c = (c & 0x5555aaaa) | ((c & 0x00005555) << 17) | ((c & 0xaaaa0000) >> 17);
-	d = (d & 0x5555aaaa) | ((d & 0x00005555) << 17) | ((d & 0xaaaa0000) >> 17);
-
-	*hvram++ = idx2pal(a >> 8);
-	*hvram++ = idx2pal(a >> 24);
-	*hvram++ = idx2pal(b >> 8);
-	*hvram++ = idx2pal(b >> 24);
-	*hvram++ = idx2pal(c >> 8);
-	*hvram++ = idx2pal(c >> 24);
-	*hvram++ = idx2pal(d >> 8);
-	*hvram++ = idx2pal(d >> 24);
-	*hvram++ = idx2pal(a);
-	*hvram++ = idx2pal(a >> 16);
-	*hvram++ = idx2pal(b);
-	*hvram++ = idx2pal(b >> 16);
-	*hvram++ = idx2pal(c);
-	*hvram++ = idx2pal(c >> 16);
-	*hvram++ = idx2pal(d);
-	*hvram++ = idx2pal(d >> 16);
-#else
-	a = (a & 0xaaaa5555) | ((a & 0x0000aaaa) << 15) | ((a & 0x55550000) >> 15);
-	b = (b & 0xaaaa5555) | ((b & 0x0000aaaa) << 15) | ((b & 0x55550000) >> 15);
-	c = (c & 0xaaaa5555) | ((c & 0x0000aaaa) << 15) | ((c & 0x55550000) >> 15);
-	d = (d & 0xaaaa5555) | ((d & 0x0000aaaa) << 15) | ((d & 0x55550000) >> 15);
-
-	*hvram++ = idx2pal(a >> 16);
-	*hvram++ = idx2pal(a);
-	*hvram++ = idx2pal(b >> 16);
-	*hvram++ = idx2pal(b);
-	*hvram++ = idx2pal(c >> 16);
-	*hvram++ = idx2pal(c);
-	*hvram++ = idx2pal(d >> 16);
-	*hvram++ = idx2pal(d);
-	*hvram++ = idx2pal(a >> 24);
-	*hvram++ = idx2pal(a >> 8);
-	*hvram++ = idx2pal(b >> 24);
-	*hvram++ = idx2pal(b >> 8);
-	*hvram++ = idx2pal(c >> 24);
-	*hvram++ = idx2pal(c >> 8);
-	*hvram++ = idx2pal(d >> 24);
-	*hvram++ = idx2pal(d >> 8);
-#endif
+/**
+ * Forget source data of given line, it was drawn without it
+ */
+static void ScreenConv_LineInvalid(int line)
+{
+	if (line < genconv.numlines)
+		genconv.valid[line] = false;
 }
 
 /**
- * Performs conversion from the TOS's bitplane word order (big endian) data
- * into the native 32-bit chunky pixels.
+ * Add given number of host screen rows, starting from given
+ * address, to the changed screen area
  */
-static void Screen_BitplaneToChunky32(Uint16 *atariBitplaneData, Uint16 bpp,
-                                      Uint32 *hvram)
+static void ScreenConv_RowsChanged(const void *hvram_line, int rows)
 {
-	Uint32 a, b, c, d, x;
-
-	if (bpp >= 4) {
-		d = *(Uint32 *)&atariBitplaneData[0];
-		c = *(Uint32 *)&atariBitplaneData[2];
-		if (bpp == 4) {
-			a = b = 0;
-		} else {
-			b = *(Uint32 *)&atariBitplaneData[4];
-			a = *(Uint32 *)&atariBitplaneData[6];
-		}
+	int row = ((const Uint8 *)hvram_line - (const Uint8 *)sdlscrn->pixels)
+	          / sdlscrn->pitch;
 
-		x = a;
-		a =  (a & 0xf0f0f0f0)       | ((c & 0xf0f0f0f0) >> 4);
-		c = ((x & 0x0f0f0f0f) << 4) |  (c & 0x0f0f0f0f);
-	} else {
-		a = b = c = 0;
-		if (bpp == 2) {
-			d = *(Uint32 *)&atariBitplaneData[0];
-		} else {
-#if SDL_BYTEORDER == SDL_BIG_ENDIAN
-			d = atariBitplaneData[0]<<16;
-#else
-			d = atariBitplaneData[0];
-#endif
+	if (genconv.firstrow < 0 || row < genconv.firstrow)
+		genconv.firstrow = row;
+	if (row + rows - 1 > genconv.lastrow)
+		genconv.lastrow = row + rows - 1;
+}
+
+/**
+ * Get the host screen rows changed by the last Screen_GenConvert() call.
+ * Return false if there were none.
+ */
+bool ScreenConv_GetChangedRows(int *first, int *last)
+{
+	if (genconv.firstrow < 0)
+		return false;
+	*first = genconv.firstrow;
+	*last = genconv.lastrow;
+	return true;
+}
+
+/**
+ * Prepare line change detection for the frame, convert all lines
+ * if something else than the screen contents changed.
+ */
+static void ScreenConv_CheckParams(int vw, int vh, int vbpp, int nextline,
+                                   int hscroll, int leftBorder, int rightBorder,
+                                   int upperBorder, int lowerBorder)
+{
+	struct genconv_params_s params;
+	int linebytes, numlines;
+
+	memset(&params, 0, sizeof(params));
+	params.surf = sdlscrn;
+	params.pixels = sdlscrn->pixels;
+	params.pitch = sdlscrn->pitch;
+	params.bpp = sdlscrn->format->BitsPerPixel;
+	params.scrwidth = Screen_GetGenConvWidth();
+	params.scrheight = Screen_GetGenConvHeight();
+	params.zoomx = nScreenZoomX;
+	params.zoomy = nScreenZoomY;
+	params.vw = vw;
+	params.vh = vh;
+	params.vbpp = vbpp;
+	params.nextline = nextline;
+	params.hscroll = hscroll;
+	params.leftBorder = leftBorder;
+	params.rightBorder = rightBorder;
+	params.upperBorder = upperBorder;
+	params.lowerBorder = lowerBorder;
+	params.bSampleHold = bTTSampleHold;
+
+	if (memcmp(&params, &genconv.params, sizeof(params)) != 0)
+	{
+		genconv.params = params;
+		genconv.bFullUpdate = true;
+	}
+
+	/* room for the extra fine scrolling block, and for lines
+	 * of the borders which are used in zoomed modes
+	 */
+	if (vbpp < 16)
+		linebytes = (((vw + 15) >> 4) + 1) * vbpp * 2;
+	else
+		linebytes = vw * 2;
+	numlines = vh + upperBorder + lowerBorder;
+
+	if (linebytes != genconv.linebytes || numlines != genconv.numlines)
+	{
+		free(genconv.lines);
+		free(genconv.valid);
+		genconv.lines = malloc(linebytes * numlines);
+		genconv.valid = calloc(numlines, sizeof(bool));
+		if (!genconv.lines || !genconv.valid)
+		{
+			free(genconv.lines);
+			free(genconv.valid);
+			genconv.lines = NULL;
+			genconv.valid = NULL;
+			linebytes = numlines = 0;
 		}
+		genconv.linebytes = linebytes;
+		genconv.numlines = numlines;
+		genconv.bFullUpdate = true;
 	}
+	if (!genconv.lines)
+		genconv.bFullUpdate = true;
 
-	x = b;
-	b =  (b & 0xf0f0f0f0)       | ((d & 0xf0f0f0f0) >> 4);
-	d = ((x & 0x0f0f0f0f) << 4) |  (d & 0x0f0f0f0f);
-
-	x = a;
-	a =  (a & 0xcccccccc)       | ((b & 0xcccccccc) >> 2);
-	b = ((x & 0x33333333) << 2) |  (b & 0x33333333);
-	x = c;
-	c =  (c & 0xcccccccc)       | ((d & 0xcccccccc) >> 2);
-	d = ((x & 0x33333333) << 2) |  (d & 0x33333333);
-
-#if SDL_BYTEORDER == SDL_BIG_ENDIAN
-	a = (a & 0x5555aaaa) | ((a & 0x00005555) << 17) | ((a & 0xaaaa0000) >> 17);
-	b = (b & 0x5555aaaa) | ((b & 0x00005555) << 17) | ((b & 0xaaaa0000) >> 17);
-	c = (c & 0x5555aaaa) | ((c & 0x00005555) << 17) | ((c & 0xaaaa0000) >> 17);
-	d = (d & 0x5555aaaa) | ((d & 0x00005555) << 17) | ((d & 0xaaaa0000) >> 17);
-
-	*hvram++ = idx2pal(a >> 8);
-	*hvram++ = idx2pal(a >> 24);
-	*hvram++ = idx2pal(b >> 8);
-	*hvram++ = idx2pal(b >> 24);
-	*hvram++ = idx2pal(c >> 8);
-	*hvram++ = idx2pal(c >> 24);
-	*hvram++ = idx2pal(d >> 8);
-	*hvram++ = idx2pal(d >> 24);
-	*hvram++ = idx2pal(a);
-	*hvram++ = idx2pal(a >> 16);
-	*hvram++ = idx2pal(b);
-	*hvram++ = idx2pal(b >> 16);
-	*hvram++ = idx2pal(c);
-	*hvram++ = idx2pal(c >> 16);
-	*hvram++ = idx2pal(d);
-	*hvram++ = idx2pal(d >> 16);
-#else
-	a = (a & 0xaaaa5555) | ((a & 0x0000aaaa) << 15) | ((a & 0x55550000) >> 15);
-	b = (b & 0xaaaa5555) | ((b & 0x0000aaaa) << 15) | ((b & 0x55550000) >> 15);
-	c = (c & 0xaaaa5555) | ((c & 0x0000aaaa) << 15) | ((c & 0x55550000) >> 15);
-	d = (d & 0xaaaa5555) | ((d & 0x0000aaaa) << 15) | ((d & 0x55550000) >> 15);
-
-	*hvram++ = idx2pal(a >> 16);
-	*hvram++ = idx2pal(a);
-	*hvram++ = idx2pal(b >> 16);
-	*hvram++ = idx2pal(b);
-	*hvram++ = idx2pal(c >> 16);
-	*hvram++ = idx2pal(c);
-	*hvram++ = idx2pal(d >> 16);
-	*hvram++ = idx2pal(d);
-	*hvram++ = idx2pal(a >> 24);
-	*hvram++ = idx2pal(a >> 8);
-	*hvram++ = idx2pal(b >> 24);
-	*hvram++ = idx2pal(b >> 8);
-	*hvram++ = idx2pal(c >> 24);
-	*hvram++ = idx2pal(c >> 8);
-	*hvram++ = idx2pal(d >> 24);
-	*hvram++ = idx2pal(d >> 8);
-#endif
+	genconv.firstrow = genconv.lastrow = -1;
 }
 
-static inline Uint16 *ScreenConv_BitplaneLineTo16bpp(Uint16 *fvram_column,
-                                                     Uint16 *hvram_column, int vw,
-                                                     int vbpp, int hscrolloffset)
+/* Maximum number of 16 pixel blocks converted to color indexes at once */
+#define BITPLANE_LINE_BLOCKS 64
+
+/**
+ * Look up native colors for 'count' color indexes. TT sample-hold mode
+ * is checked once for the whole run instead of for each pixel.
+ */
+static inline Uint16 *ScreenConv_IdxTo16bpp(const Uint8 *idx, int count,
+                                            Uint16 *hvram_column)
 {
-	Uint16 hvram_buf[16];
 	int i;
 
-	/* First 16 pixels */
-	Screen_BitplaneToChunky16(fvram_column, vbpp, hvram_buf);
-	for (i = hscrolloffset; i < 16; i++)
+	if (unlikely(bTTSampleHold))
 	{
-		*hvram_column++ = hvram_buf[i];
+		for (i = 0; i < count; i++)
+			*hvram_column++ = idx2pal(idx[i]);
+		return hvram_column;
 	}
-	fvram_column += vbpp;
+	for (i = 0; i < count; i++)
+		hvram_column[i] = palette.native[idx[i]];
+	return hvram_column + count;
+}
 
-	/* Now the main part of the line */
-	for (i = 1; i < (vw + 15) >> 4; i++)
+static inline Uint32 *ScreenConv_IdxTo32bpp(const Uint8 *idx, int count,
+                                            Uint32 *hvram_column)
+{
+	int i;
+
+	if (unlikely(bTTSampleHold))
 	{
-		Screen_BitplaneToChunky16(fvram_column, vbpp, hvram_column);
-		hvram_column += 16;
-		fvram_column += vbpp;
+		for (i = 0; i < count; i++)
+			*hvram_column++ = idx2pal(idx[i]);
+		return hvram_column;
 	}
+	for (i = 0; i < count; i++)
+		hvram_column[i] = palette.native[idx[i]];
+	return hvram_column + count;
+}
+
+/**
+ * Return number of bytes read from a bitplane line of 'vw' pixels
+ */
+static inline int ScreenConv_BitplaneLineBytes(int vw, int vbpp, int hscrolloffset)
+{
+	return (((vw + 15) >> 4) + (hscrolloffset ? 1 : 0)) * vbpp * 2;
+}
 
-	/* Last pixels of the line for fine scrolling */
-	if (hscrolloffset)
+/**
+ * Performs conversion of a line from the TOS's bitplane word order (big
+ * endian) data into the native 16-bit chunky pixels, skipping first
+ * 'hscrolloffset' pixels for fine scrolling.
+ */
+static inline Uint16 *ScreenConv_BitplaneLineTo16bpp(Uint16 *fvram_column,
+                                                     Uint16 *hvram_column, int vw,
+                                                     int vbpp, int hscrolloffset)
+{
+	Uint8 idx[BITPLANE_LINE_BLOCKS * 16];
+	int blocks, count, n, i;
+
+	/* Last pixels of the line for fine scrolling are in extra block */
+	blocks = ((vw + 15) >> 4) + (hscrolloffset ? 1 : 0);
+	count = ((vw + 15) & ~15) + hscrolloffset;
+	i = hscrolloffset;
+
+	while (blocks > 0)
 	{
-		Screen_BitplaneToChunky16(fvram_column, vbpp, hvram_buf);
-		for (i = 0; i < hscrolloffset; i++)
-		{
-			*hvram_column++ = hvram_buf[i];
-		}
+		n = blocks < BITPLANE_LINE_BLOCKS ? blocks : BITPLANE_LINE_BLOCKS;
+		ScreenPlanar_ToChunky((Uint8 *)fvram_column, vbpp, n, idx);
+		fvram_column += n * vbpp;
+		blocks -= n;
+
+		n *= 16;
+		if (n > count)
+			n = count;
+		hvram_column = ScreenConv_IdxTo16bpp(idx + i, n - i, hvram_column);
+		count -= n;
+		i = 0;
 	}
 
 	return hvram_column;
 }
 
+/**
+ * Performs conversion of a line from the TOS's bitplane word order (big
+ * endian) data into the native 32-bit chunky pixels, skipping first
+ * 'hscrolloffset' pixels for fine scrolling.
+ */
 static inline Uint32 *ScreenConv_BitplaneLineTo32bpp(Uint16 *fvram_column,
                                                      Uint32 *hvram_column, int vw,
                                                      int vbpp, int hscrolloffset)
 {
-	Uint32 hvram_buf[16];
-	int i;
+	Uint8 idx[BITPLANE_LINE_BLOCKS * 16];
+	int blocks, count, n, i;
 
-	/* First 16 pixels */
-	Screen_BitplaneToChunky32(fvram_column, vbpp, hvram_buf);
-	for (i = hscrolloffset; i < 16; i++)
+	/* Last pixels of the line for fine scrolling are in extra block */
+	blocks = ((vw + 15) >> 4) + (hscrolloffset ? 1 : 0);
+	count = ((vw + 15) & ~15) + hscrolloffset;
+	i = hscrolloffset;
+
+	while (blocks > 0)
 	{
-		*hvram_column++ = hvram_buf[i];
+		n = blocks < BITPLANE_LINE_BLOCKS ? blocks : BITPLANE_LINE_BLOCKS;
+		ScreenPlanar_ToChunky((Uint8 *)fvram_column, vbpp, n, idx);
+		fvram_column += n * vbpp;
+		blocks -= n;
+
+		n *= 16;
+		if (n > count)
+			n = count;
+		hvram_column = ScreenConv_IdxTo32bpp(idx + i, n - i, hvram_column);
+		count -= n;
+		i = 0;
 	}
-	fvram_column += vbpp;
 
-	/* Now the main part of the line */
-	for (i = 1; i < (vw + 15) >> 4; i++)
+	return hvram_column;
+}
+
+/**
+ * Convert a line of Falcon true color pixels to native 32-bit pixels
+ */
+static inline void ScreenConv_HiColorLineTo32bpp(Uint16 *fvram_column,
+                                                 Uint32 *hvram_column, int vw)
+{
+	Uint16 srcword;
+	Uint8 r, g, b;
+	int w;
+
+	if (likely(!bHiColorMapRGB))
 	{
-		Screen_BitplaneToChunky32(fvram_column, vbpp, hvram_column);
-		hvram_column += 16;
-		fvram_column += vbpp;
+		ScreenPlanar_HiColorTo32bpp((Uint8 *)fvram_column, vw,
+		                            hvram_column, &HiColorFormat);
+		return;
+	}
+	for (w = 0; w < vw; w++)
+	{
+		srcword = SDL_SwapBE16(*fvram_column++);
+		r = ((srcword >> 8) & 0xf8) | (srcword >> 13);
+		g = ((srcword >> 3) & 0xfc) | ((srcword >> 9) & 0x3);
+		b = (srcword << 3) | ((srcword >> 2) & 0x07);
+		*hvram_column ++ = SDL_MapRGB(sdlscrn->format, r, g, b);
 	}
+}
 
-	/* Last pixels of the line for fine scrolling */
-	if (hscrolloffset)
+/**
+ * Horizontally zoom a converted line to 'count' host pixels
+ */
+static inline void ScreenConv_ZoomLine16bpp(Uint16 *hvram_column,
+                                            const Uint16 *line, int count)
+{
+	int w;
+
+	switch (screen_zoom.coefx)
 	{
-		Screen_BitplaneToChunky32(fvram_column, vbpp, hvram_buf);
-		for (i = 0; i < hscrolloffset; i++)
-		{
-			*hvram_column++ = hvram_buf[i];
-		}
+	 case 1:
+		memcpy(hvram_column, line, count * sizeof(Uint16));
+		break;
+	 case 2:
+		for (w = 0; w < count; w += 2)
+			hvram_column[w] = hvram_column[w+1] = line[w >> 1];
+		break;
+	 default:
+		for (w = 0; w < count; w++)
+			hvram_column[w] = line[screen_zoom.zoomxtable[w]];
+		break;
 	}
+}
 
-	return hvram_column;
+static inline void ScreenConv_ZoomLine32bpp(Uint32 *hvram_column,
+                                            const Uint32 *line, int count)
+{
+	int w;
+
+	switch (screen_zoom.coefx)
+	{
+	 case 1:
+		memcpy(hvram_column, line, count * sizeof(Uint32));
+		break;
+	 case 2:
+		for (w = 0; w < count; w += 2)
+			hvram_column[w] = hvram_column[w+1] = line[w >> 1];
+		break;
+	 default:
+		for (w = 0; w < count; w++)
+			hvram_column[w] = line[screen_zoom.zoomxtable[w]];
+		break;
+	}
 }
 
 static void ScreenConv_BitplaneTo16bppNoZoom(Uint16 *fvram_line, Uint8 *hvram,
@@ -367,13 +468,15 @@ static void ScreenConv_BitplaneTo16bppNoZoom(Uint16 *fvram_line, Uint8 *hvram,
 {
 	Uint16 *hvram_line = (Uint16 *)hvram;
 	uint32_t nLineEndAddr = nScreenBaseAddr + nextline * 2;
+	int linebytes = ScreenConv_BitplaneLineBytes(vw, vbpp, hscrolloffset);
 	int pitch = sdlscrn->pitch >> 1;
 	int h;
 
 	/* Render the upper border */
 	for (h = 0; h < upperBorder; h++)
 	{
-		Screen_memset_uint16(hvram_line, palette.native[0], scrwidth);
+		if (genconv.bFullUpdate)
+			Screen_memset_uint16(hvram_line, palette.native[0], scrwidth);
 		hvram_line += pitch;
 	}
 
@@ -385,21 +488,28 @@ static void ScreenConv_BitplaneTo16bppNoZoom(Uint16 *fvram_line, Uint8 *hvram,
 		if (nLineEndAddr > STRamEnd)
 		{
 			Screen_memset_uint16(hvram_line, palette.native[0], pitch);
+			ScreenConv_LineInvalid(h);
+			ScreenConv_RowsChanged(hvram_line, 1);
 			hvram_line += pitch;
 			continue;
 		}
 
-		nSampleHoldIdx = 0;
+		if (ScreenConv_LineChanged(h, fvram_line, linebytes))
+		{
+			nSampleHoldIdx = 0;
 
-		/* Left border first */
-		Screen_memset_uint16(hvram_column, palette.native[0], leftBorder);
-		hvram_column += leftBorder;
+			/* Left border first */
+			Screen_memset_uint16(hvram_column, palette.native[0], leftBorder);
+			hvram_column += leftBorder;
 
-		hvram_column = ScreenConv_BitplaneLineTo16bpp(fvram_line, hvram_column,
-		                                              vw, vbpp, hscrolloffset);
+			hvram_column = ScreenConv_BitplaneLineTo16bpp(fvram_line, hvram_column,
+			                                              vw, vbpp, hscrolloffset);
 
-		/* Right border */
-		Screen_memset_uint16(hvram_column, palette.native[0], rightBorder);
+			/* Right border */
+			Screen_memset_uint16(hvram_column, palette.native[0], rightBorder);
+
+			ScreenConv_RowsChanged(hvram_line, 1);
+		}
 
 		nLineEndAddr += nextline * 2;
 		fvram_line += nextline;
@@ -409,7 +519,8 @@ static void ScreenConv_BitplaneTo16bppNoZoom(Uint16 *fvram_line, Uint8 *hvram,
 	/* Render the lower border */
 	for (h = 0; h < lowBorder; h++)
 	{
-		Screen_memset_uint16(hvram_line, palette.native[0], scrwidth);
+		if (genconv.bFullUpdate)
+			Screen_memset_uint16(hvram_line, palette.native[0], scrwidth);
 		hvram_line += pitch;
 	}
 }
@@ -423,13 +534,15 @@ static void ScreenConv_BitplaneTo32bppNoZoom(Uint16 *fvram_line, Uint8 *hvram,
 {
 	Uint32 *hvram_line = (Uint32 *)hvram;
 	uint32_t nLineEndAddr = nScreenBaseAddr + nextline * 2;
+	int linebytes = ScreenConv_BitplaneLineBytes(vw, vbpp, hscrolloffset);
 	int pitch = sdlscrn->pitch >> 2;
 	int h;
 
 	/* Render the upper border */
 	for (h = 0; h < upperBorder; h++)
 	{
-		Screen_memset_uint32(hvram_line, palette.native[0], scrwidth);
+		if (genconv.bFullUpdate)
+			Screen_memset_uint32(hvram_line, palette.native[0], scrwidth);
 		hvram_line += pitch;
 	}
 
@@ -441,21 +554,28 @@ static void ScreenConv_BitplaneTo32bppNoZoom(Uint16 *fvram_line, Uint8 *hvram,
 		if (nLineEndAddr > STRamEnd)
 		{
 			Screen_memset_uint32(hvram_line, palette.native[0], pitch);
+			ScreenConv_LineInvalid(h);
+			ScreenConv_RowsChanged(hvram_line, 1);
 			hvram_line += pitch;
 			continue;
 		}
 
-		nSampleHoldIdx = 0;
+		if (ScreenConv_LineChanged(h, fvram_line, linebytes))
+		{
+			nSampleHoldIdx = 0;
+
+			/* Left border first */
+			Screen_memset_uint32(hvram_column, palette.native[0], leftBorder);
+			hvram_column += leftBorder;
 
-		/* Left border first */
-		Screen_memset_uint32(hvram_column, palette.native[0], leftBorder);
-		hvram_column += leftBorder;
+			hvram_column = ScreenConv_BitplaneLineTo32bpp(fvram_line, hvram_column,
+			                                              vw, vbpp, hscrolloffset);
 
-		hvram_column = ScreenConv_BitplaneLineTo32bpp(fvram_line, hvram_column,
-		                                              vw, vbpp, hscrolloffset);
+			/* Right border */
+			Screen_memset_uint32(hvram_column, palette.native[0], rightBorder);
 
-		/* Right border */
-		Screen_memset_uint32(hvram_column, palette.native[0], rightBorder);
+			ScreenConv_RowsChanged(hvram_line, 1);
+		}
 
 		nLineEndAddr += nextline * 2;
 		fvram_line += nextline;
@@ -465,7 +585,8 @@ static void ScreenConv_BitplaneTo32bppNoZoom(Uint16 *fvram_line, Uint8 *hvram,
 	/* Render the lower border */
 	for (h = 0; h < lowBorder; h++)
 	{
-		Screen_memset_uint32(hvram_line, palette.native[0], scrwidth);
+		if (genconv.bFullUpdate)
+			Screen_memset_uint32(hvram_line, palette.native[0], scrwidth);
 		hvram_line += pitch;
 	}
 }
@@ -485,7 +606,8 @@ static void ScreenConv_HiColorTo16bppNoZoom(Uint16 *fvram_line, Uint8 *hvram,
 	/* Render the upper border */
 	for (h = 0; h < upperBorder; h++)
 	{
-		Screen_memset_uint16(hvram_line, palette.native[0], scrwidth);
+		if (genconv.bFullUpdate)
+			Screen_memset_uint16(hvram_line, palette.native[0], scrwidth);
 		hvram_line += pitch;
 	}
 
@@ -493,37 +615,31 @@ static void ScreenConv_HiColorTo16bppNoZoom(Uint16 *fvram_line, Uint8 *hvram,
 	for (h = 0; h < vh; h++)
 	{
 		Uint16 *hvram_column = hvram_line;
-#if SDL_BYTEORDER != SDL_BIG_ENDIAN
-		Uint16 *fvram_column;
-		int w;
-#endif
 
 		if (nLineEndAddr > STRamEnd)
 		{
 			Screen_memset_uint16(hvram_line, palette.native[0], pitch);
+			ScreenConv_LineInvalid(h);
+			ScreenConv_RowsChanged(hvram_line, 1);
 			hvram_line += pitch;
 			continue;
 		}
 
-		/* Left border first */
-		Screen_memset_uint16(hvram_column, palette.native[0], leftBorder);
-		hvram_column += leftBorder;
-
-#if SDL_BYTEORDER == SDL_BIG_ENDIAN
-		/* FIXME: here might be a runtime little/big video endian switch like:
-		 * if ( " videocard memory in Motorola endian format " false)
-		 */
-		memcpy(hvram_column, fvram_line, vw<<1);
-		hvram_column += vw;
-#else
-		fvram_column = fvram_line;
-		/* Graphical area */
-		for (w = 0; w < vw; w++)
-			*hvram_column ++ = SDL_SwapBE16(*fvram_column++);
-#endif /* SDL_BYTEORDER == SDL_BIG_ENDIAN */
-
-		/* Right border */
-		Screen_memset_uint16(hvram_column, palette.native[0], rightBorder);
+		if (ScreenConv_LineChanged(h, fvram_line, vw * 2))
+		{
+			/* Left border first */
+			Screen_memset_uint16(hvram_column, palette.native[0], leftBorder);
+			hvram_column += leftBorder;
+
+			/* Graphical area */
+			ScreenPlanar_HiColorTo16bpp((Uint8 *)fvram_line, vw, hvram_column);
+			hvram_column += vw;
+
+			/* Right border */
+			Screen_memset_uint16(hvram_column, palette.native[0], rightBorder);
+
+			ScreenConv_RowsChanged(hvram_line, 1);
+		}
 
 		nLineEndAddr += nextline * 2;
 		fvram_line += nextline;
@@ -533,7 +649,8 @@ static void ScreenConv_HiColorTo16bppNoZoom(Uint16 *fvram_line, Uint8 *hvram,
 	/* Render the bottom border */
 	for (h = 0; h < lowBorder; h++)
 	{
-		Screen_memset_uint16(hvram_line, palette.native[0], scrwidth);
+		if (genconv.bFullUpdate)
+			Screen_memset_uint16(hvram_line, palette.native[0], scrwidth);
 		hvram_line += pitch;
 	}
 }
@@ -548,44 +665,45 @@ static void ScreenConv_HiColorTo32bppNoZoom(Uint16 *fvram_line, Uint8 *hvram,
 	Uint32 *hvram_line = (Uint32 *)hvram;
 	uint32_t nLineEndAddr = nScreenBaseAddr + nextline * 2;
 	int pitch = sdlscrn->pitch >> 2;
-	int h, w;
+	int h;
 
 	/* Render the upper border */
 	for (h = 0; h < upperBorder; h++)
 	{
-		Screen_memset_uint32(hvram_line, palette.native[0], scrwidth);
+		if (genconv.bFullUpdate)
+			Screen_memset_uint32(hvram_line, palette.native[0], scrwidth);
 		hvram_line += pitch;
 	}
 
 	/* Render the graphical area */
 	for (h = 0; h < vh; h++)
 	{
-		Uint16 *fvram_column = fvram_line;
 		Uint32 *hvram_column = hvram_line;
 
 		if (nLineEndAddr > STRamEnd)
 		{
 			Screen_memset_uint32(hvram_line, palette.native[0], pitch);
+			ScreenConv_LineInvalid(h);
+			ScreenConv_RowsChanged(hvram_line, 1);
 			hvram_line += pitch;
 			continue;
 		}
 
-		/* Left border first */
-		Screen_memset_uint32(hvram_column, palette.native[0], leftBorder);
-		hvram_column += leftBorder;
-
-		/* Graphical area */
-		for (w = 0; w < vw; w++)
+		if (ScreenConv_LineChanged(h, fvram_line, vw * 2))
 		{
-			Uint16 srcword = SDL_SwapBE16(*fvram_column++);
-			Uint8 r = ((srcword >> 8) & 0xf8) | (srcword >> 13);
-			Uint8 g = ((srcword >> 3) & 0xfc) | ((srcword >> 9) & 0x3);
-			Uint8 b = (srcword << 3) | ((srcword >> 2) & 0x07);
-			*hvram_column ++ = SDL_MapRGB(sdlscrn->format, r, g, b);
-		}
+			/* Left border first */
+			Screen_memset_uint32(hvram_column, palette.native[0], leftBorder);
+			hvram_column += leftBorder;
+
+			/* Graphical area */
+			ScreenConv_HiColorLineTo32bpp(fvram_line, hvram_column, vw);
+			hvram_column += vw;
 
-		/* Right border */
-		Screen_memset_uint32(hvram_column, palette.native[0], rightBorder);
+			/* Right border */
+			Screen_memset_uint32(hvram_column, palette.native[0], rightBorder);
+
+			ScreenConv_RowsChanged(hvram_line, 1);
+		}
 
 		nLineEndAddr += nextline * 2;
 		fvram_line += nextline;
@@ -595,7 +713,8 @@ static void ScreenConv_HiColorTo32bppNoZoom(Uint16 *fvram_line, Uint8 *hvram,
 	/* Render the bottom border */
 	for (h = 0; h < lowBorder; h++)
 	{
-		Screen_memset_uint32(hvram_line, palette.native[0], scrwidth);
+		if (genconv.bFullUpdate)
+			Screen_memset_uint32(hvram_line, palette.native[0], scrwidth);
 		hvram_line += pitch;
 	}
 }
@@ -617,9 +736,6 @@ static void Screen_ConvertWithoutZoom(Uint16 *fvram, int vw, int vh, int vbpp, i
 		nextline += vbpp;
 	}
 
-	/* The sample-hold feature exists only on the TT */
-	bTTSampleHold = (TTSpecialVideoMode & 0x80) != 0;
-
 	/* Clip to SDL_Surface dimensions */
 	scrwidth = Screen_GetGenConvWidth();
 	scrheight = Screen_GetGenConvHeight();
@@ -648,7 +764,7 @@ static void Screen_ConvertWithoutZoom(Uint16 *fvram, int vw, int vh, int vbpp, i
 	if (vh_clip < upperBorder)
 		return;
 
-	/* If there's not enough space for the upper border + the graphic area, we clip */ 
+	/* If there's not enough space for the upper border + the graphic area, we clip */
 	if (vh_clip < vh + upperBorder) {
 		vh = vh_clip - upperBorder;
 		lowBorderSize = 0;
@@ -723,64 +839,76 @@ static void ScreenConv_BitplaneTo16bppZoomed(Uint16 *fvram, Uint8 *hvram,
 	Uint16 *fvram_line;
 	uint32_t nLineEndAddr = nScreenBaseAddr + nextline * 2;
 	unsigned int nBytesPerPixel = sdlscrn->format->BytesPerPixel;
+	int linebytes = ScreenConv_BitplaneLineBytes(vw, vbpp, hscrolloffset);
 	int pitch = sdlscrn->pitch >> 1;
 	int cursrcline = -1;
-	int scrIdx = 0;
-	int w, h;
+	bool changed = false;
+	int h;
 
 	/* Render the upper border */
 	for (h = 0; h < upperBorder * coefy; h++)
 	{
-		Screen_memset_uint16(hvram_line, palette.native[0], scrwidth);
+		if (genconv.bFullUpdate)
+			Screen_memset_uint16(hvram_line, palette.native[0], scrwidth);
 		hvram_line += pitch;
 	}
 
 	/* Render the graphical area */
 	for (h = 0; h < scrheight; h++)
 	{
-		fvram_line = fvram + (screen_zoom.zoomytable[scrIdx] * nextline);
-		scrIdx ++;
+		int srcline = screen_zoom.zoomytable[h];
+
+		fvram_line = fvram + (srcline * nextline);
 		nSampleHoldIdx = 0;
 
 		/* Recopy the same line ? */
-		if (screen_zoom.zoomytable[h] == cursrcline)
+		if (srcline == cursrcline)
 		{
-			memcpy(hvram_line, hvram_line - pitch, scrwidth * nBytesPerPixel);
+			if (changed)
+				memcpy(hvram_line, hvram_line - pitch, scrwidth * nBytesPerPixel);
 		}
 		else if (nLineEndAddr > STRamEnd)
 		{
 			Screen_memset_uint16(hvram_line, palette.native[0], pitch);
+			ScreenConv_LineInvalid(srcline);
+			changed = true;
 		}
 		else
 		{
-			ScreenConv_BitplaneLineTo16bpp(fvram_line, p2cline,
-			                               vw, vbpp, hscrolloffset);
+			changed = ScreenConv_LineChanged(srcline, fvram_line, linebytes);
+			if (changed)
+			{
+				ScreenConv_BitplaneLineTo16bpp(fvram_line, p2cline,
+				                               vw, vbpp, hscrolloffset);
 
-			hvram_column = hvram_line;
+				hvram_column = hvram_line;
 
-			/* Display the Left border */
-			Screen_memset_uint16(hvram_column, palette.native[0], leftBorder * coefx);
-			hvram_column += leftBorder * coefx;
+				/* Display the Left border */
+				Screen_memset_uint16(hvram_column, palette.native[0], leftBorder * coefx);
+				hvram_column += leftBorder * coefx;
 
-			/* Display the Graphical area */
-			for (w = 0; w < vw * coefx; w++)
-				hvram_column[w] = p2cline[screen_zoom.zoomxtable[w]];
-			hvram_column += vw * coefx;
+				/* Display the Graphical area */
+				ScreenConv_ZoomLine16bpp(hvram_column, p2cline, vw * coefx);
+				hvram_column += vw * coefx;
 
-			/* Display the Right border */
-			Screen_memset_uint16(hvram_column, palette.native[0], rightBorder * coefx);
+				/* Display the Right border */
+				Screen_memset_uint16(hvram_column, palette.native[0], rightBorder * coefx);
+			}
 
 			nLineEndAddr += nextline * 2;
 		}
 
+		if (changed)
+			ScreenConv_RowsChanged(hvram_line, 1);
 		hvram_line += pitch;
-		cursrcline = screen_zoom.zoomytable[h];
+		cursrcline = srcline;
 	}
 
 	/* Render the lower border */
 	for (h = 0; h < lowerBorder * coefy; h++)
 	{
-		Screen_memset_uint16(hvram_line, palette.native[0], scrwidth);
+		if (genconv.bFullUpdate)
+			Screen_memset_uint16(hvram_line, palette.native[0], scrwidth);
 		hvram_line += pitch;
 	}
 
@@ -802,65 +930,75 @@ static void ScreenConv_BitplaneTo32bppZoomed(Uint16 *fvram, Uint8 *hvram,
 	Uint16 *fvram_line;
 	uint32_t nLineEndAddr = nScreenBaseAddr + nextline * 2;
 	unsigned int nBytesPerPixel = sdlscrn->format->BytesPerPixel;
+	int linebytes = ScreenConv_BitplaneLineBytes(vw, vbpp, hscrolloffset);
 	int pitch = sdlscrn->pitch >> 2;
 	int cursrcline = -1;
-	int scrIdx = 0;
-	int w, h;
+	bool changed = false;
+	int h;
 
 	/* Render the upper border */
 	for (h = 0; h < upperBorder * coefy; h++)
 	{
-		Screen_memset_uint32(hvram_line, palette.native[0], scrwidth);
+		if (genconv.bFullUpdate)
+			Screen_memset_uint32(hvram_line, palette.native[0], scrwidth);
 		hvram_line += pitch;
 	}
 
 	/* Render the graphical area */
 	for (h = 0; h < scrheight; h++)
 	{
-		fvram_line = fvram + (screen_zoom.zoomytable[scrIdx] * nextline);
-		scrIdx ++;
+		int srcline = screen_zoom.zoomytable[h];
+
+		fvram_line = fvram + (srcline * nextline);
 		nSampleHoldIdx = 0;
 
 		/* Recopy the same line ? */
-		if (screen_zoom.zoomytable[h] == cursrcline)
+		if (srcline == cursrcline)
 		{
-			memcpy(hvram_line, hvram_line - pitch, scrwidth * nBytesPerPixel);
+			if (changed)
+				memcpy(hvram_line, hvram_line - pitch, scrwidth * nBytesPerPixel);
 		}
 		else if (nLineEndAddr > STRamEnd)
 		{
 			Screen_memset_uint32(hvram_line, palette.native[0], pitch);
+			ScreenConv_LineInvalid(srcline);
+			changed = true;
 		}
 		else
 		{
-			ScreenConv_BitplaneLineTo32bpp(fvram_line, p2cline,
-			                               vw, vbpp, hscrolloffset);
+			changed = ScreenConv_LineChanged(srcline, fvram_line, linebytes);
+			if (changed)
+			{
+				ScreenConv_BitplaneLineTo32bpp(fvram_line, p2cline,
+				                               vw, vbpp, hscrolloffset);
 
-			hvram_column = hvram_line;
-			/* Display the Left border */
-			Screen_memset_uint32(hvram_column, palette.native[0], leftBorder * coefx);
-			hvram_column += leftBorder * coefx;
+				hvram_column = hvram_line;
+				/* Display the Left border */
+				Screen_memset_uint32(hvram_column, palette.native[0], leftBorder * coefx);
+				hvram_column += leftBorder * coefx;
 
-			/* Display the Graphical area */
-			for (w = 0; w < vw * coefx; w++)
-			{
-				hvram_column[w] = p2cline[screen_zoom.zoomxtable[w]];
-			}
-			hvram_column += vw * coefx;
+				/* Display the Graphical area */
+				ScreenConv_ZoomLine32bpp(hvram_column, p2cline, vw * coefx);
+				hvram_column += vw * coefx;
 
-			/* Display the Right border */
-			Screen_memset_uint32(hvram_column, palette.native[0], rightBorder * coefx);
+				/* Display the Right border */
+				Screen_memset_uint32(hvram_column, palette.native[0], rightBorder * coefx);
+			}
 
 			nLineEndAddr += nextline * 2;
 		}
 
+		if (changed)
+			ScreenConv_RowsChanged(hvram_line, 1);
 		hvram_line += pitch;
-		cursrcline = screen_zoom.zoomytable[h];
+		cursrcline = srcline;
 	}
 
 	/* Render the lower border */
 	for (h = 0; h < lowerBorder * coefy; h++)
 	{
-		Screen_memset_uint32(hvram_line, palette.native[0], scrwidth);
+		if (genconv.bFullUpdate)
+			Screen_memset_uint32(hvram_line, palette.native[0], scrwidth);
 		hvram_line += pitch;
 	}
 
@@ -875,6 +1013,9 @@ static void ScreenConv_HiColorTo16bppZoomed(Uint16 *fvram, Uint8 *hvram,
                                             int upperBorder, int lowerBorder,
                                             int coefx, int coefy)
 {
+	/* Source pixels used by the zoomed line, converted to host format */
+	int srcwidth = screen_zoom.zoomxtable[vw * coefx - 1] + 1;
+	Uint16 *hcline = malloc(sizeof(Uint16) * srcwidth);
 	Uint16 *hvram_line = (Uint16 *)hvram;
 	Uint16 *hvram_column = hvram_line;
 	Uint16 *fvram_line;
@@ -882,63 +1023,81 @@ static void ScreenConv_HiColorTo16bppZoomed(Uint16 *fvram, Uint8 *hvram,
 	unsigned int nBytesPerPixel = sdlscrn->format->BytesPerPixel;
 	int pitch = sdlscrn->pitch >> 1;
 	int cursrcline = -1;
-	int scrIdx = 0;
-	int w, h;
+	bool changed = false;
+	int h;
 
 	/* Render the upper border */
 	for (h = 0; h < upperBorder * coefy; h++)
 	{
-		Screen_memset_uint16(hvram_line, palette.native[0], scrwidth);
+		if (genconv.bFullUpdate)
+			Screen_memset_uint16(hvram_line, palette.native[0], scrwidth);
 		hvram_line += pitch;
 	}
 
 	/* Render the graphical area */
 	for (h = 0; h < scrheight; h++)
 	{
-		Uint16 *fvram_column;
-
-		fvram_line = fvram + (screen_zoom.zoomytable[scrIdx] * nextline);
-		scrIdx ++;
+		int srcline = screen_zoom.zoomytable[h];
 
-		fvram_column = fvram_line;
+		fvram_line = fvram + (srcline * nextline);
 
 		/* Recopy the same line ? */
-		if (screen_zoom.zoomytable[h] == cursrcline)
+		if (srcline == cursrcline)
 		{
-			memcpy(hvram_line, hvram_line - pitch, scrwidth * nBytesPerPixel);
+			if (changed)
+				memcpy(hvram_line, hvram_line - pitch, scrwidth * nBytesPerPixel);
 		}
 		else if (nLineEndAddr > STRamEnd)
 		{
 			Screen_memset_uint16(hvram_line, palette.native[0], pitch);
+			ScreenConv_LineInvalid(srcline);
+			changed = true;
 		}
 		else
 		{
-			hvram_column = hvram_line;
-
-			/* Display the Left border */
-			Screen_memset_uint16(hvram_column, palette.native[0], leftBorder * coefx);
-			hvram_column += leftBorder * coefx;
-
-			/* Display the Graphical area */
-			for (w = 0; w < vw * coefx; w++)
-				*hvram_column++ = SDL_SwapBE16(fvram_column[screen_zoom.zoomxtable[w]]);
-
-			/* Display the Right border */
-			Screen_memset_uint16(hvram_column, palette.native[0], rightBorder * coefx);
+			changed = ScreenConv_LineChanged(srcline, fvram_line, srcwidth * 2);
+			if (changed)
+			{
+				hvram_column = hvram_line;
+
+				/* Display the Left border */
+				Screen_memset_uint16(hvram_column, palette.native[0], leftBorder * coefx);
+				hvram_column += leftBorder * coefx;
+
+				/* Display the Graphical area */
+				if (screen_zoom.coefx == 1)
+				{
+					ScreenPlanar_HiColorTo16bpp((Uint8 *)fvram_line, vw, hvram_column);
+				}
+				else
+				{
+					ScreenPlanar_HiColorTo16bpp((Uint8 *)fvram_line, srcwidth, hcline);
+					ScreenConv_ZoomLine16bpp(hvram_column, hcline, vw * coefx);
+				}
+				hvram_column += vw * coefx;
+
+				/* Display the Right border */
+				Screen_memset_uint16(hvram_column, palette.native[0], rightBorder * coefx);
+			}
 
 			nLineEndAddr += nextline * 2;
 		}
 
+		if (changed)
+			ScreenConv_RowsChanged(hvram_line, 1);
 		hvram_line += pitch;
-		cursrcline = screen_zoom.zoomytable[h];
+		cursrcline = srcline;
 	}
 
 	/* Render the lower border */
 	for (h = 0; h < lowerBorder * coefy; h++)
 	{
-		Screen_memset_uint16(hvram_line, palette.native[0], scrwidth);
+		if (genconv.bFullUpdate)
+			Screen_memset_uint16(hvram_line, palette.native[0], scrwidth);
 		hvram_line += pitch;
 	}
+
+	free(hcline);
 }
 
 static void ScreenConv_HiColorTo32bppZoomed(Uint16 *fvram, Uint8 *hvram,
@@ -949,6 +1108,9 @@ static void ScreenConv_HiColorTo32bppZoomed(Uint16 *fvram, Uint8 *hvram,
                                             int upperBorder, int lowerBorder,
                                             int coefx, int coefy)
 {
+	/* Source pixels used by the zoomed line, converted to host format */
+	int srcwidth = screen_zoom.zoomxtable[vw * coefx - 1] + 1;
+	Uint32 *hcline = malloc(sizeof(Uint32) * srcwidth);
 	Uint32 *hvram_line = (Uint32 *)hvram;
 	Uint32 *hvram_column = hvram_line;
 	Uint16 *fvram_line;
@@ -956,70 +1118,81 @@ static void ScreenConv_HiColorTo32bppZoomed(Uint16 *fvram, Uint8 *hvram,
 	unsigned int nBytesPerPixel = sdlscrn->format->BytesPerPixel;
 	int pitch = sdlscrn->pitch >> 2;
 	int cursrcline = -1;
-	int scrIdx = 0;
-	int w, h;
+	bool changed = false;
+	int h;
 
 	/* Render the upper border */
 	for (h = 0; h < upperBorder * coefy; h++)
 	{
-		Screen_memset_uint32(hvram_line, palette.native[0], scrwidth);
+		if (genconv.bFullUpdate)
+			Screen_memset_uint32(hvram_line, palette.native[0], scrwidth);
 		hvram_line += pitch;
 	}
 
 	/* Render the graphical area */
 	for (h = 0; h < scrheight; h++)
 	{
-		Uint16 *fvram_column;
+		int srcline = screen_zoom.zoomytable[h];
 
-		fvram_line = fvram + (screen_zoom.zoomytable[scrIdx] * nextline);
-		scrIdx ++;
-		fvram_column = fvram_line;
+		fvram_line = fvram + (srcline * nextline);
 
 		/* Recopy the same line ? */
-		if (screen_zoom.zoomytable[h] == cursrcline)
+		if (srcline == cursrcline)
 		{
-			memcpy(hvram_line, hvram_line - pitch, scrwidth * nBytesPerPixel);
+			if (changed)
+				memcpy(hvram_line, hvram_line - pitch, scrwidth * nBytesPerPixel);
 		}
 		else if (nLineEndAddr > STRamEnd)
 		{
 			Screen_memset_uint32(hvram_line, palette.native[0], pitch);
+			ScreenConv_LineInvalid(srcline);
+			changed = true;
 		}
 		else
 		{
-			hvram_column = hvram_line;
-
-			/* Display the Left border */
-			Screen_memset_uint32(hvram_column, palette.native[0], leftBorder * coefx);
-			hvram_column += leftBorder * coefx;
-
-			/* Display the Graphical area */
-			for (w = 0; w < vw * coefx; w++)
+			changed = ScreenConv_LineChanged(srcline, fvram_line, srcwidth * 2);
+			if (changed)
 			{
-				Uint16 srcword;
-				Uint8 r, g, b;
-				srcword = SDL_SwapBE16(fvram_column[screen_zoom.zoomxtable[w]]);
-				r = ((srcword >> 8) & 0xf8) | (srcword >> 13);
-				g = ((srcword >> 3) & 0xfc) | ((srcword >> 9) & 0x3);
-				b = (srcword << 3) | ((srcword >> 2) & 0x07);
-				*hvram_column ++ = SDL_MapRGB(sdlscrn->format, r, g, b);
+				hvram_column = hvram_line;
+
+				/* Display the Left border */
+				Screen_memset_uint32(hvram_column, palette.native[0], leftBorder * coefx);
+				hvram_column += leftBorder * coefx;
+
+				/* Display the Graphical area */
+				if (screen_zoom.coefx == 1)
+				{
+					ScreenConv_HiColorLineTo32bpp(fvram_line, hvram_column, vw);
+				}
+				else
+				{
+					ScreenConv_HiColorLineTo32bpp(fvram_line, hcline, srcwidth);
+					ScreenConv_ZoomLine32bpp(hvram_column, hcline, vw * coefx);
+				}
+				hvram_column += vw * coefx;
+
+				/* Display the Right border */
+				Screen_memset_uint32(hvram_column, palette.native[0], rightBorder * coefx);
 			}
 
-			/* Display the Right border */
-			Screen_memset_uint32(hvram_column, palette.native[0], rightBorder * coefx);
-
 			nLineEndAddr += nextline * 2;
 		}
 
+		if (changed)
+			ScreenConv_RowsChanged(hvram_line, 1);
 		hvram_line += pitch;
-		cursrcline = screen_zoom.zoomytable[h];
+		cursrcline = srcline;
 	}
 
 	/* Render the lower border */
 	for (h = 0; h < lowerBorder * coefy; h++)
 	{
-		Screen_memset_uint32(hvram_line, palette.native[0], scrwidth);
+		if (genconv.bFullUpdate)
+			Screen_memset_uint32(hvram_line, palette.native[0], scrwidth);
 		hvram_line += pitch;
 	}
+
+	free(hcline);
 }
 
 static void Screen_ConvertWithZoom(Uint16 *fvram, int vw, int vh, int vbpp, int nextline,
@@ -1033,9 +1206,6 @@ static void Screen_ConvertWithZoom(Uint16 *fvram, int vw, int vh, int vbpp, int
 	int vw_b, vh_b;
 	int i;
 
-	/* The sample-hold feature exists only on the TT */
-	bTTSampleHold = (TTSpecialVideoMode & 0x80) != 0;
-
 	vw_b = vw + leftBorder + rightBorder;
 	vh_b = vh + upperBorder + lowerBorder;
 
@@ -1089,6 +1259,12 @@ static void Screen_ConvertWithZoom(Uint16 *fvram, int vw, int vh, int vbpp, int
 		screen_zoom.prev_scrheight = scrheight;
 	}
 
+	/* Line doubled and other integer zooms don't need the table */
+	if (scrwidth == vw_b * coefx && coefx <= 2)
+		screen_zoom.coefx = coefx;
+	else
+		screen_zoom.coefx = 0;
+
 	/* scrwidth must not change */
 	scrheight = vh * coefy;
 
@@ -1140,8 +1316,26 @@ void Screen_GenConvert(uint32_t vaddr, void *fvram, int vw, int vh,
                        int leftBorderSize, int rightBorderSize,
                        int upperBorderSize, int lowerBorderSize)
 {
+	SDL_PixelFormat *fmt = sdlscrn->format;
+
 	nScreenBaseAddr = vaddr;
 
+	/* The sample-hold feature exists only on the TT */
+	bTTSampleHold = (TTSpecialVideoMode & 0x80) != 0;
+
+	/* True color is converted with shifts, unless host format
+	 * channels aren't 8-bit
+	 */
+	HiColorFormat.Rshift = fmt->Rshift;
+	HiColorFormat.Gshift = fmt->Gshift;
+	HiColorFormat.Bshift = fmt->Bshift;
+	HiColorFormat.Amask = fmt->Amask;
+	bHiColorMapRGB = fmt->Rloss || fmt->Gloss || fmt->Bloss;
+
+	ScreenConv_CheckParams(vw, vh, vbpp, nextline, hscroll,
+	                       leftBorderSize, rightBorderSize,
+	                       upperBorderSize, lowerBorderSize);
+
 	if (nScreenZoomX * nScreenZoomY != 1) {
 		Screen_ConvertWithZoom(fvram, vw, vh, vbpp, nextline, hscroll,
 		                       leftBorderSize, rightBorderSize,
@@ -1151,6 +1345,14 @@ void Screen_GenConvert(uint32_t vaddr, void *fvram, int vw, int vh,
 		                          leftBorderSize, rightBorderSize,
 		                          upperBorderSize, lowerBorderSize);
 	}
+
+	/* Borders and other unconverted areas were redrawn too */
+	if (genconv.bFullUpdate)
+	{
+		genconv.firstrow = 0;
+		genconv.lastrow = sdlscrn->h - 1;
+		genconv.bFullUpdate = false;
+	}
 }
 
 bool Screen_GenDraw(uint32_t vaddr, int vw, int vh, int vbpp, int nextline,
@@ -1159,6 +1361,9 @@ bool Screen_GenDraw(uint32_t vaddr, int vw, int vh, int vbpp, int nextline,
 {
 	int hscrolloffset;
 
+	/* restore area potentially left under overlay led */
+	Statusbar_OverlayRestore(sdlscrn);
+
 	if (ConfigureParams.Screen.DisableVideo || !Screen_Lock())
 		return false;
 
@@ -1171,6 +1376,7 @@ bool Screen_GenDraw(uint32_t vaddr, int vw, int vh, int vbpp, int nextline,
 	                  leftBorder, rightBorder, upperBorder, lowerBorder);
 
 	Screen_UnLock();
+	Statusbar_OverlayBackup(sdlscrn);
 	Screen_GenConvUpdate(Statusbar_Update(sdlscrn, false), false);
 	return true;
 }
@@ -0,0 +1,433 @@
+/*
+  Hatari - screenPlanar.c
+
+  This file is distributed under the GNU General Public License, version 2
+  or at your option any later version. Read the file gpl.txt for details.
+
+  Atari bitplane to chunky (one byte per pixel color index) conversion.
+
+  All the screen converters (ST/STE low & medium resolution, Spectrum 512,
+  TT and Falcon bitplane modes) first convert a whole line of interleaved
+  bitplane words to color indexes with the kernel below, and then do the
+  palette lookups from that line buffer.
+
+  Falcon true color (16-bit) lines are converted to host 16-bit or 32-bit
+  pixels with the kernels in the second half of the file.
+
+  Besides the portable kernels, there are SSE2 and NEON versions which
+  convert 8 or more pixels at a time in a single vector register. The best
+  kernels supported by the host CPU are selected at run-time.
+*/
+const char ScreenPlanar_fileid[] = "Hatari screenPlanar.c";
+
+#include <string.h>
+#include <SDL_endian.h>
+#include "main.h"
+#include "screenPlanar.h"
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+# define PLANAR_HAVE_SSE2 1
+# include <emmintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+# define PLANAR_HAVE_NEON 1
+# include <arm_neon.h>
+#endif
+
+static void ScreenPlanar_ToChunkyFirst(const Uint8 *planar, int planes,
+                                       int blocks, Uint8 *chunky);
+
+static void ScreenPlanar_HiColorTo16bppGeneric(const Uint8 *src, int count,
+                                               Uint16 *dst);
+static void ScreenPlanar_HiColorTo32bppGeneric(const Uint8 *src, int count,
+                                               Uint32 *dst,
+                                               const SCREENPLANAR_RGB32 *fmt);
+
+void (*ScreenPlanar_ToChunky)(const Uint8 *planar, int planes,
+                              int blocks, Uint8 *chunky) = ScreenPlanar_ToChunkyFirst;
+void (*ScreenPlanar_HiColorTo16bpp)(const Uint8 *src, int count,
+                                    Uint16 *dst) = ScreenPlanar_HiColorTo16bppGeneric;
+void (*ScreenPlanar_HiColorTo32bpp)(const Uint8 *src, int count, Uint32 *dst,
+                                    const SCREENPLANAR_RGB32 *fmt) = ScreenPlanar_HiColorTo32bppGeneric;
+
+/* Bits of a plane byte spread out to the lowest bit of 8 bytes,
+ * in memory order (i.e. independent of the host endianness)
+ */
+static Uint64 PlaneSpread[256];
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Portable version, ORs the spread bits of each plane together
+ * 8 pixels at a time.
+ */
+static void ScreenPlanar_ToChunkyGeneric(const Uint8 *planar, int planes,
+                                         int blocks, Uint8 *chunky)
+{
+	Uint64 left, right;
+	int p;
+
+	while (blocks-- > 0)
+	{
+		left = right = 0;
+		for (p = 0; p < planes; p++)
+		{
+			left |= PlaneSpread[planar[0]] << p;
+			right |= PlaneSpread[planar[1]] << p;
+			planar += 2;
+		}
+		memcpy(chunky, &left, 8);
+		memcpy(chunky + 8, &right, 8);
+		chunky += 16;
+	}
+}
+
+
+#if PLANAR_HAVE_SSE2
+/**
+ * SSE2 version for 1, 2, 4 and 8 planes. The plane bytes of 8 / planes
+ * blocks are loaded to a register so that each 64-bit half contains an
+ * 8x8 bit matrix with a row for each plane byte (left half for the first
+ * 8 pixels, right half for the last 8). These are transposed with delta
+ * swaps, so that there's a byte for each pixel with a bit for each row.
+ * Other plane counts and the left-over blocks use the generic version.
+ */
+__attribute__((target("sse2")))
+static void ScreenPlanar_ToChunkySSE2(const Uint8 *planar, int planes,
+                                      int blocks, Uint8 *chunky)
+{
+	const __m128i lowbytes = _mm_set1_epi16(0x00ff);
+	const __m128i mask1 = _mm_set1_epi64x(0x00AA00AA00AA00AAULL);
+	const __m128i mask2 = _mm_set1_epi64x(0x0000CCCC0000CCCCULL);
+	const __m128i mask4 = _mm_set1_epi64x(0x00000000F0F0F0F0ULL);
+	__m128i v, t, pixmask;
+	int perreg, k;
+
+	if (planes != 1 && planes != 2 && planes != 4 && planes != 8)
+	{
+		ScreenPlanar_ToChunkyGeneric(planar, planes, blocks, chunky);
+		return;
+	}
+	perreg = 8 / planes;	/* blocks per register */
+	pixmask = _mm_set1_epi8((char)((1 << planes) - 1));
+
+	for (; blocks >= perreg; blocks -= perreg)
+	{
+		/* high bytes of the plane words (pixels 0-7) to the left
+		 * half and low bytes (pixels 8-15) to the right half
+		 */
+		v = _mm_loadu_si128((const __m128i *)planar);
+		v = _mm_packus_epi16(_mm_and_si128(v, lowbytes), _mm_srli_epi16(v, 8));
+
+		/* transpose */
+		t = _mm_and_si128(_mm_xor_si128(v, _mm_srli_epi64(v, 7)), mask1);
+		v = _mm_xor_si128(v, _mm_xor_si128(t, _mm_slli_epi64(t, 7)));
+		t = _mm_and_si128(_mm_xor_si128(v, _mm_srli_epi64(v, 14)), mask2);
+		v = _mm_xor_si128(v, _mm_xor_si128(t, _mm_slli_epi64(t, 14)));
+		t = _mm_and_si128(_mm_xor_si128(v, _mm_srli_epi64(v, 28)), mask4);
+		v = _mm_xor_si128(v, _mm_xor_si128(t, _mm_slli_epi64(t, 28)));
+
+		/* most significant bit is the leftmost pixel, so reverse
+		 * the byte order in both halves
+		 */
+		v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+		v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+		v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+
+		/* split the bits of each block to their own color indexes */
+		for (k = 0; k < perreg; k++)
+		{
+			t = _mm_and_si128(_mm_srli_epi16(v, k * planes), pixmask);
+			_mm_storeu_si128((__m128i *)chunky, t);
+			chunky += 16;
+		}
+		planar += 16;
+	}
+	if (blocks)
+		ScreenPlanar_ToChunkyGeneric(planar, planes, blocks, chunky);
+}
+#endif	/* PLANAR_HAVE_SSE2 */
+
+
+#if PLANAR_HAVE_NEON
+/**
+ * NEON version, tests the duplicated plane bytes against per pixel
+ * bit masks.
+ */
+static void ScreenPlanar_ToChunkyNEON(const Uint8 *planar, int planes,
+                                      int blocks, Uint8 *chunky)
+{
+	static const Uint8 bits[16] = {
+		0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+		0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01
+	};
+	const uint8x16_t mask = vld1q_u8(bits);
+	uint8x16_t res, v;
+	int p;
+
+	while (blocks-- > 0)
+	{
+		res = vdupq_n_u8(0);
+		for (p = 0; p < planes; p++)
+		{
+			v = vcombine_u8(vdup_n_u8(planar[0]), vdup_n_u8(planar[1]));
+			v = vandq_u8(vtstq_u8(v, mask), vdupq_n_u8(1 << p));
+			res = vorrq_u8(res, v);
+			planar += 2;
+		}
+		vst1q_u8(chunky, res);
+		chunky += 16;
+	}
+}
+#endif	/* PLANAR_HAVE_NEON */
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Portable true color versions. RGB565 is expanded to 8-bit channels
+ * by replicating the highest bits of each channel to the lowest ones.
+ */
+static void ScreenPlanar_HiColorTo16bppGeneric(const Uint8 *src, int count,
+                                               Uint16 *dst)
+{
+	while (count-- > 0)
+	{
+		*dst++ = (src[0] << 8) | src[1];
+		src += 2;
+	}
+}
+
+static void ScreenPlanar_HiColorTo32bppGeneric(const Uint8 *src, int count,
+                                               Uint32 *dst,
+                                               const SCREENPLANAR_RGB32 *fmt)
+{
+	Uint32 w, r, g, b;
+
+	while (count-- > 0)
+	{
+		w = (src[0] << 8) | src[1];
+		r = ((w >> 8) & 0xf8) | (w >> 13);
+		g = ((w >> 3) & 0xfc) | ((w >> 9) & 0x03);
+		b = ((w << 3) & 0xf8) | ((w >> 2) & 0x07);
+		*dst++ = (r << fmt->Rshift) | (g << fmt->Gshift)
+		         | (b << fmt->Bshift) | fmt->Amask;
+		src += 2;
+	}
+}
+
+
+#if PLANAR_HAVE_SSE2
+/**
+ * SSE2 true color versions, 8 pixels at a time
+ */
+__attribute__((target("sse2")))
+static void ScreenPlanar_HiColorTo16bppSSE2(const Uint8 *src, int count,
+                                            Uint16 *dst)
+{
+	__m128i v;
+
+	for (; count >= 8; count -= 8)
+	{
+		v = _mm_loadu_si128((const __m128i *)src);
+		v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+		_mm_storeu_si128((__m128i *)dst, v);
+		src += 16;
+		dst += 8;
+	}
+	ScreenPlanar_HiColorTo16bppGeneric(src, count, dst);
+}
+
+__attribute__((target("sse2")))
+static inline __m128i ScreenPlanar_RGB565ToHostSSE2(__m128i w, __m128i rs,
+                                                   __m128i gs, __m128i bs,
+                                                   __m128i amask)
+{
+	const __m128i mask_f8 = _mm_set1_epi32(0xf8);
+	const __m128i mask_fc = _mm_set1_epi32(0xfc);
+	const __m128i mask_07 = _mm_set1_epi32(0x07);
+	const __m128i mask_03 = _mm_set1_epi32(0x03);
+	__m128i r, g, b;
+
+	r = _mm_or_si128(_mm_and_si128(_mm_srli_epi32(w, 8), mask_f8),
+	                 _mm_srli_epi32(w, 13));
+	g = _mm_or_si128(_mm_and_si128(_mm_srli_epi32(w, 3), mask_fc),
+	                 _mm_and_si128(_mm_srli_epi32(w, 9), mask_03));
+	b = _mm_or_si128(_mm_and_si128(_mm_slli_epi32(w, 3), mask_f8),
+	                 _mm_and_si128(_mm_srli_epi32(w, 2), mask_07));
+	return _mm_or_si128(_mm_or_si128(_mm_sll_epi32(r, rs), _mm_sll_epi32(g, gs)),
+	                    _mm_or_si128(_mm_sll_epi32(b, bs), amask));
+}
+
+__attribute__((target("sse2")))
+static void ScreenPlanar_HiColorTo32bppSSE2(const Uint8 *src, int count,
+                                            Uint32 *dst,
+                                            const SCREENPLANAR_RGB32 *fmt)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i rs = _mm_cvtsi32_si128(fmt->Rshift);
+	const __m128i gs = _mm_cvtsi32_si128(fmt->Gshift);
+	const __m128i bs = _mm_cvtsi32_si128(fmt->Bshift);
+	const __m128i amask = _mm_set1_epi32(fmt->Amask);
+	__m128i v;
+
+	for (; count >= 8; count -= 8)
+	{
+		v = _mm_loadu_si128((const __m128i *)src);
+		v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+		_mm_storeu_si128((__m128i *)dst,
+		                 ScreenPlanar_RGB565ToHostSSE2(_mm_unpacklo_epi16(v, zero),
+		                                               rs, gs, bs, amask));
+		_mm_storeu_si128((__m128i *)(dst + 4),
+		                 ScreenPlanar_RGB565ToHostSSE2(_mm_unpackhi_epi16(v, zero),
+		                                               rs, gs, bs, amask));
+		src += 16;
+		dst += 8;
+	}
+	ScreenPlanar_HiColorTo32bppGeneric(src, count, dst, fmt);
+}
+#endif	/* PLANAR_HAVE_SSE2 */
+
+
+#if PLANAR_HAVE_NEON && SDL_BYTEORDER == SDL_LIL_ENDIAN
+/**
+ * NEON true color versions, 8 pixels at a time
+ */
+static void ScreenPlanar_HiColorTo16bppNEON(const Uint8 *src, int count,
+                                            Uint16 *dst)
+{
+	for (; count >= 8; count -= 8)
+	{
+		vst1q_u8((Uint8 *)dst, vrev16q_u8(vld1q_u8(src)));
+		src += 16;
+		dst += 8;
+	}
+	ScreenPlanar_HiColorTo16bppGeneric(src, count, dst);
+}
+
+static inline uint32x4_t ScreenPlanar_RGB565ToHostNEON(uint32x4_t w, int32x4_t rs,
+                                                      int32x4_t gs, int32x4_t bs,
+                                                      uint32x4_t amask)
+{
+	uint32x4_t r, g, b;
+
+	r = vorrq_u32(vandq_u32(vshrq_n_u32(w, 8), vdupq_n_u32(0xf8)),
+	              vshrq_n_u32(w, 13));
+	g = vorrq_u32(vandq_u32(vshrq_n_u32(w, 3), vdupq_n_u32(0xfc)),
+	              vandq_u32(vshrq_n_u32(w, 9), vdupq_n_u32(0x03)));
+	b = vorrq_u32(vandq_u32(vshlq_n_u32(w, 3), vdupq_n_u32(0xf8)),
+	              vandq_u32(vshrq_n_u32(w, 2), vdupq_n_u32(0x07)));
+	return vorrq_u32(vorrq_u32(vshlq_u32(r, rs), vshlq_u32(g, gs)),
+	                 vorrq_u32(vshlq_u32(b, bs), amask));
+}
+
+static void ScreenPlanar_HiColorTo32bppNEON(const Uint8 *src, int count,
+                                            Uint32 *dst,
+                                            const SCREENPLANAR_RGB32 *fmt)
+{
+	const int32x4_t rs = vdupq_n_s32(fmt->Rshift);
+	const int32x4_t gs = vdupq_n_s32(fmt->Gshift);
+	const int32x4_t bs = vdupq_n_s32(fmt->Bshift);
+	const uint32x4_t amask = vdupq_n_u32(fmt->Amask);
+	uint16x8_t v;
+
+	for (; count >= 8; count -= 8)
+	{
+		v = vreinterpretq_u16_u8(vrev16q_u8(vld1q_u8(src)));
+		vst1q_u32(dst, ScreenPlanar_RGB565ToHostNEON(vmovl_u16(vget_low_u16(v)),
+		                                             rs, gs, bs, amask));
+		vst1q_u32(dst + 4, ScreenPlanar_RGB565ToHostNEON(vmovl_u16(vget_high_u16(v)),
+		                                                 rs, gs, bs, amask));
+		src += 16;
+		dst += 8;
+	}
+	ScreenPlanar_HiColorTo32bppGeneric(src, count, dst, fmt);
+}
+#endif	/* PLANAR_HAVE_NEON && SDL_BYTEORDER == SDL_LIL_ENDIAN */
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Select given conversion kernels. Return their name, or NULL if
+ * the kernel isn't supported by the build or the host CPU.
+ */
+const char *ScreenPlanar_SelectKernel(int kernel)
+{
+	const char *name;
+	Uint8 spread[8];
+	int i, j;
+
+	/* generic version is also used for the cases other versions
+	 * don't handle, so its table is always needed
+	 */
+	for (i = 0; i < 256; i++)
+	{
+		for (j = 0; j < 8; j++)
+			spread[j] = (i >> (7 - j)) & 1;
+		memcpy(&PlaneSpread[i], spread, sizeof(spread));
+	}
+
+	switch (kernel)
+	{
+	case PLANAR_KERNEL_AUTO:
+		name = ScreenPlanar_SelectKernel(PLANAR_KERNEL_NEON);
+		if (!name)
+			name = ScreenPlanar_SelectKernel(PLANAR_KERNEL_SSE2);
+		if (!name)
+			name = ScreenPlanar_SelectKernel(PLANAR_KERNEL_GENERIC);
+		return name;
+
+	case PLANAR_KERNEL_GENERIC:
+		ScreenPlanar_ToChunky = ScreenPlanar_ToChunkyGeneric;
+		ScreenPlanar_HiColorTo16bpp = ScreenPlanar_HiColorTo16bppGeneric;
+		ScreenPlanar_HiColorTo32bpp = ScreenPlanar_HiColorTo32bppGeneric;
+		return "generic";
+
+	case PLANAR_KERNEL_SSE2:
+#if PLANAR_HAVE_SSE2
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("sse2"))
+		{
+			ScreenPlanar_ToChunky = ScreenPlanar_ToChunkySSE2;
+			ScreenPlanar_HiColorTo16bpp = ScreenPlanar_HiColorTo16bppSSE2;
+			ScreenPlanar_HiColorTo32bpp = ScreenPlanar_HiColorTo32bppSSE2;
+			return "SSE2";
+		}
+#endif
+		return NULL;
+
+	case PLANAR_KERNEL_NEON:
+#if PLANAR_HAVE_NEON
+		ScreenPlanar_ToChunky = ScreenPlanar_ToChunkyNEON;
+# if SDL_BYTEORDER == SDL_LIL_ENDIAN
+		ScreenPlanar_HiColorTo16bpp = ScreenPlanar_HiColorTo16bppNEON;
+		ScreenPlanar_HiColorTo32bpp = ScreenPlanar_HiColorTo32bppNEON;
+# else
+		ScreenPlanar_HiColorTo16bpp = ScreenPlanar_HiColorTo16bppGeneric;
+		ScreenPlanar_HiColorTo32bpp = ScreenPlanar_HiColorTo32bppGeneric;
+# endif
+		return "NEON";
+#else
+		return NULL;
+#endif
+	}
+	return NULL;
+}
+
+/**
+ * Select the best kernel for the host CPU, return its name
+ */
+const char *ScreenPlanar_Init(void)
+{
+	return ScreenPlanar_SelectKernel(PLANAR_KERNEL_AUTO);
+}
+
+/**
+ * Initial conversion function, for the case of ScreenPlanar_Init()
+ * not having been called yet.
+ */
+static void ScreenPlanar_ToChunkyFirst(const Uint8 *planar, int planes,
+                                       int blocks, Uint8 *chunky)
+{
+	ScreenPlanar_Init();
+	ScreenPlanar_ToChunky(planar, planes, blocks, chunky);
+}
@@ -0,0 +1,599 @@
+/*
+  Hatari - screenScale.c
+
+  This file is distributed under the GNU General Public License, version 2
+  or at your option any later version. Read the file gpl.txt for details.
+
+  Scaling of the Hatari screen surface to the window surface on the CPU.
+
+  Without a GPU, the SDL renderer scales the window texture with its
+  generic software renderer, which is slow for large windows. This
+  is used instead of it when --cpu-scale option is given, to scale
+  the (32-bit) screen surface directly to the window surface:
+  - nearest: largest integer factor fitting the window, pixels repeated
+  - scanlines: like nearest, but last line of each pixel is darkened
+  - sharp: largest size fitting the window with the same aspect ratio,
+    using sharp-bilinear filtering, i.e. pixels are repeated an integer
+    number of times and only the edges between them are interpolated
+
+  Only the window rows corresponding to the updated screen surface rows
+  are scaled. Sharp-bilinear filtering is done as separate horizontal
+  and vertical passes, each horizontally filtered source row is used
+  for all the window rows needing it.
+
+  Besides the portable row kernels, there are SSE2 versions handling 4
+  pixels at a time. They are selected at run-time like the bitplane
+  conversion kernels in screenPlanar.c.
+*/
+const char ScreenScale_fileid[] = "Hatari screenScale.c";
+
+#include <math.h>
+#include <string.h>
+#include "main.h"
+#include "screenScale.h"
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+# define SCALE_HAVE_SSE2 1
+# include <emmintrin.h>
+#endif
+
+static void ScreenScale_RowNearestGeneric(const Uint32 *src, int count,
+                                          int factor, Uint32 *dst);
+static void ScreenScale_RowDimGeneric(const Uint32 *src, int count,
+                                      Uint32 amask, Uint32 *dst);
+static void ScreenScale_RowBlendGeneric(const Uint32 *a, const Uint32 *b,
+                                        int weight, int count, Uint32 *dst);
+static void ScreenScale_RowLinearGeneric(const Uint32 *src, const SCREENSCALE_TAP *taps,
+                                         int count, Uint32 *dst);
+
+void (*ScreenScale_RowNearest)(const Uint32 *src, int count, int factor,
+                               Uint32 *dst) = ScreenScale_RowNearestGeneric;
+void (*ScreenScale_RowDim)(const Uint32 *src, int count, Uint32 amask,
+                           Uint32 *dst) = ScreenScale_RowDimGeneric;
+void (*ScreenScale_RowBlend)(const Uint32 *a, const Uint32 *b, int weight,
+                             int count, Uint32 *dst) = ScreenScale_RowBlendGeneric;
+void (*ScreenScale_RowLinear)(const Uint32 *src, const SCREENSCALE_TAP *taps,
+                              int count, Uint32 *dst) = ScreenScale_RowLinearGeneric;
+
+/* Current scaling setup */
+static struct {
+	int mode;
+	int src_w, src_h;
+	SDL_Rect area;			/* scaled screen within window */
+	int factor;			/* integer scaling factor, 0 for sharp */
+	Uint32 amask;
+	SCREENSCALE_TAP *xtaps;		/* sharp: for each area column */
+	SCREENSCALE_TAP *ytaps;		/* sharp: for each area row */
+	Uint32 *rows[2];		/* sharp: horizontally filtered source rows */
+	int rowline[2];			/* source row in above buffers, -1 if none */
+	int remx, remy;			/* mouse motion remainders */
+} Scale;
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Portable versions. Pixel channels are blended two at a time,
+ * in separate 16-bit halves of a 32-bit integer.
+ */
+static void ScreenScale_RowNearestGeneric(const Uint32 *src, int count,
+                                          int factor, Uint32 *dst)
+{
+	Uint32 pixel;
+	int i;
+
+	while (count-- > 0)
+	{
+		pixel = *src++;
+		for (i = 0; i < factor; i++)
+			*dst++ = pixel;
+	}
+}
+
+static void ScreenScale_RowDimGeneric(const Uint32 *src, int count,
+                                      Uint32 amask, Uint32 *dst)
+{
+	Uint32 pixel, half;
+
+	while (count-- > 0)
+	{
+		/* (p + (p + 1) / 2 + 1) / 2 for each byte, i.e. same
+		 * rounding as with two SSE2 byte averages
+		 */
+		pixel = *src++;
+		half = pixel - ((pixel >> 1) & 0x7f7f7f7f);
+		*dst++ = ((pixel | half) - (((pixel ^ half) >> 1) & 0x7f7f7f7f)) | amask;
+	}
+}
+
+static inline Uint32 ScreenScale_Blend(Uint32 a, Uint32 b, int weight)
+{
+	Uint32 rb, ag;
+
+	rb = (a & 0x00ff00ff) * (256 - weight) + (b & 0x00ff00ff) * weight;
+	ag = ((a >> 8) & 0x00ff00ff) * (256 - weight) + ((b >> 8) & 0x00ff00ff) * weight;
+	rb = ((rb + 0x00800080) >> 8) & 0x00ff00ff;
+	ag = (ag + 0x00800080) & 0xff00ff00;
+	return rb | ag;
+}
+
+static void ScreenScale_RowBlendGeneric(const Uint32 *a, const Uint32 *b,
+                                        int weight, int count, Uint32 *dst)
+{
+	while (count-- > 0)
+		*dst++ = ScreenScale_Blend(*a++, *b++, weight);
+}
+
+static void ScreenScale_RowLinearGeneric(const Uint32 *src, const SCREENSCALE_TAP *taps,
+                                         int count, Uint32 *dst)
+{
+	const Uint32 *pair;
+
+	while (count-- > 0)
+	{
+		pair = src + taps->index;
+		if (taps->weight)
+			*dst++ = ScreenScale_Blend(pair[0], pair[1], taps->weight);
+		else
+			*dst++ = pair[0];
+		taps++;
+	}
+}
+
+
+#if SCALE_HAVE_SSE2
+/**
+ * SSE2 versions, 4 source or destination pixels at a time
+ */
+__attribute__((target("sse2")))
+static void ScreenScale_RowNearestSSE2(const Uint32 *src, int count,
+                                       int factor, Uint32 *dst)
+{
+	__m128i v;
+
+	if (factor < 2 || factor > 4)
+	{
+		ScreenScale_RowNearestGeneric(src, count, factor, dst);
+		return;
+	}
+	for (; count >= 4; count -= 4)
+	{
+		v = _mm_loadu_si128((const __m128i *)src);
+		switch (factor)
+		{
+		case 2:
+			_mm_storeu_si128((__m128i *)dst, _mm_unpacklo_epi32(v, v));
+			_mm_storeu_si128((__m128i *)dst + 1, _mm_unpackhi_epi32(v, v));
+			break;
+		case 3:
+			_mm_storeu_si128((__m128i *)dst, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 0, 0)));
+			_mm_storeu_si128((__m128i *)dst + 1, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 2, 1, 1)));
+			_mm_storeu_si128((__m128i *)dst + 2, _mm_shuffle_epi32(v, _MM_SHUFFLE(3, 3, 3, 2)));
+			break;
+		case 4:
+			_mm_storeu_si128((__m128i *)dst, _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 0, 0, 0)));
+			_mm_storeu_si128((__m128i *)dst + 1, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 1, 1, 1)));
+			_mm_storeu_si128((__m128i *)dst + 2, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 2, 2, 2)));
+			_mm_storeu_si128((__m128i *)dst + 3, _mm_shuffle_epi32(v, _MM_SHUFFLE(3, 3, 3, 3)));
+			break;
+		}
+		src += 4;
+		dst += 4 * factor;
+	}
+	ScreenScale_RowNearestGeneric(src, count, factor, dst);
+}
+
+__attribute__((target("sse2")))
+static void ScreenScale_RowDimSSE2(const Uint32 *src, int count,
+                                   Uint32 amask, Uint32 *dst)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i alpha = _mm_set1_epi32(amask);
+	__m128i v;
+
+	for (; count >= 4; count -= 4)
+	{
+		v = _mm_loadu_si128((const __m128i *)src);
+		v = _mm_avg_epu8(v, _mm_avg_epu8(v, zero));
+		_mm_storeu_si128((__m128i *)dst, _mm_or_si128(v, alpha));
+		src += 4;
+		dst += 4;
+	}
+	ScreenScale_RowDimGeneric(src, count, amask, dst);
+}
+
+/* blend 4 pixels with weights given for each of their channels */
+__attribute__((target("sse2")))
+static inline __m128i ScreenScale_BlendSSE2(__m128i a, __m128i b,
+                                            __m128i wlo, __m128i whi)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i full = _mm_set1_epi16(256);
+	const __m128i round = _mm_set1_epi16(128);
+	__m128i lo, hi;
+
+	lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), _mm_sub_epi16(full, wlo)),
+	                   _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), wlo));
+	hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), _mm_sub_epi16(full, whi)),
+	                   _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), whi));
+	lo = _mm_srli_epi16(_mm_add_epi16(lo, round), 8);
+	hi = _mm_srli_epi16(_mm_add_epi16(hi, round), 8);
+	return _mm_packus_epi16(lo, hi);
+}
+
+__attribute__((target("sse2")))
+static void ScreenScale_RowBlendSSE2(const Uint32 *a, const Uint32 *b,
+                                     int weight, int count, Uint32 *dst)
+{
+	const __m128i w = _mm_set1_epi16(weight);
+	__m128i va, vb;
+
+	for (; count >= 4; count -= 4)
+	{
+		va = _mm_loadu_si128((const __m128i *)a);
+		vb = _mm_loadu_si128((const __m128i *)b);
+		_mm_storeu_si128((__m128i *)dst, ScreenScale_BlendSSE2(va, vb, w, w));
+		a += 4;
+		b += 4;
+		dst += 4;
+	}
+	ScreenScale_RowBlendGeneric(a, b, weight, count, dst);
+}
+
+__attribute__((target("sse2")))
+static void ScreenScale_RowLinearSSE2(const Uint32 *src, const SCREENSCALE_TAP *taps,
+                                      int count, Uint32 *dst)
+{
+	const Uint32 *p0, *p1, *p2, *p3;
+	__m128i va, vb, wlo, whi;
+
+	for (; count >= 4; count -= 4)
+	{
+		p0 = src + taps[0].index;
+		p1 = src + taps[1].index;
+		p2 = src + taps[2].index;
+		p3 = src + taps[3].index;
+		va = _mm_set_epi32(p3[0], p2[0], p1[0], p0[0]);
+		/* with sharp filtering, most pixels are just copied */
+		if ((taps[0].weight | taps[1].weight | taps[2].weight | taps[3].weight) == 0)
+		{
+			_mm_storeu_si128((__m128i *)dst, va);
+		}
+		else
+		{
+			vb = _mm_set_epi32(p3[1], p2[1], p1[1], p0[1]);
+			wlo = _mm_set_epi16(taps[1].weight, taps[1].weight, taps[1].weight, taps[1].weight,
+			                    taps[0].weight, taps[0].weight, taps[0].weight, taps[0].weight);
+			whi = _mm_set_epi16(taps[3].weight, taps[3].weight, taps[3].weight, taps[3].weight,
+			                    taps[2].weight, taps[2].weight, taps[2].weight, taps[2].weight);
+			_mm_storeu_si128((__m128i *)dst, ScreenScale_BlendSSE2(va, vb, wlo, whi));
+		}
+		taps += 4;
+		dst += 4;
+	}
+	ScreenScale_RowLinearGeneric(src, taps, count, dst);
+}
+#endif	/* SCALE_HAVE_SSE2 */
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Set sharp-bilinear filter taps for 'dst' pixels covering 'src' pixels.
+ * Each source pixel is first repeated 'prescale' times (as with nearest
+ * scaling), and the result is then linearly filtered to the final size.
+ * This is done in one step by only interpolating at the pixel edges,
+ * over an area of 1/prescale source pixel.
+ */
+static void ScreenScale_SetTaps(SCREENSCALE_TAP *taps, int src, int dst,
+                                int prescale)
+{
+	double texel, frac, dist, range, pos;
+	int i, index, weight;
+
+	range = 0.5 - 0.5 / prescale;
+	for (i = 0; i < dst; i++)
+	{
+		/* source pixel & position within it at destination pixel center */
+		texel = (i + 0.5) * src / dst;
+		frac = texel - floor(texel);
+		dist = frac - 0.5;
+		if (dist > range)
+			dist = (dist - range) * prescale;
+		else if (dist < -range)
+			dist = (dist + range) * prescale;
+		else
+			dist = 0.0;
+		/* position between centers of the two pixels to interpolate */
+		pos = floor(texel) + dist;
+		index = floor(pos);
+		weight = (pos - index) * 256 + 0.5;
+		if (weight >= 256)
+		{
+			index++;
+			weight = 0;
+		}
+		if (index < 0)
+		{
+			index = 0;
+			weight = 0;
+		}
+		else if (index > src - 2)
+		{
+			/* past the last pixel center, use just the last pixel */
+			index = src - 2;
+			weight = 256;
+		}
+		taps[i].index = index;
+		taps[i].weight = weight;
+	}
+}
+
+/**
+ * Free scaling buffers
+ */
+void ScreenScale_UnInit(void)
+{
+	free(Scale.xtaps);
+	free(Scale.ytaps);
+	free(Scale.rows[0]);
+	free(Scale.rows[1]);
+	Scale.xtaps = Scale.ytaps = NULL;
+	Scale.rows[0] = Scale.rows[1] = NULL;
+}
+
+/**
+ * Set up scaling of 'src_w' x 'src_h' screen surface to 'dst_w' x 'dst_h'
+ * window with given scaling mode. 'amask' are the alpha channel bits of
+ * the 32-bit pixels. Window area covered by the scaled screen is returned
+ * in 'area'. Return false if there was not enough memory for sharp scaling.
+ */
+bool ScreenScale_SetSize(int mode, int src_w, int src_h,
+                         int dst_w, int dst_h, Uint32 amask, SDL_Rect *area)
+{
+	double scale;
+	int prescale;
+
+	ScreenScale_UnInit();
+	Scale.mode = mode;
+	Scale.src_w = src_w;
+	Scale.src_h = src_h;
+	Scale.amask = amask;
+	Scale.remx = Scale.remy = 0;
+
+	Scale.factor = dst_w / src_w < dst_h / src_h ? dst_w / src_w : dst_h / src_h;
+	if (mode == SCALE_MODE_SHARP || Scale.factor < 1)
+	{
+		/* also window smaller than screen is handled by filtering */
+		Scale.factor = 0;
+		scale = fmin((double)dst_w / src_w, (double)dst_h / src_h);
+		Scale.area.w = src_w * scale + 0.5;
+		Scale.area.h = src_h * scale + 0.5;
+		if (Scale.area.w > dst_w)
+			Scale.area.w = dst_w;
+		if (Scale.area.h > dst_h)
+			Scale.area.h = dst_h;
+		prescale = scale < 1.0 ? 1 : floor(scale);
+
+		Scale.xtaps = malloc(Scale.area.w * sizeof(SCREENSCALE_TAP));
+		Scale.ytaps = malloc(Scale.area.h * sizeof(SCREENSCALE_TAP));
+		Scale.rows[0] = malloc(Scale.area.w * sizeof(Uint32));
+		Scale.rows[1] = malloc(Scale.area.w * sizeof(Uint32));
+		if (!(Scale.xtaps && Scale.ytaps && Scale.rows[0] && Scale.rows[1]))
+		{
+			ScreenScale_UnInit();
+			return false;
+		}
+		ScreenScale_SetTaps(Scale.xtaps, src_w, Scale.area.w, prescale);
+		ScreenScale_SetTaps(Scale.ytaps, src_h, Scale.area.h, prescale);
+	}
+	else
+	{
+		Scale.area.w = src_w * Scale.factor;
+		Scale.area.h = src_h * Scale.factor;
+	}
+	Scale.area.x = (dst_w - Scale.area.w) / 2;
+	Scale.area.y = (dst_h - Scale.area.h) / 2;
+	*area = Scale.area;
+	return true;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Return horizontally filtered source row 'line', filter it if
+ * it's not already in one of the row buffers.
+ */
+static const Uint32 *ScreenScale_GetRow(const Uint8 *src, int src_pitch, int line)
+{
+	int slot = line & 1;	/* the two blended rows use different slots */
+
+	if (Scale.rowline[slot] != line)
+	{
+		ScreenScale_RowLinear((const Uint32 *)(src + line * src_pitch),
+		                      Scale.xtaps, Scale.area.w, Scale.rows[slot]);
+		Scale.rowline[slot] = line;
+	}
+	return Scale.rows[slot];
+}
+
+/**
+ * Sharp-bilinear scaling of window area rows needing given source rows
+ */
+static void ScreenScale_RowsSharp(const Uint8 *src, int src_pitch, int y, int h,
+                                  Uint8 *dst, int dst_pitch, SDL_Rect *rect)
+{
+	const SCREENSCALE_TAP *tap;
+	const Uint32 *upper;
+	int row, first, last;
+	Uint32 *out;
+
+	/* area row uses source rows tap->index and tap->index + 1 */
+	first = last = -1;
+	for (row = 0; row < Scale.area.h; row++)
+	{
+		tap = &Scale.ytaps[row];
+		if (tap->index + 1 < y)
+			continue;
+		if (tap->index >= y + h)
+			break;
+		if (first < 0)
+			first = row;
+		last = row;
+	}
+	rect->x = Scale.area.x;
+	rect->w = Scale.area.w;
+	rect->y = Scale.area.y + (first < 0 ? 0 : first);
+	rect->h = first < 0 ? 0 : last - first + 1;
+
+	/* source surface contents changed since previous call */
+	Scale.rowline[0] = Scale.rowline[1] = -1;
+
+	dst += Scale.area.y * dst_pitch + Scale.area.x * sizeof(Uint32);
+	for (row = first; row >= 0 && row <= last; row++)
+	{
+		tap = &Scale.ytaps[row];
+		out = (Uint32 *)(dst + row * dst_pitch);
+		upper = ScreenScale_GetRow(src, src_pitch, tap->index);
+		if (tap->weight)
+			ScreenScale_RowBlend(upper, ScreenScale_GetRow(src, src_pitch, tap->index + 1),
+			                     tap->weight, Scale.area.w, out);
+		else
+			memcpy(out, upper, Scale.area.w * sizeof(Uint32));
+	}
+}
+
+/**
+ * Scale given screen surface rows to the window surface, and return
+ * the changed window area in 'rect'.
+ */
+void ScreenScale_Rows(const Uint8 *src, int src_pitch, int y, int h,
+                      Uint8 *dst, int dst_pitch, SDL_Rect *rect)
+{
+	int factor = Scale.factor;
+	int size = Scale.area.w * sizeof(Uint32);
+	Uint8 *out;
+	int i;
+
+	if (y < 0)
+	{
+		h += y;
+		y = 0;
+	}
+	if (h > Scale.src_h - y)
+		h = Scale.src_h - y;
+	if (h <= 0)
+	{
+		rect->x = rect->y = rect->w = rect->h = 0;
+		return;
+	}
+	if (!factor)
+	{
+		ScreenScale_RowsSharp(src, src_pitch, y, h, dst, dst_pitch, rect);
+		return;
+	}
+
+	rect->x = Scale.area.x;
+	rect->y = Scale.area.y + y * factor;
+	rect->w = Scale.area.w;
+	rect->h = h * factor;
+
+	src += y * src_pitch;
+	out = dst + rect->y * dst_pitch + rect->x * sizeof(Uint32);
+	while (h-- > 0)
+	{
+		ScreenScale_RowNearest((const Uint32 *)src, Scale.src_w, factor,
+		                       (Uint32 *)out);
+		for (i = 1; i < factor; i++)
+		{
+			if (i == factor - 1 && Scale.mode == SCALE_MODE_SCANLINES)
+				ScreenScale_RowDim((const Uint32 *)out, Scale.area.w, Scale.amask,
+				                   (Uint32 *)(out + i * dst_pitch));
+			else
+				memcpy(out + i * dst_pitch, out, size);
+		}
+		src += src_pitch;
+		out += factor * dst_pitch;
+	}
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Map window position to screen surface position
+ */
+void ScreenScale_MapPosition(int *x, int *y)
+{
+	int sx, sy;
+
+	if (!Scale.area.w || !Scale.area.h)
+		return;
+	sx = (*x - Scale.area.x) * Scale.src_w / Scale.area.w;
+	sy = (*y - Scale.area.y) * Scale.src_h / Scale.area.h;
+	*x = sx < 0 ? 0 : (sx >= Scale.src_w ? Scale.src_w - 1 : sx);
+	*y = sy < 0 ? 0 : (sy >= Scale.src_h ? Scale.src_h - 1 : sy);
+}
+
+/**
+ * Map relative window motion to screen surface motion. Parts that
+ * don't amount to a whole screen pixel are added to next motion.
+ */
+void ScreenScale_MapMotion(int *dx, int *dy)
+{
+	if (!Scale.area.w || !Scale.area.h)
+		return;
+	Scale.remx += *dx * Scale.src_w;
+	Scale.remy += *dy * Scale.src_h;
+	*dx = Scale.remx / Scale.area.w;
+	*dy = Scale.remy / Scale.area.h;
+	Scale.remx -= *dx * Scale.area.w;
+	Scale.remy -= *dy * Scale.area.h;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Select given scaling kernels. Return their name, or NULL if
+ * the kernel isn't supported by the build or the host CPU.
+ */
+const char *ScreenScale_SelectKernel(int kernel)
+{
+	const char *name;
+
+	switch (kernel)
+	{
+	case SCALE_KERNEL_AUTO:
+		name = ScreenScale_SelectKernel(SCALE_KERNEL_SSE2);
+		if (!name)
+			name = ScreenScale_SelectKernel(SCALE_KERNEL_GENERIC);
+		return name;
+
+	case SCALE_KERNEL_GENERIC:
+		ScreenScale_RowNearest = ScreenScale_RowNearestGeneric;
+		ScreenScale_RowDim = ScreenScale_RowDimGeneric;
+		ScreenScale_RowBlend = ScreenScale_RowBlendGeneric;
+		ScreenScale_RowLinear = ScreenScale_RowLinearGeneric;
+		return "generic";
+
+	case SCALE_KERNEL_SSE2:
+#if SCALE_HAVE_SSE2
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("sse2"))
+		{
+			ScreenScale_RowNearest = ScreenScale_RowNearestSSE2;
+			ScreenScale_RowDim = ScreenScale_RowDimSSE2;
+			ScreenScale_RowBlend = ScreenScale_RowBlendSSE2;
+			ScreenScale_RowLinear = ScreenScale_RowLinearSSE2;
+			return "SSE2";
+		}
+#endif
+		return NULL;
+	}
+	return NULL;
+}
+
+/**
+ * Select the best kernels for the host CPU, return their name
+ */
+const char *ScreenScale_Init(void)
+{
+	return ScreenScale_SelectKernel(SCALE_KERNEL_AUTO);
+}
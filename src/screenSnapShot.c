@@ -5,11 +5,16 @@
   or at your option any later version. Read the file gpl.txt for details.
 
   Screen Snapshots.
+
+  Besides single screen shots, this can log a hash of every emulated frame
+  (optionally saving the frames too), so that test runs can be compared
+  against known good results without looking at the screen.
 */
 const char ScreenSnapShot_fileid[] = "Hatari screenSnapShot.c";
 
 #include <SDL.h>
 #include <dirent.h>
+#include <inttypes.h>
 #include <string.h>
 #include "main.h"
 #include "configuration.h"
@@ -30,6 +35,10 @@ const char ScreenSnapShot_fileid[] = "Hatari screenSnapShot.c";
 
 static int nScreenShots = 0;                /* Number of screen shots saved */
 
+static FILE *FrameLogFile;                  /* Frame hash log, NULL when not logging */
+static char *FrameDumpDir;                  /* Where to save frames with new hashes */
+static Uint64 PrevFrameHash;
+
 
 /*-----------------------------------------------------------------------*/
 /**
@@ -98,16 +107,44 @@ static int ScreenSnapShot_SavePNG(SDL_Surface *surface, const char *filename)
 
 
 /**
- * Save given SDL surface as PNG in an already opened FILE, eventually cropping some borders.
- * Return png file size > 0 for success.
- * This function is also used by avi_record.c to save individual frames as png images.
+ * libpng write callback used to save a PNG image into memory
  */
-int ScreenSnapShot_SavePNG_ToFile(SDL_Surface *surface, int dw, int dh,
-		FILE *fp, int png_compression_level, int png_filter,
+static void ScreenSnapShot_WritePNG_ToMem(png_structp png_ptr, png_bytep data, png_size_t length)
+{
+	SCREENSNAPSHOT_PNG_BUFFER *buf = png_get_io_ptr(png_ptr);
+
+	if (buf->Size + (int)length > buf->AllocSize)
+	{
+		int size = 2 * (buf->Size + (int)length);
+		Uint8 *p = realloc(buf->Data, size);
+		if (!p)
+			png_error(png_ptr, "out of memory");
+		buf->Data = p;
+		buf->AllocSize = size;
+	}
+	memcpy(buf->Data + buf->Size, data, length);
+	buf->Size += length;
+}
+
+/* Nothing to flush, but with a NULL callback libpng would fflush() our buffer */
+static void ScreenSnapShot_FlushPNG_ToMem(png_structp png_ptr)
+{
+}
+
+
+/**
+ * Save given SDL surface as PNG, either in an already opened FILE
+ * or (when fp is NULL) appended to the given memory buffer,
+ * eventually cropping some borders.
+ * Return png image size > 0 for success.
+ */
+static int ScreenSnapShot_SavePNG_Common(SDL_Surface *surface, int dw, int dh,
+		FILE *fp, SCREENSNAPSHOT_PNG_BUFFER *buf,
+		int png_compression_level, int png_filter,
 		int CropLeft , int CropRight , int CropTop , int CropBottom )
 {
 	bool do_lock;
-	int y, ret;
+	int y, src_y, ret;
 	int sw = surface->w - CropLeft - CropRight;
 	int sh = surface->h - CropTop - CropBottom;
 	Uint8 *src_ptr;
@@ -150,11 +187,20 @@ int ScreenSnapShot_SavePNG_ToFile(SDL_Surface *surface, int dw, int dh,
 		goto png_cleanup;
 	}
 
-	/* store current pos in fp (could be != 0 for avi recording) */
-	start = ftello ( fp );
+	if (fp)
+	{
+		/* store current pos in fp (could be != 0 for avi recording) */
+		start = ftello ( fp );
 
-	/* initialize the png structure */
-	png_init_io(png_ptr, fp);
+		/* initialize the png structure */
+		png_init_io(png_ptr, fp);
+	}
+	else
+	{
+		start = buf->Size;
+		png_set_write_fn(png_ptr, buf, ScreenSnapShot_WritePNG_ToMem,
+		                 ScreenSnapShot_FlushPNG_ToMem);
+	}
 
 	/* image data properties */
 	png_set_IHDR(png_ptr, info_ptr, dw, dh, 8, PNG_COLOR_TYPE_RGB,
@@ -187,8 +233,11 @@ int ScreenSnapShot_SavePNG_ToFile(SDL_Surface *surface, int dw, int dh,
 			SDL_LockSurface(surface);
 
 
+		src_y = (y * sh + dh/2) / dh;
+		if (src_y >= sh)
+			src_y = sh - 1;
 		src_ptr = (Uint8 *)surface->pixels
-		          + (CropTop + (y * sh + dh/2) / dh) * surface->pitch
+		          + (CropTop + src_y) * surface->pitch
 		          + CropLeft * surface->format->BytesPerPixel;
 
 		switch (fmt->BytesPerPixel)
@@ -213,13 +262,44 @@ int ScreenSnapShot_SavePNG_ToFile(SDL_Surface *surface, int dw, int dh,
 	/* write the additional chunks to the PNG file */
 	png_write_end(png_ptr, info_ptr);
 
-	ret = (int)( ftello ( fp ) - start );			/* size of the png image */
+	if (fp)
+		ret = (int)( ftello ( fp ) - start );		/* size of the png image */
+	else
+		ret = (int)( buf->Size - start );
 png_cleanup:
 	if (png_ptr)
 		/* handles info_ptr being NULL */
 		png_destroy_write_struct(&png_ptr, &info_ptr);
 	return ret;
 }
+
+
+/**
+ * Save given SDL surface as PNG in an already opened FILE, eventually cropping some borders.
+ * Return png file size > 0 for success.
+ */
+int ScreenSnapShot_SavePNG_ToFile(SDL_Surface *surface, int dw, int dh,
+		FILE *fp, int png_compression_level, int png_filter,
+		int CropLeft , int CropRight , int CropTop , int CropBottom )
+{
+	return ScreenSnapShot_SavePNG_Common(surface, dw, dh, fp, NULL,
+		png_compression_level, png_filter,
+		CropLeft, CropRight, CropTop, CropBottom);
+}
+
+
+/**
+ * Append given SDL surface as PNG of dw x dh pixels to a memory buffer,
+ * which is grown as needed. Return png image size > 0 for success.
+ * This function is used by avi_record.c to compress video frames in
+ * its encoder threads, so it must not touch any global state.
+ */
+int ScreenSnapShot_SavePNG_ToBuffer(SDL_Surface *surface, int dw, int dh,
+		SCREENSNAPSHOT_PNG_BUFFER *buf, int png_compression_level, int png_filter)
+{
+	return ScreenSnapShot_SavePNG_Common(surface, dw, dh, NULL, buf,
+		png_compression_level, png_filter, 0, 0, 0, 0);
+}
 #endif
 
 
@@ -288,3 +368,148 @@ void ScreenSnapShot_SaveToFile(const char *szFileName)
 	fprintf(stderr, "Screen dump to '%s' %s\n", szFileName,
 		success ? "succeeded" : "failed");
 }
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Start logging frame hashes to given file. Return false on error.
+ */
+bool ScreenSnapShot_SetFrameLog(const char *szFileName)
+{
+	ScreenSnapShot_CloseFrameLog();
+
+	FrameLogFile = File_Open(szFileName, "w");
+	if (!FrameLogFile)
+		return false;
+
+	fprintf(FrameLogFile, "# Hatari frame log: <VBL> <frame hash>, line is written when frame changes\n");
+	PrevFrameHash = 0;
+	return true;
+}
+
+/**
+ * Set directory where frames with new hashes are saved while logging
+ * frame hashes. Return false if directory doesn't exist.
+ */
+bool ScreenSnapShot_SetFrameDumpDir(const char *szDirName)
+{
+	if (!File_DirExists(szDirName))
+		return false;
+
+	free(FrameDumpDir);
+	FrameDumpDir = strdup(szDirName);
+	return FrameDumpDir != NULL;
+}
+
+/**
+ * Return true if frame hashes are being logged
+ */
+bool ScreenSnapShot_IsFrameLogging(void)
+{
+	return FrameLogFile != NULL;
+}
+
+/**
+ * Stop logging frame hashes
+ */
+void ScreenSnapShot_CloseFrameLog(void)
+{
+	FrameLogFile = File_Close(FrameLogFile);
+}
+
+/**
+ * Return hash of the emulated screen contents (without statusbar)
+ */
+static Uint64 ScreenSnapShot_HashFrame(SDL_Surface *surface)
+{
+	int y, x, width, height;
+	const Uint8 *row;
+	Uint64 hash, data;
+
+	width = surface->w * surface->format->BytesPerPixel;
+	height = surface->h - Statusbar_GetHeight();
+
+	hash = (Uint64)surface->w << 32 | surface->h << 8 | surface->format->BitsPerPixel;
+	for (y = 0; y < height; y++)
+	{
+		row = (const Uint8 *)surface->pixels + y * surface->pitch;
+		for (x = 0; x + 8 <= width; x += 8)
+		{
+			memcpy(&data, row + x, 8);
+			hash = (hash ^ data) * 0x9E3779B97F4A7C15ULL;
+			hash ^= hash >> 29;
+		}
+		for (; x < width; x++)
+			hash = (hash ^ row[x]) * 0x9E3779B97F4A7C15ULL;
+	}
+	return hash;
+}
+
+/**
+ * Save frame with given hash to the frame dump directory,
+ * unless it has been saved already.
+ */
+static void ScreenSnapShot_DumpFrame(Uint64 hash)
+{
+	char *szFileName;
+	bool success = false;
+#if HAVE_LIBPNG
+	const char *ext = "png";
+	FILE *fp;
+#else
+	const char *ext = "bmp";
+#endif
+
+	szFileName = malloc(FILENAME_MAX);
+	if (!szFileName)
+		return;
+
+	snprintf(szFileName, FILENAME_MAX, "%s%cframe_%016"PRIx64".%s",
+	         FrameDumpDir, PATHSEP, hash, ext);
+	if (File_Exists(szFileName))
+	{
+		free(szFileName);
+		return;
+	}
+#if HAVE_LIBPNG
+	fp = fopen(szFileName, "wb");
+	if (fp)
+	{
+		/* fast compression, there can be lots of frames */
+		success = ScreenSnapShot_SavePNG_ToFile(sdlscrn, 0, 0, fp, 1, -1,
+		                                        0, 0, 0, Statusbar_GetHeight()) > 0;
+		fclose(fp);
+	}
+#else
+	success = SDL_SaveBMP(sdlscrn, szFileName) == 0;
+#endif
+	if (!success)
+		Log_Printf(LOG_WARN, "Saving frame to '%s' failed!\n", szFileName);
+	free(szFileName);
+}
+
+/**
+ * Log hash of the frame drawn for given VBL, if it differs from
+ * the previous frame. Called after every VBL while logging.
+ */
+void ScreenSnapShot_LogFrame(int nVBL)
+{
+	Uint64 hash;
+
+	if (!FrameLogFile || !sdlscrn || ConfigureParams.Screen.DisableVideo)
+		return;
+
+	if (SDL_MUSTLOCK(sdlscrn) && SDL_LockSurface(sdlscrn) != 0)
+		return;
+	hash = ScreenSnapShot_HashFrame(sdlscrn);
+	if (SDL_MUSTLOCK(sdlscrn))
+		SDL_UnlockSurface(sdlscrn);
+
+	if (hash == PrevFrameHash)
+		return;
+	PrevFrameHash = hash;
+
+	fprintf(FrameLogFile, "%d %016"PRIx64"\n", nVBL, hash);
+	if (FrameDumpDir)
+		ScreenSnapShot_DumpFrame(hash);
+}
@@ -173,9 +173,6 @@ static void ShortCut_FastForward(void)
 	{
 		/* Restore */
 		ConfigureParams.System.bFastForward = false;
-
-		/* Reset the sound emulation variables: */
-		Sound_BufferIndexNeedReset = true;
 	}
 	else
 	{
@@ -129,6 +129,9 @@
 
 const char Sound_fileid[] = "Hatari sound.c";
 
+#include <limits.h>
+#include <inttypes.h>
+
 #include "main.h"
 #include "audio.h"
 #include "cycles.h"
@@ -149,6 +152,11 @@ const char Sound_fileid[] = "Hatari sound.c";
 #include "avi_record.h"
 #include "clocks_timings.h"
 
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+# define YM2149_HAVE_SSE2 1
+# include <emmintrin.h>
+#endif
+
 
 
 /*--------------------------------------------------------------*/
@@ -266,6 +274,7 @@ static ymu16	ToneA_per , ToneA_count , ToneA_val;
 static ymu16	ToneB_per , ToneB_count , ToneB_val;
 static ymu16	ToneC_per , ToneC_count , ToneC_val;
 static ymu16	Noise_per , Noise_count , Noise_val;
+static ymu16	Noise_div_2;				/* noise counter is incremented every 2 cycles */
 static ymu16	Env_per , Env_count;
 static ymu32	Env_pos;
 static int	Env_shape;
@@ -274,6 +283,7 @@ static ymu32	mixerTA , mixerTB , mixerTC;
 static ymu32	mixerNA , mixerNB , mixerNC;
 
 static ymu32	RndRack;				/* current random seed */
+static ymu32	YmRndSkip8[ 256 ];			/* random seed after 8 steps from each 8 bits value */
 
 static ymu16	EnvMask3Voices = 0;			/* mask is 0x1f for voices having an active envelope */
 static ymu16	Vol3Voices = 0;				/* volume 0-0x1f for voices having a constant volume */
@@ -292,21 +302,19 @@ int		YM2149_HPF_Filter = YM2149_HPF_FILTER_IIR;
 
 //int		YM2149_Resample_Method = YM2149_RESAMPLE_METHOD_NEAREST;
 //int		YM2149_Resample_Method = YM2149_RESAMPLE_METHOD_WEIGHTED_AVERAGE_2;
-int		YM2149_Resample_Method = YM2149_RESAMPLE_METHOD_WEIGHTED_AVERAGE_N;
+//int		YM2149_Resample_Method = YM2149_RESAMPLE_METHOD_WEIGHTED_AVERAGE_N;
+int		YM2149_Resample_Method = YM2149_RESAMPLE_METHOD_POLYPHASE;
 
 
 bool		bEnvelopeFreqFlag;			/* Cleared each frame for YM saving */
 
 Sint16		AudioMixBuffer[AUDIOMIXBUFFER_SIZE][2];	/* Ring buffer to store mixed audio output (YM2149, DMA sound, ...) */
 int		AudioMixBuffer_pos_write;		/* Current writing position into above buffer */
-int		AudioMixBuffer_pos_read;		/* Current reading position into above buffer */
-
-int		nGeneratedSamples;			/* Generated samples since audio buffer update */
+SDL_atomic_t	AudioMixBuffer_nWritten;		/* Number of samples written to above buffer */
+SDL_atomic_t	AudioMixBuffer_nRead;			/* Number of samples read (played) from above buffer */
 
 static int	AudioMixBuffer_pos_write_avi;		/* Current working index to save an AVI audio frame */
 
-bool		Sound_BufferIndexNeedReset = false;
-
 
 #define		YM_BUFFER_250_SIZE	32768		/* Size to store YM samples generated at 250 kHz (must be a power of 2) */
 							/* As we fill YM_Buffer_250[] at least once per VBL (min freq = 50 Hz) */
@@ -325,9 +333,18 @@ static Uint64	YM2149_Clock_250_CpuClock;		/* Corresponding value of CyclesGlobal
 /* Some variables used for stats / debug */
 #define		SOUND_STATS_SIZE	60
 static int	Sound_Stats_Array[ SOUND_STATS_SIZE ];
+static int	Sound_Stats_FillArray[ SOUND_STATS_SIZE ];	/* Samples buffered for the audio callback at each VBL */
 static int	Sound_Stats_Index = 0;
 static int	Sound_Stats_SamplePerVBL;
 
+/* Audio pipeline counters since startup, shown by Sound_Info() and logged by Sound_Stats_Log() */
+static SOUND_STATS	Sound_Perf;
+static SOUND_STATS	Sound_Perf_Logged;		/* Values at the previous log line */
+static AUDIO_STATS	Audio_Stats_Logged;
+static FILE		*Sound_Stats_File;		/* CSV log, written once per emulated second */
+static int		Sound_Stats_FillMin = INT_MAX;	/* Buffered samples range since the previous log line */
+static int		Sound_Stats_FillMax = 0;
+
 
 static CLOCKS_CYCLES_STRUCT	YM2149_ConvertCycles_250;
 
@@ -346,12 +363,14 @@ static void	YM2149_BuildLinearVolumeTable(ymu16 volumetable[32][32][32]);
 static void	YM2149_Normalise_5bit_Table(ymu16 *in_5bit , yms16 *out_5bit, unsigned int Level, bool DoCenter);
 
 static void	YM2149_EnvBuild		(void);
+static void	YM2149_RndBuild		(void);
 static void	Ym2149_BuildVolumeTable	(void);
 static void	YM2149_UpdateClock_250	( Uint64 CpuClock );
 static void	Ym2149_Init		(void);
 static void	Ym2149_Reset		(void);
 
 static ymu32	YM2149_RndCompute	(void);
+static void	YM2149_RndSkip		(int count);
 static ymu16	YM2149_TonePer		(ymu8 rHigh , ymu8 rLow);
 static ymu16	YM2149_NoisePer		(ymu8 rNoise);
 static ymu16	YM2149_EnvPer		(ymu8 rHigh , ymu8 rLow);
@@ -359,6 +378,11 @@ static ymu16	YM2149_EnvPer		(ymu8 rHigh , ymu8 rLow);
 static void	YM2149_Run		( Uint64 CPU_Clock );
 static int	Sound_GenerateSamples	( Uint64 CPU_Clock);
 static void	YM2149_DoSamples_250	( int SamplesToGenerate_250 );
+static void	YM2149_SkipSamples_250	( int SamplesToGenerate_250 );
+static Sint32	YM2149_Polyphase_DotGeneric ( const ymsample *x , const Sint16 *h , int taps );
+#if YM2149_HAVE_SSE2
+static Sint32	YM2149_Polyphase_DotSSE2 ( const ymsample *x , const Sint16 *h , int taps );
+#endif
 #ifdef YM_250_DEBUG
 static void	YM2149_DoSamples_250_Debug ( int SamplesToGenerate , int pos );
 #endif
@@ -389,21 +413,6 @@ ymsample	Subsonic_IIR_HPF_Left(ymsample x0)
 }
 
 
-ymsample	Subsonic_IIR_HPF_Right(ymsample x0)
-{
-	static	yms32	x1 = 0, y1 = 0, y0 = 0;
-
-	if ( YM2149_HPF_Filter == YM2149_HPF_FILTER_NONE )
-		return x0;
-
-	y1 += ((x0 - x1)<<15) - (y0<<6);  /*  64*y0  */
-	y0 = y1>>15;
-	x1 = x0;
-
-	return y0;
-}
-
-
 /*--------------------------------------------------------------*/
 /* Low Pass Filter routines.					*/
 /*--------------------------------------------------------------*/
@@ -754,6 +763,29 @@ static void	YM2149_EnvBuild ( void )
 
 
 
+/*-----------------------------------------------------------------------*/
+/**
+ * Precompute the random generator's next 8 steps for each 8 bits value.
+ * As the LFSR only shifts bits to the right and xors the taps depending
+ * on bit 0, the state after 8 steps is ( RndRack >> 8 ) ^ YmRndSkip8[ RndRack & 0xff ]
+ */
+
+static void	YM2149_RndBuild ( void )
+{
+	ymu32	rnd;
+	int	i , n;
+
+	for ( i=0 ; i<256 ; i++ )
+	{
+		rnd = i;
+		for ( n=0 ; n<8 ; n++ )
+			rnd = ( rnd & 1 ) ? rnd>>1 ^ 0x12000 : rnd>>1;
+		YmRndSkip8[ i ] = rnd;
+	}
+}
+
+
+
 /*-----------------------------------------------------------------------*/
 /**
  * Depending on the YM mixing method, build the table used to convert
@@ -904,6 +936,9 @@ static void	Ym2149_Init(void)
 	/* Build the 16 envelope shapes */
 	YM2149_EnvBuild();
 
+	/* Build the table to skip random values */
+	YM2149_RndBuild();
+
 	/* Build the volume conversion table */
 	Ym2149_BuildVolumeTable();
 
@@ -975,6 +1010,20 @@ static ymu32	YM2149_RndCompute(void)
 
 
 
+/**
+ * Skip 'count' values of the random generator, 8 values at once
+ * when possible using YmRndSkip8[]
+ */
+static void	YM2149_RndSkip ( int count )
+{
+	for ( ; count >= 8 ; count -= 8 )
+		RndRack = ( RndRack >> 8 ) ^ YmRndSkip8[ RndRack & 0xff ];
+	while ( count-- > 0 )
+		YM2149_RndCompute();
+}
+
+
+
 static ymu16	YM2149_TonePer(ymu8 rHigh , ymu8 rLow)
 {
 	ymu16	per;
@@ -1005,7 +1054,205 @@ static ymu16	YM2149_EnvPer(ymu8 rHigh , ymu8 rLow)
 
 /*-----------------------------------------------------------------------*/
 /**
- * Main function : compute the value of the next sample.
+ * Return the number of internal YM2149 cycles until the tone/env counter
+ * 'count' reaches 'per' and starts a new phase.
+ * As measured on a real YM2149, result for per==0 is the same as for per==1 :
+ * the counter is incremented first, then compared to per.
+ */
+static inline int	YM2149_CounterCycles ( ymu16 count , ymu16 per )
+{
+	return per > count ? per - count : 1;
+}
+
+
+/**
+ * Run a tone/env counter for 'cycles' internal YM2149 cycles and return
+ * how many times a new phase was started during that time.
+ */
+static int	YM2149_RunCounter ( ymu16 *count , ymu16 per , int cycles )
+{
+	int	first;
+
+	first = YM2149_CounterCycles ( *count , per );
+	if ( cycles < first )
+	{
+		*count += cycles;
+		return 0;
+	}
+
+	cycles -= first;				/* counter is 0 after the first phase change */
+	if ( per <= 1 )
+	{
+		*count = 0;
+		return 1 + cycles;
+	}
+	*count = cycles % per;
+	return 1 + cycles / per;
+}
+
+
+/**
+ * Same as YM2149_CounterCycles() for the noise counter, which is
+ * only incremented every 2 cycles (at 125 kHz)
+ */
+static inline int	YM2149_NoiseCycles ( void )
+{
+	if ( Noise_count >= Noise_per )
+		return 1;
+	return 2 * ( Noise_per - Noise_count ) - Noise_div_2;
+}
+
+
+/**
+ * Run the noise counter for 'cycles' internal YM2149 cycles, computing
+ * a new random value each time the counter reaches the noise period.
+ */
+static void	YM2149_RunNoise ( int cycles )
+{
+	int	n;
+	int	edges = 0;
+
+	while ( ( n = YM2149_NoiseCycles () ) <= cycles )
+	{
+		cycles -= n;
+		Noise_div_2 ^= n & 1;
+		Noise_count = 0;
+		edges++;
+
+		/* Once the counter restarted on a 125 kHz step, next values come at a fixed rate */
+		/* (every cycle when Noise_per==0, else every 2*Noise_per cycles) */
+		if ( Noise_div_2 == 0 || Noise_per == 0 )
+		{
+			n = YM2149_NoiseCycles ();
+			edges += cycles / n;
+			Noise_div_2 ^= ( cycles / n ) & n & 1;
+			cycles %= n;
+			break;
+		}
+	}
+
+	if ( edges > 0 )
+	{
+		YM2149_RndSkip ( edges - 1 );
+		Noise_val = YM2149_RndCompute();	/* 0 or 0xffff */
+	}
+
+	/* No new noise value in the remaining cycles, only count the 125 kHz steps */
+	Noise_count += ( cycles + Noise_div_2 ) >> 1;
+	Noise_div_2 ^= cycles & 1;
+}
+
+
+/**
+ * Run all the tone/noise/env counters for 'cycles' internal YM2149 cycles
+ */
+static void	YM2149_RunCounters ( int cycles )
+{
+	int	n;
+
+	YM2149_RunNoise ( cycles );
+
+	if ( YM2149_RunCounter ( &ToneA_count , ToneA_per , cycles ) & 1 )
+		ToneA_val ^= YM_SQUARE_UP;		/* 0 or 0x1f */
+	if ( YM2149_RunCounter ( &ToneB_count , ToneB_per , cycles ) & 1 )
+		ToneB_val ^= YM_SQUARE_UP;
+	if ( YM2149_RunCounter ( &ToneC_count , ToneC_per , cycles ) & 1 )
+		ToneC_val ^= YM_SQUARE_UP;
+
+	n = YM2149_RunCounter ( &Env_count , Env_per , cycles );
+	if ( n )
+	{
+		Env_pos += n;
+		if ( Env_pos >= 3*32 )			/* blocks 0, 1 and 2 were used (Env_pos 0 to 95) */
+			Env_pos = 32 + ( Env_pos - 32 ) % ( 2*32 );	/* replay/loop blocks 1 and 2 (Env_pos 32 to 95) */
+	}
+}
+
+
+/**
+ * Build the 5 bits volume of each voice with the current values of tone/noise/volume/env
+ * and return the corresponding 16 bits signed sample (before low pass filtering)
+ */
+static inline ymsample	YM2149_MixVoices ( void )
+{
+	ymu32		bt;
+	ymu16		Env3Voices;			/* 0x00CCBBAA */
+	ymu16		Tone3Voices;			/* 0x00CCBBAA */
+
+	/* Get the 5 bits volume corresponding to the current envelope's position */
+	Env3Voices = YmEnvWaves[ Env_shape ][ Env_pos ];
+	Env3Voices &= EnvMask3Voices;			/* only keep volumes for voices using envelope */
+
+	/* Tone3Voices will contain the output state of each voice : 0 or 0x1f */
+	bt = (ToneA_val | mixerTA) & (Noise_val | mixerNA);	/* 0 or 0xffff */
+	Tone3Voices = bt & YM_MASK_1VOICE;		/* 0 or 0x1f */
+
+	bt = (ToneB_val | mixerTB) & (Noise_val | mixerNB);
+	Tone3Voices |= ( bt & YM_MASK_1VOICE ) << 5;
+
+	bt = (ToneC_val | mixerTC) & (Noise_val | mixerNC);
+	Tone3Voices |= ( bt & YM_MASK_1VOICE ) << 10;
+
+	/* Combine fixed volumes and envelope volumes and keep the resulting */
+	/* volumes depending on the output state of each voice (0 or 0x1f) */
+	Tone3Voices &= ( Env3Voices | Vol3Voices );
+
+	return ymout5[ Tone3Voices ];
+}
+
+
+/**
+ * Store 'count' samples at 250 kHz for a constant YM2149 output 'sample',
+ * applying low pass filter if needed.
+ * As soon as 2 filtered samples in a row are the same, the filter's state
+ * doesn't change anymore and all remaining samples get this same value.
+ */
+static void	YM2149_StoreSamples_250 ( ymsample sample , int count , int *pos )
+{
+	ymsample	filtered = sample , prev = 0;
+	int		n;
+
+	if ( count <= 0 )
+		return;
+
+	if ( YM2149_LPF_Filter == YM2149_LPF_FILTER_LPF_STF || YM2149_LPF_Filter == YM2149_LPF_FILTER_PWM )
+	{
+		for ( n=0 ; n<count ; n++ )
+		{
+			if ( YM2149_LPF_Filter == YM2149_LPF_FILTER_LPF_STF )
+				filtered = LowPassFilter ( sample );
+			else
+				filtered = PWMaliasFilter ( sample );
+
+			YM_Buffer_250[ *pos ] = filtered;
+			*pos = ( *pos + 1 ) & YM_BUFFER_250_SIZE_MASK;
+			if ( n > 0 && filtered == prev )
+			{
+				n++;
+				break;
+			}
+			prev = filtered;
+		}
+		count -= n;
+		sample = filtered;
+	}
+
+	while ( count > 0 )
+	{
+		n = YM_BUFFER_250_SIZE - *pos;
+		if ( n > count )
+			n = count;
+		count -= n;
+		while ( n-- > 0 )
+			YM_Buffer_250[ (*pos)++ ] = sample;
+		*pos &= YM_BUFFER_250_SIZE_MASK;
+	}
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Main function : compute the values of the next samples.
  * Mixes all 3 voices with tone+noise+env and apply low pass
  * filter if needed.
  * For maximum accuracy, this function emulates all single cycles at 250 kHz
@@ -1013,109 +1260,73 @@ static ymu16	YM2149_EnvPer(ymu8 rHigh , ymu8 rLow)
  * to the chosen output frequency (eg 44.1 kHz)
  * Creating a complete 250 kHz signal allow to emulate effects that require
  * precise cycle accuracy (such as "syncsquare" used in maxYMiser v1.53)
+ *
+ * Instead of incrementing all counters on each cycle, we compute how many cycles
+ * remain until the next counter reaches its period (an "edge") and run all the
+ * counters for that many cycles at once, as the output can't change between 2 edges.
+ * Edges of counters that can't be heard with the current mixer and volume settings
+ * are skipped too. This gives exactly the same samples as running each cycle.
  */
 static void	YM2149_DoSamples_250 ( int SamplesToGenerate_250 )
 {
-	ymsample	sample;
-	ymu32		bt;
-	ymu16		Env3Voices;			/* 0x00CCBBAA */
-	ymu16		Tone3Voices;			/* 0x00CCBBAA */
-	static ymu16	Freq_div_2 = 0;
+	ymsample	sample , sample_next;
+	ymu16		Voices;
+	bool		ToneA_on , ToneB_on , ToneC_on , Noise_on , Env_on;
 	int		pos;
+	int		cycles;
+	int		count;
 	int		n;
 
 
-//fprintf ( stderr , "ym2149_dosamples_250 in nb=%d ym_pos_wr=%d\n",SamplesToGenerate_250 , YM_Buffer_250_pos_write );
-
 	/* We write new samples at position YM_Buffer_250_pos_write while we read them at the same time */
 	/* at position YM_Buffer_250_pos_read (to create the output at YM_REPLAY_FREQ) */
 	/* This means we must ensure YM_Buffer_250[] is large enough to avoid overwriting data */
 	/* that are not read yet */
 	pos = YM_Buffer_250_pos_write;
 
-	/* Emulate as many internal YM cycles as needed to generate samples */
-	for ( n=0 ; n<SamplesToGenerate_250 ; n++ )
+	/* Registers don't change during this call : check which counters can change the */
+	/* output. Voices with fixed volume 0 are always silent, whatever their tone/noise */
+	Voices = EnvMask3Voices | Vol3Voices;
+	ToneA_on = ( Voices & YM_MASK_A ) && !mixerTA;
+	ToneB_on = ( Voices & YM_MASK_B ) && !mixerTB;
+	ToneC_on = ( Voices & YM_MASK_C ) && !mixerTC;
+	Noise_on = ( ( Voices & YM_MASK_A ) && !mixerNA ) || ( ( Voices & YM_MASK_B ) && !mixerNB )
+		|| ( ( Voices & YM_MASK_C ) && !mixerNC );
+	Env_on = EnvMask3Voices != 0;
+
+	sample = YM2149_MixVoices ();
+	count = 0;				/* number of cycles 'sample' was output */
+	cycles = SamplesToGenerate_250;
+	while ( cycles > 0 )
 	{
-		/* Emulate 1 internal YM2149 cycle : increase all counters */
-		/* As measured on a real YM2149, result for per==0 is the same as for per==1 */
-		/* To obtain this in our code, counters are incremented first, then compared to per, */
-		/* which gives the same result when per=1 and when per=0 */
-
-		/* Special case for noise counter, it's increased at 125 KHz, not 250 KHz */
-		Freq_div_2 ^= 1;
-		if ( Freq_div_2 == 0 )
-			Noise_count++;
-		if ( Noise_count >= Noise_per )
+		/* Number of cycles until the next edge that can change the output */
+		n = cycles;
+		if ( ToneA_on && YM2149_CounterCycles ( ToneA_count , ToneA_per ) < n )
+			n = YM2149_CounterCycles ( ToneA_count , ToneA_per );
+		if ( ToneB_on && YM2149_CounterCycles ( ToneB_count , ToneB_per ) < n )
+			n = YM2149_CounterCycles ( ToneB_count , ToneB_per );
+		if ( ToneC_on && YM2149_CounterCycles ( ToneC_count , ToneC_per ) < n )
+			n = YM2149_CounterCycles ( ToneC_count , ToneC_per );
+		if ( Noise_on && YM2149_NoiseCycles () < n )
+			n = YM2149_NoiseCycles ();
+		if ( Env_on && YM2149_CounterCycles ( Env_count , Env_per ) < n )
+			n = YM2149_CounterCycles ( Env_count , Env_per );
+
+		/* Output is unchanged until the last of these n cycles */
+		count += n - 1;
+		YM2149_RunCounters ( n );
+		cycles -= n;
+
+		sample_next = YM2149_MixVoices ();
+		if ( sample_next != sample )
 		{
-			Noise_count = 0;
-			Noise_val = YM2149_RndCompute();/* 0 or 0xffff */
+			YM2149_StoreSamples_250 ( sample , count , &pos );
+			sample = sample_next;
+			count = 0;
 		}
-
-//fprintf ( stderr , "ym2149_dosamples_250 max=%d n=%d ToneA_count=%d ToneA_per=%d val=%x pos=%d\n",SamplesToGenerate_250,n,ToneA_count,ToneA_per,ToneA_val,pos );
-		/* Other counters are increased on every call, at 250 KHz */
-		ToneA_count++;
-		if ( ToneA_count >= ToneA_per )
-		{
-//fprintf ( stderr , "ym2149_dosamples_250 max=%d n=%d ToneA_count=%d ToneA_per=%d val=%x pos=%d toggle\n",SamplesToGenerate_250,n,ToneA_count,ToneA_per,ToneA_val,pos );
-			ToneA_count = 0;
-			ToneA_val ^= YM_SQUARE_UP;	/* 0 or 0x1f */
-		}
-
-		ToneB_count++;
-		if ( ToneB_count >= ToneB_per )
-		{
-			ToneB_count = 0;
-			ToneB_val ^= YM_SQUARE_UP;	/* 0 or 0x1f */
-		}
-
-		ToneC_count++;
-		if ( ToneC_count >= ToneC_per )
-		{
-			ToneC_count = 0;
-			ToneC_val ^= YM_SQUARE_UP;	/* 0 or 0x1f */
-		}
-
-		Env_count += 1;
-		if ( Env_count >= Env_per )
-		{
-			Env_count = 0;
-			Env_pos += 1;
-			if ( Env_pos >= 3*32 )		/* blocks 0, 1 and 2 were used (Env_pos 0 to 95) */
-				Env_pos -= 2*32;	/* replay/loop blocks 1 and 2 (Env_pos 32 to 95) */
-		}
-
-		/* Build 'sample' value with the values of tone/noise/volume/env */
-
-		/* Get the 5 bits volume corresponding to the current envelope's position */
-		Env3Voices = YmEnvWaves[ Env_shape ][ Env_pos ];
-		Env3Voices &= EnvMask3Voices;			/* only keep volumes for voices using envelope */
-
-		/* Tone3Voices will contain the output state of each voice : 0 or 0x1f */
-		bt = (ToneA_val | mixerTA) & (Noise_val | mixerNA);	/* 0 or 0xffff */
-		Tone3Voices = bt & YM_MASK_1VOICE;		/* 0 or 0x1f */
-
-		bt = (ToneB_val | mixerTB) & (Noise_val | mixerNB);
-		Tone3Voices |= ( bt & YM_MASK_1VOICE ) << 5;
-
-		bt = (ToneC_val | mixerTC) & (Noise_val | mixerNC);
-		Tone3Voices |= ( bt & YM_MASK_1VOICE ) << 10;
-
-		/* Combine fixed volumes and envelope volumes and keep the resulting */
-		/* volumes depending on the output state of each voice (0 or 0x1f) */
-		Tone3Voices &= ( Env3Voices | Vol3Voices );
-
-		sample = ymout5[ Tone3Voices ];			/* 16 bits signed value */
-
-		/* Apply low pass filter ? */
-		if ( YM2149_LPF_Filter == YM2149_LPF_FILTER_LPF_STF )
-			sample = LowPassFilter ( sample );
-		else if ( YM2149_LPF_Filter == YM2149_LPF_FILTER_PWM )
-			sample = PWMaliasFilter ( sample );
-
-		/* Store sample */
-		YM_Buffer_250[ pos ] = sample;
-		pos = ( pos + 1 ) & YM_BUFFER_250_SIZE_MASK;
+		count++;
 	}
+	YM2149_StoreSamples_250 ( sample , count , &pos );
 
 
 #ifdef YM_250_DEBUG
@@ -1124,8 +1335,34 @@ static void	YM2149_DoSamples_250 ( int SamplesToGenerate_250 )
 #endif
 
 	YM_Buffer_250_pos_write = pos;
+}
 
-//fprintf ( stderr , "ym2149_dosamples_250 out nb=%d ym_pos_wr=%d\n",SamplesToGenerate_250 , YM_Buffer_250_pos_write );
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Fill the 250 kHz buffer with silence instead of emulating each internal
+ * YM2149 cycle. This is used in fast forward turbo mode, where sound output
+ * is not needed (except when rendering sound offline for recording).
+ * YM2149 registers are still updated as usual, only the tone, noise and
+ * envelope counters are not running during that time.
+ */
+static void	YM2149_SkipSamples_250 ( int SamplesToGenerate_250 )
+{
+	int		pos;
+	int		n;
+
+	pos = YM_Buffer_250_pos_write;
+	while ( SamplesToGenerate_250 > 0 )
+	{
+		n = YM_BUFFER_250_SIZE - pos;
+		if ( n > SamplesToGenerate_250 )
+			n = SamplesToGenerate_250;
+		memset ( &YM_Buffer_250[ pos ] , 0 , n * sizeof ( YM_Buffer_250[ 0 ] ) );
+		pos = ( pos + n ) & YM_BUFFER_250_SIZE_MASK;
+		SamplesToGenerate_250 -= n;
+	}
+
+	YM_Buffer_250_pos_write = pos;
 }
 
 
@@ -1247,7 +1484,10 @@ static void	YM2149_Run ( Uint64 CPU_Clock )
 
 	if ( YM2149_Nb_Updates_250 > 0 )
 	{
-		YM2149_DoSamples_250 ( YM2149_Nb_Updates_250 );
+		if ( bFastForwardTurbo && !bAudioOffline )
+			YM2149_SkipSamples_250 ( YM2149_Nb_Updates_250 );
+		else
+			YM2149_DoSamples_250 ( YM2149_Nb_Updates_250 );
 	}
 }
 
@@ -1383,6 +1623,209 @@ static ymsample	YM2149_Next_Resample_Weighted_Average_2 ( void )
 
 
 
+/*-----------------------------------------------------------------------*/
+/**
+ * Polyphase FIR resampling : a Kaiser windowed sinc low pass filter is
+ * precomputed for YM2149_POLYPHASE_PHASES fractional positions between
+ * 2 input samples, for the current YM clock and output freq.
+ * Pass band goes up to 0.4 * YM_REPLAY_FREQ and the stop band (80 dB
+ * attenuation) starts at 0.6 * YM_REPLAY_FREQ, so aliases only fall
+ * above 0.4 * YM_REPLAY_FREQ. The number of taps depends on the ratio
+ * between both freqs (eg 144 taps for 250 kHz -> 44.1 kHz).
+ * Coefficients are signed 16 bits values scaled by 0x8000, each phase
+ * summing exactly to 0x8000 to keep a unity gain at 0 Hz.
+ */
+
+#define	YM2149_POLYPHASE_PHASES		256		/* Fractional positions between 2 input samples */
+#define	YM2149_POLYPHASE_TAPS_MAX	1024		/* Enough for 250 kHz -> 6 kHz */
+#define	YM2149_POLYPHASE_ATTENUATION	80.0		/* Stop band attenuation in dB */
+
+static Sint16	*YM2149_Polyphase_Coefs = NULL;		/* PHASES x Taps coefficients */
+static int	YM2149_Polyphase_Taps;
+static int	YM2149_Polyphase_FreqIn;		/* YM clock counter freq used for the coefficients */
+static int	YM2149_Polyphase_FreqOut;		/* Output freq used for the coefficients */
+static Sint32	(*YM2149_Polyphase_Dot) ( const ymsample *x , const Sint16 *h , int taps ) = YM2149_Polyphase_DotGeneric;
+
+
+/* Modified Bessel function of order 0, for the Kaiser window */
+static double	YM2149_BesselI0 ( double x )
+{
+	double	sum = 1.0 , term = 1.0;
+	int	k;
+
+	for ( k = 1 ; k < 50 && term > sum * 1e-12 ; k++ )
+	{
+		term *= ( x / ( 2 * k ) ) * ( x / ( 2 * k ) );
+		sum += term;
+	}
+	return sum;
+}
+
+
+/*
+ * Compute the filter bank for resampling from FreqIn to FreqOut.
+ * For a given phase (fractional position 'f' of the output sample after input
+ * sample n), coefficient 'i' applies to input sample n-(taps-1)+i. The filter
+ * is causal : it's centered taps/2 input samples before the output position,
+ * which delays the output by about 0.3 ms at 44.1 kHz.
+ */
+static void	YM2149_BuildPolyphaseFilter ( int FreqIn , int FreqOut )
+{
+	double	beta , cutoff , transition , center , d , x , w , sum;
+	double	coefs[ YM2149_POLYPHASE_TAPS_MAX ];
+	int	taps , phase , i , isum , imax;
+	Sint16	*h;
+
+	/* Taps for the wanted attenuation with a Kaiser window, rounded to a multiple of 8 */
+	transition = 0.2 * FreqOut / FreqIn;
+	taps = ceil ( ( YM2149_POLYPHASE_ATTENUATION - 8.0 ) / ( 2.285 * 2 * M_PI * transition ) );
+	taps = ( taps + 7 ) & ~7;
+	if ( taps > YM2149_POLYPHASE_TAPS_MAX )
+		taps = YM2149_POLYPHASE_TAPS_MAX;
+
+	h = realloc ( YM2149_Polyphase_Coefs , YM2149_POLYPHASE_PHASES * taps * sizeof ( Sint16 ) );
+	if ( !h )
+	{
+		Log_Printf ( LOG_ERROR , "Can't allocate YM2149 resampling filter, using weighted average\n" );
+		YM2149_Resample_Method = YM2149_RESAMPLE_METHOD_WEIGHTED_AVERAGE_N;
+		return;
+	}
+	YM2149_Polyphase_Coefs = h;
+	YM2149_Polyphase_Taps = taps;
+	YM2149_Polyphase_FreqIn = FreqIn;
+	YM2149_Polyphase_FreqOut = FreqOut;
+
+	beta = 0.1102 * ( YM2149_POLYPHASE_ATTENUATION - 8.7 );
+	cutoff = 0.5 * FreqOut / FreqIn;			/* middle of the transition band */
+	center = taps / 2.0;
+
+	for ( phase = 0 ; phase < YM2149_POLYPHASE_PHASES ; phase++ )
+	{
+		sum = 0;
+		for ( i = 0 ; i < taps ; i++ )
+		{
+			/* Distance between output position and input sample, relative to the center */
+			d = (double)phase / YM2149_POLYPHASE_PHASES + taps - 1 - i - center;
+			x = d / center;
+			w = ( x >= -1.0 && x <= 1.0 ) ? YM2149_BesselI0 ( beta * sqrt ( 1.0 - x * x ) ) / YM2149_BesselI0 ( beta ) : 0;
+			coefs[ i ] = w * ( d == 0 ? 2 * cutoff : sin ( 2 * M_PI * cutoff * d ) / ( M_PI * d ) );
+			sum += coefs[ i ];
+		}
+
+		/* Normalize to 0x8000 and put rounding errors in the largest coefficient */
+		isum = imax = 0;
+		for ( i = 0 ; i < taps ; i++ )
+		{
+			h[ i ] = round ( coefs[ i ] * 0x8000 / sum );
+			isum += h[ i ];
+			if ( h[ i ] > h[ imax ] )
+				imax = i;
+		}
+		h[ imax ] += 0x8000 - isum;
+		h += taps;
+	}
+
+#if YM2149_HAVE_SSE2
+	__builtin_cpu_init();
+	if ( __builtin_cpu_supports ( "sse2" ) )
+		YM2149_Polyphase_Dot = YM2149_Polyphase_DotSSE2;
+#endif
+}
+
+
+/* Return the dot product of 'taps' input samples and coefficients (taps is a multiple of 8) */
+static Sint32	YM2149_Polyphase_DotGeneric ( const ymsample *x , const Sint16 *h , int taps )
+{
+	Sint32	total = 0;
+	int	i;
+
+	for ( i = 0 ; i < taps ; i++ )
+		total += x[ i ] * h[ i ];
+	return total;
+}
+
+
+#if YM2149_HAVE_SSE2
+/* SSE2 version of the above, 8 samples at a time */
+__attribute__((target("sse2")))
+static Sint32	YM2149_Polyphase_DotSSE2 ( const ymsample *x , const Sint16 *h , int taps )
+{
+	__m128i	total = _mm_setzero_si128();
+	int	i;
+
+	for ( i = 0 ; i < taps ; i += 8 )
+		total = _mm_add_epi32 ( total , _mm_madd_epi16 ( _mm_loadu_si128 ( (const __m128i *)( x + i ) ) ,
+		                                                 _mm_loadu_si128 ( (const __m128i *)( h + i ) ) ) );
+	total = _mm_add_epi32 ( total , _mm_shuffle_epi32 ( total , _MM_SHUFFLE ( 1 , 0 , 3 , 2 ) ) );
+	total = _mm_add_epi32 ( total , _mm_shuffle_epi32 ( total , _MM_SHUFFLE ( 2 , 3 , 0 , 1 ) ) );
+	return _mm_cvtsi128_si32 ( total );
+}
+#endif
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Downsample the YM2149 samples data from 250 KHz to YM_REPLAY_FREQ and
+ * return the next sample to output.
+ *
+ * This method applies the polyphase FIR filter above, using the phase
+ * nearest to the position of the output sample.
+ *
+ * It's slower than 'Weighted_Average_N', but its alias rejection is much
+ * better : high notes and buzzer/sync-buzzer effects don't add spurious
+ * lower frequencies. Integer position stepping is exact, without drift.
+ */
+static ymsample	YM2149_Next_Resample_Polyphase ( void )
+{
+	static Uint32	pos_num = 0;			/* fractional position = pos_num / YM_REPLAY_FREQ */
+	ymsample	window[ YM2149_POLYPHASE_TAPS_MAX ];
+	const ymsample	*x;
+	int		start , n , phase;
+	Sint32		total;
+
+	if ( YM2149_Polyphase_FreqIn != (int)YM_ATARI_CLOCK_COUNTER || YM2149_Polyphase_FreqOut != YM_REPLAY_FREQ )
+	{
+		YM2149_BuildPolyphaseFilter ( YM_ATARI_CLOCK_COUNTER , YM_REPLAY_FREQ );
+		if ( YM2149_Resample_Method != YM2149_RESAMPLE_METHOD_POLYPHASE )
+			return YM2149_Next_Resample_Weighted_Average_N ();
+		pos_num = 0;
+	}
+
+	/* Input samples ending at pos_read, copied if they wrap around the ring buffer */
+	start = ( YM_Buffer_250_pos_read - YM2149_Polyphase_Taps + 1 ) & YM_BUFFER_250_SIZE_MASK;
+	if ( start + YM2149_Polyphase_Taps <= YM_BUFFER_250_SIZE )
+		x = &YM_Buffer_250[ start ];
+	else
+	{
+		n = YM_BUFFER_250_SIZE - start;
+		memcpy ( window , &YM_Buffer_250[ start ] , n * sizeof ( ymsample ) );
+		memcpy ( window + n , YM_Buffer_250 , ( YM2149_Polyphase_Taps - n ) * sizeof ( ymsample ) );
+		x = window;
+	}
+
+	phase = ( (Uint64)pos_num * YM2149_POLYPHASE_PHASES ) / YM_REPLAY_FREQ;
+	total = YM2149_Polyphase_Dot ( x , YM2149_Polyphase_Coefs + phase * YM2149_Polyphase_Taps , YM2149_Polyphase_Taps );
+	total = ( total + 0x4000 ) >> 15;
+	if ( total > 32767 )				/* ringing of full volume square waves */
+		total = 32767;
+	else if ( total < -32768 )
+		total = -32768;
+
+	/* Increase fractional pos and integer pos */
+	pos_num += YM_ATARI_CLOCK_COUNTER % YM_REPLAY_FREQ;
+	n = YM_ATARI_CLOCK_COUNTER / YM_REPLAY_FREQ;
+	if ( pos_num >= (Uint32)YM_REPLAY_FREQ )
+	{
+		pos_num -= YM_REPLAY_FREQ;
+		n++;
+	}
+	YM_Buffer_250_pos_read = ( YM_Buffer_250_pos_read + n ) & YM_BUFFER_250_SIZE_MASK;
+
+	return total;
+}
+
+
+
 static ymsample	YM2149_NextSample_250 ( void )
 {
 	if ( YM2149_Resample_Method == YM2149_RESAMPLE_METHOD_WEIGHTED_AVERAGE_2 )
@@ -1394,6 +1837,9 @@ static ymsample	YM2149_NextSample_250 ( void )
 	else if ( YM2149_Resample_Method == YM2149_RESAMPLE_METHOD_WEIGHTED_AVERAGE_N )
 		return YM2149_Next_Resample_Weighted_Average_N ();
 
+	else if ( YM2149_Resample_Method == YM2149_RESAMPLE_METHOD_POLYPHASE )
+		return YM2149_Next_Resample_Polyphase ();
+
 	else
 		return 0;
 }
@@ -1547,13 +1993,13 @@ void Sound_Reset(void)
 	Cycles_SetCounter(CYCLES_COUNTER_SOUND, 0);
 	bEnvelopeFreqFlag = false;
 
-	AudioMixBuffer_pos_read = 0;
 	/* We do not start with 0 here to fake some initial samples: */
-	nGeneratedSamples = SoundBufferSize + SAMPLES_PER_FRAME;
-	AudioMixBuffer_pos_write = nGeneratedSamples & AUDIOMIXBUFFER_SIZE_MASK;
+	SDL_AtomicSet(&AudioMixBuffer_nRead, 0);
+	SDL_AtomicSet(&AudioMixBuffer_nWritten, SoundBufferSize + SAMPLES_PER_FRAME);
+	AudioMixBuffer_pos_write = ( SoundBufferSize + SAMPLES_PER_FRAME ) & AUDIOMIXBUFFER_SIZE_MASK;
 	AudioMixBuffer_pos_write_avi = AudioMixBuffer_pos_write;
-//fprintf ( stderr , "Sound_Reset SoundBufferSize %d SAMPLES_PER_FRAME %d nGeneratedSamples %d , AudioMixBuffer_pos_write %d\n" ,
-//	SoundBufferSize , SAMPLES_PER_FRAME, nGeneratedSamples , AudioMixBuffer_pos_write );
+//fprintf ( stderr , "Sound_Reset SoundBufferSize %d SAMPLES_PER_FRAME %d , AudioMixBuffer_pos_write %d\n" ,
+//	SoundBufferSize , SAMPLES_PER_FRAME, AudioMixBuffer_pos_write );
 
 	Ym2149_Reset();
 
@@ -1561,24 +2007,6 @@ void Sound_Reset(void)
 }
 
 
-/*-----------------------------------------------------------------------*/
-/**
- * Reset the sound buffer index variables.
- * Very important : this function should only be called by setting
- * Sound_BufferIndexNeedReset=true
- */
-void Sound_ResetBufferIndex(void)
-{
-	Audio_Lock();
-	nGeneratedSamples = SoundBufferSize + SAMPLES_PER_FRAME;
-	AudioMixBuffer_pos_write =  (AudioMixBuffer_pos_read + nGeneratedSamples) & AUDIOMIXBUFFER_SIZE_MASK;
-	AudioMixBuffer_pos_write_avi = AudioMixBuffer_pos_write;
-//fprintf ( stderr , "Sound_ResetBufferIndex SoundBufferSize %d SAMPLES_PER_FRAME %d nGeneratedSamples %d , AudioMixBuffer_pos_write %d\n" ,
-//	SoundBufferSize , SAMPLES_PER_FRAME, nGeneratedSamples , AudioMixBuffer_pos_write );
-	Audio_Unlock();
-}
-
-
 /*-----------------------------------------------------------------------*/
 /**
  * Save/Restore snapshot of local variables('MemorySnapShot_Store' handles type)
@@ -1633,13 +2061,172 @@ void Sound_MemorySnapShot_Capture(bool bSave)
 
 /*-----------------------------------------------------------------------*/
 /**
- * Store how many samples were generated during one VBL
+ * Store how many samples were generated during one VBL, and how many
+ * of them are still waiting to be played by the audio callback
  */
-static void Sound_Stats_Add ( int Samples_Nbr )
+static void Sound_Stats_Add ( int Samples_Nbr , int Fill )
 {
+	Sound_Stats_FillArray[ Sound_Stats_Index ] = Fill;
 	Sound_Stats_Array[ Sound_Stats_Index++ ] = Samples_Nbr;
 	if ( Sound_Stats_Index == SOUND_STATS_SIZE )
 		Sound_Stats_Index = 0;
+
+	Sound_Perf.nVBLs++;
+	if ( Fill < Sound_Stats_FillMin )
+		Sound_Stats_FillMin = Fill;
+	if ( Fill > Sound_Stats_FillMax )
+		Sound_Stats_FillMax = Fill;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Convert performance counter ticks to microseconds
+ */
+static double Sound_Stats_TicksToUs ( Uint64 Ticks )
+{
+	return Ticks * 1000000.0 / SDL_GetPerformanceFrequency();
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Open the CSV file where audio pipeline statistics are logged
+ * once per emulated second. Return false if it can't be opened.
+ */
+bool Sound_Stats_SetLogFile ( const char *pszFileName )
+{
+	Sound_Stats_File = File_Close ( Sound_Stats_File );
+	Sound_Stats_File = File_Open ( pszFileName , "w" );
+	if ( !Sound_Stats_File )
+		return false;
+
+	fprintf ( Sound_Stats_File , "vbl,generated,consumed,fill,fill_min,fill_max,"
+		  "underruns,refills,skips,skipped,overflows,"
+		  "generate_us,ym_us,dmasnd_us,crossbar_us\n" );
+	fflush ( Sound_Stats_File );
+
+	Sound_Perf_Logged = Sound_Perf;
+	Audio_GetStats ( &Audio_Stats_Logged );
+	Sound_Stats_FillMin = INT_MAX;
+	Sound_Stats_FillMax = 0;
+	return true;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Write one line of the statistics log, with the counter changes
+ * since the previous line
+ */
+static void Sound_Stats_Log ( int Fill )
+{
+	AUDIO_STATS audio;
+	Uint64 generate, dmasnd, crossbar;
+
+	Audio_GetStats ( &audio );
+	generate = Sound_Perf.TimeGenerate - Sound_Perf_Logged.TimeGenerate;
+	dmasnd = Sound_Perf.TimeDmaSnd - Sound_Perf_Logged.TimeDmaSnd;
+	crossbar = Sound_Perf.TimeCrossbar - Sound_Perf_Logged.TimeCrossbar;
+
+	fprintf ( Sound_Stats_File , "%"PRIu64",%"PRIu64",%u,%d,%d,%d,%u,%u,%u,%u,%u,%.0f,%.0f,%.0f,%.0f\n" ,
+		  Sound_Perf.nVBLs ,
+		  Sound_Perf.nGenerated - Sound_Perf_Logged.nGenerated ,
+		  audio.nConsumed - Audio_Stats_Logged.nConsumed ,
+		  Fill , Sound_Stats_FillMin , Sound_Stats_FillMax ,
+		  audio.nUnderruns - Audio_Stats_Logged.nUnderruns ,
+		  audio.nRefills - Audio_Stats_Logged.nRefills ,
+		  audio.nSkips - Audio_Stats_Logged.nSkips ,
+		  audio.nSkipped - Audio_Stats_Logged.nSkipped ,
+		  Sound_Perf.nOverflows - Sound_Perf_Logged.nOverflows ,
+		  Sound_Stats_TicksToUs ( generate ) ,
+		  Sound_Stats_TicksToUs ( generate - dmasnd - crossbar ) ,
+		  Sound_Stats_TicksToUs ( dmasnd ) ,
+		  Sound_Stats_TicksToUs ( crossbar ) );
+	fflush ( Sound_Stats_File );
+
+	Sound_Perf_Logged = Sound_Perf;
+	Audio_Stats_Logged = audio;
+	Sound_Stats_FillMin = INT_MAX;
+	Sound_Stats_FillMax = 0;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Copy the sound generation statistics
+ */
+void Sound_GetStats ( SOUND_STATS *pStats )
+{
+	*pStats = Sound_Perf;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Show audio pipeline statistics (for the debugger "info sound" command):
+ * samples generated by emulation and their timing, and how the audio
+ * callback consumed them
+ */
+void Sound_Info ( FILE *fp , Uint32 dummy )
+{
+	static const char *FillRanges[ AUDIO_FILL_HISTO_SIZE ] = {
+		"  0- 24%", " 25- 49%", " 50- 74%", " 75- 99%", "100-124%",
+		"125-149%", "150-174%", "175-199%", " >= 200%"
+	};
+	AUDIO_STATS audio;
+	Uint64 generate;
+	int i, n, last, min, max, fill_min, fill_max;
+	double sum;
+
+	n = Sound_Perf.nVBLs < SOUND_STATS_SIZE ? Sound_Perf.nVBLs : SOUND_STATS_SIZE;
+	if ( n == 0 )
+	{
+		fprintf ( fp , "No VBL with sound emulated yet.\n" );
+		return;
+	}
+
+	last = ( Sound_Stats_Index + SOUND_STATS_SIZE - 1 ) % SOUND_STATS_SIZE;
+	min = fill_min = INT_MAX;
+	max = fill_max = 0;
+	sum = 0;
+	for ( i = 0 ; i < n ; i++ )
+	{
+		sum += Sound_Stats_Array[ i ];
+		if ( Sound_Stats_Array[ i ] < min )
+			min = Sound_Stats_Array[ i ];
+		if ( Sound_Stats_Array[ i ] > max )
+			max = Sound_Stats_Array[ i ];
+		if ( Sound_Stats_FillArray[ i ] < fill_min )
+			fill_min = Sound_Stats_FillArray[ i ];
+		if ( Sound_Stats_FillArray[ i ] > fill_max )
+			fill_max = Sound_Stats_FillArray[ i ];
+	}
+	generate = Sound_Perf.TimeGenerate - Sound_Perf.TimeDmaSnd - Sound_Perf.TimeCrossbar;
+	fprintf ( fp , "Emulation, %"PRIu64" VBLs:\n" , Sound_Perf.nVBLs );
+	fprintf ( fp , "- samples generated    : %"PRIu64" (%d Hz)\n" , Sound_Perf.nGenerated , nAudioFrequency );
+	fprintf ( fp , "- samples per VBL      : last %d, min/avg/max %d/%.1f/%d over %d VBLs\n" ,
+		  Sound_Stats_Array[ last ] , min , sum / n , max , n );
+	fprintf ( fp , "- buffered at VBL      : last %d, min/max %d/%d over %d VBLs\n" ,
+		  Sound_Stats_FillArray[ last ] , fill_min , fill_max , n );
+	fprintf ( fp , "- buffer overflows     : %u\n" , Sound_Perf.nOverflows );
+	fprintf ( fp , "- generation time      : %.1f ms, %.1f us/VBL\n" ,
+		  Sound_Stats_TicksToUs ( Sound_Perf.TimeGenerate ) / 1000 ,
+		  Sound_Stats_TicksToUs ( Sound_Perf.TimeGenerate ) / Sound_Perf.nVBLs );
+	fprintf ( fp , "  - YM2149             : %.1f ms\n" , Sound_Stats_TicksToUs ( generate ) / 1000 );
+	fprintf ( fp , "  - DMA sound          : %.1f ms\n" , Sound_Stats_TicksToUs ( Sound_Perf.TimeDmaSnd ) / 1000 );
+	fprintf ( fp , "  - Falcon crossbar    : %.1f ms\n" , Sound_Stats_TicksToUs ( Sound_Perf.TimeCrossbar ) / 1000 );
+
+	Audio_GetStats ( &audio );
+	fprintf ( fp , "\nAudio callback, %u calls:\n" , audio.nCallbacks );
+	fprintf ( fp , "- samples consumed     : %u\n" , audio.nConsumed );
+	fprintf ( fp , "- underruns            : %u (%u callbacks waiting for refill)\n" ,
+		  audio.nUnderruns , audio.nRefills );
+	fprintf ( fp , "- resync skips         : %u (%u samples dropped)\n" ,
+		  audio.nSkips , audio.nSkipped );
+	fprintf ( fp , "- buffered on call, %% of target latency:\n" );
+	for ( i = 0 ; i < AUDIO_FILL_HISTO_SIZE ; i++ )
+		fprintf ( fp , "  %s : %u\n" , FillRanges[ i ] , audio.FillHisto[ i ] );
 }
 
 
@@ -1695,7 +2282,9 @@ static int Sound_GenerateSamples(Uint64 CPU_Clock)
 	int	idx;
 	int	ym_margin;
 	int	Sample_Nbr;
+	Uint64	Time_Start, Time_Sub;
 
+	Time_Start = SDL_GetPerformanceCounter();
 //fprintf ( stderr , "sound_gen in ym_pos_rd=%d ym_pos_wr=%d clock=%ld\n" , YM_Buffer_250_pos_read , YM_Buffer_250_pos_write , CPU_Clock );
 
 	/* Run YM2149 emulation at 250 kHz to reach CPU_Clock counter value */
@@ -1718,7 +2307,11 @@ static int Sound_GenerateSamples(Uint64 CPU_Clock)
 		}
 		/* If Falcon emulation, crossbar does the job */
 		if ( Sample_Nbr > 0 )
+		{
+			Time_Sub = SDL_GetPerformanceCounter();
 			Crossbar_GenerateSamples(AudioMixBuffer_pos_write, Sample_Nbr);
+			Sound_Perf.TimeCrossbar += SDL_GetPerformanceCounter() - Time_Sub;
+		}
 	}
 
 	else if (!Config_IsMachineST())
@@ -1731,7 +2324,11 @@ static int Sound_GenerateSamples(Uint64 CPU_Clock)
 		}
 		/* If Ste or TT emulation, DmaSnd does mixing and filtering */
 		if ( Sample_Nbr > 0 )
+		{
+			Time_Sub = SDL_GetPerformanceCounter();
 			DmaSnd_GenerateSamples(AudioMixBuffer_pos_write, Sample_Nbr);
+			Sound_Perf.TimeDmaSnd += SDL_GetPerformanceCounter() - Time_Sub;
+		}
 	}
 
 	else
@@ -1745,7 +2342,11 @@ static int Sound_GenerateSamples(Uint64 CPU_Clock)
 	}
 
 	AudioMixBuffer_pos_write = (AudioMixBuffer_pos_write + Sample_Nbr) & AUDIOMIXBUFFER_SIZE_MASK;
-	nGeneratedSamples += Sample_Nbr;
+	/* Publish the new samples to the audio callback only after they're complete */
+	SDL_AtomicAdd(&AudioMixBuffer_nWritten, Sample_Nbr);
+
+	Sound_Perf.nGenerated += Sample_Nbr;
+	Sound_Perf.TimeGenerate += SDL_GetPerformanceCounter() - Time_Start;
 //fprintf ( stderr , "sound_gen out nb=%d ym_pos_rd=%d ym_pos_wr=%d clock=%ld\n" , Sample_Nbr , YM_Buffer_250_pos_read , YM_Buffer_250_pos_write , CPU_Clock );
 	return Sample_Nbr;
 }
@@ -1760,40 +2361,40 @@ void Sound_Update( Uint64 CPU_Clock)
 {
 	int pos_write_prev = AudioMixBuffer_pos_write;
 	int Samples_Nbr;
-	int nGeneratedSamples_before;
+	int nAvailable;
 
-	/* Make sure that we don't interfere with the audio callback function */
-	Audio_Lock();
-
-	/* Generate samples */
-	nGeneratedSamples_before = nGeneratedSamples;
+	/* Generate samples. No need to lock the audio callback function, it only reads	*/
+	/* samples before AudioMixBuffer_nWritten, which is updated after they're ready	*/
 	Samples_Nbr = Sound_GenerateSamples ( CPU_Clock );
 	Sound_Stats_SamplePerVBL += Samples_Nbr;
 //fprintf ( stderr , "sound update vbl=%d hbl=%d nbr=%d\n" , nVBLs , nHBL, Samples_Nbr );
 
+	/* When rendering offline, there's no Audio_Callback() : samples are only used for	*/
+	/* recording below and AudioMixBuffer[] doesn't need to keep them for later		*/
+	if ( bAudioOffline )
+	{
+		SDL_AtomicSet ( &AudioMixBuffer_nRead , SDL_AtomicGet ( &AudioMixBuffer_nWritten ) );
+	}
+
 	/* Check we don't fill the sound's ring buffer before it's played by Audio_Callback()	*/
 	/* This should never happen, except if the system suffers major slowdown due to	other	*/
 	/* processes or if we run in fast forward mode.						*/
-	/* In the case of slowdown, we set Sound_BufferIndexNeedReset to "resync" the working	*/
-	/* buffer's index AudioMixBuffer_pos_write with the system buffer's index		*/
-	/* AudioMixBuffer_pos_read.								*/
-	/* In the case of fast forward, we do nothing here, Sound_BufferIndexNeedReset will be	*/
-	/* set when the user exits fast forward mode.						*/
-	if ( ( Samples_Nbr > AUDIOMIXBUFFER_SIZE - nGeneratedSamples_before ) && ( ConfigureParams.System.bFastForward == false )
+	/* Audio_Callback() then skips to the most recent samples by itself, and after	*/
+	/* running out of samples waits until there's enough of them again, so there's	*/
+	/* no need to "resync" the buffer indexes here.					*/
+	nAvailable = (Uint32)SDL_AtomicGet ( &AudioMixBuffer_nWritten ) - (Uint32)SDL_AtomicGet ( &AudioMixBuffer_nRead );
+	if ( ( nAvailable > AUDIOMIXBUFFER_SIZE ) && ( ConfigureParams.System.bFastForward == false )
 	    && ( ConfigureParams.Sound.bEnableSound == true ) )
 	{
 		static int logcnt = 0;
+		Sound_Perf.nOverflows++;
 		if (logcnt++ < 50)
 		{
 			Log_Printf(LOG_WARN, "Your system is too slow, "
 			           "some sound samples were not correctly emulated\n");
 		}
-		Sound_BufferIndexNeedReset = true;
 	}
 
-	/* Allow audio callback function to occur again */
-	Audio_Unlock();
-
 	/* Save to WAV file, if open */
 	if (bRecordingWav)
 		WAVFormat_Update(AudioMixBuffer, pos_write_prev, Samples_Nbr);
@@ -1809,20 +2410,18 @@ void Sound_Update( Uint64 CPU_Clock)
  */
 void Sound_Update_VBL(void)
 {
+	int Fill;
+
 	Sound_Update ( CyclesGlobalClockCounter );			/* generate as many samples as needed to fill this VBL */
 //fprintf ( stderr , "sound_update_vbl vbl=%d nbr=%d\n" , nVBLs, Sound_Stats_SamplePerVBL );
 
 	/* Update some stats */
-	Sound_Stats_Add ( Sound_Stats_SamplePerVBL );
+	Fill = (Uint32)SDL_AtomicGet ( &AudioMixBuffer_nWritten ) - (Uint32)SDL_AtomicGet ( &AudioMixBuffer_nRead );
+	Sound_Stats_Add ( Sound_Stats_SamplePerVBL , Fill );
+	if ( Sound_Stats_File && Sound_Perf.nVBLs % nScreenRefreshRate == 0 )
+		Sound_Stats_Log ( Fill );
 //	Sound_Stats_Show ();
 
-	/* Reset sound buffer if needed (after pause, fast forward, slow system, ...) */
-	if ( Sound_BufferIndexNeedReset )
-	{
-		Sound_ResetBufferIndex ();
-		Sound_BufferIndexNeedReset = false;
-	}
-	
 	/* Record AVI audio frame is necessary */
 	if ( bRecordingAvi )
 	{
@@ -1846,7 +2445,7 @@ void Sound_Update_VBL(void)
 
 /*-----------------------------------------------------------------------*/
 /**
- * Start recording sound, as .YM or .WAV output
+ * Start recording sound, as .YM, .YMD (YM register dump) or .WAV output
  */
 bool Sound_BeginRecording(char *pszCaptureFileName)
 {
@@ -1858,15 +2457,17 @@ bool Sound_BeginRecording(char *pszCaptureFileName)
 		return false;
 	}
 
-	/* Did specify .YM or .WAV? If neither report error */
+	/* Did specify .YM, .YMD or .WAV? If neither report error */
 	if (File_DoesFileExtensionMatch(pszCaptureFileName,".ym"))
 		bRet = YMFormat_BeginRecording(pszCaptureFileName);
+	else if (File_DoesFileExtensionMatch(pszCaptureFileName,".ymd"))
+		bRet = YMFormat_BeginDump(pszCaptureFileName);
 	else if (File_DoesFileExtensionMatch(pszCaptureFileName,".wav"))
 		bRet = WAVFormat_OpenFile(pszCaptureFileName);
 	else
 	{
 		Log_AlertDlg(LOG_ERROR, "Unknown Sound Recording format.\n"
-		             "Please specify a .YM or .WAV output file.");
+		             "Please specify a .YM, .YMD or .WAV output file.");
 		bRet = false;
 	}
 
@@ -1883,6 +2484,8 @@ void Sound_EndRecording(void)
 	/* Stop sound recording and close files */
 	if (bRecordingYM)
 		YMFormat_EndRecording();
+	if (bRecordingYMDump)
+		YMFormat_EndDump();
 	if (bRecordingWav)
 		WAVFormat_CloseFile();
 }
@@ -1894,7 +2497,7 @@ void Sound_EndRecording(void)
  */
 bool Sound_AreWeRecording(void)
 {
-	return (bRecordingYM || bRecordingWav);
+	return (bRecordingYM || bRecordingYMDump || bRecordingWav);
 }
 
 
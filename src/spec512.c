@@ -68,8 +68,6 @@
 
 const char Spec512_fileid[] = "Hatari spec512.c";
 
-#include <SDL_endian.h>
-
 #include "main.h"
 #include "configuration.h"
 #include "cycles.h"
@@ -103,13 +101,6 @@ static int CycleColourIndex;
 static int nScanLine, ScanLineCycleCount;
 static bool bIsSpec512Display;
 
-#if SDL_BYTEORDER == SDL_BIG_ENDIAN
-static const int STRGBPalEndianTable[16] =
-{
-	0,2,1,3,8,10,9,11,4,6,5,7,12,14,13,15
-};
-#endif
-
 
 /*-----------------------------------------------------------------------*/
 /**
@@ -248,11 +239,7 @@ void Spec512_StartFrame(void)
        /* Copy first line palette, kept in 'HBLPalettes' and store to 'STRGBPalette' */
        for (i = 0; i < 16; i++)
        {
-#if SDL_BYTEORDER == SDL_BIG_ENDIAN
-               STRGBPalette[STRGBPalEndianTable[i]] = ST2RGB[pHBLPalettes[i]];
-#else
                STRGBPalette[i] = ST2RGB[pHBLPalettes[i]];
-#endif
        }
 
 	/* Ready for first call to 'Spec512_ScanLine' */
@@ -305,12 +292,13 @@ void Spec512_StartScanLine(void)
 
 	/* Update palette entries until we reach start of displayed screen */
 	ScanLineCycleCount = 0;
-	for (i=0; i<((LineStartCycle-SCREENBYTES_LEFT*2)/4 + 7); i++)	/* [NP] '7' is required to align pixels and colors */
-		Spec512_UpdatePaletteSpan();              /* Update palette for this 4-cycle period */
+	i = (LineStartCycle-SCREENBYTES_LEFT*2)/4 + 7;	/* [NP] '7' is required to align pixels and colors */
 
 	/* And skip for left border is not using overscan display to user */
-	for (i=0; i<(STScreenLeftSkipBytes/2); i++)   /* Eg, 16 bytes = 32 pixels or 8 palette periods */
-		Spec512_UpdatePaletteSpan();
+	i += STScreenLeftSkipBytes/2;                /* Eg, 16 bytes = 32 pixels or 8 palette periods */
+
+	while (i > 0)
+		i -= Spec512_UpdatePaletteSpans(i);
 }
 
 
@@ -325,7 +313,7 @@ void Spec512_EndScanLine(void)
 	CycleEnd >>= nCpuFreqShift;			/* Convert cycle position to 8 MHz equivalent */
 	/* Continue to reads palette until complete so have correct version for next line */
 	while (ScanLineCycleCount < CycleEnd)
-		Spec512_UpdatePaletteSpan();
+		Spec512_UpdatePaletteSpans((CycleEnd - ScanLineCycleCount + 3) / 4);
 }
 
 
@@ -338,13 +326,65 @@ void Spec512_UpdatePaletteSpan(void)
 	if (pCyclePalette->LineCycles == ScanLineCycleCount)
 	{
 		/* Need to update palette with new entry */
-#if SDL_BYTEORDER == SDL_BIG_ENDIAN
-		STRGBPalette[STRGBPalEndianTable[pCyclePalette->Index]] = ST2RGB[pCyclePalette->Colour];
-#else
 		STRGBPalette[pCyclePalette->Index] = ST2RGB[pCyclePalette->Colour];
 //fprintf ( stderr , "upd spec cyc %d %x %x\n" , ScanLineCycleCount , pCyclePalette->Index , pCyclePalette->Colour );
-#endif
 		pCyclePalette += 1;
 	}
 	ScanLineCycleCount += 4;      /* Next 4 cycles */
 }
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Update palette for the next 4-pixels span like Spec512_UpdatePaletteSpan(),
+ * and then skip the following spans which don't change the palette, up to
+ * 'MaxSpans' spans in total. Return the number of spans done, all of them
+ * use the same 'STRGBPalette'.
+ */
+int Spec512_UpdatePaletteSpans(int MaxSpans)
+{
+	int Spans, NextCycles;
+
+	Spec512_UpdatePaletteSpan();
+
+	/* Next entry is used only when the cycle count matches it exactly,
+	 * so an entry that is already behind or between the 4 cycle steps
+	 * stops the palette changes for rest of the line (terminator too)
+	 */
+	NextCycles = pCyclePalette->LineCycles - ScanLineCycleCount;
+	if (NextCycles < 0 || (NextCycles & 3))
+		Spans = MaxSpans;
+	else
+		Spans = NextCycles / 4 + 1;
+
+	if (Spans > MaxSpans)
+		Spans = MaxSpans;
+	ScanLineCycleCount += 4 * (Spans - 1);
+	return Spans;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Return hash of the palette at the current scan line position and of the
+ * palette writes remaining on the line. Screen conversion uses this to
+ * check whether the line looks the same as on the previous frame.
+ */
+Uint64 Spec512_GetScanLineHash(void)
+{
+	const CYCLEPALETTE *pPalette;
+	Uint64 Hash = ScanLineCycleCount;
+	int i;
+
+	for (i = 0; i < 16; i += 2)
+	{
+		Hash ^= (Uint64)STRGBPalette[i] << 32 | STRGBPalette[i+1];
+		Hash *= 0x9E3779B97F4A7C15ULL;
+	}
+	for (pPalette = pCyclePalette; pPalette->LineCycles >= 0; pPalette++)
+	{
+		Hash ^= (Uint64)pPalette->LineCycles << 32 | pPalette->Colour << 16 | pPalette->Index;
+		Hash *= 0x9E3779B97F4A7C15ULL;
+	}
+	return Hash ^ (Hash >> 29);
+}
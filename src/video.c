@@ -685,6 +685,28 @@ static VIDEO_TIMING	*pVideoTiming;
 static int		VideoTiming;
 
 
+/* Machine specific parts of the GLUE/Shifter emulation. The matching entry */
+/* is selected once in Video_SetTimings(), so the HBL and shifter registers */
+/* handlers don't need to check the machine type on each call */
+#define	VIDEO_MACHINE_ST		0
+#define	VIDEO_MACHINE_STE		1
+#define	VIDEO_MACHINE_TT		2
+#define	VIDEO_MACHINE_FALCON		3
+
+typedef struct
+{
+	void	(*RasterHBL)(void);		/* handle borders and copy line to the screen buffer at end of HBL */
+	Uint16	ColorRegMask;			/* 0x777 (STF 512 colors) or 0xfff (STE 4096 colors) */
+	Uint16	FirstLinePaletteMask;		/* 0x777 on STF, else colors are already masked when written */
+	bool	ColorRegRandomBits;		/* unused color bits are random when read on STF */
+	Uint8	SyncRegReadOr;			/* unused bits of $ff820a read as 1 on STF/STE */
+	Uint8	ResRegReadAnd;			/* valid bits of $ff8260 */
+	Uint8	ResRegReadOr;			/* unused bits of $ff8260 read as 1 on STF */
+} VIDEO_MACHINE;
+
+static const VIDEO_MACHINE	*pVideoMachine;
+
+
 /* Convert a horizontal video position measured at 8 MHz on STF/STE */
 /* to the equivalent number of cycles when CPU runs at 8/16/32 MHz */
 #define VIDEO_HPOS_TO_CYCLE( pos )	( pos << nCpuFreqShift )
@@ -736,6 +758,19 @@ static void	Video_ColorReg_ReadWord(void);
 static void	Video_TT_RasterHBL(void);
 
 
+static const VIDEO_MACHINE	VideoMachines[] =
+{
+	/* VIDEO_MACHINE_ST */
+	{ Video_EndHBL , 0x777 , 0x777 , true , 0xfc , 0xff , 0xfc },
+	/* VIDEO_MACHINE_STE */
+	{ Video_EndHBL , 0xfff , 0xffff , false , 0xfc , 0x03 , 0x00 },
+	/* VIDEO_MACHINE_TT */
+	{ Video_TT_RasterHBL , 0xfff , 0xffff , false , 0x00 , 0x07 , 0x00 },
+	/* VIDEO_MACHINE_FALCON */
+	{ VIDEL_VideoRasterHBL , 0xfff , 0xffff , false , 0x00 , 0x03 , 0x00 },
+};
+
+
 /*-----------------------------------------------------------------------*/
 /**
  * Save/Restore snapshot of local variables('MemorySnapShot_Store' handles type)
@@ -1111,6 +1146,15 @@ void	Video_SetTimings( MACHINETYPE MachineType , VIDEOTIMINGMODE Mode )
 
 	pVideoTiming = &VideoTimings[ VideoTiming ];
 
+	if ( ( MachineType == MACHINE_ST ) || ( MachineType == MACHINE_MEGA_ST ) )
+		pVideoMachine = &VideoMachines[ VIDEO_MACHINE_ST ];
+	else if ( ( MachineType == MACHINE_STE ) || ( MachineType == MACHINE_MEGA_STE ) )
+		pVideoMachine = &VideoMachines[ VIDEO_MACHINE_STE ];
+	else if ( MachineType == MACHINE_TT )
+		pVideoMachine = &VideoMachines[ VIDEO_MACHINE_TT ];
+	else
+		pVideoMachine = &VideoMachines[ VIDEO_MACHINE_FALCON ];
+
 	Log_Printf(LOG_DEBUG, "Video_SetSystemTimings %d %d -> %d (%s) %d %d %d\n", MachineType, Mode,
 	           VideoTiming, pVideoTiming->VideoTimingName, pVideoTiming->RemoveTopBorder_Pos,
 	           pVideoTiming->RemoveBottomBorder_Pos, pVideoTiming->VblVideoCycleOffset);
@@ -2771,10 +2815,11 @@ void Video_Sync_WriteByte ( void )
 
 	/* TEMP for 'Gen4 Demo' by Ziggy / OVR in WS2,WS3,WS4 : */
 	/* top border is removed 4 cycles too late (due to double STOP instruction ?) and trigger a wrong "left+2" */
-	if ( ( STMemory_ReadLong ( 0xc000 ) == 0x69676779 )			/* "iggy" */
+	/* (memory is checked last, as this is called for every freq change) */
+	if ( ( ShifterFrame.ShifterLines[ HblCounterVideo ].BorderMask & BORDERMASK_LEFT_PLUS_2 )
 		&& ( M68000_GetPC() == 0x635e )
+		&& ( STMemory_ReadLong ( 0xc000 ) == 0x69676779 )			/* "iggy" */
 		&& ( STMemory_ReadLong ( M68000_GetPC() ) == 0x11fc0002 )	/* move.b #2 */
-		&& ( ShifterFrame.ShifterLines[ HblCounterVideo ].BorderMask & BORDERMASK_LEFT_PLUS_2 )
 	   )
 	{
 		/* cancel a wrong left+2 */
@@ -3011,18 +3056,7 @@ if ( CycInt_From_Opcode )		/* TEMP : to update CYCLES_COUNTER_VIDEO during an op
 	/* Set pending bit for HBL interrupt in the CPU IPL */
 	M68000_Exception(EXCEPTION_NR_HBLANK , M68000_EXC_SRC_AUTOVEC);	/* Horizontal blank interrupt, level 2 */
 
-	if (Config_IsMachineFalcon())
-	{
-		VIDEL_VideoRasterHBL();
-	}
-	else if (Config_IsMachineTT())
-	{
-		Video_TT_RasterHBL();
-	}
-	else
-	{
-		Video_EndHBL();				/* Check some borders removal and copy line to display buffer */
-	}
+	pVideoMachine->RasterHBL();			/* Check some borders removal and copy line to display buffer */
 
 	DmaSnd_STE_HBL_Update();			/* Update STE DMA sound if needed */
 
@@ -3380,9 +3414,7 @@ static void Video_StoreFirstLinePalette(void)
 	pp2 = (Uint16 *)&IoMem[0xff8240];
 	for (i = 0; i < 16; i++)
 	{
-		HBLPalettes[i] = SDL_SwapBE16(*pp2++);
-		if (Config_IsMachineST())
-			HBLPalettes[i] &= 0x777;			/* Force unused "random" bits to 0 */
+		HBLPalettes[i] = SDL_SwapBE16(*pp2++) & pVideoMachine->FirstLinePaletteMask;	/* Force unused "random" bits to 0 on STF */
 	}
 
 	/* And set mask flag with palette and resolution */
@@ -4381,9 +4413,22 @@ bool Video_RenderTTScreen(void)
  */
 static void Video_DrawScreen(void)
 {
-	/* Skip frame if need to */
-	if (nVBLs % (nFrameSkips+1))
-		return;
+	/* When frames are logged, all of them need to be drawn */
+	if (!ScreenSnapShot_IsFrameLogging())
+	{
+		/* In preview mode, only every Nth frame is drawn */
+		if (Main_GetPreviewFrames())
+		{
+			if (nVBLs % Main_GetPreviewFrames())
+				return;
+		}
+		/* Skip frame if need to */
+		else if (nVBLs % (nFrameSkips+1))
+			return;
+		/* In fast forward turbo mode, only draw every Nth frame */
+		if (bFastForwardTurbo && nVBLs % ConfigureParams.System.nFastForwardTurbo)
+			return;
+	}
 
 	/* Now draw the screen! */
 	if (bUseVDIRes)
@@ -4417,6 +4462,8 @@ static void Video_DrawScreen(void)
 
 		Screen_Draw();
 	}
+
+	ScreenSnapShot_LogFrame(nVBLs);
 }
 
 
@@ -4847,8 +4894,7 @@ void Video_ScreenCounter_WriteByte(void)
  */
 void Video_Sync_ReadByte(void)
 {
-	if (Config_IsMachineST() || Config_IsMachineSTE())
-		IoMem[0xff820a] |= 0xfc;		/* set unused bits 2-7 to 1 */
+	IoMem[0xff820a] |= pVideoMachine->SyncRegReadOr;	/* On STF/STE, set unused bits 2-7 to 1 */
 }
 
 /*-----------------------------------------------------------------------*/
@@ -4893,12 +4939,9 @@ void Video_Res_ReadByte(void)
 	if (bUseHighRes)
 		IoMem[0xff8260] = 2;			/* If mono monitor, force to high resolution */
 
-	if (Config_IsMachineST())
-		IoMem[0xff8260] |= 0xfc;		/* On STF, set unused bits 2-7 to 1 */
-	else if (Config_IsMachineTT())
-		IoMem[0xff8260] &= 0x07;		/* Only use bits 0, 1 and 2 */
-	else
-		IoMem[0xff8260] &= 0x03;		/* Only use bits 0 and 1, unused bits 2-7 are set to 0 */
+	/* On STF, set unused bits 2-7 to 1. On TT, only use bits 0, 1 and 2. */
+	/* Else only use bits 0 and 1, unused bits 2-7 are set to 0 */
+	IoMem[0xff8260] = ( IoMem[0xff8260] & pVideoMachine->ResRegReadAnd ) | pVideoMachine->ResRegReadOr;
 }
 
 /*-----------------------------------------------------------------------*/
@@ -4981,10 +5024,7 @@ static void Video_ColorReg_WriteWord(void)
 	else
 		col = IoMem_ReadWord(addr);
 
-	if (Config_IsMachineST())
-		col &= 0x777;			/* Mask off to ST 512 palette */
-	else
-		col &= 0xfff;			/* Mask off to STe 4096 palette */
+	col &= pVideoMachine->ColorRegMask;	/* Mask off to ST 512 palette or STe 4096 palette */
 
 	addr &= 0xfffffffe;			/* Ensure addr is even to store the 16 bit color */
 	IoMem_WriteWord(addr, col);		/* (some games write 0xFFFF and read back to see if STe) */
@@ -5059,7 +5099,7 @@ static void Video_ColorReg_ReadWord(void)
 
 	col = IoMem_ReadWord(addr);
 
-	if (Config_IsMachineST() && M68000_GetPC() < 0x400000)		/* PC in RAM < 4MB */
+	if (pVideoMachine->ColorRegRandomBits && M68000_GetPC() < 0x400000)	/* STF and PC in RAM < 4MB */
 	{
 		col = ( col & 0x777 ) | ( rand() & 0x888 );
 		IoMem_WriteWord ( addr , col );
@@ -5688,10 +5728,7 @@ void Video_RemoteDebugSync(void)
 	if (bUseHighRes)
 		IoMem[0xff8260] = 2;			/* If mono monitor, force to high resolution */
 
-	if (Config_IsMachineST())
-		IoMem[0xff8260] |= 0xfc;		/* On STF, set unused bits 2-7 to 1 */
-	else if (Config_IsMachineTT())
-		IoMem[0xff8260] &= 0x07;		/* Only use bits 0, 1 and 2 */
-	else
-		IoMem[0xff8260] &= 0x03;		/* Only use bits 0 and 1, unused bits 2-7 are set to 0 */
+	/* On STF, set unused bits 2-7 to 1. On TT, only use bits 0, 1 and 2. */
+	/* Else only use bits 0 and 1, unused bits 2-7 are set to 0 */
+	IoMem[0xff8260] = ( IoMem[0xff8260] & pVideoMachine->ResRegReadAnd ) | pVideoMachine->ResRegReadOr;
 }
@@ -174,30 +174,33 @@ void WAVFormat_CloseFile(void)
  */
 void WAVFormat_Update(Sint16 pSamples[][2], int Index, int Length)
 {
-	Sint16 sample[2];
-	int i;
+	Sint16 buffer[1024][2];
+	int i, n;
 	int idx;
 
 	if (bRecordingWav)
 	{
-		/* Output, better if did in two section if wrap */
+		/* Output in blocks, converting samples to little endian */
 		idx = Index & AUDIOMIXBUFFER_SIZE_MASK;
-		for(i = 0; i < Length; i++)
+		while (Length > 0)
 		{
-			/* Convert sample to little endian */
-			sample[0] = SDL_SwapLE16(pSamples[idx][0]);
-			sample[1] = SDL_SwapLE16(pSamples[idx][1]);
-			idx = ( idx+1 ) & AUDIOMIXBUFFER_SIZE_MASK;
+			n = Length < ARRAY_SIZE(buffer) ? Length : ARRAY_SIZE(buffer);
+			for (i = 0; i < n; i++)
+			{
+				buffer[i][0] = SDL_SwapLE16(pSamples[idx][0]);
+				buffer[i][1] = SDL_SwapLE16(pSamples[idx][1]);
+				idx = ( idx+1 ) & AUDIOMIXBUFFER_SIZE_MASK;
+			}
 			/* And store */
-			if (fwrite(&sample, sizeof(sample), 1, WavFileHndl) != 1)
+			if (fwrite(buffer, sizeof(buffer[0]), n, WavFileHndl) != (size_t)n)
 			{
 				perror("WAVFormat_Update");
 				WAVFormat_CloseFile();
 				return;
 			}
+			/* Add samples to wav file length counter */
+			nWavOutputBytes += n * sizeof(buffer[0]);
+			Length -= n;
 		}
-
-		/* Add samples to wav file length counter */
-		nWavOutputBytes += Length * 4;
 	}
 }
@@ -5,15 +5,30 @@
   or at your option any later version. Read the file gpl.txt for details.
 
   YM File output, for use with STSound etc...
+
+  Besides the per-VBL YM3 format, YM register writes can be dumped with
+  their CPU cycle time stamps to a Hatari specific '.ymd' file:
+    4 byte header 'YMD1'
+    4 byte CPU clock frequency (big endian)
+    6 byte entries for each write:
+      4 byte CPU cycles since previous write (big endian)
+      1 byte register number, 0xff marks end of recording
+      1 byte register value
+  Such dumps and YM3 files can be rendered to a WAV file without
+  emulating the rest of the machine, see YMFormat_Render().
 */
 const char YMFormat_fileid[] = "Hatari ymFormat.c";
 
 #include "main.h"
 #include "configuration.h"
+#include "audio.h"
+#include "clocks_timings.h"
+#include "cycles.h"
 #include "file.h"
 #include "log.h"
 #include "psg.h"
 #include "sound.h"
+#include "wavFormat.h"
 #include "ymFormat.h"
 
 
@@ -25,6 +40,14 @@ static int nYMVBLS = 0;
 static Uint8 *pYMData, *pYMWorkspace = NULL;
 static char *pszYMFileName = NULL;
 
+#define YMD_HEADER_SIZE  8
+#define YMD_ENTRY_SIZE   6
+#define YMD_REG_END      0xff
+
+bool bRecordingYMDump = false;
+static FILE *YMDumpFile = NULL;
+static Uint64 YMDumpClock;               /* CPU clock of previous dumped write */
+
 /*-----------------------------------------------------------------------*/
 /**
  * Start recording YM registers to workspace
@@ -195,3 +218,205 @@ void YMFormat_UpdateRecording(void)
 	}
 }
 
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Write one entry to the YM register dump, stop dumping on error
+ */
+static void YMFormat_DumpEntry(Uint64 Clock, Uint8 Reg, Uint8 Data)
+{
+	Uint8 entry[YMD_ENTRY_SIZE];
+	Uint64 Delta = Clock > YMDumpClock ? Clock - YMDumpClock : 0;
+
+	/* A delta too large for one entry (~9 minutes at 8 MHz) is split with no-op writes */
+	while (Delta > 0xffffffff)
+	{
+		YMFormat_DumpEntry(YMDumpClock + 0xffffffff, PSG_REG_ENV_SHAPE, 0xff);
+		if (!bRecordingYMDump)
+			return;
+		Delta -= 0xffffffff;
+	}
+	YMDumpClock += Delta;
+
+	entry[0] = Delta >> 24;
+	entry[1] = Delta >> 16;
+	entry[2] = Delta >> 8;
+	entry[3] = Delta;
+	entry[4] = Reg;
+	entry[5] = Data;
+	if (fwrite(entry, sizeof(entry), 1, YMDumpFile) != 1)
+	{
+		perror("YMFormat_DumpEntry");
+		fclose(YMDumpFile);
+		YMDumpFile = NULL;
+		bRecordingYMDump = false;
+	}
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Start dumping YM register writes with their cycle time stamps
+ */
+bool YMFormat_BeginDump(const char *filename)
+{
+	Uint8 header[YMD_HEADER_SIZE] = { 'Y', 'M', 'D', '1' };
+	int i;
+
+	YMFormat_EndDump();
+
+	YMDumpFile = fopen(filename, "wb");
+	if (!YMDumpFile)
+	{
+		perror("YMFormat_BeginDump");
+		Log_AlertDlg(LOG_ERROR, "YM register dump: Failed to open file!");
+		return false;
+	}
+
+	header[4] = MachineClocks.CPU_Freq_Emul >> 24;
+	header[5] = MachineClocks.CPU_Freq_Emul >> 16;
+	header[6] = MachineClocks.CPU_Freq_Emul >> 8;
+	header[7] = MachineClocks.CPU_Freq_Emul;
+	if (fwrite(header, sizeof(header), 1, YMDumpFile) != 1)
+	{
+		perror("YMFormat_BeginDump");
+		Log_AlertDlg(LOG_ERROR, "YM register dump: Failed to write header!");
+		fclose(YMDumpFile);
+		YMDumpFile = NULL;
+		return false;
+	}
+	bRecordingYMDump = true;
+
+	/* Start with the current register values, so that dump can be started anytime */
+	YMDumpClock = CyclesGlobalClockCounter;
+	for (i = 0; i < NUM_PSG_SOUND_REGISTERS - 1; i++)
+		YMFormat_DumpEntry(YMDumpClock, i, SoundRegs[i]);
+
+	Log_AlertDlg(LOG_INFO, "YM register dump has been started.");
+	return bRecordingYMDump;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Dump a YM register write done at given CPU clock - call on each write
+ */
+void YMFormat_DumpWrite(Uint64 Clock, int Reg, Uint8 Data)
+{
+	if (bRecordingYMDump)
+		YMFormat_DumpEntry(Clock, Reg, Data);
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Mark end of recording and close YM register dump
+ */
+void YMFormat_EndDump(void)
+{
+	if (bRecordingYMDump)
+		YMFormat_DumpEntry(CyclesGlobalClockCounter, YMD_REG_END, 0);
+	if (YMDumpFile)
+	{
+		fclose(YMDumpFile);
+		YMDumpFile = NULL;
+		Log_AlertDlg(LOG_INFO, "YM register dump has been stopped.");
+	}
+	bRecordingYMDump = false;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Render YM3 file or YM register dump to given WAV file, using YM2149
+ * emulation directly instead of running the emulated machine.
+ * Samples are generated like on ST, as fast as the host can.
+ * Return true on success.
+ */
+bool YMFormat_Render(const char *pszYMFile, char *pszWavFile)
+{
+	Uint8 *pData, *pEntry;
+	long nSize;
+	Uint64 Clock = 0, FrameClock;
+	Uint32 Freq;
+	int nFrames, Frame, Reg;
+
+	pData = File_Read(pszYMFile, &nSize, NULL);
+	if (!pData)
+	{
+		Log_Printf(LOG_ERROR, "Can't read YM file '%s'!\n", pszYMFile);
+		return false;
+	}
+	if (nSize < YMD_HEADER_SIZE ||
+	    (memcmp(pData, "YM3!", 4) != 0 && memcmp(pData, "YMD1", 4) != 0))
+	{
+		Log_Printf(LOG_ERROR, "'%s' isn't an uncompressed YM3 file or a YM register dump!\n",
+		           pszYMFile);
+		free(pData);
+		return false;
+	}
+
+	/* Only the YM2149 is rendered, so use the ST sound path */
+	ConfigureParams.System.nMachineType = MACHINE_ST;
+	ClocksTimings_InitMachine(MACHINE_ST);
+	if (pData[3] == '1')
+		MachineClocks.CPU_Freq_Emul = ((Uint32)pData[4] << 24) | ((Uint32)pData[5] << 16)
+		                              | ((Uint32)pData[6] << 8) | pData[7];
+	Freq = MachineClocks.CPU_Freq_Emul;
+
+	/* Samples are only written to the WAV file */
+	bAudioOffline = true;
+	CyclesGlobalClockCounter = 0;
+	Sound_Init();
+	if (!WAVFormat_OpenFile(pszWavFile))
+	{
+		free(pData);
+		return false;
+	}
+
+	if (pData[3] == '!')
+	{
+		/* YM3 has one 50 Hz frame per register, register streams one after another */
+		nFrames = (nSize - 4) / NUM_PSG_SOUND_REGISTERS;
+		for (Frame = 0; Frame < nFrames; Frame++)
+		{
+			FrameClock = (Uint64)Frame * Freq / 50;
+			Sound_Update(FrameClock);
+			for (Reg = 0; Reg < NUM_PSG_SOUND_REGISTERS; Reg++)
+			{
+				Uint8 Data = pData[4 + Reg * nFrames + Frame];
+				if (Reg != PSG_REG_ENV_SHAPE || Data != 0xff)
+					Sound_WriteReg(Reg, Data);
+			}
+		}
+		Clock = (Uint64)nFrames * Freq / 50;
+	}
+	else
+	{
+		for (pEntry = pData + YMD_HEADER_SIZE; pEntry + YMD_ENTRY_SIZE <= pData + nSize;
+		     pEntry += YMD_ENTRY_SIZE)
+		{
+			Clock += ((Uint32)pEntry[0] << 24) | ((Uint32)pEntry[1] << 16)
+			         | ((Uint32)pEntry[2] << 8) | pEntry[3];
+			/* Create samples up until this write, like PSG_Set_DataRegister() */
+			Sound_Update(Clock);
+			if (pEntry[4] == YMD_REG_END)
+				break;
+			/* 0xff for register 13 means no write, like in YM3 files */
+			if (pEntry[4] < NUM_PSG_SOUND_REGISTERS &&
+			    (pEntry[4] != PSG_REG_ENV_SHAPE || pEntry[5] != 0xff))
+				Sound_WriteReg(pEntry[4], pEntry[5]);
+		}
+		if (pEntry + YMD_ENTRY_SIZE > pData + nSize)
+			Log_Printf(LOG_WARN, "YM register dump '%s' has no end mark, "
+			           "rendered it up to its last write\n", pszYMFile);
+	}
+	Sound_Update(Clock);
+
+	WAVFormat_CloseFile();
+	free(pData);
+	Log_Printf(LOG_INFO, "Rendered %.1f seconds of YM sound to '%s'\n",
+	           (double)Clock / Freq, pszWavFile);
+	return true;
+}
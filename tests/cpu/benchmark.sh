@@ -0,0 +1,55 @@
+#!/bin/sh
+#
+# Run the CPU integer test program repeatedly for the main CPU cores
+# and report the total wall clock time for each of them. Not run by
+# "make test", this is meant for comparing CPU core / memory access
+# changes against a previous Hatari binary.
+
+if [ $# -lt 1 ] || [ "$1" = "-h" ] || [ "$1" = "--help" ]; then
+	echo "Usage: $0 <hatari> [rounds] [hatari options]"
+	exit 1;
+fi
+
+hatari=$1
+shift
+if [ ! -x "$hatari" ]; then
+	echo "First parameter must point to valid hatari executable."
+	exit 1;
+fi;
+
+rounds=200
+if [ $# -gt 0 ]; then
+	rounds=$1
+	shift
+fi
+
+basedir=$(dirname "$0")
+testdir=$(mktemp -d)
+
+remove_temp() {
+  rm -rf "$testdir"
+}
+trap remove_temp EXIT
+
+export HATARI_TEST=cpu
+export SDL_VIDEODRIVER=dummy
+export SDL_AUDIODRIVER=dummy
+
+for cpu in "--cpulevel 0 --compatible off" "--cpulevel 0 --compatible on" \
+	   "--cpulevel 3" "--cpulevel 4"; do
+	start=$(date +%s)
+	i=0
+	while [ $i -lt "$rounds" ]; do
+		# shellcheck disable=SC2086 # word splitting of $cpu is wanted
+		if ! HOME="$testdir" $hatari --log-level error --sound off \
+			--benchmark --tos none --run-vbls 500 $cpu "$@" \
+			"$basedir/int_test.tos" > "$testdir/out.txt" 2>&1; then
+			echo "Running hatari failed:"
+			cat "$testdir/out.txt"
+			exit 1
+		fi
+		i=$((i+1))
+	done
+	end=$(date +%s)
+	echo "$cpu: $rounds rounds in $((end - start)) seconds"
+done
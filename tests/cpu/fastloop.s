@@ -0,0 +1,623 @@
+; Test for the CPU core "move/clr (An)+ ; dbf Dn,loop" fast path.
+;
+; Runs copy / clear loops in all the forms handled by the fast path,
+; and corner cases for it, first without interrupts, then with MFP
+; Timer A interrupts, and then also with HBL and VBL interrupts.
+; After each loop, writes the registers, CCR, Timer A and HBL / VBL
+; interrupt counts (i.e. cycles used), a checksum of the SR & PC at
+; the interrupts, and a checksum of the memory to FASTLOOP.TXT.
+; run_fastloop.sh runs this with the fast path active and inactive,
+; and compares the outputs.
+;
+; Uses only PC-relative and absolute addressing, so there's no need
+; for relocation (this was assembled by hand).  Needs 1 MiB of RAM.
+
+LOOP	equ	$20000		; tests are copied here, fast path needs pc >= $10000
+SRCBUF	equ	$21000		; source data
+DSTBUF	equ	$22000		; destination
+BUFEND	equ	$24000
+
+OVF	equ	$2f000		; Timer A interrupts
+HBLS	equ	$2f004		; HBL interrupts
+VBLS	equ	$2f008		; VBL interrupts
+TASTART	equ	$2f00c		; Timer A data before the test
+TAEND	equ	$2f00d		; Timer A data after the test
+SAVESP	equ	$2f010		; A7 before the test, for the A7 tests
+TESTSP	equ	$2f014		; A7 after the test loop
+CCRVAL	equ	$2f018		; SR after the test
+SRLEVEL	equ	$2f01a		; SR for running the test
+NAME	equ	$2f01c		; test name
+IRQSUM	equ	$2f060		; checksum of interrupted SR & PC
+HANDLE	equ	$2f064		; output file handle
+REGS	equ	$2f020		; d0-d7/a0-a6 after the test
+LINE	equ	$2f100		; output line
+
+	text
+
+	clr.l	-(sp)
+	move.w	#$20,-(sp)
+	trap	#1		; Super
+	addq.l	#6,sp
+
+	clr.w	-(sp)
+	pea	filename(pc)
+	move.w	#$3c,-(sp)
+	trap	#1		; Fcreate
+	addq.l	#8,sp
+	move.w	d0,HANDLE
+
+	move.w	#$2700,sr
+	lea	hbl(pc),a0
+	move.l	a0,$68.w
+	lea	vbl(pc),a0
+	move.l	a0,$70.w
+	lea	timer_a(pc),a0
+	move.l	a0,$134.w
+	move.b	#$40,$fffffa17.w	; MFP vectors at $100, automatic EOI
+	clr.b	$fffffa19.w		; stop Timer A
+	clr.b	$fffffa1f.w		; 256 counts
+	move.b	#$20,$fffffa07.w	; enable & unmask only Timer A
+	move.b	#$20,$fffffa13.w
+	move.b	#1,$fffffa19.w		; delay mode, /4 prescaler
+
+	move.w	#$2700,SRLEVEL		; no interrupts
+	bsr.w	all_tests
+	move.w	#$2500,SRLEVEL		; Timer A interrupts
+	bsr.w	all_tests
+	move.w	#$2100,SRLEVEL		; also HBL and VBL interrupts
+	bsr.w	all_tests
+
+	move.w	HANDLE,-(sp)
+	move.w	#$3e,-(sp)
+	trap	#1		; Fclose
+	addq.l	#4,sp
+
+	clr.w	-(sp)
+	trap	#1		; Pterm0
+
+filename:
+	dc.b	"FASTLOOP.TXT",0
+	even
+
+hbl:
+	addq.l	#1,HBLS
+	bra.s	irq_sum
+vbl:
+	addq.l	#1,VBLS
+	bra.s	irq_sum
+timer_a:
+	addq.l	#1,OVF
+irq_sum:
+	move.l	d0,-(sp)
+	move.l	IRQSUM,d0
+	rol.l	#5,d0
+	add.w	4(sp),d0	; interrupted SR
+	add.l	6(sp),d0	; and PC
+	move.l	d0,IRQSUM
+	move.l	(sp)+,d0
+	rte
+
+
+all_tests:
+	lea	t_moveb(pc),a0
+	lea	t_moveb_end(pc),a1
+	bsr.w	run_test
+	lea	t_movew(pc),a0
+	lea	t_movew_end(pc),a1
+	bsr.w	run_test
+	lea	t_movel(pc),a0
+	lea	t_movel_end(pc),a1
+	bsr.w	run_test
+	lea	t_movebd(pc),a0
+	lea	t_movebd_end(pc),a1
+	bsr.w	run_test
+	lea	t_movewd(pc),a0
+	lea	t_movewd_end(pc),a1
+	bsr.w	run_test
+	lea	t_moveld(pc),a0
+	lea	t_moveld_end(pc),a1
+	bsr.w	run_test
+	lea	t_clrb(pc),a0
+	lea	t_clrb_end(pc),a1
+	bsr.w	run_test
+	lea	t_clrw(pc),a0
+	lea	t_clrw_end(pc),a1
+	bsr.w	run_test
+	lea	t_clrl(pc),a0
+	lea	t_clrl_end(pc),a1
+	bsr.w	run_test
+	lea	t_a7src(pc),a0
+	lea	t_a7src_end(pc),a1
+	bsr.w	run_test
+	lea	t_a7dst(pc),a0
+	lea	t_a7dst_end(pc),a1
+	bsr.w	run_test
+	lea	t_a7d(pc),a0
+	lea	t_a7d_end(pc),a1
+	bsr.w	run_test
+	lea	t_a7clr(pc),a0
+	lea	t_a7clr_end(pc),a1
+	bsr.w	run_test
+	lea	t_samew(pc),a0
+	lea	t_samew_end(pc),a1
+	bsr.w	run_test
+	lea	t_samel(pc),a0
+	lea	t_samel_end(pc),a1
+	bsr.w	run_test
+	lea	t_sameb(pc),a0
+	lea	t_sameb_end(pc),a1
+	bsr.w	run_test
+	lea	t_samea7(pc),a0
+	lea	t_samea7_end(pc),a1
+	bsr.w	run_test
+	lea	t_cntb(pc),a0
+	lea	t_cntb_end(pc),a1
+	bsr.w	run_test
+	lea	t_cntw(pc),a0
+	lea	t_cntw_end(pc),a1
+	bsr.w	run_test
+	lea	t_cntl(pc),a0
+	lea	t_cntl_end(pc),a1
+	bsr.w	run_test
+	lea	t_selfmod(pc),a0
+	lea	t_selfmod_end(pc),a1
+	bsr.w	run_test
+	lea	t_ramsrc(pc),a0
+	lea	t_ramsrc_end(pc),a1
+	bsr.w	run_test
+	lea	t_ramdst(pc),a0
+	lea	t_ramdst_end(pc),a1
+	bsr.w	run_test
+	lea	t_lowsrc(pc),a0
+	lea	t_lowsrc_end(pc),a1
+	bsr.w	run_test
+	lea	t_lowdst(pc),a0
+	lea	t_lowdst_end(pc),a1
+	bsr.w	run_test
+	lea	t_long(pc),a0
+	lea	t_long_end(pc),a1
+	bsr.w	run_test
+	rts
+
+
+; Run test from a0 (name string followed by code) to a1, print results
+run_test:
+	move.l	a0,NAME
+skip_name:
+	tst.b	(a0)+
+	bne.s	skip_name
+	move.l	a0,d0
+	addq.l	#1,d0
+	and.w	#$fffe,d0
+	move.l	d0,a0
+
+	lea	LOOP,a2
+copy_test:
+	move.w	(a0)+,(a2)+
+	cmp.l	a1,a0
+	bcs.s	copy_test
+
+	lea	SRCBUF,a0
+	move.w	#(BUFEND-SRCBUF)/2-1,d0
+	moveq	#0,d1
+init_buf:
+	move.w	d1,(a0)+
+	add.w	#$1357,d1
+	dbf	d0,init_buf
+
+	clr.l	TESTSP
+	clr.l	OVF
+	clr.l	HBLS
+	clr.l	VBLS
+	clr.l	IRQSUM
+	move.b	$fffffa1f.w,TASTART
+	move.w	SRLEVEL,sr
+	jsr	LOOP
+	move.w	sr,CCRVAL
+	move.w	#$2700,sr
+	move.b	$fffffa1f.w,TAEND
+	movem.l	d0-d7/a0-a6,REGS
+
+	; checksum of test code, buffers and the areas around $10000 & RAM end
+	moveq	#0,d7
+	lea	LOOP,a0
+	move.w	#(BUFEND-LOOP)/4-1,d0
+	bsr.w	checksum
+	lea	$ff00,a0
+	move.w	#$200/4-1,d0
+	bsr.w	checksum
+	lea	$fff00,a0
+	move.w	#$100/4-1,d0
+	bsr.w	checksum
+
+	; output line: name, SR level, registers, A7, CCR, interrupts, checksums
+	lea	LINE,a6
+	move.l	NAME,a5
+copy_name:
+	move.b	(a5)+,(a6)+
+	bne.s	copy_name
+	subq.l	#1,a6
+	moveq	#0,d0
+	move.w	SRLEVEL,d0
+	bsr.w	hex8
+	lea	REGS,a4
+	moveq	#15-1,d3
+print_regs:
+	move.l	(a4)+,d0
+	bsr.w	hex8
+	dbf	d3,print_regs
+	move.l	TESTSP,d0
+	bsr.w	hex8
+	moveq	#0,d0
+	move.w	CCRVAL,d0
+	bsr.w	hex8
+	move.l	OVF,d0
+	bsr.w	hex8
+	move.l	TASTART,d0	; start & end data, in the upper word
+	bsr.w	hex8
+	move.l	HBLS,d0
+	bsr.w	hex8
+	move.l	VBLS,d0
+	bsr.w	hex8
+	move.l	IRQSUM,d0
+	bsr.w	hex8
+	move.l	d7,d0
+	bsr.w	hex8
+	move.b	#10,(a6)+
+
+	move.l	a6,d0
+	lea	LINE,a0
+	sub.l	a0,d0
+	pea	LINE
+	move.l	d0,-(sp)
+	move.w	HANDLE,-(sp)
+	move.w	#$40,-(sp)
+	trap	#1		; Fwrite
+	lea	12(sp),sp
+	rts
+
+; Add d0+1 longs from a0 to checksum in d7
+checksum:
+	add.l	(a0)+,d7
+	rol.l	#1,d7
+	dbf	d0,checksum
+	rts
+
+; Add space and d0 as 8 hex digits to a6
+hex8:
+	move.b	#32,(a6)+
+	moveq	#8-1,d2
+hex_digit:
+	rol.l	#4,d0
+	move.b	d0,d1
+	and.b	#15,d1
+	add.b	#48,d1
+	cmp.b	#57,d1
+	bls.s	hex_dec
+	addq.b	#7,d1
+hex_dec:
+	move.b	d1,(a6)+
+	dbf	d2,hex_digit
+	rts
+
+
+; The tests. Code after the name is copied to LOOP and called there.
+
+t_moveb:
+	dc.b	"move.b (a0)+,(a1)+",0
+	even
+	lea	SRCBUF+1,a0
+	lea	DSTBUF+3,a1
+	move.w	#999,d0
+l_moveb:
+	move.b	(a0)+,(a1)+
+	dbf	d0,l_moveb
+	rts
+t_moveb_end:
+
+t_movew:
+	dc.b	"move.w (a0)+,(a1)+",0
+	even
+	lea	SRCBUF,a0
+	lea	DSTBUF+2,a1
+	move.w	#999,d0
+l_movew:
+	move.w	(a0)+,(a1)+
+	dbf	d0,l_movew
+	rts
+t_movew_end:
+
+t_movel:
+	dc.b	"move.l (a2)+,(a3)+",0
+	even
+	lea	SRCBUF+2,a2
+	lea	DSTBUF,a3
+	move.w	#999,d5
+l_movel:
+	move.l	(a2)+,(a3)+
+	dbf	d5,l_movel
+	rts
+t_movel_end:
+
+t_movebd:
+	dc.b	"move.b d1,(a1)+",0
+	even
+	move.l	#$12345680,d1
+	lea	DSTBUF+1,a1
+	move.w	#499,d2
+l_movebd:
+	move.b	d1,(a1)+
+	dbf	d2,l_movebd
+	rts
+t_movebd_end:
+
+t_movewd:
+	dc.b	"move.w d3,(a4)+",0
+	even
+	move.l	#$89ab0000,d3
+	lea	DSTBUF,a4
+	move.w	#499,d7
+l_movewd:
+	move.w	d3,(a4)+
+	dbf	d7,l_movewd
+	rts
+t_movewd_end:
+
+t_moveld:
+	dc.b	"move.l d1,(a6)+",0
+	even
+	move.l	#$80000001,d1
+	lea	DSTBUF+2,a6
+	move.w	#299,d0
+l_moveld:
+	move.l	d1,(a6)+
+	dbf	d0,l_moveld
+	rts
+t_moveld_end:
+
+t_clrb:
+	dc.b	"clr.b (a1)+",0
+	even
+	lea	DSTBUF+1,a1
+	move.w	#777,d0
+l_clrb:
+	clr.b	(a1)+
+	dbf	d0,l_clrb
+	rts
+t_clrb_end:
+
+t_clrw:
+	dc.b	"clr.w (a5)+",0
+	even
+	lea	DSTBUF,a5
+	move.w	#777,d4
+l_clrw:
+	clr.w	(a5)+
+	dbf	d4,l_clrw
+	rts
+t_clrw_end:
+
+t_clrl:
+	dc.b	"clr.l (a0)+",0
+	even
+	lea	DSTBUF+2,a0
+	move.w	#511,d0
+l_clrl:
+	clr.l	(a0)+
+	dbf	d0,l_clrl
+	rts
+t_clrl_end:
+
+t_a7src:
+	dc.b	"move.b (a7)+,(a1)+",0
+	even
+	move.l	sp,SAVESP
+	lea	SRCBUF+$800,sp
+	lea	DSTBUF,a1
+	move.w	#199,d0
+l_a7src:
+	move.b	(sp)+,(a1)+
+	dbf	d0,l_a7src
+	move.l	sp,TESTSP
+	move.l	SAVESP,sp
+	rts
+t_a7src_end:
+
+t_a7dst:
+	dc.b	"move.b (a0)+,(a7)+",0
+	even
+	move.l	sp,SAVESP
+	lea	DSTBUF+$800,sp
+	lea	SRCBUF+1,a0
+	move.w	#199,d0
+l_a7dst:
+	move.b	(a0)+,(sp)+
+	dbf	d0,l_a7dst
+	move.l	sp,TESTSP
+	move.l	SAVESP,sp
+	rts
+t_a7dst_end:
+
+t_a7d:
+	dc.b	"move.b d1,(a7)+",0
+	even
+	move.l	sp,SAVESP
+	lea	DSTBUF+$800,sp
+	moveq	#$55,d1
+	move.w	#199,d0
+l_a7d:
+	move.b	d1,(sp)+
+	dbf	d0,l_a7d
+	move.l	sp,TESTSP
+	move.l	SAVESP,sp
+	rts
+t_a7d_end:
+
+t_a7clr:
+	dc.b	"clr.b (a7)+",0
+	even
+	move.l	sp,SAVESP
+	lea	DSTBUF+$800,sp
+	move.w	#199,d0
+l_a7clr:
+	clr.b	(sp)+
+	dbf	d0,l_a7clr
+	move.l	sp,TESTSP
+	move.l	SAVESP,sp
+	rts
+t_a7clr_end:
+
+t_samew:
+	dc.b	"move.w (a0)+,(a0)+",0
+	even
+	lea	SRCBUF,a0
+	move.w	#499,d0
+l_samew:
+	move.w	(a0)+,(a0)+
+	dbf	d0,l_samew
+	rts
+t_samew_end:
+
+t_samel:
+	dc.b	"move.l (a3)+,(a3)+",0
+	even
+	lea	SRCBUF,a3
+	move.w	#299,d1
+l_samel:
+	move.l	(a3)+,(a3)+
+	dbf	d1,l_samel
+	rts
+t_samel_end:
+
+t_sameb:
+	dc.b	"move.b (a2)+,(a2)+",0
+	even
+	lea	SRCBUF+1,a2
+	move.w	#499,d0
+l_sameb:
+	move.b	(a2)+,(a2)+
+	dbf	d0,l_sameb
+	rts
+t_sameb_end:
+
+t_samea7:
+	dc.b	"move.b (a7)+,(a7)+",0
+	even
+	move.l	sp,SAVESP
+	lea	SRCBUF+$100,sp
+	move.w	#99,d0
+l_samea7:
+	move.b	(sp)+,(sp)+
+	dbf	d0,l_samea7
+	move.l	sp,TESTSP
+	move.l	SAVESP,sp
+	rts
+t_samea7_end:
+
+t_cntb:
+	dc.b	"move.b d5,(a0)+ ; dbf d5",0
+	even
+	move.l	#$12340155,d5
+	lea	DSTBUF+1,a0
+l_cntb:
+	move.b	d5,(a0)+
+	dbf	d5,l_cntb
+	rts
+t_cntb_end:
+
+t_cntw:
+	dc.b	"move.w d0,(a1)+ ; dbf d0",0
+	even
+	move.l	#$ffff0257,d0
+	lea	DSTBUF,a1
+l_cntw:
+	move.w	d0,(a1)+
+	dbf	d0,l_cntw
+	rts
+t_cntw_end:
+
+t_cntl:
+	dc.b	"move.l d3,(a2)+ ; dbf d3",0
+	even
+	move.l	#$abcd0200,d3
+	lea	DSTBUF+2,a2
+l_cntl:
+	move.l	d3,(a2)+
+	dbf	d3,l_cntl
+	rts
+t_cntl_end:
+
+; Writes NOPs up to the loop, and over its move instruction,
+; after which the loop keeps running as "nop ; dbf"
+t_selfmod:
+	dc.b	"move.w d1,(a1)+ over loop",0
+	even
+t_selfmod_code:
+	lea	LOOP+l_selfmod-t_selfmod_code-8,a1
+	move.w	#$4e71,d1
+	move.w	#20,d0
+l_selfmod:
+	move.w	d1,(a1)+
+	dbf	d0,l_selfmod
+	rts
+t_selfmod_end:
+
+t_ramsrc:
+	dc.b	"move.l (a0)+,(a1)+ from RAM end",0
+	even
+	lea	$100000-32,a0
+	lea	DSTBUF,a1
+	move.w	#15,d0
+l_ramsrc:
+	move.l	(a0)+,(a1)+
+	dbf	d0,l_ramsrc
+	rts
+t_ramsrc_end:
+
+t_ramdst:
+	dc.b	"move.l (a0)+,(a1)+ to RAM end",0
+	even
+	lea	SRCBUF,a0
+	lea	$100000-32,a1
+	move.w	#15,d0
+l_ramdst:
+	move.l	(a0)+,(a1)+
+	dbf	d0,l_ramdst
+	rts
+t_ramdst_end:
+
+t_lowsrc:
+	dc.b	"move.w (a0)+,(a1)+ from below $10000",0
+	even
+	lea	$10000-32,a0
+	lea	DSTBUF,a1
+	move.w	#31,d0
+l_lowsrc:
+	move.w	(a0)+,(a1)+
+	dbf	d0,l_lowsrc
+	rts
+t_lowsrc_end:
+
+t_lowdst:
+	dc.b	"move.w (a0)+,(a1)+ to below $10000",0
+	even
+	lea	SRCBUF,a0
+	lea	$10000-32,a1
+	move.w	#31,d0
+l_lowdst:
+	move.w	(a0)+,(a1)+
+	dbf	d0,l_lowdst
+	rts
+t_lowdst_end:
+
+; Long enough for several HBL, VBL and Timer A interrupts
+t_long:
+	dc.b	"clr.b (a1)+ long",0
+	even
+	lea	DSTBUF,a1
+	move.w	#7999,d0
+l_long:
+	clr.b	(a1)+
+	dbf	d0,l_long
+	rts
+t_long_end:
@@ -0,0 +1,64 @@
+#!/bin/sh
+
+if [ $# -lt 1 ] || [ "$1" = "-h" ] || [ "$1" = "--help" ]; then
+	echo "Usage: $0 <hatari>"
+	exit 1;
+fi
+
+hatari=$1
+shift
+if [ ! -x "$hatari" ]; then
+	echo "First parameter must point to valid hatari executable."
+	exit 1;
+fi;
+
+basedir=$(dirname "$0")
+testdir=$(mktemp -d)
+
+remove_temp() {
+  rm -rf "$testdir"
+}
+trap remove_temp EXIT
+
+export HATARI_TEST=cpu
+export SDL_VIDEODRIVER=dummy
+export SDL_AUDIODRIVER=dummy
+
+# The "move/clr (An)+ ; dbf" loop fast path is used only in the 68000
+# prefetch CPU core, and not while a debugger breakpoint is set
+printf 'b pc = 0\n' > "$testdir/nofast.ini"
+
+for mode in fast normal; do
+	if [ $mode = normal ]; then
+		set -- "$@" --parse "$testdir/nofast.ini"
+	fi
+	mkdir "$testdir/$mode"
+	cp "$basedir/fastloop.prg" "$testdir/$mode"
+	HOME="$testdir" $hatari --log-level fatal --fast-forward on --sound off \
+		--run-vbls 500 --tos none --machine st --memsize 1 \
+		--compatible true --cpu-exact false "$@" \
+		"$testdir/$mode/fastloop.prg" > "$testdir/$mode.txt" 2>&1
+	exitstat=$?
+	if [ $exitstat -ne 0 ]; then
+		echo "Test FAILED, Hatari returned error status ${exitstat} ($mode)."
+		cat "$testdir/$mode.txt"
+		exit 1
+	fi
+done
+
+# 26 tests, each without and with interrupts, and with more interrupts
+lines=$(wc -l < "$testdir/normal/FASTLOOP.TXT")
+if [ "$lines" -ne 78 ]; then
+	echo "Test FAILED, $lines result lines instead of 78."
+	cat "$testdir/normal/FASTLOOP.TXT"
+	exit 1
+fi
+
+if ! diff -q "$testdir/normal/FASTLOOP.TXT" "$testdir/fast/FASTLOOP.TXT"; then
+	echo "Test FAILED, fast path output differs:"
+	diff -u "$testdir/normal/FASTLOOP.TXT" "$testdir/fast/FASTLOOP.TXT"
+	exit 1
+fi
+
+echo "Test PASSED."
+exit 0
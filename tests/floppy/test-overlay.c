@@ -0,0 +1,249 @@
+/*
+ * Code to test the floppy image copy-on-write overlays in src/floppy.c
+ *
+ * Writes sectors to an overlaid ST image, saves a memory snapshot,
+ * writes some more, restores the snapshot and re-inserts the image,
+ * and checks that it has the contents it had when the snapshot was
+ * saved, and that the image file itself was never changed.
+ */
+#include <stdio.h>
+#include <unistd.h>
+#include "../../src/floppy.c"
+#include "../../src/diskOverlay.c"
+#include "../../src/utils.c"
+
+#define IMAGE_SIZE	(80 * 2 * 9 * NUMBYTESPERSECTOR)
+
+/* fake stuff needed by floppy.c */
+CNF_PARAMS ConfigureParams;
+bool bAcsiEmuOn, bScsiEmuOn;
+int nVBLs;
+EMULATEDDRIVE **emudrives;
+
+bool File_Lock(FILE *fp) { return true; }
+void File_UnLock(FILE *fp) { }
+bool File_DirExists(const char *psDirName) { return true; }
+void File_MakeAbsoluteName(char *pFileName) { }
+bool File_Exists(const char *filename) { return access(filename, F_OK) == 0; }
+char *File_MakePath(const char *pDir, const char *pName, const char *pExt)
+{
+	char *path = malloc(strlen(pDir) + strlen(pName) + (pExt ? strlen(pExt) : 0) + 3);
+	sprintf(path, "%s/%s%s%s", pDir, pName, pExt ? "." : "", pExt ? pExt : "");
+	return path;
+}
+char *File_FindPossibleExtFileName(const char *pszFileName, const char * const ppszExts[]) { return NULL; }
+void File_SplitPath(const char *pSrcFileName, char *pDir, char *pName, char *pExt) { }
+void Log_AlertDlg(LOGTYPE nType, const char *psFormat, ...) { }
+void Log_Printf(LOGTYPE nType, const char *psFormat, ...) { }
+
+bool ST_FileNameIsST(const char *pszFileName, bool bAllowGZ)
+{
+	size_t len = strlen(pszFileName);
+	return len > 3 && strcmp(pszFileName + len - 3, ".st") == 0;
+}
+Uint8 *ST_ReadDisk(int Drive, const char *pszFileName, long *pImageSize, int *pImageType)
+{
+	Uint8 *buf = malloc(IMAGE_SIZE);
+	FILE *fp = fopen(pszFileName, "rb");
+
+	if (!buf || !fp || fread(buf, IMAGE_SIZE, 1, fp) != 1)
+	{
+		free(buf);
+		buf = NULL;
+	}
+	if (fp)
+		fclose(fp);
+	*pImageSize = IMAGE_SIZE;
+	*pImageType = FLOPPY_IMAGE_TYPE_ST;
+	return buf;
+}
+bool ST_WriteDisk(int Drive, const char *pszFileName, Uint8 *pBuffer, int ImageSize) { return false; }
+bool MSA_FileNameIsMSA(const char *pszFileName, bool bAllowGZ) { return false; }
+Uint8 *MSA_ReadDisk(int Drive, const char *pszFileName, long *pImageSize, int *pImageType) { return NULL; }
+bool MSA_WriteDisk(int Drive, const char *pszFileName, Uint8 *pBuffer, int ImageSize) { return false; }
+bool DIM_FileNameIsDIM(const char *pszFileName, bool bAllowGZ) { return false; }
+Uint8 *DIM_ReadDisk(int Drive, const char *pszFileName, long *pImageSize, int *pImageType) { return NULL; }
+bool DIM_WriteDisk(int Drive, const char *pszFileName, Uint8 *pBuffer, int ImageSize) { return false; }
+bool IPF_FileNameIsIPF(const char *pszFileName, bool bAllowGZ) { return false; }
+Uint8 *IPF_ReadDisk(int Drive, const char *pszFileName, long *pImageSize, int *pImageType) { return NULL; }
+bool IPF_WriteDisk(int Drive, const char *pszFileName, Uint8 *pBuffer, int ImageSize) { return false; }
+bool IPF_Insert(int Drive, Uint8 *pImageBuffer, long ImageSize) { return false; }
+bool IPF_Eject(int Drive) { return true; }
+bool STX_FileNameIsSTX(const char *pszFileName, bool bAllowGZ) { return false; }
+Uint8 *STX_ReadDisk(int Drive, const char *pszFileName, long *pImageSize, int *pImageType) { return NULL; }
+bool STX_WriteDisk(int Drive, const char *pszFileName, Uint8 *pBuffer, int ImageSize) { return false; }
+bool STX_Insert(int Drive, const char *FilenameSTX, Uint8 *pImageBuffer, long ImageSize) { return false; }
+bool STX_Eject(int Drive) { return true; }
+bool ZIP_FileNameIsZIP(const char *pszFileName) { return false; }
+Uint8 *ZIP_ReadDisk(int Drive, const char *pszFileName, const char *pszZipPath, long *pImageSize, int *pImageType) { return NULL; }
+bool ZIP_WriteDisk(int Drive, const char *pszFileName, unsigned char *pBuffer, int ImageSize) { return false; }
+void FDC_InsertFloppy(int Drive) { }
+void FDC_EjectFloppy(int Drive) { }
+
+/* memory snapshot kept in memory */
+static Uint8 snapshot[IMAGE_SIZE * MAX_FLOPPYDRIVES + 65536];
+static size_t snapshot_pos;
+static bool snapshot_saving;
+
+void MemorySnapShot_Store(void *pData, int Size)
+{
+	if (snapshot_pos + Size > sizeof(snapshot))
+		return;
+	if (snapshot_saving)
+		memcpy(snapshot + snapshot_pos, pData, Size);
+	else
+		memcpy(pData, snapshot + snapshot_pos, Size);
+	snapshot_pos += Size;
+}
+
+static void snapshot_capture(bool bSave)
+{
+	snapshot_pos = 0;
+	snapshot_saving = bSave;
+	Floppy_MemorySnapShot_Capture(bSave);
+}
+
+static char image_name[FILENAME_MAX];
+static char overlay_dir[] = "/tmp/test-floppy-XXXXXX";
+
+static Uint8 pattern(int i)
+{
+	return (i * 7 + (i >> 9)) & 0xff;
+}
+
+/* create double sided, 9 sectors per track image with known contents */
+static bool create_image(void)
+{
+	static Uint8 image[IMAGE_SIZE];
+	FILE *fp;
+	int i;
+
+	for (i = 0; i < IMAGE_SIZE; i++)
+		image[i] = pattern(i);
+	image[11] = NUMBYTESPERSECTOR & 0xff;	/* BPS */
+	image[12] = NUMBYTESPERSECTOR >> 8;
+	image[13] = 2;				/* SPC */
+	image[19] = (IMAGE_SIZE / NUMBYTESPERSECTOR) & 0xff;	/* NSECTS */
+	image[20] = (IMAGE_SIZE / NUMBYTESPERSECTOR) >> 8;
+	image[24] = 9;				/* SPT */
+	image[25] = 0;
+	image[26] = 2;				/* NSIDES */
+	image[27] = 0;
+
+	fp = fopen(image_name, "wb");
+	if (!fp)
+		return false;
+	if (fwrite(image, IMAGE_SIZE, 1, fp) != 1)
+	{
+		fclose(fp);
+		return false;
+	}
+	return fclose(fp) == 0;
+}
+
+/* write sector filled with given value */
+static void write_sector(Uint16 Sector, Uint16 Track, Uint16 Side, Uint8 value)
+{
+	Uint8 buf[NUMBYTESPERSECTOR];
+
+	memset(buf, value, sizeof(buf));
+	Floppy_WriteSectors(0, buf, Sector, Track, Side, 1, NULL, NULL);
+}
+
+/* check that sector in given image buffer has given value, or the
+ * original image contents when value is zero */
+static int check_sector(const Uint8 *image, Uint16 Sector, Uint16 Track, Uint16 Side,
+			Uint8 value, const char *what)
+{
+	int i, offset = ((Track * 2 + Side) * 9 + Sector - 1) * NUMBYTESPERSECTOR;
+	const Uint8 *buf = image + offset;
+
+	for (i = 0; i < NUMBYTESPERSECTOR; i++)
+	{
+		if (buf[i] != (value ? value : pattern(offset + i)))
+		{
+			fprintf(stderr, "ERROR: %s: sector %d/%d/%d byte %d is 0x%02x, not 0x%02x\n",
+				what, Side, Track, Sector, i, buf[i],
+				value ? value : pattern(offset + i));
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static int test_restore(bool discard)
+{
+	long size;
+	int type, errors = 0;
+	Uint8 *image;
+
+	fprintf(stderr, "- snapshot restore, %s overlay\n", discard ? "discarded" : "kept");
+	DiskOverlay_SetDiscard(discard);
+	if (!create_image() || !Floppy_InsertDiskIntoDrive(0) || !FloppyOverlay[0])
+	{
+		fprintf(stderr, "ERROR: inserting overlaid image failed\n");
+		return 1;
+	}
+
+	write_sector(3, 10, 1, 0x11);
+	snapshot_capture(true);
+
+	/* these need to be gone after restore */
+	write_sector(3, 10, 1, 0x22);
+	write_sector(5, 40, 0, 0x33);
+
+	snapshot_capture(false);
+	image = EmulationDrives[0].pBuffer;
+	errors += check_sector(image, 3, 10, 1, 0x11, "after restore");
+	errors += check_sector(image, 5, 40, 0, 0, "after restore");
+
+	/* overlay needs to have what was restored */
+	Floppy_InsertDiskIntoDrive(0);
+	image = EmulationDrives[0].pBuffer;
+	errors += check_sector(image, 3, 10, 1, discard ? 0 : 0x11, "after re-insert");
+	errors += check_sector(image, 5, 40, 0, 0, "after re-insert");
+	Floppy_EjectDiskFromDrive(0);
+
+	/* image file itself is never written */
+	image = ST_ReadDisk(0, image_name, &size, &type);
+	if (!image)
+	{
+		fprintf(stderr, "ERROR: reading image file failed\n");
+		return errors + 1;
+	}
+	errors += check_sector(image, 3, 10, 1, 0, "image file");
+	errors += check_sector(image, 5, 40, 0, 0, "image file");
+	free(image);
+	return errors;
+}
+
+int main(int argc, const char *argv[])
+{
+	char *delta_name;
+	int errors = 0;
+
+	if (!mkdtemp(overlay_dir) || !DiskOverlay_SetDir(overlay_dir))
+	{
+		perror("mkdtemp");
+		return 1;
+	}
+	snprintf(image_name, sizeof(image_name), "%s/disk.st", overlay_dir);
+	strcpy(ConfigureParams.DiskImage.szDiskFileName[0], image_name);
+	ConfigureParams.DiskImage.nWriteProtection = WRITEPROT_AUTO;
+
+	errors += test_restore(false);
+	errors += test_restore(true);
+
+	delta_name = DiskOverlay_FileName(image_name, "ovl");
+	remove(delta_name);
+	free(delta_name);
+	remove(image_name);
+	rmdir(overlay_dir);
+
+	if (errors) {
+		fprintf(stderr, "\n***Detected %d ERRORs in floppy overlays!***\n\n", errors);
+	} else {
+		fprintf(stderr, "\nFinished without any errors!\n\n");
+	}
+	return errors;
+}
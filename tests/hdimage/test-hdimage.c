@@ -0,0 +1,610 @@
+/*
+ * Code to test the hard disk image access in src/hdImage.c
+ *
+ * Checks that reading and writing (with and without byte-swapping)
+ * gives the same results whether the image is memory mapped or
+ * accessed with stdio calls, also with a copy-on-write overlay file
+ * from src/diskOverlay.c, that overlay files are tied to their image,
+ * that src/hdc.c reads the partition table through the overlay,
+ * and that the SSE2 byte-swapping gives
+ * the same results as the generic one. With "--bench", times reading
+ * and writing a larger image both ways.
+ */
+#include <stdio.h>
+#include <time.h>
+#include <utime.h>
+#include "../../src/hdc.c"
+#include "../../src/hdImage.c"
+#include "../../src/diskOverlay.c"
+#include "../../src/utils.c"
+
+/* fake stuff needed by hdc.c & hdImage.c */
+CNF_PARAMS ConfigureParams;
+FILE *TraceFile;
+Uint64 LogTraceFlags;
+int nNumDrives;
+#if ENABLE_SMALL_MEM
+Uint8 *STRam;
+#else
+Uint8 STRam[16*1024*1024];
+#endif
+void FDC_ClearHdcIRQ(void) { }
+int FDC_DMA_GetMode(void) { return 0; }
+Uint32 FDC_GetDMAAddress(void) { return 0; }
+void FDC_SetDMAStatus(bool bError) { }
+void FDC_SetIRQ(Uint8 IRQ_Source) { }
+void FDC_WriteDMAAddress(Uint32 Address) { }
+off_t File_Length(const char *pszFileName) { return -1; }
+void File_ShrinkName(char *pDestFileName, const char *pSrcFileName, int maxlen) { }
+void Ncr5380_WriteByte(int addr, Uint8 byte) { }
+Uint8 Ncr5380_ReadByte(int addr) { return 0; }
+void Ncr5380_DmaTransfer_Falcon(void) { }
+bool STMemory_SafeCopy(Uint32 addr, Uint8 *src, unsigned int len, const char *name) { return false; }
+bool STMemory_CheckAreaType(Uint32 addr, int size, int mem_type) { return false; }
+void Statusbar_EnableHDLed(drive_led_t state) { }
+bool File_Lock(FILE *fp) { return true; }
+void File_UnLock(FILE *fp) { }
+bool File_DirExists(const char *psDirName) { return true; }
+void File_MakeAbsoluteName(char *pFileName) { }
+char *File_MakePath(const char *pDir, const char *pName, const char *pExt)
+{
+	char *path = malloc(strlen(pDir) + strlen(pName) + (pExt ? strlen(pExt) : 0) + 3);
+	sprintf(path, "%s/%s%s%s", pDir, pName, pExt ? "." : "", pExt ? pExt : "");
+	return path;
+}
+void Log_AlertDlg(LOGTYPE nType, const char *psFormat, ...) { }
+void Log_Printf(LOGTYPE nType, const char *psFormat, ...) { }
+
+#define IMAGE_SIZE	(256 * 1024)
+
+static char image_name[] = "/tmp/test-hdimage-XXXXXX";
+static char overlay_dir[] = "/tmp/test-overlay-XXXXXX";
+
+static Uint8 pattern(off_t i)
+{
+	return (i * 7 + (i >> 9)) & 0xff;
+}
+
+/* create image file with known contents */
+static bool create_image(off_t size)
+{
+	static Uint8 block[4096];
+	off_t pos;
+	FILE *fp;
+	int i;
+
+	fp = fopen(image_name, "wb");
+	if (!fp)
+		return false;
+	for (pos = 0; pos < size; pos += sizeof(block))
+	{
+		for (i = 0; i < (int)sizeof(block); i++)
+			block[i] = pattern(pos + i);
+		fwrite(block, sizeof(block), 1, fp);
+	}
+	return fclose(fp) == 0;
+}
+
+/* open image, optionally dropping its mapping to use stdio instead */
+static bool open_image(HD_IMAGE *img, off_t size, bool mapped)
+{
+	if (HDImage_Open(img, "TEST", image_name, size) != 0)
+		return false;
+#ifdef HAVE_MMAP
+	if (!mapped && img->map)
+	{
+		munmap(img->map, img->size);
+		img->map = NULL;
+	}
+	if (!mapped && img->overlay && img->overlay->map)
+	{
+		DISK_OVERLAY *ov = img->overlay;
+		int bitmap_size = (size / DISK_OVERLAY_BLOCK_SIZE + 8) / 8;
+		ov->bitmap = malloc(bitmap_size);
+		memcpy(ov->bitmap, ov->map + OVERLAY_HEADER_SIZE, bitmap_size);
+		munmap(ov->map, ov->data_offset + ov->size);
+		ov->map = NULL;
+	}
+#endif
+	return true;
+}
+
+/* check given buffer against the pattern at given image offset */
+static int check_data(const char *what, const Uint8 *buf, off_t offset, int len, bool swapped)
+{
+	int i;
+
+	for (i = 0; i < len; i++)
+	{
+		if (buf[i] != pattern(offset + (swapped ? i ^ 1 : i)))
+		{
+			fprintf(stderr, "ERROR: %s: byte %d at 0x%lx is 0x%02x, not 0x%02x\n",
+				what, i, (long)offset, buf[i], pattern(offset + (swapped ? i ^ 1 : i)));
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static int test_access(bool mapped)
+{
+	static Uint8 buf[8192], swapped[8192];
+	HD_IMAGE img;
+	off_t offset;
+	Uint8 *ptr;
+	int errors = 0;
+	FILE *fp;
+
+	fprintf(stderr, "- %s access\n", mapped ? "mapped" : "stdio");
+	if (!create_image(IMAGE_SIZE) || !open_image(&img, IMAGE_SIZE, mapped))
+	{
+		fprintf(stderr, "ERROR: creating/opening image failed\n");
+		return 1;
+	}
+#ifdef HAVE_MMAP
+	if (mapped && !img.map)
+	{
+		fprintf(stderr, "ERROR: image isn't mapped\n");
+		errors++;
+	}
+#endif
+
+	/* reads, as-is and byte-swapped */
+	for (offset = 0; offset < IMAGE_SIZE; offset += 512 * 5)
+	{
+		int len = offset + (int)sizeof(buf) <= IMAGE_SIZE ? (int)sizeof(buf) : IMAGE_SIZE - offset;
+		if (HDImage_Read(&img, offset, buf, len, false) != 0 ||
+		    HDImage_Read(&img, offset, swapped, len, true) != 0)
+		{
+			fprintf(stderr, "ERROR: reading 0x%lx failed\n", (long)offset);
+			errors++;
+			break;
+		}
+		errors += check_data("read", buf, offset, len, false);
+		errors += check_data("swapped read", swapped, offset, len, true);
+		ptr = HDImage_Map(&img, offset, len);
+		if (ptr && memcmp(ptr, buf, len) != 0)
+		{
+			fprintf(stderr, "ERROR: mapped data at 0x%lx differs\n", (long)offset);
+			errors++;
+		}
+	}
+
+	/* out of range accesses fail */
+	if (HDImage_Read(&img, IMAGE_SIZE - 512, buf, 1024, false) != -EINVAL ||
+	    HDImage_Write(&img, IMAGE_SIZE - 512, buf, 1024, false) != -EINVAL ||
+	    HDImage_Map(&img, IMAGE_SIZE - 512, 1024) != NULL)
+	{
+		fprintf(stderr, "ERROR: access past image end didn't fail\n");
+		errors++;
+	}
+
+	/* swapped write of swapped data, and plain write of plain data
+	 * restore the original contents, so they're visible in the file */
+	HDImage_Read(&img, 4096, swapped, 1024, true);
+	memset(buf, 0, sizeof(buf));
+	HDImage_Write(&img, 4096, buf, 1024, false);
+	HDImage_Write(&img, 4096, swapped, 1024, true);
+	HDImage_Read(&img, 8192, buf, 512, false);
+	HDImage_Write(&img, 8192, buf, 512, false);
+	if (!img.dirty)
+	{
+		fprintf(stderr, "ERROR: written image isn't dirty\n");
+		errors++;
+	}
+	HDImage_Flush(&img);
+	if (img.dirty)
+	{
+		fprintf(stderr, "ERROR: image is still dirty after flush\n");
+		errors++;
+	}
+
+	fp = fopen(image_name, "rb");
+	if (!fp || fseek(fp, 4096, SEEK_SET) != 0 || fread(buf, 1, 8192, fp) != 8192)
+	{
+		fprintf(stderr, "ERROR: reading image file failed\n");
+		errors++;
+	}
+	else
+	{
+		errors += check_data("written file", buf, 4096, 8192, false);
+	}
+	if (fp)
+		fclose(fp);
+
+	HDImage_Close(&img);
+	if (img.fp || img.map)
+	{
+		fprintf(stderr, "ERROR: closed image isn't cleared\n");
+		errors++;
+	}
+	return errors;
+}
+
+/* compare image contents read through HDImage_Read() against model */
+static int check_overlay(HD_IMAGE *img, const Uint8 *model, const char *what)
+{
+	static Uint8 buf[IMAGE_SIZE];
+
+	if (HDImage_Read(img, 0, buf, IMAGE_SIZE, false) != 0 ||
+	    memcmp(buf, model, IMAGE_SIZE) != 0)
+	{
+		fprintf(stderr, "ERROR: %s: overlaid image contents differ\n", what);
+		return 1;
+	}
+	return 0;
+}
+
+static int test_overlay(bool mapped)
+{
+	static Uint8 model[IMAGE_SIZE], data[4096];
+	char *delta_name;
+	HD_IMAGE img;
+	Uint8 *ptr;
+	int i, errors = 0;
+	FILE *fp;
+
+	fprintf(stderr, "- %s overlay\n", mapped ? "mapped" : "stdio");
+	for (i = 0; i < IMAGE_SIZE; i++)
+		model[i] = pattern(i);
+	for (i = 0; i < (int)sizeof(data); i++)
+		data[i] = i * 13 + 5;
+
+	DiskOverlay_SetDiscard(false);
+	if (!create_image(IMAGE_SIZE) || !open_image(&img, IMAGE_SIZE, mapped) || !img.overlay)
+	{
+		fprintf(stderr, "ERROR: creating/opening overlaid image failed\n");
+		return 1;
+	}
+	delta_name = strdup(img.overlay->filename);
+
+	/* aligned, unaligned (partial block) and byte-swapped writes */
+	HDImage_Write(&img, 8192, data, 2048, false);
+	memcpy(model + 8192, data, 2048);
+	HDImage_Write(&img, 20000, data, 300, false);
+	memcpy(model + 20000, data, 300);
+	HDImage_Write(&img, 65536 + 256, data, 1024, true);
+	HDImage_ByteSwapGeneric(model + 65536 + 256, data, 1024);
+	HDImage_Write(&img, IMAGE_SIZE - 512, data, 512, false);
+	memcpy(model + IMAGE_SIZE - 512, data, 512);
+	errors += check_overlay(&img, model, "after writes");
+
+	/* zero-copy access only for ranges that are all in base or overlay */
+	ptr = HDImage_Map(&img, 8192, 2048);
+	if (mapped && (!ptr || memcmp(ptr, data, 2048) != 0))
+	{
+		fprintf(stderr, "ERROR: overlay range mapping failed\n");
+		errors++;
+	}
+	if (HDImage_Map(&img, 8192 - 512, 1024) != NULL)
+	{
+		fprintf(stderr, "ERROR: mixed base / overlay range got mapped\n");
+		errors++;
+	}
+	HDImage_Close(&img);
+
+	/* base image needs to be intact */
+	fp = fopen(image_name, "rb");
+	if (!fp || fread(model, IMAGE_SIZE, 1, fp) != 1)
+	{
+		fprintf(stderr, "ERROR: reading base image failed\n");
+		errors++;
+	}
+	else
+	{
+		errors += check_data("base image", model, 0, IMAGE_SIZE, false);
+	}
+	if (fp)
+		fclose(fp);
+
+	/* changes need to persist over re-open */
+	memcpy(model + 8192, data, 2048);
+	memcpy(model + 20000, data, 300);
+	HDImage_ByteSwapGeneric(model + 65536 + 256, data, 1024);
+	memcpy(model + IMAGE_SIZE - 512, data, 512);
+	open_image(&img, IMAGE_SIZE, mapped);
+	errors += check_overlay(&img, model, "after re-open");
+	HDImage_Close(&img);
+
+	/* ...unless they're discarded */
+	DiskOverlay_SetDiscard(true);
+	open_image(&img, IMAGE_SIZE, mapped);
+	for (i = 0; i < IMAGE_SIZE; i++)
+		model[i] = pattern(i);
+	errors += check_overlay(&img, model, "with discard");
+	HDImage_Write(&img, 0, data, 512, false);
+	HDImage_Close(&img);
+	if (access(delta_name, F_OK) == 0)
+	{
+		fprintf(stderr, "ERROR: discarded overlay file '%s' still exists\n", delta_name);
+		errors++;
+		remove(delta_name);
+	}
+	free(delta_name);
+	DiskOverlay_SetDiscard(false);
+	return errors;
+}
+
+/* partitioning done within emulation needs to be seen on next start */
+static int test_overlay_partitions(void)
+{
+	static const char ids[2][4] = { "GEM", "BGM" };
+	Uint8 mbr[512];
+	char *delta_name;
+	HD_IMAGE img;
+	int i, parts, errors = 0;
+
+	fprintf(stderr, "- overlay partition table\n");
+	DiskOverlay_SetDiscard(false);
+	if (!create_image(IMAGE_SIZE) || !open_image(&img, IMAGE_SIZE, true))
+	{
+		fprintf(stderr, "ERROR: creating/opening overlaid image failed\n");
+		return 1;
+	}
+	parts = HDC_PartitionCount(&img, 0, NULL);
+	if (parts != 0)
+	{
+		fprintf(stderr, "ERROR: base image has %d partitions, not 0\n", parts);
+		errors++;
+	}
+
+	/* Atari MBR with two partitions */
+	memset(mbr, 0, sizeof(mbr));
+	for (i = 0; i < 2; i++)
+	{
+		mbr[0x1c6 + 12 * i] = 0x01;
+		memcpy(mbr + 0x1c7 + 12 * i, ids[i], 3);
+	}
+	HDImage_Write(&img, 0, mbr, sizeof(mbr), false);
+	HDImage_Close(&img);
+
+	open_image(&img, IMAGE_SIZE, false);
+	parts = HDC_PartitionCount(&img, 0, NULL);
+	if (parts != 2)
+	{
+		fprintf(stderr, "ERROR: overlaid image has %d partitions after re-open, not 2\n", parts);
+		errors++;
+	}
+	delta_name = strdup(img.overlay->filename);
+	HDImage_Close(&img);
+	remove(delta_name);
+	free(delta_name);
+	return errors;
+}
+
+/* copy image file contents to given file */
+static bool copy_image(const char *name)
+{
+	static Uint8 buf[IMAGE_SIZE];
+	FILE *in, *out;
+	bool ok;
+
+	in = fopen(image_name, "rb");
+	out = fopen(name, "wb");
+	ok = in && out && fread(buf, IMAGE_SIZE, 1, in) == 1 &&
+	     fwrite(buf, IMAGE_SIZE, 1, out) == 1;
+	if (in)
+		fclose(in);
+	if (out && fclose(out) != 0)
+		ok = false;
+	return ok;
+}
+
+/* return 0 if first block of overlay has given value, 1 otherwise */
+static int check_block(DISK_OVERLAY *ov, Uint8 value, const char *what)
+{
+	Uint8 buf[DISK_OVERLAY_BLOCK_SIZE];
+	int i;
+
+	memset(buf, 0, sizeof(buf));
+	if (ov && DiskOverlay_Read(ov, 0, buf, sizeof(buf)) == 0)
+	{
+		for (i = 0; i < (int)sizeof(buf) && buf[i] == value; i++)
+			;
+		if (i == (int)sizeof(buf))
+			return 0;
+	}
+	fprintf(stderr, "ERROR: %s: overlay block isn't 0x%02x\n", what, value);
+	return 1;
+}
+
+static int test_overlay_identity(void)
+{
+	static char other_dir[] = "/tmp/test-hdimage-dir-XXXXXX";
+	char other_name[FILENAME_MAX], *delta_name, *other_delta;
+	Uint8 block[DISK_OVERLAY_BLOCK_SIZE];
+	DISK_OVERLAY *ov, *other;
+	struct utimbuf times;
+	struct stat st;
+	int errors = 0;
+
+	fprintf(stderr, "- overlay identity\n");
+	DiskOverlay_SetDiscard(false);
+	snprintf(other_name, sizeof(other_name), "%s/%s",
+		 mkdtemp(other_dir), strrchr(image_name, '/') + 1);
+	if (!create_image(IMAGE_SIZE) || !copy_image(other_name))
+	{
+		fprintf(stderr, "ERROR: creating images failed\n");
+		return 1;
+	}
+
+	/* images with the same name and size in different directories */
+	ov = DiskOverlay_Open(image_name, IMAGE_SIZE);
+	other = DiskOverlay_Open(other_name, IMAGE_SIZE);
+	if (!ov || !other)
+	{
+		fprintf(stderr, "ERROR: opening overlays failed\n");
+		DiskOverlay_Close(ov);
+		DiskOverlay_Close(other);
+		return 1;
+	}
+	delta_name = strdup(ov->filename);
+	other_delta = strdup(other->filename);
+	if (strcmp(delta_name, other_delta) == 0)
+	{
+		fprintf(stderr, "ERROR: images in different directories share overlay '%s'\n",
+			delta_name);
+		errors++;
+	}
+	memset(block, 0x11, sizeof(block));
+	DiskOverlay_Write(ov, 0, block, sizeof(block));
+	memset(block, 0x22, sizeof(block));
+	DiskOverlay_Write(other, 0, block, sizeof(block));
+	DiskOverlay_Close(ov);
+	DiskOverlay_Close(other);
+
+	ov = DiskOverlay_Open(image_name, IMAGE_SIZE);
+	other = DiskOverlay_Open(other_name, IMAGE_SIZE);
+	errors += check_block(ov, 0x11, "first image");
+	errors += check_block(other, 0x22, "second image");
+	DiskOverlay_Close(ov);
+	DiskOverlay_Close(other);
+
+	/* replaced (same size) image discards overlay contents */
+	if (stat(image_name, &st) == 0)
+	{
+		times.actime = st.st_atime;
+		times.modtime = st.st_mtime - 60;
+		utime(image_name, &times);
+	}
+	ov = DiskOverlay_Open(image_name, IMAGE_SIZE);
+	if (!ov || DiskOverlay_Intersects(ov, 0, IMAGE_SIZE))
+	{
+		fprintf(stderr, "ERROR: overlay of replaced image wasn't discarded\n");
+		errors++;
+	}
+	DiskOverlay_Close(ov);
+
+	/* ...and so does size change, overlay file shrinking with it */
+	ov = DiskOverlay_Open(image_name, IMAGE_SIZE / 2);
+	if (!ov || stat(delta_name, &st) != 0 ||
+	    st.st_size != ov->data_offset + IMAGE_SIZE / 2)
+	{
+		fprintf(stderr, "ERROR: overlay of smaller image wasn't truncated\n");
+		errors++;
+	}
+	DiskOverlay_Close(ov);
+
+	remove(delta_name);
+	remove(other_delta);
+	free(delta_name);
+	free(other_delta);
+	remove(other_name);
+	rmdir(other_dir);
+	return errors;
+}
+
+static int test_byteswap(void)
+{
+	static Uint8 src[1024 + 16], generic[1024 + 16], vector[1024 + 16];
+	int i, start, len, errors = 0;
+
+	fprintf(stderr, "- byte-swap kernels\n");
+	for (i = 0; i < (int)sizeof(src); i++)
+		src[i] = pattern(i);
+
+	for (start = 0; start < 16; start++)
+	{
+		for (len = 0; len <= 1024; len += 2 + (len >> 4) * 2)
+		{
+			memset(generic, 0xaa, sizeof(generic));
+			memset(vector, 0xaa, sizeof(vector));
+			HDImage_ByteSwapGeneric(generic + start, src + start, len);
+			HDImage_ByteSwap(vector + start, src + start, len);
+			if (memcmp(generic, vector, sizeof(vector)) != 0)
+			{
+				fprintf(stderr, "ERROR: byte-swap of %d bytes at %d differs\n", len, start);
+				errors++;
+			}
+			errors += check_data("byte-swap", generic + start, start, len, true);
+		}
+	}
+	/* in place */
+	memcpy(vector, src, sizeof(src));
+	HDImage_ByteSwap(vector + 2, vector + 2, 1000);
+	errors += check_data("in place byte-swap", vector + 2, 2, 1000, true);
+	return errors;
+}
+
+/* time reading and writing whole image in 'len' byte blocks */
+static void bench(off_t size, int len, bool mapped, bool swap)
+{
+	static Uint8 buf[64 * 1024];
+	HD_IMAGE img;
+	struct timespec t0, t1;
+	off_t offset;
+	double rd, wr;
+
+	open_image(&img, size, mapped);
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (offset = 0; offset < size; offset += len)
+		HDImage_Read(&img, offset, buf, len, swap);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	rd = (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (offset = 0; offset < size; offset += len)
+		HDImage_Write(&img, offset, buf, len, swap);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	wr = (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6;
+	HDImage_Close(&img);
+
+	fprintf(stderr, "%-6s %-8s %6d bytes: read %7.1f ms, write %7.1f ms\n",
+		mapped ? "mapped" : "stdio", swap ? "swapped" : "as-is", len, rd, wr);
+}
+
+int main(int argc, const char *argv[])
+{
+	int fd, errors = 0;
+
+	fd = mkstemp(image_name);
+	if (fd < 0)
+	{
+		perror("mkstemp");
+		return 1;
+	}
+	close(fd);
+	ConfigureParams.HardDisk.nImageSync = HDSYNC_FLUSH;
+
+	if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+	{
+		const off_t size = 256 * 1024 * 1024;
+		int len;
+
+		/* sync only at the end, like with "--hd-sync flush" */
+		create_image(size);
+		for (len = 512; len <= 64 * 1024; len *= 8)
+		{
+			bench(size, len, false, false);
+			bench(size, len, true, false);
+			bench(size, len, false, true);
+			bench(size, len, true, true);
+		}
+		unlink(image_name);
+		return 0;
+	}
+
+	/* opening an image selects the byte-swap kernel */
+	errors += test_access(true);
+	errors += test_access(false);
+	errors += test_byteswap();
+
+	if (!mkdtemp(overlay_dir) || !DiskOverlay_SetDir(overlay_dir))
+	{
+		perror("mkdtemp");
+		return 1;
+	}
+	errors += test_overlay(true);
+	errors += test_overlay(false);
+	errors += test_overlay_identity();
+	errors += test_overlay_partitions();
+	rmdir(overlay_dir);
+	unlink(image_name);
+
+	if (errors) {
+		fprintf(stderr, "\n***Detected %d ERRORs in HD image access!***\n\n", errors);
+	} else {
+		fprintf(stderr, "\nFinished without any errors!\n\n");
+	}
+	return errors;
+}
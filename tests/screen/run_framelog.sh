@@ -0,0 +1,94 @@
+#!/bin/sh
+
+if [ $# -lt 2 ] || [ "$1" = "-h" ] || [ "$1" = "--help" ]; then
+	echo "Usage: $0 <hatari> <prg> ..."
+	exit 1
+fi
+
+hatari=$1
+shift
+if [ ! -x "$hatari" ]; then
+	echo "First parameter must point to valid hatari executable."
+	exit 1
+fi;
+
+prg=$1
+shift
+
+testdir=$(mktemp -d)
+
+export HATARI_TEST=screen
+export SDL_VIDEODRIVER=dummy
+export SDL_AUDIODRIVER=dummy
+unset TERM
+
+# Frame log needs to be the same regardless of frame skipping
+for skips in 0 4; do
+	mkdir "$testdir/$skips"
+	HOME="$testdir" $hatari --log-level fatal --sound off -z 1 --max-width 416 \
+		--bios-intercept on --statusbar off --drive-led off --fast-forward on \
+		--run-vbls 100 --frameskips $skips --tos none --screenshot-dir "$testdir" \
+		--frame-log "$testdir/$skips.log" --frame-dump-dir "$testdir/$skips" \
+		"$@" "$prg" > "$testdir/out.txt" 2>&1
+	exitstat=$?
+	if [ $exitstat -ne 0 ]; then
+		echo "Running hatari FAILED. Status=${exitstat}. Hatari output:"
+		cat "$testdir/out.txt"
+		rm -rf "$testdir"
+		exit 1
+	fi
+done
+
+frames=$(grep -c -v '^#' "$testdir/0.log")
+if [ "$frames" -lt 2 ]; then
+	echo "Test FAILED: frame log has too few frames:"
+	cat "$testdir/0.log"
+	rm -rf "$testdir"
+	exit 1
+fi
+
+if ! cmp "$testdir/0.log" "$testdir/4.log"; then
+	echo "Test FAILED: frame log differs with frame skipping:"
+	diff "$testdir/0.log" "$testdir/4.log"
+	rm -rf "$testdir"
+	exit 1
+fi
+
+# Preview mode frames need to be the same as with 1:1 screen settings above
+HOME="$testdir" $hatari --log-level info --sound off --bios-intercept on \
+	--run-vbls 100 --preview 4 --tos none --screenshot-dir "$testdir" \
+	--frame-log "$testdir/preview.log" "$@" "$prg" > "$testdir/out.txt" 2>&1
+exitstat=$?
+if [ $exitstat -ne 0 ]; then
+	echo "Running hatari in preview mode FAILED. Status=${exitstat}. Hatari output:"
+	cat "$testdir/out.txt"
+	rm -rf "$testdir"
+	exit 1
+fi
+
+if ! cmp "$testdir/0.log" "$testdir/preview.log"; then
+	echo "Test FAILED: frame log differs in preview mode:"
+	diff "$testdir/0.log" "$testdir/preview.log"
+	rm -rf "$testdir"
+	exit 1
+fi
+
+if ! grep -q "PREVIEW:" "$testdir/out.txt"; then
+	echo "Test FAILED: no preview mode timings in Hatari output:"
+	cat "$testdir/out.txt"
+	rm -rf "$testdir"
+	exit 1
+fi
+
+# every logged frame with a different hash needs to be saved
+dumps=$(ls "$testdir/0" | wc -l)
+hashes=$(grep -v '^#' "$testdir/0.log" | cut -d' ' -f2 | sort -u | wc -l)
+if [ "$dumps" -ne "$hashes" ]; then
+	echo "Test FAILED: $dumps frames saved for $hashes frame hashes."
+	rm -rf "$testdir"
+	exit 1
+fi
+
+echo "Test PASSED."
+rm -rf "$testdir"
+exit 0
@@ -0,0 +1,264 @@
+/*
+ * Code to test and benchmark Hatari bitplane to chunky and Falcon
+ * true color conversion kernels in src/screenPlanar.c
+ *
+ * Without arguments, checks results of all the kernels supported on
+ * the host against a reference implementation. With "--bench [rounds]"
+ * argument, times the kernels converting canned screen frames.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "main.h"
+#include "screenPlanar.h"
+
+#define MAX_BLOCKS 96
+#define MAX_PLANES 8
+
+static Uint8 planar[MAX_BLOCKS * MAX_PLANES * 2];
+static volatile Uint8 sink;	/* keeps compiler from optimizing conversions away */
+
+/* fill 'planar' with pseudo-random data */
+static void fill_planar(Uint32 seed)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(planar); i++) {
+		seed = seed * 1103515245 + 12345;
+		planar[i] = seed >> 16;
+	}
+}
+
+/* bit by bit conversion to compare against */
+static void reference(const Uint8 *src, int planes, int blocks, Uint8 *chunky)
+{
+	int b, p, x;
+	Uint16 word;
+
+	for (b = 0; b < blocks; b++) {
+		for (x = 0; x < 16; x++) {
+			chunky[x] = 0;
+			for (p = 0; p < planes; p++) {
+				word = (src[2*p] << 8) | src[2*p+1];
+				if (word & (0x8000 >> x))
+					chunky[x] |= 1 << p;
+			}
+		}
+		src += 2 * planes;
+		chunky += 16;
+	}
+}
+
+/* host formats for true color tests: ARGB, ABGR and RGB without alpha */
+static const SCREENPLANAR_RGB32 rgb32[] = {
+	{ 16, 8, 0, 0xff000000 },
+	{ 0, 8, 16, 0xff000000 },
+	{ 24, 16, 8, 0 },
+};
+
+/* RGB565 to 8-bit channels conversion to compare against */
+static Uint32 reference_hicolor(const Uint8 *src, const SCREENPLANAR_RGB32 *fmt)
+{
+	Uint16 word = (src[0] << 8) | src[1];
+	Uint8 r = word >> 11, g = (word >> 5) & 0x3f, b = word & 0x1f;
+
+	r = (r << 3) | (r >> 2);
+	g = (g << 2) | (g >> 4);
+	b = (b << 3) | (b >> 2);
+	return (r << fmt->Rshift) | (g << fmt->Gshift) | (b << fmt->Bshift) | fmt->Amask;
+}
+
+static int test_hicolor(const char *name)
+{
+	Uint32 result32[MAX_BLOCKS * 8 + 1];
+	Uint16 result16[MAX_BLOCKS * 8 + 1];
+	int count, f, i, errors = 0;
+
+	fill_planar(42);
+	for (count = 1; count <= MAX_BLOCKS * 8; count += 13) {
+		memset(result16, 0xaa, sizeof(result16));
+		ScreenPlanar_HiColorTo16bpp(planar, count, result16);
+		for (i = 0; i < count; i++) {
+			if (result16[i] != ((planar[2*i] << 8) | planar[2*i+1]))
+				break;
+		}
+		if (i < count || result16[count] != 0xaaaa) {
+			fprintf(stderr, "  ***%s 16-bit true color kernel ERROR with %d pixels***\n",
+				name, count);
+			errors++;
+		}
+		for (f = 0; f < ARRAY_SIZE(rgb32); f++) {
+			memset(result32, 0xaa, sizeof(result32));
+			ScreenPlanar_HiColorTo32bpp(planar, count, result32, &rgb32[f]);
+			for (i = 0; i < count; i++) {
+				if (result32[i] != reference_hicolor(planar + 2*i, &rgb32[f]))
+					break;
+			}
+			if (i < count || result32[count] != 0xaaaaaaaa) {
+				fprintf(stderr, "  ***%s 32-bit true color kernel ERROR with %d pixels, format %d***\n",
+					name, count, f);
+				errors++;
+			}
+		}
+	}
+	return errors;
+}
+
+static int test_kernel(const char *name)
+{
+	Uint8 expected[MAX_BLOCKS * 16], result[MAX_BLOCKS * 16 + 16];
+	int planes, blocks, seed, errors = 0;
+
+	for (seed = 0; seed < 16; seed++) {
+		fill_planar(seed);
+		for (planes = 1; planes <= MAX_PLANES; planes++) {
+			for (blocks = 1; blocks <= MAX_BLOCKS; blocks += 19) {
+				reference(planar, planes, blocks, expected);
+				/* check also for writes past the end */
+				memset(result, 0xaa, sizeof(result));
+				ScreenPlanar_ToChunky(planar, planes, blocks, result);
+				if (memcmp(result, expected, blocks * 16) != 0 ||
+				    result[blocks * 16] != 0xaa) {
+					fprintf(stderr, "  ***%s kernel ERROR with %d planes, %d blocks***\n",
+						name, planes, blocks);
+					errors++;
+				}
+			}
+		}
+	}
+	return errors;
+}
+
+/* convert canned frames of given size, return used CPU time in ms */
+static long bench_frame(int planes, int linebytes, int lines, int rounds)
+{
+	Uint8 *frame, chunky[MAX_BLOCKS * 16];
+	int blocks = linebytes / (2 * planes);
+	clock_t start;
+	long ms;
+	int i, y;
+
+	frame = malloc(linebytes * lines);
+	if (!frame)
+		return -1;
+	for (i = 0; i < linebytes * lines; i++)
+		frame[i] = i * 2654435761u >> 24;
+
+	start = clock();
+	for (i = 0; i < rounds; i++) {
+		for (y = 0; y < lines; y++)
+			ScreenPlanar_ToChunky(frame + y * linebytes, planes, blocks, chunky);
+		sink = chunky[0];
+	}
+	ms = (clock() - start) * 1000 / CLOCKS_PER_SEC;
+	free(frame);
+	return ms;
+}
+
+/* convert canned true color frames of given size to 16 or 32 bits
+ * per host pixel, return used CPU time in ms
+ */
+static long bench_hicolor(int hostbpp, int width, int lines, int rounds)
+{
+	Uint8 *frame;
+	Uint32 *line;
+	clock_t start;
+	long ms;
+	int i, y;
+
+	frame = malloc(width * 2 * lines);
+	line = malloc(width * 4);
+	if (!frame || !line) {
+		free(frame);
+		return -1;
+	}
+	for (i = 0; i < width * 2 * lines; i++)
+		frame[i] = i * 2654435761u >> 24;
+
+	start = clock();
+	for (i = 0; i < rounds; i++) {
+		for (y = 0; y < lines; y++) {
+			if (hostbpp == 16)
+				ScreenPlanar_HiColorTo16bpp(frame + y * width * 2, width,
+				                            (Uint16 *)line);
+			else
+				ScreenPlanar_HiColorTo32bpp(frame + y * width * 2, width,
+				                            line, &rgb32[0]);
+		}
+		sink = line[0];
+	}
+	ms = (clock() - start) * 1000 / CLOCKS_PER_SEC;
+	free(frame);
+	free(line);
+	return ms;
+}
+
+static void bench_kernel(const char *name, int rounds)
+{
+	static const struct {
+		const char *desc;
+		int planes, linebytes, lines;
+	} frames[] = {
+		{ "ST low overscan  416x276x4", 4, 208, 276 },
+		{ "ST medium        640x200x2", 2, 160, 200 },
+		{ "TT low           320x480x8", 8, 320, 480 },
+		{ "Falcon           640x480x4", 4, 320, 480 },
+		{ "Falcon           768x576x8", 8, 768, 576 },
+	};
+	static const struct {
+		const char *desc;
+		int hostbpp, width, lines;
+	} hiframes[] = {
+		{ "Falcon TC->16   320x240x16", 16, 320, 240 },
+		{ "Falcon TC->32   320x240x16", 32, 320, 240 },
+		{ "Falcon TC->32   640x480x16", 32, 640, 480 },
+	};
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(frames); i++) {
+		fprintf(stderr, "  %-8s %s: %ld ms / %d frames\n", name,
+			frames[i].desc, bench_frame(frames[i].planes,
+			frames[i].linebytes, frames[i].lines, rounds), rounds);
+	}
+	for (i = 0; i < ARRAY_SIZE(hiframes); i++) {
+		fprintf(stderr, "  %-8s %s: %ld ms / %d frames\n", name,
+			hiframes[i].desc, bench_hicolor(hiframes[i].hostbpp,
+			hiframes[i].width, hiframes[i].lines, rounds), rounds);
+	}
+}
+
+int main(int argc, const char *argv[])
+{
+	int kernel, tests = 0, errors = 0, rounds = 0;
+	const char *name;
+
+	if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+		rounds = argc > 2 ? atoi(argv[2]) : 1000;
+
+	for (kernel = PLANAR_KERNEL_AUTO + 1; kernel < PLANAR_KERNEL_COUNT; kernel++) {
+		name = ScreenPlanar_SelectKernel(kernel);
+		if (!name)
+			continue;
+		if (rounds) {
+			bench_kernel(name, rounds);
+			continue;
+		}
+		fprintf(stderr, "- %s kernel\n", name);
+		errors += test_kernel(name);
+		errors += test_hicolor(name);
+		tests++;
+	}
+	if (rounds)
+		return 0;
+
+	name = ScreenPlanar_Init();
+	fprintf(stderr, "Auto-selected kernel: %s\n", name);
+
+	if (errors) {
+		fprintf(stderr, "\n***Detected %d ERRORs in %d tested kernels!***\n\n",
+			errors, tests);
+	} else {
+		fprintf(stderr, "\nFinished without any errors!\n\n");
+	}
+	return errors;
+}
@@ -0,0 +1,309 @@
+/*
+ * Code to test and benchmark Hatari CPU screen scaling in src/screenScale.c
+ *
+ * Without arguments, checks results of all the scaling kernels supported
+ * on the host against reference implementations. With "--bench [rounds]"
+ * argument, times each scaling mode with canned screen frames.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "main.h"
+#include "screenScale.h"
+
+#define AMASK 0xff000000
+
+static volatile Uint32 sink;	/* keeps compiler from optimizing scaling away */
+
+/* pseudo-random frame with some pixel runs, like in real screens */
+static Uint32 *make_frame(int w, int h, Uint32 seed)
+{
+	Uint32 *frame, pixel = 0;
+	int i;
+
+	frame = malloc(w * h * sizeof(Uint32));
+	if (!frame)
+		return NULL;
+	for (i = 0; i < w * h; i++) {
+		seed = seed * 1103515245 + 12345;
+		if ((seed >> 28) < 4)
+			pixel = (seed >> 4) | AMASK;
+		frame[i] = pixel;
+	}
+	return frame;
+}
+
+/* per channel blend to compare against */
+static Uint32 reference_blend(Uint32 a, Uint32 b, int weight)
+{
+	Uint32 result = 0, ca, cb;
+	int shift;
+
+	for (shift = 0; shift < 32; shift += 8) {
+		ca = (a >> shift) & 0xff;
+		cb = (b >> shift) & 0xff;
+		result |= ((ca * (256 - weight) + cb * weight + 128) >> 8) << shift;
+	}
+	return result;
+}
+
+static Uint32 reference_dim(Uint32 p)
+{
+	Uint32 result = 0, c;
+	int shift;
+
+	for (shift = 0; shift < 32; shift += 8) {
+		c = (p >> shift) & 0xff;
+		result |= ((c + (c + 1) / 2 + 1) / 2) << shift;
+	}
+	return result | AMASK;
+}
+
+static int test_rows(const char *name)
+{
+	static SCREENSCALE_TAP taps[64];
+	Uint32 *a, *b, out[5*64];
+	int i, n, w, errors = 0;
+
+	a = make_frame(64, 1, 1);
+	b = make_frame(64, 1, 2);
+	if (!a || !b)
+		return 1;
+
+	/* odd counts to check also the left-overs */
+	for (n = 1; n <= 63; n += 31) {
+		for (w = 1; w <= 5; w++) {
+			ScreenScale_RowNearest(a, n, w, out);
+			for (i = 0; i < n * w; i++) {
+				if (out[i] != a[i / w]) {
+					fprintf(stderr, "ERROR: %s nearest x%d, pixel %d\n", name, w, i);
+					errors++;
+					break;
+				}
+			}
+		}
+		ScreenScale_RowDim(a, n, AMASK, out);
+		for (i = 0; i < n; i++) {
+			if (out[i] != reference_dim(a[i])) {
+				fprintf(stderr, "ERROR: %s dim, pixel %d: 0x%08x != 0x%08x\n",
+					name, i, out[i], reference_dim(a[i]));
+				errors++;
+				break;
+			}
+		}
+		for (w = 0; w <= 256; w += 32) {
+			ScreenScale_RowBlend(a, b, w, n, out);
+			for (i = 0; i < n; i++) {
+				if (out[i] != reference_blend(a[i], b[i], w)) {
+					fprintf(stderr, "ERROR: %s blend %d/256, pixel %d\n", name, w, i);
+					errors++;
+					break;
+				}
+			}
+		}
+		for (i = 0; i < n; i++) {
+			taps[i].index = (i * 7) % 63;
+			taps[i].weight = (i % 3) ? (i * 37) % 257 : 0;
+		}
+		ScreenScale_RowLinear(a, taps, n, out);
+		for (i = 0; i < n; i++) {
+			if (out[i] != reference_blend(a[taps[i].index], a[taps[i].index + 1],
+						      taps[i].weight)) {
+				fprintf(stderr, "ERROR: %s linear, pixel %d\n", name, i);
+				errors++;
+				break;
+			}
+		}
+	}
+	free(a);
+	free(b);
+	return errors;
+}
+
+/* scale 'src' frame with given mode into 'dst', in 'step' rows at a time */
+static void scale_frame(int mode, const Uint32 *src, int sw, int sh,
+			Uint32 *dst, int dw, int dh, int step, SDL_Rect *area)
+{
+	SDL_Rect rect;
+	int y;
+
+	if (!ScreenScale_SetSize(mode, sw, sh, dw, dh, AMASK, area)) {
+		fprintf(stderr, "ERROR: scaler setup failed\n");
+		exit(1);
+	}
+	memset(dst, 0, dw * dh * sizeof(Uint32));
+	for (y = 0; y < sh; y += step) {
+		ScreenScale_Rows((const Uint8 *)src, sw * sizeof(Uint32), y, step,
+				 (Uint8 *)dst, dw * sizeof(Uint32), &rect);
+	}
+}
+
+static int test_modes(const char *name)
+{
+	const int sw = 40, sh = 30, dw = 130, dh = 100;
+	Uint32 *src, *dst, *full, expect;
+	SDL_Rect area;
+	int x, y, f, errors = 0;
+
+	src = make_frame(sw, sh, 3);
+	dst = malloc(dw * dh * sizeof(Uint32));
+	full = malloc(dw * dh * sizeof(Uint32));
+	if (!src || !dst || !full)
+		return 1;
+
+	/* integer modes: factor 3 (limited by width), centered */
+	for (f = SCALE_MODE_NEAREST; f <= SCALE_MODE_SCANLINES; f++) {
+		scale_frame(f, src, sw, sh, dst, dw, dh, 7, &area);
+		if (area.w != 3 * sw || area.h != 3 * sh || area.x != 5 || area.y != 5) {
+			fprintf(stderr, "ERROR: %s mode %d area %dx%d+%d+%d\n", name, f,
+				area.w, area.h, area.x, area.y);
+			errors++;
+			continue;
+		}
+		for (y = 0; y < area.h; y++) {
+			for (x = 0; x < area.w; x++) {
+				expect = src[(y / 3) * sw + x / 3];
+				if (f == SCALE_MODE_SCANLINES && y % 3 == 2)
+					expect = reference_dim(expect);
+				if (dst[(area.y + y) * dw + area.x + x] != expect) {
+					fprintf(stderr, "ERROR: %s mode %d pixel %d,%d\n", name, f, x, y);
+					errors++;
+					y = area.h;
+					break;
+				}
+			}
+		}
+	}
+
+	/* sharp-bilinear with an integer factor is same as nearest */
+	scale_frame(SCALE_MODE_NEAREST, src, sw, sh, full, 120, dh, sh, &area);
+	scale_frame(SCALE_MODE_SHARP, src, sw, sh, dst, 120, dh, 4, &area);
+	if (memcmp(dst, full, 120 * dh * sizeof(Uint32)) != 0) {
+		fprintf(stderr, "ERROR: %s integer sharp scaling differs from nearest\n", name);
+		errors++;
+	}
+
+	/* non-integer sharp scaling done in parts needs to match doing it at once */
+	scale_frame(SCALE_MODE_SHARP, src, sw, sh, full, 97, 71, sh, &area);
+	scale_frame(SCALE_MODE_SHARP, src, sw, sh, dst, 97, 71, 3, &area);
+	if (area.w != 95 || area.h != 71 || memcmp(dst, full, 97 * 71 * sizeof(Uint32)) != 0) {
+		fprintf(stderr, "ERROR: %s partial sharp scaling differs (area %dx%d)\n",
+			name, area.w, area.h);
+		errors++;
+	}
+	/* black to white edge is blurred only over about one pixel,
+	 * not over the whole 2.4x scaling factor like with bilinear
+	 */
+	for (y = 0; y < sh; y++)
+		for (x = 0; x < sw; x++)
+			src[y * sw + x] = x < sw / 2 ? AMASK : 0xffffffff;
+	scale_frame(SCALE_MODE_SHARP, src, sw, sh, dst, 97, 71, sh, &area);
+	f = 0;
+	for (x = 0; x < area.w; x++) {
+		expect = dst[(area.y + area.h / 2) * 97 + area.x + x];
+		if (expect != AMASK && expect != 0xffffffff)
+			f++;
+	}
+	if (f < 1 || f > 2) {
+		fprintf(stderr, "ERROR: %s sharp scaling edge is %d pixels wide\n", name, f);
+		errors++;
+	}
+
+	ScreenScale_UnInit();
+	free(src);
+	free(dst);
+	free(full);
+	return errors;
+}
+
+/* scale canned frames with given mode, return used CPU time in ms */
+static long bench_mode(int mode, int sw, int sh, int dw, int dh, int rounds)
+{
+	Uint32 *src, *dst;
+	SDL_Rect area, rect;
+	clock_t start;
+	long ms;
+	int i;
+
+	src = make_frame(sw, sh, 4);
+	dst = malloc(dw * dh * sizeof(Uint32));
+	if (!src || !dst || !ScreenScale_SetSize(mode, sw, sh, dw, dh, AMASK, &area)) {
+		free(src);
+		free(dst);
+		return -1;
+	}
+	start = clock();
+	for (i = 0; i < rounds; i++) {
+		ScreenScale_Rows((const Uint8 *)src, sw * sizeof(Uint32), 0, sh,
+				 (Uint8 *)dst, dw * sizeof(Uint32), &rect);
+		sink = dst[(area.y + area.h / 2) * dw + area.x + area.w / 2];
+	}
+	ms = (clock() - start) * 1000 / CLOCKS_PER_SEC;
+	ScreenScale_UnInit();
+	free(src);
+	free(dst);
+	return ms;
+}
+
+static void bench_kernel(const char *name, int rounds)
+{
+	static const struct {
+		const char *desc;
+		int mode, sw, sh, dw, dh;
+	} frames[] = {
+		{ "nearest   640x400 -> x2 ", SCALE_MODE_NEAREST, 640, 400, 1280, 800 },
+		{ "nearest   640x400 -> x3 ", SCALE_MODE_NEAREST, 640, 400, 1920, 1200 },
+		{ "nearest   832x552 -> x3 ", SCALE_MODE_NEAREST, 832, 552, 2496, 1656 },
+		{ "scanlines 640x400 -> x3 ", SCALE_MODE_SCANLINES, 640, 400, 1920, 1200 },
+		{ "scanlines 832x552 -> x3 ", SCALE_MODE_SCANLINES, 832, 552, 2496, 1656 },
+		{ "sharp     640x400 -> x3 ", SCALE_MODE_SHARP, 640, 400, 1920, 1200 },
+		{ "sharp     640x400 -> 1080", SCALE_MODE_SHARP, 640, 400, 1920, 1080 },
+		{ "sharp     832x552 -> 1080", SCALE_MODE_SHARP, 832, 552, 1920, 1080 },
+		{ "sharp     832x552 -> 1440", SCALE_MODE_SHARP, 832, 552, 2560, 1440 },
+	};
+	long ms;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(frames); i++) {
+		ms = bench_mode(frames[i].mode, frames[i].sw, frames[i].sh,
+				frames[i].dw, frames[i].dh, rounds);
+		fprintf(stderr, "  %-8s %s: %ld ms / %d frames (%.1f FPS)\n", name,
+			frames[i].desc, ms, rounds, ms > 0 ? rounds * 1000.0 / ms : 0.0);
+	}
+}
+
+int main(int argc, const char *argv[])
+{
+	int kernel, tests = 0, errors = 0, rounds = 0;
+	const char *name;
+
+	if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+		rounds = argc > 2 ? atoi(argv[2]) : 100;
+
+	for (kernel = SCALE_KERNEL_AUTO + 1; kernel < SCALE_KERNEL_COUNT; kernel++) {
+		name = ScreenScale_SelectKernel(kernel);
+		if (!name)
+			continue;
+		if (rounds) {
+			bench_kernel(name, rounds);
+			continue;
+		}
+		fprintf(stderr, "- %s kernel\n", name);
+		errors += test_rows(name);
+		errors += test_modes(name);
+		tests++;
+	}
+	if (rounds)
+		return 0;
+
+	name = ScreenScale_Init();
+	fprintf(stderr, "Auto-selected kernel: %s\n", name);
+
+	if (errors) {
+		fprintf(stderr, "\n***Detected %d ERRORs in %d tested kernels!***\n\n",
+			errors, tests);
+	} else {
+		fprintf(stderr, "\nFinished without any errors!\n\n");
+	}
+	return errors;
+}
@@ -0,0 +1,79 @@
+#!/bin/sh
+
+if [ $# -lt 1 ] || [ "$1" = "-h" ] || [ "$1" = "--help" ]; then
+	echo "Usage: $0 <hatari>"
+	exit 1;
+fi
+
+hatari=$1
+shift
+if [ ! -x "$hatari" ]; then
+	echo "First parameter must point to valid hatari executable."
+	exit 1;
+fi;
+
+basedir=$(dirname "$0")
+testdir=$(mktemp -d)
+
+remove_temp() {
+  rm -rf "$testdir"
+}
+trap remove_temp EXIT
+
+export HATARI_TEST=sound
+export SDL_VIDEODRIVER=dummy
+export SDL_AUDIODRIVER=dummy
+
+# Offline sound rendering needs to produce the same samples regardless
+# of emulation speed, also in fast forward turbo mode
+for speed in normal fast turbo; do
+	case $speed in
+		normal) opts="--fast-forward off" ;;
+		fast) opts="--fast-forward on" ;;
+		turbo) opts="--fast-forward on --fast-forward-turbo 4" ;;
+	esac
+	HOME="$testdir" $hatari --log-level warn --sound 44100 --sound-offline on \
+		--sound-record "$testdir/$speed.wav" --run-vbls 50 --tos none \
+		$opts "$@" "$basedir/ymsweep.prg" > "$testdir/log.txt" 2>&1
+	exitstat=$?
+	if [ $exitstat -ne 0 ]; then
+		echo "Test FAILED, Hatari returned error status ${exitstat}."
+		cat "$testdir/log.txt"
+		exit 1
+	fi
+done
+
+# WAV header is 44 bytes, 50 VBLs at 60 Hz should give about 36750 samples
+bytes=$(tail -c +45 "$testdir/normal.wav" | tr -d '\000' | wc -c)
+if [ "$bytes" -lt 100000 ]; then
+	echo "Test FAILED, WAV file is (mostly) silent or too short: $bytes non-zero bytes."
+	exit 1
+fi
+
+for speed in fast turbo; do
+	if ! cmp "$testdir/normal.wav" "$testdir/$speed.wav"; then
+		echo "Test FAILED, sound recorded in '$speed' mode differs."
+		exit 1
+	fi
+done
+
+# Rendering YM register dump of the same run needs to give identical WAV
+HOME="$testdir" $hatari --log-level warn --sound 44100 --sound-offline on \
+	--sound-record "$testdir/dump.ymd" --run-vbls 50 --tos none \
+	"$@" "$basedir/ymsweep.prg" > "$testdir/log.txt" 2>&1 &&
+HOME="$testdir" $hatari --log-level warn --sound 44100 \
+	--sound-record "$testdir/render.wav" --ym-render "$testdir/dump.ymd" \
+	>> "$testdir/log.txt" 2>&1
+exitstat=$?
+if [ $exitstat -ne 0 ]; then
+	echo "Test FAILED, YM register dump rendering returned error status ${exitstat}."
+	cat "$testdir/log.txt"
+	exit 1
+fi
+if ! cmp "$testdir/normal.wav" "$testdir/render.wav"; then
+	echo "Test FAILED, WAV rendered from YM register dump differs."
+	exit 1
+fi
+
+echo "Test PASSED."
+exit 0
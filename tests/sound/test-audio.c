@@ -0,0 +1,215 @@
+/*
+ * Code to test the audio callback in src/audio.c
+ *
+ * Feeds the sample ring buffer like emulation does (a frame worth
+ * of samples per VBL) and calls the audio callback like the host
+ * audio device does, with their clocks drifting apart, and checks
+ * that the played sound stays continuous, and that the callback
+ * statistics account for what happened.
+ */
+#include <stdio.h>
+#include "../../src/audio.c"
+
+/* fake stuff needed by audio.c */
+CNF_PARAMS ConfigureParams;
+int nScreenRefreshRate = 50;
+int YM2149_LPF_Filter;
+Sint16 AudioMixBuffer[AUDIOMIXBUFFER_SIZE][2];
+SDL_atomic_t AudioMixBuffer_nWritten;
+SDL_atomic_t AudioMixBuffer_nRead;
+void Crossbar_Compute_Ratio(void) { }
+void DmaSnd_Init_Bass_and_Treble_Tables(void) { }
+void Log_Printf(LOGTYPE nType, const char *psFormat, ...) { }
+
+#define CALLBACK_LEN	1024
+#define SILENCE		0	/* produced samples are never silent */
+
+static Uint32 produced;		/* samples produced so far */
+static Sint16 last;		/* last played sample */
+
+/* triangle wave between 1000 and 17000, changing by one per sample */
+static Sint16 wave(Uint32 n)
+{
+	n %= 32000;
+	return 1000 + (n < 16000 ? n : 32000 - n);
+}
+
+static void produce(int count)
+{
+	int i, idx;
+
+	for (i = 0; i < count; i++) {
+		idx = (produced + i) & AUDIOMIXBUFFER_SIZE_MASK;
+		AudioMixBuffer[idx][0] = AudioMixBuffer[idx][1] = wave(produced + i);
+	}
+	produced += count;
+	SDL_AtomicAdd(&AudioMixBuffer_nWritten, count);
+}
+
+static int available(void)
+{
+	return SDL_AtomicGet(&AudioMixBuffer_nWritten) - SDL_AtomicGet(&AudioMixBuffer_nRead);
+}
+
+/* play one callback worth of samples, return number of jumps in them */
+static int play(Sint16 out[CALLBACK_LEN][2], bool exact)
+{
+	Uint32 first = SDL_AtomicGet(&AudioMixBuffer_nRead);
+	int i, jumps = 0;
+
+	Audio_CallBack(NULL, (Uint8 *)out, CALLBACK_LEN * 4);
+	for (i = 0; i < CALLBACK_LEN; i++) {
+		if (out[i][0] != out[i][1] ||
+		    (exact && out[i][0] != wave(first + i)) ||
+		    (!exact && abs(out[i][0] - last) > 2))
+			jumps++;
+		last = out[i][0];
+	}
+	return jumps;
+}
+
+static void reset(void)
+{
+	SDL_AtomicSet(&AudioMixBuffer_nWritten, 0);
+	SDL_AtomicSet(&AudioMixBuffer_nRead, 0);
+	nAudioPhase = 0;
+	bAudioRefill = true;
+	produced = 0;
+	last = wave(0);
+	memset(&AudioStats, 0, sizeof(AudioStats));
+}
+
+/* check that the callback statistics add up, return number of errors */
+static int check_stats(void)
+{
+	Uint32 histo = 0;
+	int i;
+
+	for (i = 0; i < AUDIO_FILL_HISTO_SIZE; i++)
+		histo += AudioStats.FillHisto[i];
+	if (histo != AudioStats.nCallbacks) {
+		fprintf(stderr, "ERROR: fill histogram has %u callbacks, not %u\n",
+			histo, AudioStats.nCallbacks);
+		return 1;
+	}
+	if (AudioStats.nConsumed + AudioStats.nSkipped != (Uint32)SDL_AtomicGet(&AudioMixBuffer_nRead)) {
+		fprintf(stderr, "ERROR: %u samples consumed and %u skipped, but %u read\n",
+			AudioStats.nConsumed, AudioStats.nSkipped,
+			SDL_AtomicGet(&AudioMixBuffer_nRead));
+		return 1;
+	}
+	return 0;
+}
+
+/* emulate given number of seconds with host clock running 'drift' faster,
+ * return number of callbacks which had discontinuities after settling down */
+static int run(double seconds, double drift, bool exact)
+{
+	static Sint16 out[CALLBACK_LEN][2];
+	int frame = nAudioFrequency / nScreenRefreshRate;
+	double host = 0, next = 0;
+	int vbl, errors = 0, jumps;
+
+	for (vbl = 0; vbl < seconds * nScreenRefreshRate; vbl++) {
+		produce(frame);
+		host += frame / (1.0 + drift);
+		while (next < host) {
+			jumps = play(out, exact);
+			/* allow a few seconds for the rate to settle */
+			if (jumps && vbl > 5 * nScreenRefreshRate) {
+				fprintf(stderr, "ERROR: %d jumps at VBL %d (available %d)\n",
+					jumps, vbl, available());
+				errors++;
+			}
+			next += CALLBACK_LEN;
+		}
+	}
+	return errors;
+}
+
+int main(int argc, const char *argv[])
+{
+	static Sint16 out[CALLBACK_LEN][2];
+	AUDIO_STATS stats;
+	int target, before, i, errors = 0;
+	double drift;
+
+	SoundBufferSize = CALLBACK_LEN;
+	target = SoundBufferSize + nAudioFrequency / nScreenRefreshRate;
+
+	/* with sound sync, samples need to be played as-is */
+	fprintf(stderr, "- sound sync\n");
+	ConfigureParams.Sound.bEnableSoundSync = true;
+	reset();
+	errors += run(20, 0.0, true);
+	errors += check_stats();
+
+	/* without it, read rate needs to follow drift of the host clock
+	 * (which would run out of samples or fill the buffer within a minute)
+	 */
+	ConfigureParams.Sound.bEnableSoundSync = false;
+	for (drift = -0.004; drift <= 0.004; drift += 0.002) {
+		fprintf(stderr, "- %+.1f%% host clock drift\n", drift * 100);
+		reset();
+		errors += run(120, drift, false);
+		errors += check_stats();
+		if (abs(available() - target) > target) {
+			fprintf(stderr, "ERROR: %d samples buffered, target %d\n",
+				available(), target);
+			errors++;
+		}
+	}
+
+	/* after running out of samples, playing resumes
+	 * only when there's enough of them again
+	 */
+	fprintf(stderr, "- refill after underrun\n");
+	Audio_GetStats(&stats);
+	for (i = 0; i < 3; i++)
+		play(out, false);
+	if (!bAudioRefill || out[CALLBACK_LEN-1][0] != SILENCE) {
+		fprintf(stderr, "ERROR: no silence after underrun\n");
+		errors++;
+	}
+	if (AudioStats.nUnderruns != stats.nUnderruns + 1 ||
+	    AudioStats.nRefills == stats.nRefills) {
+		fprintf(stderr, "ERROR: %u underruns and %u refill callbacks counted\n",
+			AudioStats.nUnderruns - stats.nUnderruns,
+			AudioStats.nRefills - stats.nRefills);
+		errors++;
+	}
+	for (;;) {
+		produce(100);
+		before = available();
+		play(out, false);
+		if ((out[0][0] != SILENCE) != (before >= target)) {
+			fprintf(stderr, "ERROR: playing %s with %d samples\n",
+				out[0][0] == SILENCE ? "didn't resume" : "resumed", before);
+			errors++;
+		}
+		if (before >= target)
+			break;
+	}
+
+	/* too many samples are skipped to the most recent ones */
+	fprintf(stderr, "- overrun\n");
+	produce(AUDIOMIXBUFFER_SIZE - 2 * target);
+	Audio_GetStats(&stats);
+	play(out, false);
+	if (available() > target) {
+		fprintf(stderr, "ERROR: %d samples buffered after overrun\n", available());
+		errors++;
+	}
+	if (AudioStats.nSkips != stats.nSkips + 1 || AudioStats.FillHisto[AUDIO_FILL_HISTO_SIZE-1] == 0) {
+		fprintf(stderr, "ERROR: overrun not counted\n");
+		errors++;
+	}
+	errors += check_stats();
+
+	if (errors) {
+		fprintf(stderr, "\n***Detected %d ERRORs in audio callback!***\n\n", errors);
+	} else {
+		fprintf(stderr, "\nFinished without any errors!\n\n");
+	}
+	return errors;
+}
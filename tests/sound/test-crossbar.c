@@ -0,0 +1,431 @@
+/*
+ * Code to test Hatari Falcon crossbar block mode in src/falcon/crossbar.c
+ *
+ * Runs the same random sequence of crossbar register accesses and sound
+ * sample generation twice, once with each crossbar clock tick handled by
+ * its own interrupt and once with the ticks handled in blocks, and checks
+ * that DMA transfers, DSP SSI transfers, MFP interrupt lines, frame counter
+ * reads and generated samples are identical. With "--bench [seconds]"
+ * argument, times emulated DMA sound playback in both modes.
+ */
+#include <stdio.h>
+#include <time.h>
+#include <inttypes.h>
+
+/* crossbar.c is included to access its internal state */
+#include "../../src/falcon/crossbar.c"
+
+/* fake stuff needed by crossbar.c */
+#if ENABLE_SMALL_MEM
+static Uint8 iomem[0x10000];
+uae_u8 *IOmemory = iomem;
+#else
+Uint8 STRam[16*1024*1024];
+#endif
+CNF_PARAMS ConfigureParams;
+CLOCKS_STRUCT MachineClocks;
+Uint64 CyclesGlobalClockCounter;
+int nAudioFrequency = 44100;
+Sint16 AudioMixBuffer[AUDIOMIXBUFFER_SIZE][2];
+int PendingInterruptCount;
+int CurrentInstrCycles;
+struct regstruct regs;
+FILE *TraceFile;
+Uint64 LogTraceFlags;
+MFP_STRUCT *pMFP_Main;
+int DMA_MaskAddressHigh(void) { return 0x3f; }
+void Log_Printf(LOGTYPE nType, const char *psFormat, ...) { }
+void MemorySnapShot_Store(void *pData, int Size) { }
+bool Microphone_Start(int sampleRate) { return false; }
+void Sound_Update(Uint64 CPU_Clock) { }
+void DmaSnd_Info(FILE *fp, Uint32 dummy) { }
+
+/* what the crossbar does, in order */
+enum { EV_DMA_READ, EV_DMA_WRITE, EV_SNDINT, EV_SOUNDINT, EV_SSI_TX, EV_SSI_RX,
+       EV_FRAME_COUNT, EV_SAMPLES, EV_DAC_STATE };
+
+typedef struct {
+	Uint64 clock;
+	int type;
+	Uint32 value;
+} event_t;
+
+#define MAX_EVENTS	(4*1024*1024)
+
+static event_t *events;
+static int nEvents;
+static bool bLogTransfers = true;
+
+static void log_event(int type, Uint32 value)
+{
+	if (nEvents < MAX_EVENTS) {
+		events[nEvents].clock = CyclesGlobalClockCounter;
+		events[nEvents].type = type;
+		events[nEvents].value = value;
+	}
+	nEvents++;
+}
+
+/* DMA sound data, a mix of sine waves */
+static Uint8 memory[0x10000];
+
+Uint16 STMemory_DMA_ReadWord(Uint32 addr)
+{
+	if (bLogTransfers)
+		log_event(EV_DMA_READ, addr);
+	return memory[addr & 0xffff] << 8 | memory[(addr + 1) & 0xffff];
+}
+Uint8 STMemory_DMA_ReadByte(Uint32 addr)
+{
+	if (bLogTransfers)
+		log_event(EV_DMA_READ, addr);
+	return memory[addr & 0xffff];
+}
+void STMemory_DMA_WriteWord(Uint32 addr, Uint16 value)
+{
+	log_event(EV_DMA_WRITE, addr << 16 | value);
+}
+void STMemory_DMA_WriteByte(Uint32 addr, Uint8 value)
+{
+	log_event(EV_DMA_WRITE, addr << 16 | value);
+}
+
+void MFP_GPIP_Set_Line_Input(MFP_STRUCT *pMFP, Uint8 LineNr, Uint8 Bit)
+{
+	log_event(EV_SNDINT, Bit);
+}
+void MFP_TimerA_Set_Line_Input(MFP_STRUCT *pMFP, Uint8 Bit)
+{
+	log_event(EV_SOUNDINT, Bit);
+}
+
+/* DSP SSI, transmitting a counter */
+static Uint32 ssi_tx;
+Uint32 DSP_SsiReadTxValue(void) { log_event(EV_SSI_TX, ssi_tx); return ssi_tx++ * 0x123; }
+void DSP_SsiWriteRxValue(Uint32 value) { log_event(EV_SSI_RX, value); }
+void DSP_SsiReceive_SC0(void) { }
+void DSP_SsiReceive_SC1(Uint32 value) { }
+void DSP_SsiReceive_SC2(Uint32 value) { }
+void DSP_SsiReceive_SCK(void) { }
+
+/* interrupts, in CPU cycles */
+static Uint64 int_time[MAX_INTERRUPTS];
+static bool int_active[MAX_INTERRUPTS];
+static interrupt_id int_current;
+
+Uint64 Cycles_GetClockCounterImmediate(void) { return CyclesGlobalClockCounter; }
+Uint64 Cycles_GetClockCounterOnWriteAccess(void) { return CyclesGlobalClockCounter; }
+int Cycles_GetCounter(int nId) { return 0; }
+void CycInt_AddRelativeInterrupt(int CycleTime, int CycleType, interrupt_id Handler)
+{
+	int_time[Handler] = CyclesGlobalClockCounter + CycleTime;
+	int_active[Handler] = true;
+}
+void CycInt_AcknowledgeInterrupt(void)
+{
+	int_active[int_current] = false;
+}
+static int nInterrupts;
+
+/* run CPU for given number of cycles, as instructions of random length */
+static Uint32 cpu_seed;
+static void run_cpu(Uint32 cycles)
+{
+	Uint64 end = CyclesGlobalClockCounter + cycles;
+	interrupt_id id;
+
+	while (CyclesGlobalClockCounter < end) {
+		cpu_seed = cpu_seed * 1103515245 + 12345;
+		CyclesGlobalClockCounter += 4 + ((cpu_seed >> 16) % 16) * 4;
+
+		/* interrupts happen between instructions, the earliest first */
+		for (;;) {
+			if (int_active[INTERRUPT_CROSSBAR_25MHZ] &&
+			    (!int_active[INTERRUPT_CROSSBAR_32MHZ] ||
+			     int_time[INTERRUPT_CROSSBAR_25MHZ] <= int_time[INTERRUPT_CROSSBAR_32MHZ]))
+				id = INTERRUPT_CROSSBAR_25MHZ;
+			else if (int_active[INTERRUPT_CROSSBAR_32MHZ])
+				id = INTERRUPT_CROSSBAR_32MHZ;
+			else
+				break;
+			if (int_time[id] > CyclesGlobalClockCounter)
+				break;
+			PendingInterruptCount = INT_CONVERT_TO_INTERNAL((Sint64)int_time[id] - (Sint64)CyclesGlobalClockCounter, INT_CPU_CYCLE);
+			int_current = id;
+			nInterrupts++;
+			if (id == INTERRUPT_CROSSBAR_25MHZ)
+				Crossbar_InterruptHandler_25Mhz();
+			else
+				Crossbar_InterruptHandler_32Mhz();
+		}
+	}
+}
+
+
+/* ---------------------------------------------------------------------- */
+
+static Uint32 seed;
+
+static int rnd(int max)
+{
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 8) % max;
+}
+
+static void write_byte(Uint32 addr, Uint8 value, void (*handler)(void))
+{
+	IoMem[addr] = value;
+	if (handler)
+		handler();
+}
+
+static void write_word(Uint32 addr, Uint16 value, void (*handler)(void))
+{
+	IoMem[addr] = value >> 8;
+	IoMem[addr + 1] = value;
+	handler();
+}
+
+static void set_frame(Uint32 start, Uint32 end)
+{
+	write_byte(0xff8903, start >> 16, Crossbar_FrameStartHigh_WriteByte);
+	write_byte(0xff8905, start >> 8, Crossbar_FrameStartMed_WriteByte);
+	write_byte(0xff8907, start, Crossbar_FrameStartLow_WriteByte);
+	write_byte(0xff890f, end >> 16, Crossbar_FrameEndHigh_WriteByte);
+	write_byte(0xff8911, end >> 8, Crossbar_FrameEndMed_WriteByte);
+	write_byte(0xff8913, end, Crossbar_FrameEndLow_WriteByte);
+}
+
+static void read_frame_count(void)
+{
+	Crossbar_FrameCountHigh_ReadByte();
+	Crossbar_FrameCountMed_ReadByte();
+	Crossbar_FrameCountLow_ReadByte();
+	log_event(EV_FRAME_COUNT, IoMem[0xff8909] << 16 | IoMem[0xff890b] << 8 | IoMem[0xff890d]);
+}
+
+static int idx;
+
+static void generate_samples(int count)
+{
+	Uint32 sum = 0;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		int n = (idx + i) & AUDIOMIXBUFFER_SIZE_MASK;
+		AudioMixBuffer[n][0] = AudioMixBuffer[n][1] = i * 37;
+	}
+	Crossbar_GenerateSamples(idx, count);
+	log_event(EV_DAC_STATE, dac.writePosition << 16 | adc.readPosition);
+	for (i = 0; i < count; i++) {
+		int n = (idx + i) & AUDIOMIXBUFFER_SIZE_MASK;
+		sum = sum * 31 + (Uint16)AudioMixBuffer[n][0];
+		sum = sum * 31 + (Uint16)AudioMixBuffer[n][1];
+	}
+	idx = (idx + count) & AUDIOMIXBUFFER_SIZE_MASK;
+	log_event(EV_SAMPLES, sum);
+}
+
+static void reset(Uint32 maxTicks)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(memory); i++)
+		memory[i] = 60 * sin(i * 0.07) + 60 * sin(i * 0.0031);
+	memset(&crossbar, 0, sizeof(crossbar));
+	memset(&dmaPlay, 0, sizeof(dmaPlay));
+	memset(&dmaRecord, 0, sizeof(dmaRecord));
+	memset(&dspXmit, 0, sizeof(dspXmit));
+	memset(&dspReceive, 0, sizeof(dspReceive));
+	memset(&dac, 0, sizeof(dac));
+	memset(&adc, 0, sizeof(adc));
+	memset(int_active, 0, sizeof(int_active));
+	CyclesGlobalClockCounter = 0;
+	ssi_tx = 0;
+	idx = 0;
+	nEvents = 0;
+	nInterrupts = 0;
+
+	MachineClocks.CPU_Freq_Emul = 16108800;
+	nMaxBlockTicks = maxTicks;
+	Crossbar_Reset(true);
+	/* DSP tristated, DMA play to DAC and DMA record */
+	write_word(0xff8930, 0x0000, Crossbar_SrcControler_WriteWord);
+	write_word(0xff8932, 0x0000, Crossbar_DstControler_WriteWord);
+}
+
+/* random crossbar setup changes, frame counter reads and sample generation */
+static void run_scenario(Uint32 maxTicks, Uint32 scenario_seed, int steps)
+{
+	static const Uint16 dests[] = {
+		0x0000, 0x0001 | 0x0000, 0x0000 | 0x0080,	/* DMA play to DAC, DMA record, DSP */
+		0x2000 | 0x0080 | 0x0010, 0x2000 | 0x0002,	/* DSP to DAC, DSP to DMA record */
+		0x6000 | 0x0066, 0x6000 | 0x00e6,		/* ADC to DAC, DMA record, DSP */
+		0x0006, 0x0006 | 0x0080				/* ADC to DMA record */
+	};
+	Uint32 start;
+	int step;
+
+	seed = scenario_seed;
+	cpu_seed = scenario_seed;
+	reset(maxTicks);
+
+	for (step = 0; step < steps; step++) {
+		run_cpu(rnd(4000));
+
+		switch (rnd(16)) {
+		case 0:	/* DMA play / record start, stop */
+			start = rnd(0x8000) & ~1;
+			set_frame(start, start + 2 + (rnd(0x800) & ~1));
+			write_byte(0xff8901, rnd(2) ? 0x80 : 0x00, Crossbar_DmaCtrlReg_WriteByte);
+			write_byte(0xff8901, rnd(4) ? rnd(0x40) & 0x33 : 0, Crossbar_DmaCtrlReg_WriteByte);
+			break;
+		case 1:	/* frame for next loop */
+			start = rnd(0x8000) & ~1;
+			set_frame(start, start + 2 + (rnd(0x400) & ~1));
+			break;
+		case 2:
+			write_byte(0xff8900, rnd(16), Crossbar_BufferInter_WriteByte);
+			break;
+		case 3:
+			write_byte(0xff8921, (rnd(3) << 6) | rnd(4), Crossbar_SoundModeCtrl_WriteByte);
+			break;
+		case 4:
+			write_byte(0xff8935, rnd(4) ? rnd(6) : rnd(16), Crossbar_FreqDivInt_WriteByte);
+			break;
+		case 5:	/* DSP tristated or not, DMA play and DSP on 25 or 32 Mhz clock */
+			write_word(0xff8930, (rnd(2) << 7) | (rnd(2) << 6) | (rnd(2) << 4) |
+				   (rnd(2) << 2) | 1, Crossbar_SrcControler_WriteWord);
+			break;
+		case 6:
+			write_word(0xff8932, dests[rnd(ARRAY_SIZE(dests))], Crossbar_DstControler_WriteWord);
+			break;
+		case 7:
+			write_byte(0xff8920, rnd(4), Crossbar_DmaTrckCtrl_WriteByte);
+			break;
+		case 8: case 9: case 10:
+			read_frame_count();
+			break;
+		default:
+			generate_samples(rnd(1000) + 1);
+			break;
+		}
+	}
+	run_cpu(100000);
+	generate_samples(500);
+}
+
+/* events are compared in separate streams: DMA reads, DMA writes and the rest */
+static int stream_of(const event_t *ev)
+{
+	return ev->type == EV_DMA_READ || ev->type == EV_DMA_WRITE ? ev->type : -1;
+}
+
+static int compare_events(Uint32 scenario_seed, const event_t *expect, int nExpect, int stream)
+{
+	bool dma = stream >= 0;
+	int i = 0, j = 0;
+
+	for (;;) {
+		while (i < nEvents && stream_of(&events[i]) != stream)
+			i++;
+		while (j < nExpect && stream_of(&expect[j]) != stream)
+			j++;
+		if (i >= nEvents || j >= nExpect)
+			break;
+		/* DMA transfers may be done later in block mode, but in same order */
+		if (events[i].type != expect[j].type || events[i].value != expect[j].value ||
+		    (dma ? events[i].clock < expect[j].clock : events[i].clock != expect[j].clock)) {
+			fprintf(stderr, "ERROR: seed %u: event %d is %d:0x%x at %"PRIu64
+				" instead of %d:0x%x at %"PRIu64"\n", scenario_seed, i,
+				events[i].type, events[i].value, events[i].clock,
+				expect[j].type, expect[j].value, expect[j].clock);
+			return 1;
+		}
+		i++;
+		j++;
+	}
+	return 0;
+}
+
+static int compare_runs(Uint32 scenario_seed, int steps)
+{
+	static event_t expect[MAX_EVENTS];
+	int nExpect, nTicksInts;
+
+	run_scenario(1, scenario_seed, steps);
+	nExpect = nEvents < MAX_EVENTS ? nEvents : MAX_EVENTS;
+	memcpy(expect, events, nExpect * sizeof(event_t));
+	nTicksInts = nInterrupts;
+
+	run_scenario(CROSSBAR_BLOCK_TICKS, scenario_seed, steps);
+	if (nEvents != nExpect) {
+		fprintf(stderr, "ERROR: seed %u: %d events in block mode instead of %d\n",
+			scenario_seed, nEvents, nExpect);
+		return 1;
+	}
+	/* DMA transfers of a block can move past events of the other clock */
+	if (compare_events(scenario_seed, expect, nExpect, EV_DMA_READ) ||
+	    compare_events(scenario_seed, expect, nExpect, EV_DMA_WRITE) ||
+	    compare_events(scenario_seed, expect, nExpect, -1))
+		return 1;
+	fprintf(stderr, "- seed %u: %d events, %d interrupts per tick, %d in blocks\n",
+		scenario_seed, nExpect, nTicksInts, nInterrupts);
+	return 0;
+}
+
+/* play 50 kHz 16-bit stereo DMA sound in a loop, return used CPU time in ms */
+static long bench_mode(Uint32 maxTicks, int seconds)
+{
+	clock_t start;
+	int vbl;
+
+	bLogTransfers = false;
+	seed = cpu_seed = 1;
+	reset(maxTicks);
+	write_word(0xff8930, 0x0001, Crossbar_SrcControler_WriteWord);
+	/* DMA play to DAC, no handshake, DSP receive tristated */
+	write_word(0xff8932, 0x0011, Crossbar_DstControler_WriteWord);
+	write_byte(0xff8921, 0x40 | 3, Crossbar_SoundModeCtrl_WriteByte);
+	set_frame(0, 0x8000);
+	write_byte(0xff8901, CROSSBAR_SNDCTRL_PLAY | CROSSBAR_SNDCTRL_PLAYLOOP, Crossbar_DmaCtrlReg_WriteByte);
+
+	start = clock();
+	for (vbl = 0; vbl < seconds * 50; vbl++) {
+		run_cpu(MachineClocks.CPU_Freq_Emul / 50);
+		generate_samples(nAudioFrequency / 50);
+	}
+	bLogTransfers = true;
+	return (clock() - start) * 1000 / CLOCKS_PER_SEC;
+}
+
+int main(int argc, const char *argv[])
+{
+	int i, seconds = 0, errors = 0;
+	long ms;
+
+	events = malloc(MAX_EVENTS * sizeof(event_t));
+	if (!events)
+		return 1;
+
+	if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+		seconds = argc > 2 ? atoi(argv[2]) : 60;
+		ms = bench_mode(1, seconds);
+		fprintf(stderr, "  interrupt per tick: %5ld ms (%d interrupts) for %d s of 50 kHz DMA sound\n",
+			ms, nInterrupts, seconds);
+		ms = bench_mode(CROSSBAR_BLOCK_TICKS, seconds);
+		fprintf(stderr, "  ticks in blocks   : %5ld ms (%d interrupts) for %d s of 50 kHz DMA sound\n",
+			ms, nInterrupts, seconds);
+		return 0;
+	}
+
+	for (i = 1; i <= 20; i++)
+		errors += compare_runs(i, 2000);
+
+	if (errors) {
+		fprintf(stderr, "\n***Detected %d ERRORs in crossbar block mode!***\n\n", errors);
+	} else {
+		fprintf(stderr, "\nFinished without any errors!\n\n");
+	}
+	return errors;
+}
@@ -0,0 +1,414 @@
+/*
+ * Code to test and benchmark Hatari STE DMA sound generation in src/dmaSnd.c
+ *
+ * Checks that the block based DmaSnd_GenerateSamples() gives exactly the
+ * same samples and DMA state as the previous implementation handling one
+ * sample at a time, with random DMA and LMC1992 settings and random call
+ * sizes, for all the LMC1992 filtering kernels supported on the host.
+ * With "--bench [seconds]" argument, times both implementations
+ * generating given amount of sound (default 10 minutes).
+ */
+#include <stdio.h>
+#include <time.h>
+
+/* dmaSnd.c is included to access its internal state */
+#include "../../src/dmaSnd.c"
+
+/* fake stuff needed by dmaSnd.c */
+CNF_PARAMS ConfigureParams;
+#if ENABLE_SMALL_MEM
+static Uint8 iomem[0x10000];
+uae_u8 *IOmemory = iomem;
+#else
+Uint8 STRam[16*1024*1024];
+#endif
+Uint64 CyclesGlobalClockCounter;
+int nAudioFrequency = 44100;
+int YM2149_HPF_Filter;
+Sint16 AudioMixBuffer[AUDIOMIXBUFFER_SIZE][2];
+int nCpuFreqShift;
+int nHBL;
+int nVBLs;
+void CycInt_AddRelativeInterrupt(int CycleTime, int CycleType, interrupt_id Handler) { }
+void CycInt_AcknowledgeInterrupt(void) { }
+int Cycles_GetCounter(int nId) { return 0; }
+Uint64 Cycles_GetClockCounterOnWriteAccess(void) { return 0; }
+int CurrentInstrCycles;
+int PendingInterruptCount;
+int DMA_MaskAddressHigh(void) { return 0x3f; }
+void Crossbar_InterruptHandler_Microwire(void) { }
+struct regstruct regs;
+FILE *TraceFile;
+Uint64 LogTraceFlags;
+void Log_Printf(LOGTYPE nType, const char *psFormat, ...) { }
+void MemorySnapShot_Store(void *pData, int Size) { }
+void MFP_GPIP_Set_Line_Input(MFP_STRUCT *pMFP, Uint8 LineNr, Uint8 Bit) { }
+void MFP_TimerA_Set_Line_Input(MFP_STRUCT *pMFP, Uint8 Bit) { }
+MFP_STRUCT *pMFP_Main;
+void Sound_Update(Uint64 CPU_Clock) { }
+void Video_GetPosition(int *pFrameCycles, int *pHBL, int *pLineCycles)
+	{ *pFrameCycles = *pHBL = *pLineCycles = 0; }
+
+/* DMA sound data, a mix of sine waves */
+static Uint8 memory[0x10000];
+
+Uint8 STMemory_DMA_ReadByte(Uint32 addr)
+{
+	return memory[addr & 0xffff];
+}
+
+
+/* ---------------------------------------------------------------------- */
+/* previous implementation, using its own filter states */
+
+static float ref_iir[2][2];
+static Sint16 ref_lowpass[2][2];
+static yms32 ref_hpf[2][3];
+
+static ymsample ref_hpf_filter(int c, ymsample x0)
+{
+	yms32 *x1 = &ref_hpf[c][0], *y1 = &ref_hpf[c][1], *y0 = &ref_hpf[c][2];
+
+	if ( YM2149_HPF_Filter == YM2149_HPF_FILTER_NONE )
+		return x0;
+
+	*y1 += ((x0 - *x1)<<15) - (*y0<<6);  /*  64*y0  */
+	*y0 = *y1>>15;
+	*x1 = x0;
+
+	return *y0;
+}
+
+static float ref_iir_filter(int c, float xn)
+{
+	float *data = ref_iir[c];
+	float a, yn;
+
+	a  = (c ? lmc1992.right_gain : lmc1992.left_gain) * xn;
+	a -= lmc1992.coef[0] * data[0];
+	a -= lmc1992.coef[1] * data[1];
+	yn  = lmc1992.coef[2] * a;
+	yn += lmc1992.coef[3] * data[0];
+	yn += lmc1992.coef[4] * data[1];
+
+	data[1] = data[0];
+	data[0] = a;
+	return yn;
+}
+
+static Sint16 ref_lowpass_filter(int c, Sint16 in)
+{
+	Sint16 *lowPassFilter = ref_lowpass[c];
+	Sint16 out;
+
+	if (DmaSnd_LowPass)
+		out = lowPassFilter[0] + (lowPassFilter[1]<<1) + in;
+	else
+		out = lowPassFilter[1] << 2;
+
+	lowPassFilter[0] = lowPassFilter[1];
+	lowPassFilter[1] = in;
+
+	return out;
+}
+
+static void ref_apply_lmc(int nMixBufIdx, int nSamplesToGenerate)
+{
+	int nBufIdx, i, c;
+	Sint32 sample;
+
+	for (i = 0; i < nSamplesToGenerate; i++) {
+		nBufIdx = (nMixBufIdx + i) & AUDIOMIXBUFFER_SIZE_MASK;
+		for (c = 0; c < 2; c++) {
+			sample = ref_iir_filter(c, ref_hpf_filter(c, AudioMixBuffer[nBufIdx][c]));
+			if (sample<-32767)
+				sample = -32767;
+			else if (sample>32767)
+				sample = 32767;
+			AudioMixBuffer[nBufIdx][c] = sample;
+		}
+	}
+}
+
+static void ref_pull_frame(void)
+{
+	Sint8 left, right;
+
+	left = DmaSnd_FIFO_PullByte();
+	right = (dma.soundMode & DMASNDMODE_MONO) ? left : DmaSnd_FIFO_PullByte();
+	dma.FrameLeft  = ref_lowpass_filter(0, left);
+	dma.FrameRight = ref_lowpass_filter(1, right);
+}
+
+static void reference_samples(int nMixBufIdx, int nSamplesToGenerate)
+{
+	int i, nBufIdx;
+	unsigned n;
+	Sint64 FreqRatio;
+
+	if ( !(nDmaSoundControl & DMASNDCTRL_PLAY) && ( dma.FIFO_NbBytes == 0 ) )
+	{
+		for (i = 0; i < nSamplesToGenerate; i++)
+		{
+			nBufIdx = (nMixBufIdx + i) & AUDIOMIXBUFFER_SIZE_MASK;
+			if (microwire.mixing == 1) {
+				AudioMixBuffer[nBufIdx][0] = AudioMixBuffer[nBufIdx][0] + dma.FrameLeft * -((256*3/4)/4)/4;
+				AudioMixBuffer[nBufIdx][1] = AudioMixBuffer[nBufIdx][1] + dma.FrameRight * -((256*3/4)/4)/4;
+			} else {
+				AudioMixBuffer[nBufIdx][0] = dma.FrameLeft * -((256*3/4)/4)/4;
+				AudioMixBuffer[nBufIdx][1] = dma.FrameRight * -((256*3/4)/4)/4;
+			}
+		}
+		ref_apply_lmc(nMixBufIdx, nSamplesToGenerate);
+		return;
+	}
+
+	DmaSnd_LowPass = DmaSnd_DetectSampleRate() > nAudioFrequency;
+	FreqRatio = ( ((Sint64)DmaSnd_DetectSampleRate()) << 32 ) / nAudioFrequency;
+
+	for (i = 0; i < nSamplesToGenerate; i++)
+	{
+		if ( DmaInitSample )
+		{
+			ref_pull_frame();
+			DmaInitSample = false;
+		}
+
+		nBufIdx = (nMixBufIdx + i) & AUDIOMIXBUFFER_SIZE_MASK;
+
+		if (microwire.mixing == 1)
+			AudioMixBuffer[nBufIdx][0] = AudioMixBuffer[nBufIdx][0] + dma.FrameLeft * -((256*3/4)/4)/4;
+		else
+			AudioMixBuffer[nBufIdx][0] = dma.FrameLeft * -((256*3/4)/4)/4;
+
+		if (dma.soundMode & DMASNDMODE_MONO)
+			AudioMixBuffer[nBufIdx][1] = AudioMixBuffer[nBufIdx][0];
+		else if (microwire.mixing == 1)
+			AudioMixBuffer[nBufIdx][1] = AudioMixBuffer[nBufIdx][1] + dma.FrameRight * -((256*3/4)/4)/4;
+		else
+			AudioMixBuffer[nBufIdx][1] = dma.FrameRight * -((256*3/4)/4)/4;
+
+		frameCounter_float += FreqRatio;
+		n = frameCounter_float >> 32;
+		while ( n > 0 )
+		{
+			ref_pull_frame();
+			n--;
+		}
+		frameCounter_float &= 0xffffffff;
+	}
+
+	ref_apply_lmc(nMixBufIdx, nSamplesToGenerate);
+}
+
+
+/* ---------------------------------------------------------------------- */
+
+static Uint32 seed = 1;
+
+static int rnd(int max)
+{
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 8) % max;
+}
+
+static void reset_state(void)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(memory); i++)
+		memory[i] = 60 * sin(i * 0.07) + 60 * sin(i * 0.0031);
+
+	memset(&filter, 0, sizeof(filter));
+	memset(ref_iir, 0, sizeof(ref_iir));
+	memset(ref_lowpass, 0, sizeof(ref_lowpass));
+	memset(ref_hpf, 0, sizeof(ref_hpf));
+	memset(&dma, 0, sizeof(dma));
+	nDmaSoundControl = 0;
+	frameCounter_float = 0;
+	DmaInitSample = false;
+}
+
+/* start playing DMA sound from random address with given mode */
+static void start_dma(Uint16 mode, Uint16 control)
+{
+	Uint32 start = rnd(0x8000) & ~1, end = start + 2 + (rnd(0x4000) & ~1);
+
+	IoMem[0xff8903] = start >> 16;
+	IoMem[0xff8905] = start >> 8;
+	IoMem[0xff8907] = start;
+	IoMem[0xff890f] = end >> 16;
+	IoMem[0xff8911] = end >> 8;
+	IoMem[0xff8913] = end;
+	dma.soundMode = mode;
+	nDmaSoundControl = control;
+	if (control & DMASNDCTRL_PLAY) {
+		DmaSnd_StartNewFrame();
+		frameCounter_float = 0;
+		DmaInitSample = true;
+	}
+}
+
+/* random LMC1992 settings, volume above -40dB to get non-zero samples */
+static void set_lmc(void)
+{
+	static const int freqs[] = { 11025, 22050, 25033, 32000, 44100, 48000, 50066 };
+
+	nAudioFrequency = freqs[rnd(ARRAY_SIZE(freqs))];
+	microwire.mixing = rnd(4);
+	microwire.bass = rnd(13);
+	microwire.treble = rnd(13);
+	microwire.masterVolume = LMC1992_Master_Volume_Table[44 + rnd(20)];
+	microwire.leftVolume = LMC1992_LeftRight_Volume_Table[12 + rnd(20)];
+	microwire.rightVolume = LMC1992_LeftRight_Volume_Table[12 + rnd(20)];
+	DmaSnd_Init_Bass_and_Treble_Tables();
+	YM2149_HPF_Filter = rnd(2) ? YM2149_HPF_FILTER_IIR : YM2149_HPF_FILTER_NONE;
+}
+
+/* random YM2149 samples, sometimes loud enough to be clipped */
+static void fill_ym(int idx, int count)
+{
+	int i, amp = rnd(2) ? 8000 : 32767;
+
+	for (i = 0; i < count; i++) {
+		idx &= AUDIOMIXBUFFER_SIZE_MASK;
+		AudioMixBuffer[idx][0] = AudioMixBuffer[idx][1] = rnd(2 * amp) - amp;
+		idx++;
+	}
+}
+
+static int test_kernel(const char *name)
+{
+	static Sint16 ymbuf[AUDIOMIXBUFFER_SIZE][2], expect[AUDIOMIXBUFFER_SIZE][2];
+	struct dma_s dma_before, dma_expect;
+	Sint64 counter_before, counter_expect;
+	bool init_before, init_expect;
+	Uint16 control_before;
+	int round, idx, count, i, errors = 0;
+
+	reset_state();
+	for (round = 0; round < 3000; round++) {
+		if (rnd(8) == 0)
+			set_lmc();
+		if (rnd(8) == 0)
+			start_dma(rnd(4) | (rnd(2) ? DMASNDMODE_MONO : 0),
+				  rnd(6) ? DMASNDCTRL_PLAY | (rnd(2) ? DMASNDCTRL_PLAYLOOP : 0) : 0);
+
+		/* also blocks crossing the end of the ring buffer */
+		idx = rnd(4) ? rnd(AUDIOMIXBUFFER_SIZE) : AUDIOMIXBUFFER_SIZE - 1 - rnd(300);
+		count = rnd(8) ? rnd(1200) + 1 : rnd(AUDIOMIXBUFFER_SIZE / 2);
+		fill_ym(idx, count);
+
+		memcpy(ymbuf, AudioMixBuffer, sizeof(ymbuf));
+		dma_before = dma;
+		counter_before = frameCounter_float;
+		init_before = DmaInitSample;
+		control_before = nDmaSoundControl;
+
+		reference_samples(idx, count);
+		memcpy(expect, AudioMixBuffer, sizeof(expect));
+		dma_expect = dma;
+		counter_expect = frameCounter_float;
+		init_expect = DmaInitSample;
+
+		memcpy(AudioMixBuffer, ymbuf, sizeof(ymbuf));
+		dma = dma_before;
+		frameCounter_float = counter_before;
+		DmaInitSample = init_before;
+		nDmaSoundControl = control_before;
+
+		DmaSnd_GenerateSamples(idx, count);
+
+		for (i = 0; i < count; i++) {
+			int n = (idx + i) & AUDIOMIXBUFFER_SIZE_MASK;
+			if (AudioMixBuffer[n][0] != expect[n][0] ||
+			    AudioMixBuffer[n][1] != expect[n][1]) {
+				fprintf(stderr, "ERROR: %s kernel, round %d: sample %d/%d is %d/%d instead of %d/%d\n",
+					name, round, i, count, AudioMixBuffer[n][0], AudioMixBuffer[n][1],
+					expect[n][0], expect[n][1]);
+				errors++;
+				break;
+			}
+		}
+		if (memcmp(&dma, &dma_expect, sizeof(dma)) != 0 ||
+		    frameCounter_float != counter_expect || DmaInitSample != init_expect) {
+			fprintf(stderr, "ERROR: %s kernel, round %d: DMA state differs after %d samples\n",
+				name, round, count);
+			errors++;
+		}
+		if (errors > 10)
+			break;
+	}
+	return errors;
+}
+
+/* time both implementations playing with given DMA sound mode */
+static void bench_mode(const char *desc, Uint16 mode, Uint16 control, int mixing, int seconds)
+{
+	clock_t start;
+	long ms_ref, ms_new;
+	int i, frame = nAudioFrequency / 50;
+
+	reset_state();
+	microwire.mixing = mixing;
+	YM2149_HPF_Filter = YM2149_HPF_FILTER_IIR;
+	DmaSnd_Init_Bass_and_Treble_Tables();
+	fill_ym(0, AUDIOMIXBUFFER_SIZE);
+
+	/* 50 calls per second (one per VBL) */
+	start_dma(mode, control);
+	start = clock();
+	for (i = 0; i < seconds * 50; i++)
+		reference_samples(i * frame, frame);
+	ms_ref = (clock() - start) * 1000 / CLOCKS_PER_SEC;
+
+	start_dma(mode, control);
+	start = clock();
+	for (i = 0; i < seconds * 50; i++)
+		DmaSnd_GenerateSamples(i * frame, frame);
+	ms_new = (clock() - start) * 1000 / CLOCKS_PER_SEC;
+
+	fprintf(stderr, "  %-28s: %5ld ms per sample, %5ld ms in blocks, for %d s of sound\n",
+		desc, ms_ref, ms_new, seconds);
+}
+
+static void bench(const char *name, int seconds)
+{
+	const Uint16 play = DMASNDCTRL_PLAY | DMASNDCTRL_PLAYLOOP;
+
+	fprintf(stderr, "- %s kernel\n", name);
+	bench_mode("idle, YM2149 mixing", 0, 0, 1, seconds);
+	bench_mode("50 kHz stereo, DMA only", 3, play, 0, seconds);
+	bench_mode("50 kHz stereo, YM2149 mixing", 3, play, 1, seconds);
+	bench_mode("12 kHz mono, YM2149 mixing", 1 | DMASNDMODE_MONO, play, 1, seconds);
+}
+
+int main(int argc, const char *argv[])
+{
+	int kernel, seconds = 0, errors = 0;
+	const char *name;
+
+	if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+		seconds = argc > 2 ? atoi(argv[2]) : 600;
+
+	for (kernel = DMASND_KERNEL_AUTO + 1; kernel < DMASND_KERNEL_COUNT; kernel++) {
+		name = DmaSnd_SelectKernel(kernel);
+		if (!name)
+			continue;
+		if (seconds) {
+			bench(name, seconds);
+			continue;
+		}
+		fprintf(stderr, "- %s kernel\n", name);
+		errors += test_kernel(name);
+	}
+	if (seconds)
+		return 0;
+
+	if (errors) {
+		fprintf(stderr, "\n***Detected %d ERRORs in DMA sound generation!***\n\n", errors);
+	} else {
+		fprintf(stderr, "\nFinished without any errors!\n\n");
+	}
+	return errors;
+}
@@ -0,0 +1,458 @@
+/*
+ * Code to test and benchmark Hatari YM2149 sample generation in src/sound.c
+ *
+ * Checks that the edge-skipping YM2149_DoSamples_250() gives exactly the
+ * same 250 kHz samples and internal counter states as the previous
+ * implementation running every single YM2149 cycle, with random register
+ * writes and all the low pass filter settings.
+ * Also measures pass band gain and alias rejection of the resampling
+ * methods at 44.1, 48 and 96 kHz, and checks that the polyphase FIR
+ * resampler keeps the gain within 0.1 dB and rejects aliases by 70 dB.
+ * With "--bench [seconds]" argument, times both implementations with
+ * a few typical register settings, and the resampling methods.
+ */
+#include <stdio.h>
+#include <time.h>
+#include <math.h>
+
+/* sound.c is included to access its internal state */
+#include "../../src/sound.c"
+
+/* fake stuff needed by sound.c */
+CNF_PARAMS ConfigureParams;
+CLOCKS_STRUCT MachineClocks;
+Uint64 CyclesGlobalClockCounter;
+int nAudioFrequency = 44100;
+int SoundBufferSize = 1024;
+int nScreenRefreshRate = 50;
+bool bFastForwardTurbo, bAudioOffline, bRecordingAvi, bRecordingWav, bRecordingYM, bRecordingYMDump;
+void Audio_Lock(void) { }
+void Audio_Unlock(void) { }
+void Audio_GetStats(AUDIO_STATS *pStats) { memset(pStats, 0, sizeof(*pStats)); }
+bool Avi_RecordAudioStream(Sint16 pSamples[][2], int SampleIndex, int SampleLength) { return true; }
+Uint32 ClocksTimings_GetVBLPerSec(MACHINETYPE MachineType, int ScreenRefreshRate) { return 50 << CLOCKS_TIMINGS_SHIFT_VBL; }
+void ClocksTimings_ConvertCycles(Uint32 CyclesIn, Uint64 ClockFreqIn, CLOCKS_CYCLES_STRUCT *CyclesStructOut, Uint64 ClockFreqOut) { }
+void Crossbar_GenerateSamples(int nMixBufIdx, int nSamplesToGenerate) { }
+void Cycles_SetCounter(int nId, int nValue) { }
+void DmaSnd_GenerateSamples(int nMixBufIdx, int nSamplesToGenerate) { }
+bool File_DoesFileExtensionMatch(const char *pszFileName, const char *pszExtension) { return false; }
+FILE *File_Close(FILE *fp) { return NULL; }
+FILE *File_Open(const char *path, const char *mode) { return NULL; }
+void Log_AlertDlg(LOGTYPE nType, const char *psFormat, ...) { }
+void Log_Printf(LOGTYPE nType, const char *psFormat, ...) { }
+void MemorySnapShot_Store(void *pData, int Size) { }
+bool WAVFormat_OpenFile(char *pszWavFileName) { return false; }
+void WAVFormat_CloseFile(void) { }
+void WAVFormat_Update(Sint16 pSamples[][2], int Index, int Length) { }
+bool YMFormat_BeginRecording(const char *pszYMFileName) { return false; }
+void YMFormat_EndRecording(void) { }
+bool YMFormat_BeginDump(const char *filename) { return false; }
+void YMFormat_EndDump(void) { }
+
+
+/* copies of the filters, with their own state for the reference code */
+static ymsample	RefLowPassFilter(ymsample x0)
+{
+	static	yms32 y0 = 0, x1 = 0;
+
+	if (x0 >= y0)
+		y0 = (3*(x0 + x1) + (y0<<1)) >> 3;
+	else
+		y0 = ((x0 + x1) + (6*y0)) >> 3;
+
+	x1 = x0;
+	return y0;
+}
+
+static ymsample	RefPWMaliasFilter(ymsample x0)
+{
+	static	yms32 y0 = 0, x1 = 0;
+
+	if (x0 >= y0)
+		y0 = x0;
+	else
+		y0 = (3*(x0 + x1) + (y0<<1)) >> 3;
+
+	x1 = x0;
+	return y0;
+}
+
+/* previous YM2149_DoSamples_250(), emulating every single YM2149 cycle */
+static void reference_samples(int SamplesToGenerate_250, ymsample *out)
+{
+	ymsample	sample;
+	ymu32		bt;
+	ymu16		Env3Voices;
+	ymu16		Tone3Voices;
+	int		n;
+
+	for ( n=0 ; n<SamplesToGenerate_250 ; n++ )
+	{
+		Noise_div_2 ^= 1;
+		if ( Noise_div_2 == 0 )
+			Noise_count++;
+		if ( Noise_count >= Noise_per )
+		{
+			Noise_count = 0;
+			Noise_val = YM2149_RndCompute();
+		}
+
+		ToneA_count++;
+		if ( ToneA_count >= ToneA_per )
+		{
+			ToneA_count = 0;
+			ToneA_val ^= YM_SQUARE_UP;
+		}
+
+		ToneB_count++;
+		if ( ToneB_count >= ToneB_per )
+		{
+			ToneB_count = 0;
+			ToneB_val ^= YM_SQUARE_UP;
+		}
+
+		ToneC_count++;
+		if ( ToneC_count >= ToneC_per )
+		{
+			ToneC_count = 0;
+			ToneC_val ^= YM_SQUARE_UP;
+		}
+
+		Env_count += 1;
+		if ( Env_count >= Env_per )
+		{
+			Env_count = 0;
+			Env_pos += 1;
+			if ( Env_pos >= 3*32 )
+				Env_pos -= 2*32;
+		}
+
+		Env3Voices = YmEnvWaves[ Env_shape ][ Env_pos ];
+		Env3Voices &= EnvMask3Voices;
+
+		bt = (ToneA_val | mixerTA) & (Noise_val | mixerNA);
+		Tone3Voices = bt & YM_MASK_1VOICE;
+
+		bt = (ToneB_val | mixerTB) & (Noise_val | mixerNB);
+		Tone3Voices |= ( bt & YM_MASK_1VOICE ) << 5;
+
+		bt = (ToneC_val | mixerTC) & (Noise_val | mixerNC);
+		Tone3Voices |= ( bt & YM_MASK_1VOICE ) << 10;
+
+		Tone3Voices &= ( Env3Voices | Vol3Voices );
+
+		sample = ymout5[ Tone3Voices ];
+
+		if ( YM2149_LPF_Filter == YM2149_LPF_FILTER_LPF_STF )
+			sample = RefLowPassFilter ( sample );
+		else if ( YM2149_LPF_Filter == YM2149_LPF_FILTER_PWM )
+			sample = RefPWMaliasFilter ( sample );
+
+		out[ n ] = sample;
+	}
+}
+
+/* YM2149 state changed by sample generation */
+typedef struct {
+	ymu16 ToneA_count, ToneA_val, ToneB_count, ToneB_val, ToneC_count, ToneC_val;
+	ymu16 Noise_count, Noise_val, Noise_div_2, Env_count;
+	ymu32 Env_pos, RndRack;
+} ym_state_t;
+
+static void save_state(ym_state_t *s)
+{
+	memset(s, 0, sizeof(*s));
+	s->ToneA_count = ToneA_count; s->ToneA_val = ToneA_val;
+	s->ToneB_count = ToneB_count; s->ToneB_val = ToneB_val;
+	s->ToneC_count = ToneC_count; s->ToneC_val = ToneC_val;
+	s->Noise_count = Noise_count; s->Noise_val = Noise_val;
+	s->Noise_div_2 = Noise_div_2; s->Env_count = Env_count;
+	s->Env_pos = Env_pos; s->RndRack = RndRack;
+}
+
+static void restore_state(const ym_state_t *s)
+{
+	ToneA_count = s->ToneA_count; ToneA_val = s->ToneA_val;
+	ToneB_count = s->ToneB_count; ToneB_val = s->ToneB_val;
+	ToneC_count = s->ToneC_count; ToneC_val = s->ToneC_val;
+	Noise_count = s->Noise_count; Noise_val = s->Noise_val;
+	Noise_div_2 = s->Noise_div_2; Env_count = s->Env_count;
+	Env_pos = s->Env_pos; RndRack = s->RndRack;
+}
+
+static Uint32 seed = 1;
+
+static int random_int(int max)
+{
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 8) % max;
+}
+
+/* period register values, biased towards the special small periods */
+static int random_period(int max)
+{
+	switch (random_int(4)) {
+	case 0:
+		return random_int(4);
+	case 1:
+		return random_int(64);
+	default:
+		return random_int(max + 1);
+	}
+}
+
+/* write some random values to YM registers, like a replay routine would */
+static void random_writes(void)
+{
+	int i, writes, per;
+
+	writes = 1 + random_int(6);
+	for (i = 0; i < writes; i++) {
+		switch (random_int(8)) {
+		case 0: case 1:
+			per = random_period(0xfff);
+			Sound_WriteReg(random_int(3) * 2, per & 0xff);
+			Sound_WriteReg(random_int(3) * 2 + 1, per >> 8);
+			break;
+		case 2:
+			Sound_WriteReg(6, random_period(0x1f));
+			break;
+		case 3:
+			Sound_WriteReg(7, random_int(64));
+			break;
+		case 4: case 5:
+			/* fixed volume, envelope or silent voice */
+			Sound_WriteReg(8 + random_int(3),
+			               random_int(3) ? random_int(32) : 0);
+			break;
+		case 6:
+			per = random_period(random_int(2) ? 0x200 : 0xffff);
+			Sound_WriteReg(11, per & 0xff);
+			Sound_WriteReg(12, per >> 8);
+			break;
+		case 7:
+			Sound_WriteReg(13, random_int(16));
+			break;
+		}
+	}
+}
+
+static ymsample ref_buffer[YM_BUFFER_250_SIZE];
+
+static int test_filter(int filter, const char *name)
+{
+	ym_state_t before, after, expect;
+	int i, n, start, round, errors = 0;
+
+	YM2149_LPF_Filter = filter;
+	Ym2149_Reset();
+	for (round = 0; round < 20000 && errors < 10; round++) {
+		random_writes();
+		n = 1 + (random_int(4) ? random_int(300) : random_int(8000));
+
+		save_state(&before);
+		start = YM_Buffer_250_pos_write;
+		YM2149_DoSamples_250(n);
+		save_state(&after);
+
+		restore_state(&before);
+		reference_samples(n, ref_buffer);
+		save_state(&expect);
+
+		for (i = 0; i < n; i++) {
+			if (YM_Buffer_250[(start + i) & YM_BUFFER_250_SIZE_MASK] != ref_buffer[i]) {
+				fprintf(stderr, "ERROR: %s filter, round %d: sample %d/%d is %d instead of %d\n",
+				        name, round, i, n,
+				        YM_Buffer_250[(start + i) & YM_BUFFER_250_SIZE_MASK], ref_buffer[i]);
+				errors++;
+				break;
+			}
+		}
+		if (memcmp(&after, &expect, sizeof(after)) != 0) {
+			fprintf(stderr, "ERROR: %s filter, round %d: YM2149 state differs after %d cycles\n",
+			        name, round, n);
+			errors++;
+		}
+	}
+	return errors;
+}
+
+static const struct {
+	int method;
+	const char *name;
+} resamplers[] = {
+	{ YM2149_RESAMPLE_METHOD_NEAREST, "nearest" },
+	{ YM2149_RESAMPLE_METHOD_WEIGHTED_AVERAGE_2, "weighted average 2" },
+	{ YM2149_RESAMPLE_METHOD_WEIGHTED_AVERAGE_N, "weighted average N" },
+	{ YM2149_RESAMPLE_METHOD_POLYPHASE, "polyphase FIR" },
+};
+static const int resample_freqs[] = { 44100, 48000, 96000 };
+
+#define RESAMPLE_OUT	4096
+static ymsample resample_out[RESAMPLE_OUT];
+
+/* resample a 250 kHz sine of given freq, return output RMS relative to input RMS in dB */
+static double resample_gain(int method, int freq_out, double tone)
+{
+	double mean = 0, sum = 0, amp = 8000;
+	int i, skip = 64;
+
+	for (i = 0; i < YM_BUFFER_250_SIZE; i++)
+		YM_Buffer_250[i] = 16000 + amp * sin(2 * M_PI * tone * i / YM_ATARI_CLOCK_COUNTER);
+
+	nAudioFrequency = freq_out;
+	YM2149_Resample_Method = method;
+	YM_Buffer_250_pos_read = YM2149_POLYPHASE_TAPS_MAX;
+	for (i = 0; i < RESAMPLE_OUT; i++)
+		resample_out[i] = YM2149_NextSample_250();
+
+	/* filter history starts with the sine */
+	for (i = skip; i < RESAMPLE_OUT; i++)
+		mean += resample_out[i];
+	mean /= RESAMPLE_OUT - skip;
+	for (i = skip; i < RESAMPLE_OUT; i++)
+		sum += (resample_out[i] - mean) * (resample_out[i] - mean);
+	return 10 * log10(sum / (RESAMPLE_OUT - skip) / (amp * amp / 2));
+}
+
+static int test_resample(void)
+{
+	static ymsample out_generic[RESAMPLE_OUT];
+	double pass, high, alias;
+	int i, f, errors = 0;
+
+	for (f = 0; f < ARRAY_SIZE(resample_freqs); f++) {
+		int freq = resample_freqs[f];
+		for (i = 0; i < ARRAY_SIZE(resamplers); i++) {
+			/* 1 kHz, top of the pass band and a tone that aliases in the audible range */
+			pass = resample_gain(resamplers[i].method, freq, 1000);
+			high = resample_gain(resamplers[i].method, freq, 0.4 * freq);
+			alias = resample_gain(resamplers[i].method, freq, 0.7 * freq);
+			fprintf(stderr, "  %5d Hz %-18s: %+6.2f dB at 1 kHz, %+6.2f dB at %5d Hz, "
+			        "%+6.1f dB alias of %5d Hz\n", freq, resamplers[i].name,
+			        pass, high, (int)(0.4 * freq), alias, (int)(0.7 * freq));
+			if (resamplers[i].method != YM2149_RESAMPLE_METHOD_POLYPHASE)
+				continue;
+			if (fabs(pass) > 0.1 || fabs(high) > 0.1 || alias > -70) {
+				fprintf(stderr, "ERROR: polyphase FIR at %d Hz doesn't meet its specs\n", freq);
+				errors++;
+			}
+		}
+	}
+
+	/* vectorized dot product needs to give identical results */
+	YM2149_Polyphase_Dot = YM2149_Polyphase_DotGeneric;
+	resample_gain(YM2149_RESAMPLE_METHOD_POLYPHASE, 44100, 12345);
+	memcpy(out_generic, resample_out, sizeof(out_generic));
+	YM2149_Polyphase_FreqOut = 0;		/* rebuild and select best version */
+	resample_gain(YM2149_RESAMPLE_METHOD_POLYPHASE, 44100, 12345);
+	if (memcmp(out_generic, resample_out, sizeof(out_generic)) != 0) {
+		fprintf(stderr, "ERROR: polyphase FIR dot product versions differ\n");
+		errors++;
+	}
+	return errors;
+}
+
+/* time resampling methods at usual host rates */
+static void bench_resample(int seconds)
+{
+	clock_t start;
+	long ms;
+	int f, i, n;
+
+	for (f = 0; f < ARRAY_SIZE(resample_freqs); f++) {
+		for (i = 0; i < ARRAY_SIZE(resamplers); i++) {
+			resample_gain(resamplers[i].method, resample_freqs[f], 3000);
+			start = clock();
+			for (n = 0; n < seconds * resample_freqs[f]; n++) {
+				YM2149_NextSample_250();
+				/* stay in the filled buffer */
+				YM_Buffer_250_pos_read &= YM_BUFFER_250_SIZE_MASK >> 1;
+			}
+			ms = (clock() - start) * 1000 / CLOCKS_PER_SEC;
+			fprintf(stderr, "  %5d Hz %-18s: %5ld ms for %d s of sound\n",
+			        resample_freqs[f], resamplers[i].name, ms, seconds);
+		}
+	}
+}
+
+/* time both implementations with given registers */
+static void bench_regs(const char *desc, const Uint8 *regs, int seconds)
+{
+	clock_t start;
+	long ms_ref, ms_new;
+	int i;
+
+	Ym2149_Reset();
+	for (i = 0; i < 14; i++)
+		Sound_WriteReg(i, regs[i]);
+
+	/* 50 calls per second (one per VBL) */
+	start = clock();
+	for (i = 0; i < seconds * 50; i++)
+		reference_samples(5000, ref_buffer);
+	ms_ref = (clock() - start) * 1000 / CLOCKS_PER_SEC;
+
+	start = clock();
+	for (i = 0; i < seconds * 50; i++) {
+		YM2149_DoSamples_250(5000);
+		YM_Buffer_250_pos_read = YM_Buffer_250_pos_write;
+	}
+	ms_new = (clock() - start) * 1000 / CLOCKS_PER_SEC;
+
+	fprintf(stderr, "  %-22s: %5ld ms per cycle, %5ld ms with edges, for %d s of sound\n",
+	        desc, ms_ref, ms_new, seconds);
+}
+
+static void bench(int seconds)
+{
+	static const struct {
+		const char *desc;
+		Uint8 regs[14];
+	} tests[] = {
+		{ "silent (after reset)", { 0, 0, 0, 0, 0, 0, 0, 0xff, 0, 0, 0, 0, 0, 0 } },
+		{ "3 tones",             { 0x1c, 1, 0xfd, 0, 0xa8, 2, 0, 0xf8, 15, 12, 10, 0, 0, 0 } },
+		{ "3 tones + noise",     { 0x1c, 1, 0xfd, 0, 0xa8, 2, 7, 0xf0, 15, 12, 10, 0, 0, 0 } },
+		{ "tone + buzzer env",   { 0x1c, 1, 0, 0, 0, 0, 0, 0xfe, 0x10, 0, 0, 0x20, 0, 8 } },
+	};
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(tests); i++)
+		bench_regs(tests[i].desc, tests[i].regs, seconds);
+	bench_resample(seconds);
+}
+
+int main(int argc, const char *argv[])
+{
+	static const struct {
+		int filter;
+		const char *name;
+	} filters[] = {
+		{ YM2149_LPF_FILTER_NONE, "no" },
+		{ YM2149_LPF_FILTER_LPF_STF, "STF low pass" },
+		{ YM2149_LPF_FILTER_PWM, "PWM alias" },
+	};
+	int i, errors = 0;
+
+	Ym2149_Init();
+	MachineClocks.YM_Freq = 2000000;
+
+	if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+		bench(argc > 2 ? atoi(argv[2]) : 10);
+		return 0;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(filters); i++) {
+		fprintf(stderr, "- %s filter\n", filters[i].name);
+		errors += test_filter(filters[i].filter, filters[i].name);
+	}
+	fprintf(stderr, "- resampling\n");
+	errors += test_resample();
+
+	if (errors) {
+		fprintf(stderr, "\n***Detected %d ERRORs!***\n\n", errors);
+	} else {
+		fprintf(stderr, "\nFinished without any errors!\n\n");
+	}
+	return errors;
+}
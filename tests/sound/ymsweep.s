@@ -0,0 +1,35 @@
+; Set up all YM2149 registers (tones, noise and envelope) and then
+; keep sweeping the voice A tone period, for testing sound recording.
+; Never exits, use Hatari --run-vbls option to end the test.
+
+	text
+
+	clr.l	-(sp)
+	move.w	#$20,-(sp)
+	trap	#1		; Super
+	addq.l	#6,sp
+
+	lea	regs(pc),a0
+	moveq	#0,d0
+init:
+	move.b	d0,$ffff8800.w	; select register
+	move.b	(a0)+,$ffff8802.w
+	addq.b	#1,d0
+	cmp.b	#14,d0
+	bne.s	init
+
+sweep:
+	move.b	#0,$ffff8800.w	; voice A fine tone period
+	move.b	d0,$ffff8802.w
+	addq.b	#1,d0
+	move.w	#2000,d2
+wait:
+	dbra	d2,wait
+	bra.s	sweep
+
+regs:
+	dc.b	$1c,$01,$fd,$00,$a8,$02	; voice A/B/C tone periods
+	dc.b	$07			; noise period
+	dc.b	$f0			; mixer: all tones and noise on voice A
+	dc.b	$0f,$0c,$10		; voice A/B volume, envelope on voice C
+	dc.b	$20,$00,$0e		; envelope period & triangle shape